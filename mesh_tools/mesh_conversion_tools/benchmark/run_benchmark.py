@@ -0,0 +1,270 @@
+#!/usr/bin/env python
+'''
+Times MpasMeshConverter.x, MpasMaskCreator.x and MpasCellCuller.x stage by
+stage on synthetic meshes, and compares the timings against a stored baseline.
+
+For every benchmark case, MpasGridGenerator.x writes a grid.nc (either a
+quasi-uniform icosahedral sphere or a doubly periodic hex plane), which is then
+converted, masked with the Arctic Ocean region from the test directory
+(spherical cases only) and culled. Each tool is run with --profile, and the
+per-stage wall times of all cases are collected in results.json in the work
+directory.
+
+A stage is reported as a regression when it is slower than the baseline by
+more than the tolerance, and by more than --min-seconds, which keeps very
+short stages from tripping the check on timer noise. The script exits with a
+non-zero status if any stage regressed. Use --update-baseline to replace the
+baseline with the new timings instead.
+
+Timings are only comparable between runs on the same machine with the same
+thread count, so the baseline should be regenerated whenever either changes.
+'''
+
+from __future__ import absolute_import, division, print_function, \
+    unicode_literals
+
+import os
+import sys
+import json
+import platform
+import subprocess
+from argparse import ArgumentParser
+
+
+# name: (generator arguments, spherical)
+# Icosahedral grids have 10 N^2 + 2 cells and hex grids NX x NY cells.
+CASES = {
+    'ico_10k': (['icosahedral', '32'], True),
+    'ico_160k': (['icosahedral', '128'], True),
+    'ico_655k': (['icosahedral', '256'], True),
+    'ico_2.6M': (['icosahedral', '512'], True),
+    'ico_10M': (['icosahedral', '1024'], True),
+    'ico_42M': (['icosahedral', '2048'], True),
+    'hex_10k': (['hex', '100', '100'], False),
+    'hex_160k': (['hex', '400', '400'], False),
+    'hex_640k': (['hex', '800', '800'], False),
+    'hex_2.6M': (['hex', '1600', '1600'], False),
+    'hex_10M': (['hex', '3200', '3200'], False),
+    'hex_50M': (['hex', '7072', '7072'], False),
+}
+
+SIZES = {
+    'small': ['ico_10k', 'hex_10k'],
+    'medium': ['ico_10k', 'ico_160k', 'hex_10k', 'hex_160k'],
+    'large': ['ico_160k', 'ico_655k', 'ico_2.6M', 'hex_160k', 'hex_640k',
+              'hex_2.6M'],
+    'huge': ['ico_2.6M', 'ico_10M', 'ico_42M', 'hex_2.6M', 'hex_10M',
+             'hex_50M'],
+}
+
+
+def run_tool(binDir, tool, args, workDir, logName):
+    '''
+    Runs one of the executables in workDir, sending its output to logName.
+    '''
+    command = [os.path.join(binDir, tool)] + args
+    with open(os.path.join(workDir, logName), 'w') as log:
+        status = subprocess.call(command, cwd=workDir, stdout=log,
+                                 stderr=subprocess.STDOUT)
+    if status != 0:
+        raise RuntimeError('{} failed with status {}, see {}'.format(
+            ' '.join(command), status, os.path.join(workDir, logName)))
+
+
+def read_profile(fileName):
+    '''
+    Returns the wall seconds of each stage in a --profile file, plus the
+    whole run under "total". Stages that run more than once (e.g.
+    mergeCellMasks) are summed.
+    '''
+    with open(fileName) as f:
+        profile = json.load(f)
+
+    times = {}
+    for stage in profile['stages']:
+        times[stage['name']] = times.get(stage['name'], 0.0) + \
+            stage['wall_seconds']
+    times['total'] = profile['total']['wall_seconds']
+    return times, profile['threads']
+
+
+def run_case(name, binDir, workDir, maskFile, threadArgs):
+    '''
+    Generates, converts, masks and culls one benchmark case, returning the
+    stage times of each tool.
+    '''
+    generatorArgs, spherical = CASES[name]
+    caseDir = os.path.join(workDir, name)
+    if not os.path.isdir(caseDir):
+        os.makedirs(caseDir)
+
+    # Generating large grids takes a while, and is not what is measured, so
+    # grids are kept between runs.
+    if not os.path.exists(os.path.join(caseDir, 'grid.nc')):
+        run_tool(binDir, 'MpasGridGenerator.x',
+                 generatorArgs + ['grid.nc', '--format', 'cdf5'], caseDir,
+                 'generator.log')
+
+    results = {}
+
+    run_tool(binDir, 'MpasMeshConverter.x',
+             ['grid.nc', 'mesh.nc', '--profile', 'converter.json',
+              '--format', 'cdf5'] + threadArgs,
+             caseDir, 'converter.log')
+    results['MpasMeshConverter.x'], threads = read_profile(
+        os.path.join(caseDir, 'converter.json'))
+
+    if spherical:
+        # Region masks are defined in lat/lon, so only apply to the sphere.
+        run_tool(binDir, 'MpasMaskCreator.x',
+                 ['mesh.nc', 'masks.nc', '-f', maskFile, '--profile',
+                  'mask_creator.json', '--format', 'cdf5'],
+                 caseDir, 'mask_creator.log')
+        results['MpasMaskCreator.x'], _ = read_profile(
+            os.path.join(caseDir, 'mask_creator.json'))
+        cullerArgs = ['-i', 'masks.nc']
+    else:
+        cullerArgs = []
+
+    run_tool(binDir, 'MpasCellCuller.x',
+             ['mesh.nc', 'culled_mesh.nc'] + cullerArgs +
+             ['--profile', 'culler.json', '--format', 'cdf5'],
+             caseDir, 'culler.log')
+    results['MpasCellCuller.x'], _ = read_profile(
+        os.path.join(caseDir, 'culler.json'))
+
+    return results, threads
+
+
+def compare(results, baseline, tolerance, minSeconds):
+    '''
+    Prints each stage next to its baseline time, and returns the number of
+    regressions.
+    '''
+    regressions = 0
+    print('{:<10} {:<20} {:<36} {:>10} {:>10} {:>8}'.format(
+        'case', 'tool', 'stage', 'base (s)', 'new (s)', 'ratio'))
+    for case in sorted(results):
+        if case not in baseline:
+            print('{:<10} not in the baseline, skipped'.format(case))
+            continue
+        for tool in sorted(results[case]):
+            baseTimes = baseline[case].get(tool, {})
+            for stage, seconds in sorted(results[case][tool].items()):
+                if stage not in baseTimes:
+                    continue
+                base = baseTimes[stage]
+                ratio = seconds / base if base > 0.0 else 1.0
+                flag = ''
+                if seconds > base * (1.0 + tolerance) and \
+                        seconds - base > minSeconds:
+                    flag = '  REGRESSION'
+                    regressions += 1
+                print('{:<10} {:<20} {:<36} {:>10.3f} {:>10.3f} {:>8.2f}{}'.format(
+                    case, tool, stage, base, seconds, ratio, flag))
+    return regressions
+
+
+def main():
+    scriptDir = os.path.dirname(os.path.abspath(__file__))
+
+    parser = ArgumentParser(description=__doc__)
+    parser.add_argument('--bin-dir', dest='binDir', default='.',
+                        help='Directory holding the four executables.')
+    parser.add_argument('--work-dir', dest='workDir', default='benchmark_run',
+                        help='Directory the meshes and profiles are written '
+                             'to.')
+    parser.add_argument('--baseline', dest='baseline',
+                        default=os.path.join(scriptDir, 'baseline.json'),
+                        help='Baseline timings to compare against.')
+    parser.add_argument('--sizes', dest='sizes', default='medium',
+                        help='Cases to run: one of {}, or a comma separated '
+                             'list of case names ({}).'.format(
+                                 ', '.join(sorted(SIZES)),
+                                 ', '.join(sorted(CASES))))
+    parser.add_argument('--threads', dest='threads', type=int, default=0,
+                        help='Threads passed to MpasMeshConverter.x. The '
+                             'OpenMP default is used if omitted.')
+    parser.add_argument('--tolerance', dest='tolerance', type=float,
+                        default=0.25,
+                        help='Allowed relative slow down of a stage.')
+    parser.add_argument('--min-seconds', dest='minSeconds', type=float,
+                        default=0.1,
+                        help='Slow downs smaller than this are ignored.')
+    parser.add_argument('--update-baseline', dest='updateBaseline',
+                        action='store_true',
+                        help='Write the new timings to the baseline file '
+                             'instead of comparing.')
+    args = parser.parse_args()
+
+    if args.sizes in SIZES:
+        cases = SIZES[args.sizes]
+    else:
+        cases = args.sizes.split(',')
+    for case in cases:
+        if case not in CASES:
+            parser.error('unknown case {}'.format(case))
+
+    binDir = os.path.abspath(args.binDir)
+    workDir = os.path.abspath(args.workDir)
+    maskFile = os.path.join(scriptDir, '..', 'test', 'Arctic_Ocean.geojson')
+    threadArgs = ['--threads', str(args.threads)] if args.threads > 0 else []
+
+    if not os.path.isdir(workDir):
+        os.makedirs(workDir)
+
+    results = {}
+    threads = None
+    for case in cases:
+        print('Running {}'.format(case))
+        sys.stdout.flush()
+        results[case], threads = run_case(case, binDir, workDir, maskFile,
+                                          threadArgs)
+
+    output = {'machine': platform.node(), 'threads': threads,
+              'cases': results}
+    with open(os.path.join(workDir, 'results.json'), 'w') as f:
+        json.dump(output, f, indent=2, sort_keys=True)
+
+    if args.updateBaseline:
+        baseline = {'machine': platform.node(), 'threads': threads,
+                    'cases': {}}
+        if os.path.exists(args.baseline):
+            with open(args.baseline) as f:
+                baseline = json.load(f)
+        # Cases that were not run keep their old timings.
+        baseline['machine'] = platform.node()
+        baseline['threads'] = threads
+        baseline['cases'].update(results)
+        with open(args.baseline, 'w') as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write('\n')
+        print('Wrote {}'.format(args.baseline))
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print('No baseline at {}, run with --update-baseline to create '
+              'one.'.format(args.baseline))
+        return 1
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    if baseline.get('threads') != threads or \
+            baseline.get('machine') != platform.node():
+        print('Warning: the baseline was recorded on {} with {} threads, '
+              'this run is on {} with {} threads.'.format(
+                  baseline.get('machine'), baseline.get('threads'),
+                  platform.node(), threads))
+
+    regressions = compare(results, baseline['cases'], args.tolerance,
+                          args.minSeconds)
+    if regressions > 0:
+        print('{} stages are slower than the baseline.'.format(regressions))
+        return 1
+
+    print('No stage is slower than the baseline.')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,155 @@
+#ifndef CCW_ORDER_H
+#define CCW_ORDER_H
+
+#include <vector>
+#include <cmath>
+
+/*
+ * ccw_order sorts the neighbours of a mesh element (vertices or edges around
+ * a cell, edges around a vertex) counter-clockwise, starting from whichever
+ * neighbour is listed first.
+ *
+ * Every neighbour is projected once onto the plane tangent to the element
+ * (the x/y plane for planar meshes, after undoing periodicity through the
+ * Geometry policy, see mesh_geometry.h), and sorted by a pseudo-angle. The
+ * pseudo-angle increases monotonically with the true angle and advances by
+ * exactly 2 over half a turn, but only needs a division, so no acos or cross
+ * products are needed while sorting.
+ *
+ * pnt.h has to be included before this header.
+ */
+template <class Geometry>
+class ccw_order {/*{{{*/
+	public:
+		explicit ccw_order(const Geometry &geometry_) : geometry(geometry_) { }
+
+		void sort(const pnt &center, const std::vector<pnt> &locations, int *ids, const int n) const {/*{{{*/
+			/*
+			 * Sorts ids[0 .. n-1], which index into locations, counter-clockwise
+			 * around center, keeping ids[0] first.
+			 *
+			 * Starting from ids[0], the next neighbour is always the closest one
+			 * counter-clockwise, within half a turn. For a closed ring (all gaps
+			 * smaller than half a turn) this is the plain counter-clockwise order.
+			 * For an open fan on a mesh boundary it matches the order the
+			 * converter has always produced.
+			 */
+			static const int MAX_LOCAL = 64;
+			double localKeys[MAX_LOCAL];
+			std::vector<double> heapKeys;
+			double *keys = localKeys;
+			double e1[3], e2[3];
+			double diff, min_diff, swp_key;
+			int i, j, k, swp_idx, swp;
+
+			if(n < 3){
+				return;
+			}
+
+			if(n > MAX_LOCAL){
+				heapKeys.resize(n);
+				keys = &heapKeys[0];
+			}
+
+			tangentBasis(center, e1, e2);
+
+			for(i = 0; i < n; i++){
+				keys[i] = pseudoAngle(center, locations[ids[i]], e1, e2);
+			}
+
+			// Selection sort, since n is rarely more than a handful.
+			for(j = 0; j < n - 2; j++){
+				min_diff = 2.0;
+				swp_idx = -1;
+
+				for(k = j+1; k < n; k++){
+					diff = keys[k] - keys[j];
+					if(diff < 0.0){
+						diff += 4.0;
+					}
+
+					// Half a turn is a pseudo-angle difference of 2.
+					if(diff > 0.0 && diff < min_diff){
+						min_diff = diff;
+						swp_idx = k;
+					}
+				}
+
+				if(swp_idx != -1 && swp_idx != j+1){
+					swp = ids[j+1];
+					ids[j+1] = ids[swp_idx];
+					ids[swp_idx] = swp;
+
+					swp_key = keys[j+1];
+					keys[j+1] = keys[swp_idx];
+					keys[swp_idx] = swp_key;
+				}
+			}
+		}/*}}}*/
+
+	private:
+		Geometry geometry;
+
+		void tangentBasis(const pnt &center, double e1[3], double e2[3]) const {/*{{{*/
+			/*
+			 * Builds two vectors spanning the tangent plane, such that
+			 * (e1, e2, normal) is right handed. They are not normalized: any
+			 * linear map with a positive determinant keeps the cyclic order of
+			 * directions, which is all the sort needs.
+			 */
+			double n[3], a[3];
+
+			if(!Geometry::isSpherical){
+				e1[0] = 1.0; e1[1] = 0.0; e1[2] = 0.0;
+				e2[0] = 0.0; e2[1] = 1.0; e2[2] = 0.0;
+				return;
+			}
+
+			n[0] = center.x; n[1] = center.y; n[2] = center.z;
+
+			// Use the coordinate axis least aligned with the normal.
+			a[0] = 0.0; a[1] = 0.0; a[2] = 0.0;
+			if(fabs(n[0]) <= fabs(n[1]) && fabs(n[0]) <= fabs(n[2])){
+				a[0] = 1.0;
+			} else if(fabs(n[1]) <= fabs(n[2])){
+				a[1] = 1.0;
+			} else {
+				a[2] = 1.0;
+			}
+
+			// e1 = a x n, e2 = n x e1
+			e1[0] = a[1]*n[2] - a[2]*n[1];
+			e1[1] = a[2]*n[0] - a[0]*n[2];
+			e1[2] = a[0]*n[1] - a[1]*n[0];
+
+			e2[0] = n[1]*e1[2] - n[2]*e1[1];
+			e2[1] = n[2]*e1[0] - n[0]*e1[2];
+			e2[2] = n[0]*e1[1] - n[1]*e1[0];
+		}/*}}}*/
+		double pseudoAngle(const pnt &center, const pnt &loc, const double e1[3], const double e2[3]) const {/*{{{*/
+			/*
+			 * Returns a value in [0, 4) that increases with the counter-clockwise
+			 * angle of loc around center, measured from e1. Opposite directions
+			 * differ by exactly 2.
+			 */
+			double dx, dy, dz, u, v, p;
+
+			dx = loc.x - center.x;
+			dy = loc.y - center.y;
+			dz = loc.z - center.z;
+
+			geometry.fixOffset(dx, dy);
+
+			u = dx*e1[0] + dy*e1[1] + dz*e1[2];
+			v = dx*e2[0] + dy*e2[1] + dz*e2[2];
+
+			if(u == 0.0 && v == 0.0){
+				return 0.0;
+			}
+
+			p = u / (fabs(u) + fabs(v));
+			return (v >= 0.0) ? 1.0 - p : 3.0 + p;
+		}/*}}}*/
+};/*}}}*/
+
+#endif
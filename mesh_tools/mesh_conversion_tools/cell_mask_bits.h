@@ -0,0 +1,111 @@
+#ifndef CELL_MASK_BITS_H
+#define CELL_MASK_BITS_H
+
+#include <vector>
+#include <algorithm>
+#include <stddef.h>
+#include <inttypes.h>
+#include <netcdfcpp.h>
+
+/*
+ * Cell masks are held one bit per cell, 64 cells to a word: bit i % 64 of
+ * word i / 64 is set for the cells where the mask is non-zero. Bits past
+ * the last cell are always 0.
+ */
+inline size_t maskWords(const size_t nCells){/*{{{*/
+	return (nCells + 63) / 64;
+}/*}}}*/
+inline bool maskBit(const std::vector<uint64_t> &bits, const size_t i){/*{{{*/
+	return (bits[i / 64] >> (i % 64)) & 1;
+}/*}}}*/
+template <class T>
+inline void orMaskRows(const T *values, const size_t nRows, const size_t width, uint64_t *words){/*{{{*/
+	/*
+	 * ORs into words (whose first bit is row 0) the bit of every row where
+	 * any of its width values is non-zero.
+	 */
+	const long nWords = (nRows + 63) / 64;
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(long w = 0; w < nWords; w++){
+		const size_t first = (size_t) w * 64;
+		const size_t last = std::min(first + 64, nRows);
+		uint64_t word = 0;
+
+		for(size_t i = first; i < last; i++){
+			T any = 0;
+			for(size_t j = 0; j < width; j++){
+				any |= values[i * width + j];
+			}
+			word |= (uint64_t) (any != 0) << (i - first);
+		}
+		words[w] |= word;
+	}
+}/*}}}*/
+inline int orMaskVariable(NcFile &ncid, const char *name, const long nCells, const size_t budget, std::vector<uint64_t> &bits){/*{{{*/
+	/*
+	 * ORs the cells where the nCells x width variable name (e.g.
+	 * regionCellMasks) is non-zero for any column into bits. The variable is
+	 * read as bytes, in blocks of a multiple of 64 cells that fit in budget
+	 * bytes, so only one block is held at a time. A missing variable adds
+	 * nothing. Returns 1 if the variable does not have nCells rows or can't
+	 * be read.
+	 */
+	NcError err(NcError::silent_nonfatal);
+	NcVar *var = ncid.get_var(name);
+	std::vector<ncbyte> block;
+
+	if ( var == NULL ) return 0;
+	if ( var->num_dims() < 1 || var->num_dims() > 2 || var->get_dim(0)->size() != nCells ) return 1;
+
+	const long width = var->num_dims() == 2 ? var->get_dim(1)->size() : 1;
+	const long rows = std::max(budget / std::max(width, 1L) / 64 * 64, (size_t) 64);
+
+	bits.resize(maskWords(nCells), 0);
+	for(long firstRow = 0; firstRow < nCells && width > 0; firstRow += rows){
+		const long nRows = std::min(rows, nCells - firstRow);
+		NcBool ok;
+
+		block.resize((size_t) nRows * width);
+		if ( var->num_dims() == 1 ) {
+			ok = var->set_cur(firstRow) && var->get(&block[0], nRows);
+		} else {
+			ok = var->set_cur(firstRow, 0) && var->get(&block[0], nRows, width);
+		}
+		if ( !ok ) return 1;
+
+		orMaskRows(&block[0], nRows, width, &bits[firstRow / 64]);
+	}
+
+	return 0;
+}/*}}}*/
+inline void mergeMaskBits(std::vector<uint64_t> &cull, const std::vector<uint64_t> &mask, const size_t nCells, const bool invert){/*{{{*/
+	/*
+	 * Adds the cells of mask (or, if invert, the cells outside it) to cull,
+	 * 64 cells per operation.
+	 */
+	const long nWords = maskWords(nCells);
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(long w = 0; w < nWords; w++){
+		cull[w] |= invert ? ~mask[w] : mask[w];
+	}
+
+	// Keep the bits past the last cell clear.
+	if ( nCells % 64 != 0 ) {
+		cull[nWords - 1] &= ((uint64_t) 1 << (nCells % 64)) - 1;
+	}
+}/*}}}*/
+inline void preserveMaskBits(std::vector<uint64_t> &cull, const std::vector<uint64_t> &mask, const size_t nCells){/*{{{*/
+	/*
+	 * Removes the cells of mask from cull, 64 cells per operation.
+	 */
+	const long nWords = maskWords(nCells);
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(long w = 0; w < nWords; w++){
+		cull[w] &= ~mask[w];
+	}
+}/*}}}*/
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef CHECKPOINT_FILE_H
+#define CHECKPOINT_FILE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+/*
+ * checkpoint_file reads and writes the raw binary checkpoints of
+ * MpasMeshBuilder (see mpas_mesh_builder_set_checkpoint). A checkpoint is a
+ * header (magic, version, input checksum, stage), a sequence of arrays, each
+ * prefixed by its length, and an end marker, so truncated files are rejected
+ * instead of resumed from.
+ *
+ * Values are stored in the byte order of the machine that wrote them, so
+ * checkpoints are only meant to be read back by the same build on the same
+ * machine. The layout of pnt and the version are checked when reading.
+ *
+ * Every write and read function returns true on success. After the first
+ * failure all further calls fail as well, so callers only need to check the
+ * last one.
+ *
+ * stride_array.h has to be included before this header.
+ */
+
+static const char CHECKPOINT_MAGIC[8] = {'M', 'P', 'A', 'S', 'C', 'K', 'P', 'T'};
+static const char CHECKPOINT_END[8] = {'C', 'K', 'P', 'T', '_', 'E', 'N', 'D'};
+static const int CHECKPOINT_VERSION = 1;
+
+inline uint64_t checksumBytes(const void *data, const size_t nBytes, uint64_t hash){/*{{{*/
+	/*
+	 * 64 bit FNV-1a hash of nBytes at data, continuing from hash (use
+	 * 14695981039346656037 to start a new one). Whole 8 byte words are hashed
+	 * at a time, which is several times faster than hashing single bytes and
+	 * good enough to tell input grids apart.
+	 */
+	const uint64_t prime = 1099511628211ULL;
+	const unsigned char *bytes = (const unsigned char *)data;
+	size_t i;
+	uint64_t word;
+
+	for(i = 0; i + 8 <= nBytes; i += 8){
+		memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * prime;
+	}
+	for(; i < nBytes; i++){
+		hash = (hash ^ bytes[i]) * prime;
+	}
+
+	return hash;
+}/*}}}*/
+
+class checkpoint_file {/*{{{*/
+	public:
+		checkpoint_file() : fp(NULL), ok(false) { }
+		~checkpoint_file(){ close(); }
+
+		bool open_write(const std::string &filename){/*{{{*/
+			close();
+			fp = fopen(filename.c_str(), "wb");
+			ok = fp != NULL;
+			return ok;
+		}/*}}}*/
+		bool open_read(const std::string &filename){/*{{{*/
+			close();
+			fp = fopen(filename.c_str(), "rb");
+			ok = fp != NULL;
+			return ok;
+		}/*}}}*/
+		bool close(){/*{{{*/
+			if(fp != NULL){
+				ok = (fclose(fp) == 0) && ok;
+				fp = NULL;
+			}
+			return ok;
+		}/*}}}*/
+
+		bool write_header(const uint64_t checksum, const int stage, const int pntSize){/*{{{*/
+			write_bytes(CHECKPOINT_MAGIC, 8);
+			write_value(CHECKPOINT_VERSION);
+			write_value(pntSize);
+			write_value(checksum);
+			return write_value(stage);
+		}/*}}}*/
+		bool read_header(const uint64_t checksum, int &stage, const int pntSize){/*{{{*/
+			// Fails if the file was not written by this version, or for a
+			// different input.
+			char magic[8];
+			int version, size;
+			uint64_t sum;
+
+			read_bytes(magic, 8);
+			read_value(version);
+			read_value(size);
+			read_value(sum);
+			read_value(stage);
+			ok = ok && memcmp(magic, CHECKPOINT_MAGIC, 8) == 0
+				&& version == CHECKPOINT_VERSION && size == pntSize && sum == checksum;
+			return ok;
+		}/*}}}*/
+		bool write_end(){/*{{{*/
+			return write_bytes(CHECKPOINT_END, 8);
+		}/*}}}*/
+		bool read_end(){/*{{{*/
+			char end[8];
+
+			read_bytes(end, 8);
+			ok = ok && memcmp(end, CHECKPOINT_END, 8) == 0;
+			return ok;
+		}/*}}}*/
+
+		template <class T>
+		bool write_value(const T &value){/*{{{*/
+			return write_bytes(&value, sizeof(T));
+		}/*}}}*/
+		template <class T>
+		bool read_value(T &value){/*{{{*/
+			return read_bytes(&value, sizeof(T));
+		}/*}}}*/
+
+		template <class T>
+		bool write(const std::vector<T> &values){/*{{{*/
+			// T has to be a plain value type (int, double, pnt).
+			write_value((uint64_t)values.size());
+			return write_bytes(values.empty() ? NULL : &values[0], values.size() * sizeof(T));
+		}/*}}}*/
+		template <class T>
+		bool read(std::vector<T> &values){/*{{{*/
+			uint64_t n = 0;
+
+			if(!read_value(n)) return false;
+			values.resize(n);
+			return read_bytes(values.empty() ? NULL : &values[0], n * sizeof(T));
+		}/*}}}*/
+
+		template <class T>
+		bool write(stride_array<T> &values){/*{{{*/
+			const size_t nRows = values.size();
+
+			write_value(values.size());
+			write_value(values.stride());
+			write_value(values.fill());
+			write_bytes(values.sizes(), nRows * sizeof(int));
+			return write_bytes(values.data(), nRows * values.stride() * sizeof(T));
+		}/*}}}*/
+		template <class T>
+		bool read(stride_array<T> &values){/*{{{*/
+			int nRows = 0, stride = 0;
+			T fill;
+
+			read_value(nRows);
+			read_value(stride);
+			read_value(fill);
+			if(!ok || nRows < 0 || stride < 0) return ok = false;
+
+			values.resize(nRows, stride, fill);
+			read_bytes(values.sizes(), (size_t)nRows * sizeof(int));
+			return read_bytes(values.data(), (size_t)nRows * stride * sizeof(T));
+		}/*}}}*/
+
+	private:
+		FILE *fp;
+		bool ok;
+
+		bool write_bytes(const void *data, const size_t nBytes){/*{{{*/
+			ok = ok && (nBytes == 0 || fwrite(data, 1, nBytes, fp) == nBytes);
+			return ok;
+		}/*}}}*/
+		bool read_bytes(void *data, const size_t nBytes){/*{{{*/
+			ok = ok && (nBytes == 0 || fread(data, 1, nBytes, fp) == nBytes);
+			return ok;
+		}/*}}}*/
+
+		// Not copyable.
+		checkpoint_file(const checkpoint_file &);
+		checkpoint_file& operator=(const checkpoint_file &);
+};/*}}}*/
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef COMPACT_MAP_H
+#define COMPACT_MAP_H
+
+#include <vector>
+#include <stddef.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * compactMap turns keep flags into a map from old to new indices, in place:
+ * map[i] is non-zero on entry for the elements to keep, and on return holds
+ * their new index, numbered from 0 in their original order, or -1 for the
+ * removed elements. keep is filled with the old indices of the kept elements,
+ * in their new order. Returns the number of kept elements.
+ *
+ * Each thread counts the flags of a contiguous chunk, an exclusive prefix sum
+ * over the chunk counts gives each chunk its first new index, and the chunks
+ * are then numbered in parallel, so the result does not depend on the number
+ * of OpenMP threads.
+ */
+inline int compactMap(std::vector<int> &map, std::vector<int> &keep){/*{{{*/
+	const size_t n = map.size();
+	int maxThreads = 1;
+	int nThreads = 1;
+
+#ifdef _OPENMP
+	maxThreads = omp_get_max_threads();
+#endif
+
+	std::vector<size_t> offsets((size_t)maxThreads + 1, 0);
+
+	#pragma omp parallel default(shared)
+	{
+		int tid = 0;
+#ifdef _OPENMP
+		tid = omp_get_thread_num();
+		#pragma omp single
+		nThreads = omp_get_num_threads();
+#endif
+		size_t start = n * tid / nThreads;
+		size_t end = n * (tid + 1) / nThreads;
+		size_t count = 0;
+
+		for(size_t i = start; i < end; i++){
+			count += (map[i] != 0);
+		}
+		offsets[tid + 1] = count;
+
+		#pragma omp barrier
+
+		#pragma omp single
+		{
+			for(int t = 0; t < nThreads; t++){
+				offsets[t + 1] += offsets[t];
+			}
+			keep.resize(offsets[nThreads]);
+		}
+
+		size_t next = offsets[tid];
+		for(size_t i = start; i < end; i++){
+			if(map[i] != 0){
+				keep[next] = i;
+				map[i] = next++;
+			} else {
+				map[i] = -1;
+			}
+		}
+	}
+
+	return offsets[nThreads];
+}/*}}}*/
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef COORD_ARRAY_H
+#define COORD_ARRAY_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdlib.h>
+
+/*
+ * coord_array holds the coordinates of a set of points (e.g. all cell
+ * centers) as three separate x, y and z arrays, each starting on a 64 byte
+ * boundary, so geometry kernels can stream through them with vector loads
+ * instead of striding over whole pnt objects. A coord_array can also borrow
+ * three arrays owned by the caller (see borrow), which are then only read,
+ * and need not be aligned.
+ *
+ * The batched kernels below compute the same quantities as the matching
+ * functions in pnt.h (sphericalTriangleArea and planarTriangleArea), with the
+ * same operations in the same order, so results are bit for bit identical.
+ * Each takes one coord_array and one index list per argument of the scalar
+ * function, and evaluates the function for every position of the index
+ * lists. Work is split over OpenMP threads in blocks of
+ * COORD_BLOCK entries. Within a block, the arithmetic (gathers, products,
+ * square roots and divisions) runs in one loop the compiler can vectorize,
+ * and the remaining asin, tan and atan calls in a second loop.
+ *
+ * pnt.h has to be included before this header.
+ */
+
+static const int COORD_BLOCK = 256;
+
+class coord_array {/*{{{*/
+	public:
+		coord_array() : n(0), stride(0), block(NULL), xs(NULL), ys(NULL), zs(NULL) { }
+		explicit coord_array(const std::vector<pnt> &points) : n(0), stride(0), block(NULL), xs(NULL), ys(NULL), zs(NULL) {/*{{{*/
+			assign(points);
+		}/*}}}*/
+		~coord_array(){/*{{{*/
+			free(block);
+		}/*}}}*/
+
+		void resize(const int n_){/*{{{*/
+			// Existing coordinates are not kept.
+			const size_t stride_ = ((size_t)n_ + 7) / 8 * 8;
+			void *ptr = NULL;
+
+			if(stride_ != stride || block == NULL){
+				free(block);
+				block = NULL;
+				if(posix_memalign(&ptr, 64, std::max((size_t)1, 3 * stride_) * sizeof(double)) == 0){
+					block = (double *)ptr;
+				}
+				stride = stride_;
+			}
+
+			n = n_;
+			xs = block;
+			ys = block + stride;
+			zs = block + 2 * stride;
+		}/*}}}*/
+		void assign(const std::vector<pnt> &points){/*{{{*/
+			resize(points.size());
+
+			#pragma omp parallel for default(shared)
+			for(int i = 0; i < n; i++){
+				xs[i] = points[i].x;
+				ys[i] = points[i].y;
+				zs[i] = points[i].z;
+			}
+		}/*}}}*/
+
+		void borrow(const int n_, const double *x_, const double *y_, const double *z_){/*{{{*/
+			// Reads the caller's arrays instead of a copy. They have to stay
+			// valid and unchanged while this coord_array uses them, and must
+			// not be written through x(), y() or z().
+			free(block);
+			block = NULL;
+			stride = 0;
+			n = n_;
+			xs = const_cast<double *>(x_);
+			ys = const_cast<double *>(y_);
+			zs = const_cast<double *>(z_);
+		}/*}}}*/
+		void clear(){/*{{{*/
+			free(block);
+			block = NULL;
+			stride = 0;
+			n = 0;
+			xs = ys = zs = NULL;
+		}/*}}}*/
+
+		int size() const { return n; }
+		double* x() { return xs; }
+		double* y() { return ys; }
+		double* z() { return zs; }
+		const double* x() const { return xs; }
+		const double* y() const { return ys; }
+		const double* z() const { return zs; }
+		pnt at(const int i) const { return pnt(xs[i], ys[i], zs[i], i); }
+
+	private:
+		int n;
+		size_t stride;
+		double *block, *xs, *ys, *zs;
+
+		// Not copyable.
+		coord_array(const coord_array &);
+		coord_array& operator=(const coord_array &);
+};/*}}}*/
+
+inline double halfChord(const double x1, const double y1, const double z1, const double n1, const double x2, const double y2, const double z2, const double n2){/*{{{*/
+	/*
+	 * Half the distance between the directions of two points, given their
+	 * magnitudes, clamped to 1. This is the sine of half the angle between
+	 * them, as in pnt::sphereDistance.
+	 */
+	double dx, dy, dz, arg;
+
+	dx = x1/n1 - x2/n2;
+	dy = y1/n1 - y2/n2;
+	dz = z1/n1 - z2/n2;
+
+	arg = 0.5 * sqrt(dx*dx + dy*dy + dz*dz);
+	return (arg > 1.0) ? 1.0 : arg;
+}/*}}}*/
+inline void sphericalTriangleAreas(const coord_array &A, const int *iA, const coord_array &B, const int *iB, const coord_array &C, const int *iC, const int n, double *areas){/*{{{*/
+	/*
+	 * areas[k] = sphericalTriangleArea(A[iA[k]], B[iB[k]], C[iC[k]])
+	 */
+	const int nBlocks = (n + COORD_BLOCK - 1) / COORD_BLOCK;
+
+	#pragma omp parallel for default(shared)
+	for(int iBlock = 0; iBlock < nBlocks; iBlock++){
+		const int first = iBlock * COORD_BLOCK;
+		const int count = std::min(COORD_BLOCK, n - first);
+		double ab[COORD_BLOCK], bc[COORD_BLOCK], ca[COORD_BLOCK];
+		int k;
+
+		for(k = 0; k < count; k++){
+			const int a = iA[first + k], b = iB[first + k], c = iC[first + k];
+			const double ax = A.x()[a], ay = A.y()[a], az = A.z()[a];
+			const double bx = B.x()[b], by = B.y()[b], bz = B.z()[b];
+			const double cx = C.x()[c], cy = C.y()[c], cz = C.z()[c];
+			const double na = sqrt(ax*ax + ay*ay + az*az);
+			const double nb = sqrt(bx*bx + by*by + bz*bz);
+			const double nc = sqrt(cx*cx + cy*cy + cz*cz);
+
+			ab[k] = halfChord(ax, ay, az, na, bx, by, bz, nb);
+			bc[k] = halfChord(bx, by, bz, nb, cx, cy, cz, nc);
+			ca[k] = halfChord(cx, cy, cz, nc, ax, ay, az, na);
+		}
+
+		for(k = 0; k < count; k++){
+			double tanqe, s, a, b, c;
+
+			a = 2.0*asin(ab[k]);
+			b = 2.0*asin(bc[k]);
+			c = 2.0*asin(ca[k]);
+			s = 0.5*(a+b+c);
+
+			tanqe = sqrt(tan(0.5*s)*tan(0.5*(s-a))*tan(0.5*(s-b))*tan(0.5*(s-c)));
+			areas[first + k] = 4.*atan(tanqe);
+		}
+	}
+}/*}}}*/
+template <bool periodic>
+inline void planarTriangleAreas(const coord_array &A, const int *iA, const coord_array &B, const int *iB, const coord_array &C, const int *iC, const int n, const double xPeriod, const double yPeriod, double *areas){/*{{{*/
+	/*
+	 * areas[k] = planarTriangleArea(A[iA[k]], B[iB[k]], C[iC[k]]). If
+	 * periodic, B and C are first moved to the periodic image closest to A,
+	 * as pnt::fixPeriodicity(A, xPeriod, yPeriod) does. copysign gives the
+	 * same shift as fixPeriodicity's -(d/fabs(d)) * xPeriod without the
+	 * division. The periodic shift keeps GCC from vectorizing the loop, so
+	 * only the non-periodic version is vectorized.
+	 */
+	const int nBlocks = (n + COORD_BLOCK - 1) / COORD_BLOCK;
+
+	#pragma omp parallel for default(shared)
+	for(int iBlock = 0; iBlock < nBlocks; iBlock++){
+		const int first = iBlock * COORD_BLOCK;
+		const int count = std::min(COORD_BLOCK, n - first);
+
+		for(int k = 0; k < count; k++){
+			const int a = iA[first + k], b = iB[first + k], c = iC[first + k];
+			const double ax = A.x()[a], ay = A.y()[a], az = A.z()[a];
+			double bx = B.x()[b], by = B.y()[b], bz = B.z()[b];
+			double cx = C.x()[c], cy = C.y()[c], cz = C.z()[c];
+			double d, s, la, lb, lc;
+
+			if(periodic){
+				d = bx - ax;
+				bx -= (fabs(d) > xPeriod * 0.6) ? copysign(xPeriod, d) : 0.0;
+				d = by - ay;
+				by -= (fabs(d) > yPeriod * 0.6) ? copysign(yPeriod, d) : 0.0;
+				d = cx - ax;
+				cx -= (fabs(d) > xPeriod * 0.6) ? copysign(xPeriod, d) : 0.0;
+				d = cy - ay;
+				cy -= (fabs(d) > yPeriod * 0.6) ? copysign(yPeriod, d) : 0.0;
+			}
+
+			la = sqrt((bx-ax)*(bx-ax) + (by-ay)*(by-ay) + (bz-az)*(bz-az));
+			lb = sqrt((cx-bx)*(cx-bx) + (cy-by)*(cy-by) + (cz-bz)*(cz-bz));
+			lc = sqrt((ax-cx)*(ax-cx) + (ay-cy)*(ay-cy) + (az-cz)*(az-cz));
+
+			s = (la + lb + lc) * 0.5;
+			areas[first + k] = sqrt(s * (s - la) * (s - lb) * (s - lc));
+		}
+	}
+}/*}}}*/
+inline int nearestPoint(const coord_array &points, const pnt &p){/*{{{*/
+	/*
+	 * Returns the index of the point closest to p in angle (the first one if
+	 * several are equally close), or -1 if there are no points. This gives
+	 * the same answer as minimizing p.dotForAngle(points[i]), but only takes
+	 * the acos of dot products within rounding distance of the largest one.
+	 */
+	const int n = points.size();
+	const double *x = points.x(), *y = points.y(), *z = points.z();
+	const double tolerance = 1.0e-12;
+	double maxDot, minAngle, angle;
+	int i, best;
+
+	if(n == 0){
+		return -1;
+	}
+
+	maxDot = -HUGE_VAL;
+	for(i = 0; i < n; i++){
+		const double dot = p.x*x[i] + p.y*y[i] + p.z*z[i];
+		maxDot = (dot > maxDot) ? dot : maxDot;
+	}
+
+	best = -1;
+	minAngle = HUGE_VAL;
+	for(i = 0; i < n; i++){
+		const double dot = p.x*x[i] + p.y*y[i] + p.z*z[i];
+		if(dot >= maxDot - tolerance){
+			angle = acos(std::max(-1.0, std::min(1.0, dot)));
+			if(angle < minAngle){
+				minAngle = angle;
+				best = i;
+			}
+		}
+	}
+
+	return best;
+}/*}}}*/
+
+#endif
@@ -24,6 +24,12 @@ class edge {/*{{{*/
 		}
 	};/*}}}*/
 
+	uint64_t key() const {/*{{{*/
+		// Packs the vertex pair into one sortable integer. Indices are offset
+		// by one so a missing vertex (-1) packs as 0.
+		return ((uint64_t)(uint32_t)(vertex1 + 1) << 32) | (uint64_t)(uint32_t)(vertex2 + 1);
+	}/*}}}*/
+
 	bool operator==(const edge &e) const {/*{{{*/
 		return (vertex1 == e.vertex1) && (vertex2 == e.vertex2);
 	}/*}}}*/
@@ -0,0 +1,104 @@
+#ifndef MESH_GEOMETRY_H
+#define MESH_GEOMETRY_H
+
+#include <cmath>
+
+/*
+ * Geometry policies for the mesh converter's build stages.
+ *
+ * The build stages are templates on one of the classes below, and main()
+ * picks the class once from on_a_sphere and is_periodic. Each stage is then
+ * compiled separately for each geometry, so its inner loops contain only the
+ * operations of that geometry, instead of testing spherical for every
+ * element. Every policy provides:
+ *
+ *   isSpherical                  Compile time flag, for the few places that
+ *                                use a different algorithm altogether.
+ *   fixPeriodicity(p, ref)       Moves p to the periodic image closest to ref.
+ *   fixOffset(dx, dy)            Same as fixPeriodicity, for the offset of a
+ *                                point from a reference point.
+ *   project(p)                   Moves p back onto the surface.
+ *   normal(center)               Surface normal at center.
+ *   intersect(c1, c2, v1, v2)    Intersection of the c1-c2 and v1-v2 arcs.
+ *   distance(a, b)               Distance between two points on the surface.
+ *   triangleAreas(...)           Batched triangle areas (see coord_array.h).
+ *
+ * Another geometry (e.g. an ellipsoid) only needs a new class with the same
+ * members, and does not affect the code generated for the others.
+ *
+ * pnt.h and coord_array.h have to be included before this header.
+ */
+
+class spherical_geometry {/*{{{*/
+	public:
+		static const bool isSpherical = true;
+
+		void fixPeriodicity(pnt &p, const pnt &ref) const { }
+		void fixOffset(double &dx, double &dy) const { }
+		void project(pnt &p) const { p.normalize(); }
+		pnt normal(const pnt &center) const { return center; }
+		pnt intersect(const pnt &c1, const pnt &c2, const pnt &v1, const pnt &v2) const {/*{{{*/
+			return gcIntersect(c1, c2, v1, v2);
+		}/*}}}*/
+		double distance(const pnt &a, const pnt &b) const {/*{{{*/
+			return a.sphereDistance(b);
+		}/*}}}*/
+		void triangleAreas(const coord_array &A, const int *iA, const coord_array &B, const int *iB, const coord_array &C, const int *iC, const int n, double *areas) const {/*{{{*/
+			sphericalTriangleAreas(A, iA, B, iB, C, iC, n, areas);
+		}/*}}}*/
+};/*}}}*/
+
+class planar_geometry {/*{{{*/
+	public:
+		static const bool isSpherical = false;
+
+		void fixPeriodicity(pnt &p, const pnt &ref) const { }
+		void fixOffset(double &dx, double &dy) const { }
+		void project(pnt &p) const { }
+		pnt normal(const pnt &center) const { return pnt(0.0, 0.0, 1.0); }
+		pnt intersect(const pnt &c1, const pnt &c2, const pnt &v1, const pnt &v2) const {/*{{{*/
+			return planarIntersect(c1, c2, v1, v2);
+		}/*}}}*/
+		double distance(const pnt &a, const pnt &b) const {/*{{{*/
+			return (a - b).magnitude();
+		}/*}}}*/
+		void triangleAreas(const coord_array &A, const int *iA, const coord_array &B, const int *iB, const coord_array &C, const int *iC, const int n, double *areas) const {/*{{{*/
+			planarTriangleAreas<false>(A, iA, B, iB, C, iC, n, 0.0, 0.0, areas);
+		}/*}}}*/
+};/*}}}*/
+
+class periodic_planar_geometry {/*{{{*/
+	public:
+		static const bool isSpherical = false;
+
+		periodic_planar_geometry(const double xPeriod_, const double yPeriod_)
+			: xPeriod(xPeriod_), yPeriod(yPeriod_) { }
+
+		void fixPeriodicity(pnt &p, const pnt &ref) const {/*{{{*/
+			p.fixPeriodicity(ref, xPeriod, yPeriod);
+		}/*}}}*/
+		void fixOffset(double &dx, double &dy) const {/*{{{*/
+			if(fabs(dx) > xPeriod * 0.6){
+				dx -= (dx > 0.0) ? xPeriod : -xPeriod;
+			}
+			if(fabs(dy) > yPeriod * 0.6){
+				dy -= (dy > 0.0) ? yPeriod : -yPeriod;
+			}
+		}/*}}}*/
+		void project(pnt &p) const { }
+		pnt normal(const pnt &center) const { return pnt(0.0, 0.0, 1.0); }
+		pnt intersect(const pnt &c1, const pnt &c2, const pnt &v1, const pnt &v2) const {/*{{{*/
+			return planarIntersect(c1, c2, v1, v2);
+		}/*}}}*/
+		double distance(const pnt &a, const pnt &b) const {/*{{{*/
+			return (a - b).magnitude();
+		}/*}}}*/
+		void triangleAreas(const coord_array &A, const int *iA, const coord_array &B, const int *iB, const coord_array &C, const int *iC, const int n, double *areas) const {/*{{{*/
+			planarTriangleAreas<true>(A, iA, B, iB, C, iC, n, xPeriod, yPeriod, areas);
+		}/*}}}*/
+
+	private:
+		double xPeriod, yPeriod;
+};/*}}}*/
+
+#endif
@@ -0,0 +1,354 @@
+#ifndef MESH_PARTITION_H
+#define MESH_PARTITION_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+
+/*
+ * Geometric partitioner used to write graph.info.part.N files next to a
+ * graph.info, so meshes can be decomposed for any number of processors without
+ * running gpmetis.
+ *
+ * Cells are cut into nParts contiguous, equally sized pieces of a space filling
+ * curve on the mesh surface (see surfaceCurveOrder in mesh_reorder.h), which
+ * gives compact partitions, and the pieces are then improved by moving
+ * boundary cells to the neighbouring partition that holds most of their
+ * neighbours, while keeping every partition within PARTITION_IMBALANCE of the
+ * average size. The curve order is computed once and shared by every
+ * processor count.
+ *
+ * A piece of the curve can still come out in several pieces on the mesh where
+ * the curve grazes a partition boundary, so a final pass moves every piece
+ * but the largest to a neighbouring partition. Pieces that no neighbour has
+ * room for are left, and counted in the output.
+ *
+ * The cell graph is passed as a padded nCells x stride table (e.g.
+ * cellsOnCell) plus the number of valid entries per cell. Entries are numbered
+ * from base (0 for C tables, 1 for tables read from or written to NetCDF), and
+ * anything outside [base, base + nCells) is ignored.
+ */
+
+static const double PARTITION_IMBALANCE = 0.03;
+static const int PARTITION_REFINE_PASSES = 4;
+
+inline int parsePartitionFlags(int &argc, char *argv[], std::vector<int> &counts){/*{{{*/
+	/*
+	 * Removes "--partitions N[,N...]" from argv, in the same way as
+	 * netcdf_mpas_parse_output_flags, and appends the counts. Returns non-zero
+	 * if the list is malformed.
+	 */
+	int nKept = 1;
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "--partitions") != 0){
+			argv[nKept++] = argv[i];
+			continue;
+		}
+
+		if(i + 1 >= argc){
+			std::cout << " ERROR: --partitions requires a comma separated list of partition counts." << std::endl;
+			return 1;
+		}
+
+		std::stringstream list(argv[++i]);
+		std::string item;
+		while(std::getline(list, item, ',')){
+			int count = atoi(item.c_str());
+			if(count <= 0){
+				std::cout << " ERROR: Invalid partition count '" << item << "'." << std::endl;
+				return 1;
+			}
+			counts.push_back(count);
+		}
+	}
+
+	argc = nKept;
+	return 0;
+}/*}}}*/
+inline void printPartitionUsage(){/*{{{*/
+	std::cout << "\t\t--partitions N[,N...]:" << std::endl;
+	std::cout << "\t\t\tAlso write a gpmetis style .part.N file next to the" << std::endl;
+	std::cout << "\t\t\tgraph.info file for each partition count N, using a" << std::endl;
+	std::cout << "\t\t\tspace filling curve partitioner." << std::endl;
+}/*}}}*/
+inline bool leavesPartitionConnected(const int *adjacency, const int *nAdjacent, const int stride, const int base, const std::vector<int> &part, const int i){/*{{{*/
+	/*
+	 * Returns true if the neighbours of cell i in its own partition form at
+	 * most one run around it (adjacency rows are in cyclic order, as
+	 * cellsOnCell is), so that moving i elsewhere doesn't split them apart.
+	 */
+	const int n = part.size();
+	const int p = part[i];
+	int runs = 0;
+
+	for(int j = 0; j < nAdjacent[i]; j++){
+		int nbr = adjacency[(size_t)i * stride + j] - base;
+		int prev = adjacency[(size_t)i * stride + (j + nAdjacent[i] - 1) % nAdjacent[i]] - base;
+		bool inside = nbr >= 0 && nbr < n && part[nbr] == p;
+		bool prevInside = prev >= 0 && prev < n && part[prev] == p;
+
+		if(inside && !prevInside){
+			runs++;
+		}
+	}
+
+	return runs <= 1;
+}/*}}}*/
+inline int labelComponents(const std::vector<int> &curve, const int *adjacency, const int *nAdjacent, const int stride, const int base, const std::vector<int> &part, std::vector<int> &component, std::vector<int> &componentCells, std::vector<int> &componentStart){/*{{{*/
+	/*
+	 * Labels the connected pieces of every partition, numbered in the curve
+	 * order of their first cell. The cells of component c are
+	 * componentCells[componentStart[c] .. componentStart[c + 1]). Returns the
+	 * number of components.
+	 */
+	const int n = curve.size();
+	int nComponents = 0;
+
+	component.assign(n, -1);
+	componentCells.resize(n);
+	componentStart.assign(1, 0);
+
+	size_t next = 0;
+	for(int k = 0; k < n; k++){
+		if(component[curve[k]] != -1){
+			continue;
+		}
+
+		// Breadth first search, with componentCells as the queue.
+		size_t first = next;
+		component[curve[k]] = nComponents;
+		componentCells[next++] = curve[k];
+		while(first < next){
+			int i = componentCells[first++];
+			for(int j = 0; j < nAdjacent[i]; j++){
+				int nbr = adjacency[(size_t)i * stride + j] - base;
+				if(nbr >= 0 && nbr < n && component[nbr] == -1 && part[nbr] == part[i]){
+					component[nbr] = nComponents;
+					componentCells[next++] = nbr;
+				}
+			}
+		}
+
+		nComponents++;
+		componentStart.push_back(next);
+	}
+
+	return nComponents;
+}/*}}}*/
+inline int countSplitPartitions(const std::vector<int> &curve, const int *adjacency, const int *nAdjacent, const int stride, const int base, const int nParts, const std::vector<int> &part){/*{{{*/
+	/*
+	 * Returns the number of partitions made of more than one connected piece.
+	 */
+	std::vector<int> component, componentCells, componentStart, pieces(nParts, 0);
+	int nComponents = labelComponents(curve, adjacency, nAdjacent, stride, base, part, component, componentCells, componentStart);
+	int split = 0;
+
+	for(int c = 0; c < nComponents; c++){
+		if(++pieces[part[componentCells[componentStart[c]]]] == 2){
+			split++;
+		}
+	}
+
+	return split;
+}/*}}}*/
+inline int partitionCells(const std::vector<int> &curve, const int *adjacency, const int *nAdjacent, const int stride, const int base, const int nParts, std::vector<int> &part){/*{{{*/
+	/*
+	 * Splits the cells into nParts partitions, writing the partition of each
+	 * cell to part. Returns the number of partitions that are still not
+	 * contiguous.
+	 */
+	const int n = curve.size();
+	const double average = (double)n / nParts;
+	const int maxSize = std::max((int)(average * (1.0 + PARTITION_IMBALANCE)), (n + nParts - 1) / nParts);
+	const int minSize = std::max(std::min((int)(average * (1.0 - PARTITION_IMBALANCE)), n / nParts), 1);
+	std::vector<int> sizes(nParts, 0);
+	std::vector<int> nbrParts(stride), nbrCounts(stride);
+	int i, j, k, p, q, nbr, nDistinct, moved;
+
+	part.resize(n);
+
+	// Equal pieces of the curve. Piece p holds curve positions
+	// [n*p/nParts, n*(p+1)/nParts).
+	for(p = 0; p < nParts; p++){
+		for(i = (int)((long long)n * p / nParts); i < (int)((long long)n * (p + 1) / nParts); i++){
+			part[curve[i]] = p;
+		}
+		sizes[p] = (int)((long long)n * (p + 1) / nParts) - (int)((long long)n * p / nParts);
+	}
+
+	// Greedy boundary refinement, visiting cells in curve order so the result
+	// does not depend on the input numbering. Cells only move if that leaves
+	// their partition connected around them.
+	for(int pass = 0; pass < PARTITION_REFINE_PASSES; pass++){
+		moved = 0;
+
+		for(k = 0; k < n; k++){
+			i = curve[k];
+			p = part[i];
+
+			nDistinct = 0;
+			for(j = 0; j < nAdjacent[i]; j++){
+				nbr = adjacency[(size_t)i * stride + j] - base;
+				if(nbr < 0 || nbr >= n){
+					continue;
+				}
+
+				q = part[nbr];
+				int slot = 0;
+				while(slot < nDistinct && nbrParts[slot] != q){
+					slot++;
+				}
+				if(slot == nDistinct){
+					nbrParts[nDistinct] = q;
+					nbrCounts[nDistinct] = 0;
+					nDistinct++;
+				}
+				nbrCounts[slot]++;
+			}
+
+			int internal = 0;
+			int best = -1;
+			for(j = 0; j < nDistinct; j++){
+				if(nbrParts[j] == p){
+					internal = nbrCounts[j];
+				} else if(best == -1 || nbrCounts[j] > nbrCounts[best]){
+					best = j;
+				}
+			}
+
+			// Moving the cell reduces the cut by nbrCounts[best] - internal.
+			if(best != -1 && nbrCounts[best] > internal){
+				q = nbrParts[best];
+				if(sizes[q] < maxSize && sizes[p] > minSize
+						&& leavesPartitionConnected(adjacency, nAdjacent, stride, base, part, i)){
+					part[i] = q;
+					sizes[q]++;
+					sizes[p]--;
+					moved++;
+				}
+			}
+		}
+
+		if(moved == 0){
+			break;
+		}
+	}
+
+	// Contiguity repair. The largest piece of each partition stays, and every
+	// other piece joins the neighbouring partition it shares most edges
+	// with, if that partition stays within maxSize. Pieces are visited in
+	// curve order.
+	std::vector<int> component, componentCells, componentStart, largest, shared(nParts, 0), touched;
+
+	for(int pass = 0; pass < PARTITION_REFINE_PASSES; pass++){
+		const int nComponents = labelComponents(curve, adjacency, nAdjacent, stride, base, part, component, componentCells, componentStart);
+
+		largest.assign(nParts, -1);
+		for(int c = 0; c < nComponents; c++){
+			p = part[componentCells[componentStart[c]]];
+			if(largest[p] == -1 || componentStart[c + 1] - componentStart[c] > componentStart[largest[p] + 1] - componentStart[largest[p]]){
+				largest[p] = c;
+			}
+		}
+
+		moved = 0;
+		for(int c = 0; c < nComponents; c++){
+			const int size = componentStart[c + 1] - componentStart[c];
+			p = part[componentCells[componentStart[c]]];
+			if(largest[p] == c){
+				continue;
+			}
+
+			touched.clear();
+			for(k = componentStart[c]; k < componentStart[c + 1]; k++){
+				i = componentCells[k];
+				for(j = 0; j < nAdjacent[i]; j++){
+					nbr = adjacency[(size_t)i * stride + j] - base;
+					if(nbr >= 0 && nbr < n && part[nbr] != p){
+						if(shared[part[nbr]]++ == 0){
+							touched.push_back(part[nbr]);
+						}
+					}
+				}
+			}
+
+			int best = -1;
+			for(size_t t = 0; t < touched.size(); t++){
+				q = touched[t];
+				if(sizes[q] + size <= maxSize && (best == -1 || shared[q] > shared[best])){
+					best = q;
+				}
+				shared[q] = 0;
+			}
+
+			if(best != -1){
+				for(k = componentStart[c]; k < componentStart[c + 1]; k++){
+					part[componentCells[k]] = best;
+				}
+				sizes[best] += size;
+				sizes[p] -= size;
+				moved++;
+			}
+		}
+
+		if(moved == 0){
+			break;
+		}
+	}
+
+	return countSplitPartitions(curve, adjacency, nAdjacent, stride, base, nParts, part);
+}/*}}}*/
+inline int writePartitionFiles(const std::string &graphFilename, const std::vector<int> &curve, const int *adjacency, const int *nAdjacent, const int stride, const int base, const std::vector<int> &counts){/*{{{*/
+	/*
+	 * Writes graphFilename.part.N for each N in counts, in the gpmetis
+	 * format: one line per cell holding its 0-based partition.
+	 */
+	const int n = curve.size();
+	std::vector<int> part;
+
+	for(size_t c = 0; c < counts.size(); c++){
+		const int nParts = counts[c];
+		long long cut = 0;
+
+		if(nParts > n){
+			std::cout << " ERROR: Cannot split " << n << " cells into " << nParts << " partitions." << std::endl;
+			return 1;
+		}
+
+		const int split = partitionCells(curve, adjacency, nAdjacent, stride, base, nParts, part);
+
+		for(int i = 0; i < n; i++){
+			for(int j = 0; j < nAdjacent[i]; j++){
+				int nbr = adjacency[(size_t)i * stride + j] - base;
+				if(nbr >= 0 && nbr < n && part[nbr] != part[i]){
+					cut++;
+				}
+			}
+		}
+
+		std::stringstream name;
+		name << graphFilename << ".part." << nParts;
+
+		std::ofstream partFile(name.str().c_str());
+		if(!partFile){
+			std::cout << " ERROR: Could not open " << name.str() << " for writing." << std::endl;
+			return 1;
+		}
+		for(int i = 0; i < n; i++){
+			partFile << part[i] << "\n";
+		}
+		partFile.close();
+
+		std::cout << "\tWrote " << name.str() << " (edge cut " << cut / 2 << ", " << split << " non-contiguous partitions)." << std::endl;
+	}
+
+	return 0;
+}/*}}}*/
+
+#endif
@@ -0,0 +1,404 @@
+#ifndef MESH_REORDER_H
+#define MESH_REORDER_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <inttypes.h>
+
+#include "stride_array.h"
+#include "radix_sort.h"
+
+/*
+ * Helpers for renumbering the cells, edges and vertices of a mesh so that
+ * elements which are close in space are also close in memory.
+ *
+ * Every ordering is returned as a list of old indices in their new order
+ * (order[new] = old). invertOrder turns that into the old to new map needed
+ * to rewrite connectivity tables.
+ *
+ * pnt.h has to be included before this header.
+ */
+
+inline uint64_t mortonKey(const uint32_t *coords, const int nDims, const int bits){/*{{{*/
+	/*
+	 * Interleaves the low bits of each coordinate, most significant bit
+	 * first, so the key walks the domain in Z order.
+	 */
+	uint64_t key = 0;
+
+	for(int b = bits - 1; b >= 0; b--){
+		for(int d = 0; d < nDims; d++){
+			key = (key << 1) | ((coords[d] >> b) & 1);
+		}
+	}
+
+	return key;
+}/*}}}*/
+inline uint64_t hilbertKey(const uint32_t *coords, const int nDims, const int bits){/*{{{*/
+	/*
+	 * Position along the Hilbert curve through a 2^bits grid in nDims
+	 * dimensions. Uses Skilling's transform ("Programming the Hilbert curve",
+	 * AIP Conf. Proc. 707, 2004), which turns the coordinates into the
+	 * "transposed" Hilbert index. Interleaving that like a Morton key gives
+	 * the index itself.
+	 */
+	uint32_t x[3];
+	uint32_t M = 1u << (bits - 1);
+	uint32_t P, Q, t;
+	int d;
+
+	for(d = 0; d < nDims; d++){
+		x[d] = coords[d];
+	}
+
+	// Inverse undo
+	for(Q = M; Q > 1; Q >>= 1){
+		P = Q - 1;
+		for(d = 0; d < nDims; d++){
+			if(x[d] & Q){
+				x[0] ^= P;
+			} else {
+				t = (x[0] ^ x[d]) & P;
+				x[0] ^= t;
+				x[d] ^= t;
+			}
+		}
+	}
+
+	// Gray encode
+	for(d = 1; d < nDims; d++){
+		x[d] ^= x[d-1];
+	}
+	t = 0;
+	for(Q = M; Q > 1; Q >>= 1){
+		if(x[nDims-1] & Q){
+			t ^= Q - 1;
+		}
+	}
+	for(d = 0; d < nDims; d++){
+		x[d] ^= t;
+	}
+
+	return mortonKey(x, nDims, bits);
+}/*}}}*/
+inline void curveOrder(const double *x, const double *y, const double *z, const int n, const bool spherical, const bool hilbert, std::vector<int> &order){/*{{{*/
+	/*
+	 * Orders n points along a space filling curve through their bounding box.
+	 * Spherical meshes use the 3D curve on the Cartesian coordinates (21 bits
+	 * per axis), planar meshes the 2D curve on x and y (31 bits per axis).
+	 * Ties keep their current order, since radixSortKeys is stable.
+	 */
+	const int nDims = spherical ? 3 : 2;
+	const int bits = spherical ? 21 : 31;
+	const double maxCoord = (double)((1u << bits) - 1);
+	const double *coords[3] = { x, y, z };
+	double lo[3], scale[3];
+	std::vector<uint64_t> keys(n);
+	int i, d;
+
+	lo[0] = lo[1] = lo[2] = HUGE_VAL;
+	scale[0] = scale[1] = scale[2] = -HUGE_VAL;
+	for(i = 0; i < n; i++){
+		for(d = 0; d < 3; d++){
+			lo[d] = std::min(lo[d], coords[d][i]);
+			scale[d] = std::max(scale[d], coords[d][i]);
+		}
+	}
+	for(d = 0; d < 3; d++){
+		// scale holds the upper bound until here.
+		scale[d] = (scale[d] > lo[d]) ? maxCoord / (scale[d] - lo[d]) : 0.0;
+	}
+
+	order.resize(n);
+	#pragma omp parallel for default(shared) private(d)
+	for(i = 0; i < n; i++){
+		uint32_t q[3];
+
+		for(d = 0; d < nDims; d++){
+			q[d] = (uint32_t)std::min(maxCoord, std::max(0.0, (coords[d][i] - lo[d]) * scale[d]));
+		}
+
+		keys[i] = hilbert ? hilbertKey(q, nDims, bits) : mortonKey(q, nDims, bits);
+		order[i] = i;
+	}
+
+	radixSortKeys(keys, order);
+}/*}}}*/
+inline void curveOrder(const std::vector<pnt> &points, const bool spherical, const bool hilbert, std::vector<int> &order){/*{{{*/
+	const int n = points.size();
+	std::vector<double> x(n), y(n), z(n);
+
+	for(int i = 0; i < n; i++){
+		x[i] = points[i].x;
+		y[i] = points[i].y;
+		z[i] = points[i].z;
+	}
+
+	curveOrder(x.empty() ? NULL : &x[0], y.empty() ? NULL : &y[0], z.empty() ? NULL : &z[0], n, spherical, hilbert, order);
+}/*}}}*/
+inline void surfaceCurveOrder(const double *x, const double *y, const double *z, const int n, const bool spherical, std::vector<int> &order){/*{{{*/
+	/*
+	 * Orders n points along a Hilbert curve that stays on the mesh surface,
+	 * so that any contiguous piece of the order is a connected region (up to
+	 * the cells along its edge). Planar meshes use the 2D curve of
+	 * curveOrder. On the sphere a 3D curve jumps between points that are
+	 * close in space but not on the surface, so instead the sphere is cut
+	 * into the six faces of an equiangular cubed sphere, and each face is
+	 * walked by a 2D curve that starts at the cube corner where the curve on
+	 * the previous face ended. The faces are visited in the closed loop of
+	 * cube corners listed in corners, with face k running from corners[k] to
+	 * corners[k+1].
+	 */
+	if(!spherical){
+		curveOrder(x, y, z, n, false, true, order);
+		return;
+	}
+
+	static const int corners[7][3] = { {-1,-1,-1}, {-1,-1,1}, {-1,1,1}, {-1,1,-1}, {1,1,-1}, {1,-1,-1}, {-1,-1,-1} };
+	static const int faceAxis[6] = { 0, 2, 1, 2, 0, 1 };
+	const int bits = 30;
+	const double maxCoord = (double)((1u << bits) - 1);
+	// For the face normal to axis a with sign s, faceRank[2*a + (s > 0)] is
+	// its place in the loop, and the 2D curve runs along uAxis from the
+	// entry corner, with vAxis across it. entrySign holds the entry corner.
+	int faceRank[6], uAxis[6], vAxis[6];
+	int entrySign[6][3];
+	std::vector<uint64_t> keys(n);
+	int i, k, d;
+
+	for(k = 0; k < 6; k++){
+		const int a = faceAxis[k];
+		const int f = 2 * a + (corners[k][a] > 0);
+
+		faceRank[f] = k;
+		for(d = 0; d < 3; d++){
+			entrySign[f][d] = corners[k][d];
+			if(corners[k][d] != corners[k+1][d]){
+				uAxis[f] = d;
+			}
+		}
+		vAxis[f] = 3 - a - uAxis[f];
+	}
+
+	order.resize(n);
+	#pragma omp parallel for default(shared) private(d)
+	for(i = 0; i < n; i++){
+		const double p[3] = { x[i], y[i], z[i] };
+		uint32_t q[2];
+		int a = 0;
+
+		for(d = 1; d < 3; d++){
+			if(fabs(p[d]) > fabs(p[a])){
+				a = d;
+			}
+		}
+
+		const int f = 2 * a + (p[a] > 0.0);
+		const int axes[2] = { uAxis[f], vAxis[f] };
+		for(d = 0; d < 2; d++){
+			// Equiangular coordinate in [-1, 1], then 0 at the entry corner.
+			double t = (p[a] != 0.0) ? atan(p[axes[d]] / fabs(p[a])) * 4.0 / M_PI : 0.0;
+			double s = 0.5 * (1.0 - entrySign[f][axes[d]] * t);
+			q[d] = (uint32_t)std::min(maxCoord, std::max(0.0, s * maxCoord));
+		}
+
+		// hilbertKey's 2D curve runs from (0, 0) to (2^bits - 1, 0).
+		keys[i] = ((uint64_t)faceRank[f] << (2 * bits)) | hilbertKey(q, 2, bits);
+		order[i] = i;
+	}
+
+	radixSortKeys(keys, order);
+}/*}}}*/
+inline void surfaceCurveOrder(const std::vector<pnt> &points, const bool spherical, std::vector<int> &order){/*{{{*/
+	const int n = points.size();
+	std::vector<double> x(n), y(n), z(n);
+
+	for(int i = 0; i < n; i++){
+		x[i] = points[i].x;
+		y[i] = points[i].y;
+		z[i] = points[i].z;
+	}
+
+	surfaceCurveOrder(x.empty() ? NULL : &x[0], y.empty() ? NULL : &y[0], z.empty() ? NULL : &z[0], n, spherical, order);
+}/*}}}*/
+inline void rcmOrder(const stride_array<int> &adjacency, std::vector<int> &order){/*{{{*/
+	/*
+	 * Reverse Cuthill-McKee ordering of the graph given by adjacency (e.g.
+	 * cellsOnCell, with -1 marking missing neighbours).
+	 *
+	 * Each connected component is numbered breadth first from a low degree
+	 * start node, visiting neighbours in increasing order of degree, and the
+	 * whole numbering is reversed at the end. The start node of a component
+	 * is the lowest degree node on the last level of a breadth first search
+	 * from its lowest degree node, which puts it near the periphery of the
+	 * graph and keeps the levels (and so the bandwidth) narrow.
+	 */
+	const int n = adjacency.size();
+	std::vector<int> degree(n, 0);
+	std::vector<int> level(n, -1);
+	std::vector<char> visited(n, 0);
+	std::vector<int> neighbours;
+	size_t head, levelStart;
+	int i, j, node, nbr, start, seed, lastLevel;
+
+	for(i = 0; i < n; i++){
+		for(j = 0; j < adjacency.size(i); j++){
+			nbr = adjacency.at(i, j);
+			if(nbr >= 0 && nbr < n && nbr != i){
+				degree[i]++;
+			}
+		}
+	}
+
+	order.clear();
+	order.reserve(n);
+
+	for(seed = 0; seed < n; seed++){
+		if(visited[seed]){
+			continue;
+		}
+
+		// A breadth first search from the first unnumbered node finds the
+		// rest of its component, and the lowest degree node in it.
+		start = seed;
+		levelStart = order.size();
+		order.push_back(seed);
+		level[seed] = 0;
+		for(head = levelStart; head < order.size(); head++){
+			node = order[head];
+			if(degree[node] < degree[start]){
+				start = node;
+			}
+			for(j = 0; j < adjacency.size(node); j++){
+				nbr = adjacency.at(node, j);
+				if(nbr >= 0 && nbr < n && level[nbr] == -1){
+					level[nbr] = level[node] + 1;
+					order.push_back(nbr);
+				}
+			}
+		}
+
+		// Move the start to the periphery.
+		for(head = levelStart; head < order.size(); head++){
+			level[order[head]] = -1;
+		}
+		order.resize(levelStart);
+		order.push_back(start);
+		level[start] = 0;
+		for(head = levelStart; head < order.size(); head++){
+			node = order[head];
+			for(j = 0; j < adjacency.size(node); j++){
+				nbr = adjacency.at(node, j);
+				if(nbr >= 0 && nbr < n && level[nbr] == -1){
+					level[nbr] = level[node] + 1;
+					order.push_back(nbr);
+				}
+			}
+		}
+		lastLevel = level[order.back()];
+		start = -1;
+		for(head = levelStart; head < order.size(); head++){
+			node = order[head];
+			if(level[node] == lastLevel && (start == -1 || degree[node] < degree[start])){
+				start = node;
+			}
+		}
+		order.resize(levelStart);
+
+		// Cuthill-McKee numbering of the component.
+		order.push_back(start);
+		visited[start] = 1;
+		for(head = levelStart; head < order.size(); head++){
+			node = order[head];
+
+			neighbours.clear();
+			for(j = 0; j < adjacency.size(node); j++){
+				nbr = adjacency.at(node, j);
+				if(nbr >= 0 && nbr < n && !visited[nbr]){
+					visited[nbr] = 1;
+					neighbours.push_back(nbr);
+				}
+			}
+
+			for(i = 1; i < (int)neighbours.size(); i++){
+				// Insertion sort by degree, stable for equal degrees.
+				nbr = neighbours[i];
+				for(j = i; j > 0 && degree[neighbours[j-1]] > degree[nbr]; j--){
+					neighbours[j] = neighbours[j-1];
+				}
+				neighbours[j] = nbr;
+			}
+
+			order.insert(order.end(), neighbours.begin(), neighbours.end());
+		}
+	}
+
+	std::reverse(order.begin(), order.end());
+}/*}}}*/
+inline void firstTouchOrder(const stride_array<int> &onCell, const std::vector<int> &cellOrder, const int n, std::vector<int> &order){/*{{{*/
+	/*
+	 * Orders the n edges (or vertices) by the first cell, in cellOrder, that
+	 * lists them in onCell (edgesOnCell or verticesOnCell), so they follow the
+	 * cells they belong to. Elements no cell lists keep their relative order
+	 * at the end.
+	 */
+	std::vector<char> placed(n, 0);
+	int i, j, idx;
+
+	order.clear();
+	order.reserve(n);
+
+	for(i = 0; i < (int)cellOrder.size(); i++){
+		for(j = 0; j < onCell.size(cellOrder[i]); j++){
+			idx = onCell.at(cellOrder[i], j);
+			if(idx >= 0 && idx < n && !placed[idx]){
+				placed[idx] = 1;
+				order.push_back(idx);
+			}
+		}
+	}
+
+	for(idx = 0; idx < n; idx++){
+		if(!placed[idx]){
+			order.push_back(idx);
+		}
+	}
+}/*}}}*/
+inline void invertOrder(const std::vector<int> &order, std::vector<int> &oldToNew){/*{{{*/
+	oldToNew.resize(order.size());
+	for(int i = 0; i < (int)order.size(); i++){
+		oldToNew[order[i]] = i;
+	}
+}/*}}}*/
+template <class T>
+inline void permuteVector(std::vector<T> &v, const std::vector<int> &order){/*{{{*/
+	// Vectors that were never filled (or already released) are left alone.
+	if(v.size() != order.size()){
+		return;
+	}
+
+	std::vector<T> permuted;
+	permuted.reserve(v.size());
+	for(size_t i = 0; i < order.size(); i++){
+		permuted.push_back(v[order[i]]);
+	}
+	v.swap(permuted);
+}/*}}}*/
+template <class T>
+inline void selectVector(std::vector<T> &v, const std::vector<int> &order, const size_t oldSize){/*{{{*/
+	// Like permuteVector, but order may list only some of the oldSize
+	// elements, and the others are dropped.
+	if(v.size() != oldSize){
+		return;
+	}
+
+	std::vector<T> selected;
+	selected.reserve(order.size());
+	for(size_t i = 0; i < order.size(); i++){
+		selected.push_back(v[order[i]]);
+	}
+	v.swap(selected);
+}/*}}}*/
+
+#endif
@@ -3,14 +3,26 @@
 #include <inttypes.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
+#include <map>
 #include <utility>
+#include <algorithm>
+#include <limits>
 #include <math.h>
 #include <assert.h>
 #include <time.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include "netcdf_utils.h"
+#include "pnt.h"
+#include "mesh_reorder.h"
+#include "mesh_partition.h"
+#include "compact_map.h"
+#include "cell_mask_bits.h"
+#include "stage_profiler.h"
 
 #define ID_LEN 10
 
@@ -20,29 +32,66 @@ enum { mergeOp, invertOp, preserveOp };
 
 int nCells, nVertices, nEdges, vertexDegree, maxEdges;
 bool spherical, periodic;
-bool cullMasks = false;
 double sphere_radius, xPeriod, yPeriod;
 string in_history = "";
 string in_file_id = "";
 string in_parent_id = "";
 double in_mesh_spec = 1.0;
 bool outputMap = false;
+netcdf_mpas_output_format outputFormat;
+vector<int> partitionCounts;
+string profileFilename = "";
+stage_profiler profiler;
+size_t memoryBudget = (size_t) 512 << 20;
+string batchFilename = "";
+int maxConcurrent = 1;
+string graphFilename = "culled_graph.info";
+string cellMapPrefix = "";
 
 // Connectivity and location information {{{
 
-vector<int> cullCell;
+vector<uint64_t> cullCell;		// One bit per cell, see cell_mask_bits.h
 vector<int> cellMap;
 vector<int> vertexMap;
 vector<int> edgeMap;
-vector< vector<int> > verticesOnEdge;
-vector< vector<int> > cellsOnEdge;
-vector< vector<int> > cellsOnVertex;
+vector<int> cellKeep;		// Old indices of the kept cells, in their new order
+vector<int> edgeKeep;
+vector<int> vertexKeep;
+vector<int> verticesOnEdge;		// nEdges x 2, base 0
+vector<int> cellsOnEdge;		// nEdges x 2, base 0
+vector<int> cellsOnVertex;		// nVertices x vertexDegree, base 0
 vector<double> areaCell;
 
 // }}}
 
+// One culled output, and the masks to cull it with.
+struct cull_job {
+	string outName;
+	vector<string> maskNames;
+	vector<int> maskOps;
+	bool outputMap;
+};
+
+// A variable carried from the input file by mapAndOutputOtherFields.
+struct carried_variable {
+	int inVarid, outVarid;
+	nc_type type;
+	int ndims;
+	size_t count[NC_MAX_VAR_DIMS];
+	int meshDim;					// Position of nCells, nEdges or nVertices, or -1
+	const vector<int> *keep;		// Old indices of the kept rows
+	const vector<int> *indexMap;	// Map to renumber indices with, or NULL
+	bool boundaryVertex;
+};
+
+int runCull(const string in_name, const cull_job &job);
+int runBatch(const string in_name, const vector<cull_job> &jobs);
+size_t availableMemoryBytes();
+size_t jobMemoryBytes(const string in_name);
+
 /* Input/Marking Functions {{{ */
 int readGridInput(const string inputFilename);
+int readCullCell(const string inputFilename);
 int mergeCellMasks(const string masksFilename, const int maskOp);
 int markCells();
 int markVertices();
@@ -56,13 +105,29 @@ int mapAndOutputGridCoordinates(const string inputFilename, const string outputF
 int mapAndOutputCellFields(const string inputFilename, const string outputFilename);
 int mapAndOutputEdgeFields(const string inputFilename, const string outputFilename);
 int mapAndOutputVertexFields(const string inputFilename, const string outputFilename);
+int mapAndOutputOtherFields(const string inputFilename, const string outputFilename);
+const vector<int>* indexMapFor(const string name);
+template <class T> int cullVariable(const int inId, const int outId, const carried_variable &var);
+template <class T> void compactRows(const T *in, T *out, const int *keep, const size_t nKeep, const size_t firstRow, const size_t rowLen);
+template <class T> void remapIndices(T *values, const size_t n, const vector<int> &indexMap);
+template <class T> int putRows(const int outId, const int varid, const size_t *start, const size_t *count, const T *values);
+long blockRows(const size_t rowBytes);
+void keptRows(const vector<int> &keep, const long firstRow, const long lastRow, long &firstNew, long &lastNew);
+template <class T> NcBool readRows(NcVar *var, const long firstRow, const long nRows, const long width, T *values);
+template <class T> NcBool writeRows(NcVar *var, const long firstRow, const long nRows, const long width, const T *values);
+template <class T> NcBool cullRows(NcVar *inVar, NcVar *outVar, const vector<int> &keep, const long width);
+NcBool cullConnectivity(NcVar *inVar, NcVar *outVar, const vector<int> &keep, const long oldWidth, const long newWidth, const vector<int> &indexMap);
+NcBool outputIndices(NcVar *outVar, const long nRows);
+NcBool fillRows(NcVar *outVar, const long nRows, const double value);
+NcBool outputGraph(const string graphFilename, NcVar *nEocVar, NcVar *cocVar, const long nCellsNew, const long maxEdgesNew);
 int outputCellMap();
 /*}}}*/
 
 void print_usage(){/*{{{*/
 	cout << endl << endl;
 	cout << "Usage:" << endl;
-	cout << "\tMpasCellCuller.x [input_name] [output_name] [[-m/-i/-p] masks_name] [-c]" << endl;
+	cout << "\tMpasCellCuller.x [input_name] [output_name] [[-m/-i/-p] masks_name] [-c] [--partitions N[,N...]] [--memory-budget MB] [--profile file] [--format F] [--deflate N] [--shuffle]" << endl;
+	cout << "\tMpasCellCuller.x [input_name] --batch job_file [--concurrent N] [other options as above]" << endl;
 	cout << endl;
 	cout << "\t\tinput_name:" << endl;
 	cout << "\t\t\tThis argument specifies the input MPAS mesh." << endl;
@@ -87,16 +152,145 @@ void print_usage(){/*{{{*/
         cout << "\t\t\t\tcellMapForward.txt, " << endl;
 	cout << "\t\t\tand output the reverse mapping from new to old mesh in" << endl;
         cout << "\t\t\t\tcellMapBackward.txt." << endl;
+	printPartitionUsage();
+	cout << "\t\t--memory-budget MB:" << endl;
+	cout << "\t\t\tRead, cull and write each variable in blocks of rows" << endl;
+	cout << "\t\t\tthat take at most MB megabytes of buffers (default 512)." << endl;
+	cout << "\t\t\tThe cell, edge and vertex maps and the connectivity used" << endl;
+	cout << "\t\t\tto build them are held on top of this." << endl;
+	cout << "\t\t--batch job_file:" << endl;
+	cout << "\t\t\tRead the input mesh once, and write one culled mesh for" << endl;
+	cout << "\t\t\teach line of job_file, which holds an output name and" << endl;
+	cout << "\t\t\tits -m/-i/-p and -c arguments. Each job logs to" << endl;
+	cout << "\t\t\t<output>.log and writes <output stem>_graph.info." << endl;
+	cout << "\t\t--concurrent N:" << endl;
+	cout << "\t\t\tRun up to N batch jobs at once (default 1), as far as" << endl;
+	cout << "\t\t\tthe available memory allows." << endl;
+	printProfileUsage();
+	netcdf_mpas_print_output_usage();
+}/*}}}*/
+int parseCullerFlags(int &argc, char *argv[]){/*{{{*/
+	/*
+	 * Removes "--memory-budget MB", "--batch job_file" and "--concurrent N"
+	 * from argv, in the same way as netcdf_mpas_parse_output_flags. Returns
+	 * non-zero if a value is missing or invalid.
+	 */
+	int nKept = 1;
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "--memory-budget") == 0){
+			if(i + 1 >= argc || atof(argv[i + 1]) <= 0.0){
+				cout << " ERROR: --memory-budget requires a size in megabytes." << endl;
+				return 1;
+			}
+			memoryBudget = (size_t) ( atof(argv[++i]) * ( 1 << 20 ) );
+		} else if(strcmp(argv[i], "--batch") == 0){
+			if(i + 1 >= argc){
+				cout << " ERROR: --batch requires a job file." << endl;
+				return 1;
+			}
+			batchFilename = argv[++i];
+		} else if(strcmp(argv[i], "--concurrent") == 0){
+			if(i + 1 >= argc || atoi(argv[i + 1]) <= 0){
+				cout << " ERROR: --concurrent requires a positive number of jobs." << endl;
+				return 1;
+			}
+			maxConcurrent = atoi(argv[++i]);
+		} else {
+			argv[nKept++] = argv[i];
+		}
+	}
+
+	argc = nKept;
+	return 0;
+}/*}}}*/
+int parseMaskArguments(const vector<string> &args, cull_job &job){/*{{{*/
+	/*
+	 * Reads the [-m/-i/-p masks_name] and [-c] arguments that follow the
+	 * output name, on the command line or on a line of a job file.
+	 */
+	for ( size_t i = 0; i < args.size(); i++ ) {
+		int op;
+
+		if ( args[i] == "-c" ) {
+			job.outputMap = true;
+			continue;
+		} else if ( args[i] == "-m" ) {
+			op = mergeOp;
+		} else if ( args[i] == "-i" ) {
+			op = invertOp;
+		} else if ( args[i] == "-p" ) {
+			op = preserveOp;
+		} else {
+			cout << " ERROR: Invalid option passed on the command line " << args[i] << ". Exiting..." << endl;
+			return 1;
+		}
+
+		if ( i + 1 >= args.size() ) {
+			cout << " ERROR: " << args[i] << " requires a masks file." << endl;
+			return 1;
+		}
+		job.maskOps.push_back(op);
+		job.maskNames.push_back(args[++i]);
+	}
+
+	return 0;
+}/*}}}*/
+int readJobList(const string jobFilename, vector<cull_job> &jobs){/*{{{*/
+	/*
+	 * Reads one job per line: the output name, followed by the same mask
+	 * arguments as on the command line, e.g.
+	 *		arctic.nc -i arctic_masks.nc -p keep_masks.nc -c
+	 * Empty lines and lines starting with # are skipped.
+	 */
+	ifstream jobFile(jobFilename.c_str());
+	string line;
+	int lineNumber = 0;
+
+	if ( !jobFile.is_open() ) {
+		cout << " ERROR: Could not open job file " << jobFilename << "." << endl;
+		return 1;
+	}
+
+	while ( getline(jobFile, line) ) {
+		istringstream tokens(line);
+		vector<string> args;
+		string token;
+		cull_job job;
+
+		lineNumber++;
+		while ( tokens >> token ) {
+			args.push_back(token);
+		}
+		if ( args.empty() || args[0][0] == '#' ) continue;
+
+		job.outName = args[0];
+		job.outputMap = false;
+		args.erase(args.begin());
+		if ( parseMaskArguments(args, job) ) {
+			cout << " ERROR: In line " << lineNumber << " of " << jobFilename << "." << endl;
+			return 1;
+		}
+		jobs.push_back(job);
+	}
+
+	if ( jobs.empty() ) {
+		cout << " ERROR: No jobs in " << jobFilename << "." << endl;
+		return 1;
+	}
+
+	return 0;
 }/*}}}*/
 
 string gen_random(const int len);
 
 int main ( int argc, char *argv[] ) {
 	int error;
-	string out_name = "culled_mesh.nc";
 	string in_name = "mesh.nc";
-	vector<string> mask_names;
-	vector<int> mask_ops;
+	vector<cull_job> jobs(1);
+
+	jobs[0].outName = "culled_mesh.nc";
+	jobs[0].outputMap = false;
 
 	cout << endl << endl;
 	cout << "************************************************************" << endl;
@@ -107,10 +301,38 @@ int main ( int argc, char *argv[] ) {
 	cout << "  Compiled on " << __DATE__ << " at " << __TIME__ << ".\n";
 	cout << "************************************************************" << endl;
 	cout << endl << endl;
+
+	//
+	//  Pull out the output format, partition, memory, batch and profile
+	//  flags, so the remaining arguments keep their positions.
+	//
+	if ( netcdf_mpas_parse_output_flags(argc, argv, outputFormat)
+			|| parsePartitionFlags(argc, argv, partitionCounts)
+			|| parseCullerFlags(argc, argv)
+			|| parseProfileFlags(argc, argv, profileFilename) ) {
+		print_usage();
+		exit(1);
+	}
+
+	//
+	//  In batch mode, the jobs come from the job file.
+	//
+	if ( batchFilename != "" )
+	{
+		if ( argc != 2 )
+		{
+			cout << " ERROR: With --batch, only the input name is given on the command line. See usage statement" << endl;
+			print_usage();
+			exit(1);
+		}
+		in_name = argv[1];
+		jobs.clear();
+		if ( readJobList(batchFilename, jobs) ) exit(1);
+	}
 	//
 	//  If the input file was not specified, get it now.
 	//
-	if ( argc <= 1 )
+	else if ( argc <= 1 )
 	{
 		cout << "\n";
 		cout << "MPAS_CELL_CULLER:\n";
@@ -122,7 +344,7 @@ int main ( int argc, char *argv[] ) {
 		cout << "MPAS_CELL_CULLER:\n";
 		cout << "  Please enter the output NetCDF MPAS Mesh filename.\n";
 
-		cin >> out_name;
+		cin >> jobs[0].outName;
 	}
 	else if (argc == 2)
 	{
@@ -135,7 +357,7 @@ int main ( int argc, char *argv[] ) {
 	else if (argc == 3)
 	{
 		in_name = argv[1];
-		out_name = argv[2];
+		jobs[0].outName = argv[2];
 	}
 	else if (argc >= 10)
 	{
@@ -146,115 +368,308 @@ int main ( int argc, char *argv[] ) {
 	}
 	else
 	{
-
-		cullMasks = true;
 		in_name = argv[1];
-		out_name = argv[2];
-		bool foundOperation;
-
-		for ( int i = 3; i < argc; i+=2 ) {
-			foundOperation = false;
-			if (strcmp(argv[i], "-m") == 0 ) {
-				mask_ops.push_back(static_cast<int>(mergeOp));
-				foundOperation = true;
-			} else if ( strcmp(argv[i], "-i") == 0 ){
-				mask_ops.push_back(static_cast<int>(invertOp));
-				foundOperation = true;
-			} else if ( strcmp(argv[i], "-p") == 0 ){
-				mask_ops.push_back(static_cast<int>(preserveOp));
-				foundOperation = true;
-			} else if ( strcmp(argv[i], "-c") == 0 ){
-				outputMap = true;
-			} else {
-				cout << " ERROR: Invalid option passed on the command line " << argv[i] << ". Exiting..." << endl;
-				print_usage();
-				exit(1);
-			}
-
-			if (foundOperation) {
-				mask_names.push_back( argv[i+1] );
-			}
+		jobs[0].outName = argv[2];
+		if ( parseMaskArguments(vector<string>(argv + 3, argv + argc), jobs[0]) ) {
+			print_usage();
+			exit(1);
 		}
 	}
 
-
-	if(out_name == in_name){
-		cout << "   ERROR: Input and Output names are the same." << endl;
-		return 1;
+	for ( size_t j = 0; j < jobs.size(); j++ ) {
+		if(jobs[j].outName == in_name){
+			cout << "   ERROR: Input and Output names are the same." << endl;
+			return 1;
+		}
 	}
 
+	//
+	//  Every other variable of the input is carried to the output, so the
+	//  output has to hold their types, and keep indices at one width.
+	//
+	if ( netcdf_mpas_check_dims(in_name) ) exit(1);
+	if ( netcdf_mpas_match_input_types(in_name, outputFormat) ) exit(1);
+
 	srand(time(NULL));
 
 	cout << "Reading input grid." << endl;
+	profiler.start("readGridInput");
 	error = readGridInput(in_name);
 	if(error) return 1;
+	profiler.stop(nCells, "cells");
 
-	if ( cullMasks ) {
+	if ( batchFilename != "" ) {
+		return runBatch(in_name, jobs);
+	}
+
+	return runCull(in_name, jobs[0]);
+}
+
+int runCull(const string in_name, const cull_job &job){/*{{{*/
+	/*
+	 * Culls the input grid, already read by readGridInput, with the masks of
+	 * job, and writes job.outName. Returns the exit code of the run.
+	 */
+	int error;
+	const string out_name = job.outName;
+
+	outputMap = job.outputMap;
+
+	profiler.start("readCullCell");
+	error = readCullCell(in_name);
+	if(error) return 1;
+	profiler.stop(nCells, "cells");
+
+	if ( !job.maskNames.empty() ) {
 		cout << "Reading in mask information." << endl;
-		for ( int i = 0; i < mask_names.size(); i++ ) {
-			error = mergeCellMasks(mask_names[i], mask_ops[i]);
+		for ( int i = 0; i < job.maskNames.size(); i++ ) {
+			profiler.start("mergeCellMasks");
+			error = mergeCellMasks(job.maskNames[i], job.maskOps[i]);
 			if(error) return 1;
+			profiler.stop(nCells, "cells");
 		}
 	}
 
 	cout << "Marking cells for removal." << endl;
+	profiler.start("markCells");
 	error = markCells();
 	if(error) return 1;
+	profiler.stop(nCells, "cells");
 
 	cout << "Marking vertices for removal." << endl;
+	profiler.start("markVertices");
 	error = markVertices();
 	if(error) return 1;
+	profiler.stop(nVertices, "vertices");
 
 	cout << "Marking edges for removal." << endl;
+	profiler.start("markEdges");
 	error = markEdges();
 	if(error) return 1;
+	profiler.stop(nEdges, "edges");
 
 	cout << "Writing grid dimensions" << endl;
+	profiler.start("outputGridDimensions");
 	if(error = outputGridDimensions(out_name)){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop();
 
 	cout << "Writing grid attributes" << endl;
+	profiler.start("outputGridAttributes");
 	if(error = outputGridAttributes(in_name, out_name)){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop();
 
 	cout << "Writing grid coordinates" << endl;
+	profiler.start("mapAndOutputGridCoordinates");
 	if(error = mapAndOutputGridCoordinates(in_name, out_name)){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop(nCells + nEdges + nVertices, "elements");
 
-	cout << "Mapping and writing cell fields and culled_graph.info" << endl;
+	cout << "Mapping and writing cell fields and " << graphFilename << endl;
+	profiler.start("mapAndOutputCellFields");
 	if(error = mapAndOutputCellFields(in_name, out_name)){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop(nCells, "cells");
 
 	cout << "Mapping and writing edge fields" << endl;
+	profiler.start("mapAndOutputEdgeFields");
 	if(error = mapAndOutputEdgeFields(in_name, out_name)){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop(nEdges, "edges");
 
 	cout << "Mapping and writing vertex fields" << endl;
+	profiler.start("mapAndOutputVertexFields");
 	if(error = mapAndOutputVertexFields(in_name, out_name)){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
+	}
+	profiler.stop(nVertices, "vertices");
+
+	cout << "Mapping and writing other fields" << endl;
+	profiler.start("mapAndOutputOtherFields");
+	if(error = mapAndOutputOtherFields(in_name, out_name)){
+		cout << "Error - " << error << endl;
+		return error;
 	}
+	profiler.stop(nCells + nEdges + nVertices, "elements");
 
 	cout << "Outputting cell map" << endl;
 	if (outputMap) {
+		profiler.start("outputCellMap");
 		if(error = outputCellMap()){
 			cout << "Error - " << error << endl;
-			exit(error);
+			return error;
 		}
+		profiler.stop(nCells, "cells");
+	}
+
+	profiler.report(cout);
+	if(profileFilename != ""){
+		if(profiler.write_json(profileFilename, "MpasCellCuller.x")) return 1;
 	}
 
 	return 0;
-}
+}/*}}}*/
+int runBatch(const string in_name, const vector<cull_job> &jobs){/*{{{*/
+	/*
+	 * Runs each job in a child process, forked once the input grid is read,
+	 * so the jobs share its arrays (copy-on-write) instead of reading it
+	 * again. netCDF isn't thread safe, which rules out threads. Up to
+	 * maxConcurrent jobs run at once, fewer if their maps and buffers would
+	 * not fit in the available memory. The parent runs no OpenMP region before
+	 * forking, so each job starts its own thread pool.
+	 *
+	 * Each job writes what it prints to <output>.log, its graph to
+	 * <output stem>_graph.info, with -c its cell maps to
+	 * <output stem>_cellMapForward.txt and _cellMapBackward.txt, and with
+	 * --profile its stages to <output stem>_profile.json.
+	 */
+	int concurrent = min((size_t) maxConcurrent, jobs.size());
+	map<pid_t, size_t> running;
+	size_t next = 0;
+	int failed = 0;
+
+	if ( concurrent > 1 ) {
+		const size_t jobBytes = jobMemoryBytes(in_name);
+		const size_t freeBytes = availableMemoryBytes();
+
+		if ( freeBytes > 0 && (size_t) concurrent * jobBytes > freeBytes ) {
+			concurrent = max(freeBytes / jobBytes, (size_t) 1);
+			cout << "Only " << freeBytes / ( 1 << 20 ) << " MB of memory is available and each job needs about "
+				<< jobBytes / ( 1 << 20 ) << " MB, so running " << concurrent << " jobs at once." << endl;
+		}
+	}
+
+	cout << "Running " << jobs.size() << " jobs, " << concurrent << " at a time." << endl;
+
+	while ( next < jobs.size() || !running.empty() ) {
+		if ( next < jobs.size() && running.size() < (size_t) concurrent ) {
+			const string stem = jobs[next].outName.substr(0, jobs[next].outName.rfind(".nc"));
+			const string logName = jobs[next].outName + ".log";
+			pid_t pid;
+
+			cout.flush();
+			pid = fork();
+
+			if ( pid == 0 ) {
+				graphFilename = stem + "_graph.info";
+				cellMapPrefix = stem + "_";
+				if ( profileFilename != "" ) {
+					profileFilename = stem + "_profile.json";
+				}
+				srand(time(NULL) + getpid());
+
+				if ( !freopen(logName.c_str(), "w", stdout) ) exit(1);
+				exit(runCull(in_name, jobs[next]));
+			} else if ( pid < 0 ) {
+				cout << "   ERROR: Could not start job for " << jobs[next].outName << "." << endl;
+				failed++;
+			} else {
+				cout << "Started job " << next + 1 << ": " << jobs[next].outName << " (log in " << logName << ")" << endl;
+				running[pid] = next;
+			}
+			next++;
+			continue;
+		}
+
+		int status;
+		pid_t pid = wait(&status);
+		if ( pid < 0 ) break;
+
+		const size_t j = running[pid];
+		running.erase(pid);
+		if ( WIFEXITED(status) && WEXITSTATUS(status) == 0 ) {
+			cout << "Finished job " << j + 1 << ": " << jobs[j].outName << endl;
+		} else {
+			cout << "   ERROR: Job " << j + 1 << " (" << jobs[j].outName << ") failed, see " << jobs[j].outName << ".log" << endl;
+			failed++;
+		}
+	}
+
+	profiler.report(cout);
+	if(profileFilename != ""){
+		if(profiler.write_json(profileFilename, "MpasCellCuller.x")) return 1;
+	}
+
+	return failed ? 1 : 0;
+}/*}}}*/
+size_t availableMemoryBytes(){/*{{{*/
+	/*
+	 * Returns the memory that can be allocated without swapping, i.e.
+	 * MemAvailable from /proc/meminfo, which unlike MemFree counts the page
+	 * cache that the kernel can reclaim. Falls back to the free pages where
+	 * /proc/meminfo is missing, and returns 0 if neither is known.
+	 */
+	ifstream meminfo("/proc/meminfo");
+	string key;
+	size_t kB;
+
+	while ( meminfo >> key >> kB ) {
+		if ( key == "MemAvailable:" ) {
+			return kB << 10;
+		}
+		meminfo.ignore(numeric_limits<streamsize>::max(), '\n');
+	}
+
+#ifdef _SC_AVPHYS_PAGES
+	return (size_t) sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}/*}}}*/
+size_t jobMemoryBytes(const string in_name){/*{{{*/
+	/*
+	 * Estimates what one cull job allocates on top of the arrays it shares
+	 * with the parent: the cell, edge and vertex maps and kept index lists
+	 * (8 bytes per element), the bit per cell of cullCell, and the blocks
+	 * variables are streamed in. memoryBudget only caps those blocks; a
+	 * stage holds at most about three times its variable (input, output and
+	 * index rows), so the largest variable in the input bounds them too.
+	 * With --partitions, the culled cellsOnCell and cell centers are read
+	 * back and partitioned in full.
+	 */
+	size_t largest = 0;
+	size_t bytes = (size_t) 8 * ( (size_t) nCells + nEdges + nVertices ) + nCells / 8;
+	int ncid, nVars;
+
+	if ( nc_open(in_name.c_str(), NC_NOWRITE, &ncid) == NC_NOERR ) {
+		nc_inq_nvars(ncid, &nVars);
+		for(int varid = 0; varid < nVars; varid++){
+			int ndims, dimids[NC_MAX_VAR_DIMS];
+			nc_type type;
+			size_t size = 0, len;
+
+			nc_inq_var(ncid, varid, NULL, &type, &ndims, dimids, NULL);
+			nc_inq_type(ncid, type, NULL, &size);
+			for(int d = 0; d < ndims; d++){
+				nc_inq_dimlen(ncid, dimids[d], &len);
+				size *= len;
+			}
+			largest = max(largest, size);
+		}
+		nc_close(ncid);
+	} else {
+		largest = memoryBudget;
+	}
+	bytes += min(memoryBudget, 3 * largest);
+
+	if ( !partitionCounts.empty() ) {
+		bytes += (size_t) nCells * ( 4 * maxEdges + 48 );
+	}
+
+	return bytes;
+}/*}}}*/
 
 int outputCellMap(){/*{{{*/
 
@@ -262,7 +677,7 @@ int outputCellMap(){/*{{{*/
 	ofstream outputfileForward, outputfileBackward;
 
 	// forwards mapping
-	outputfileForward.open("cellMapForward.txt");
+	outputfileForward.open((cellMapPrefix + "cellMapForward.txt").c_str());
 
 	for (iCell=0 ; iCell < nCells ; iCell++) {
 
@@ -290,7 +705,7 @@ int outputCellMap(){/*{{{*/
 
 	}
 
-	outputfileBackward.open("cellMapBackward.txt");
+	outputfileBackward.open((cellMapPrefix + "cellMapBackward.txt").c_str());
 
 	for (iCell=0 ; iCell < nCellsNew ; iCell++) {
 
@@ -307,10 +722,6 @@ int outputCellMap(){/*{{{*/
 
 /* Input/Marking Functions {{{ */
 int readGridInput(const string inputFilename){/*{{{*/
-	double *xcell, *ycell,*zcell;
-	double *xvertex, *yvertex,*zvertex;
-	int *cellsonvertex_list, *verticesonedge_list, *cellsonedge_list;
-
 #ifdef _DEBUG
 	cout << endl << endl << "Begin function: readGridInput" << endl << endl;
 #endif
@@ -382,220 +793,166 @@ int readGridInput(const string inputFilename){/*{{{*/
 	areaCell.resize(nCells);
 	netcdf_mpas_read_areacell ( inputFilename, nCells, &areaCell[0] );
 
-#ifdef _DEBUG
-	cout << " Read cullCell" << endl;
-#endif
-	cullCell.clear();
-	cullCell.resize(nCells);
-	netcdf_mpas_read_cullcell ( inputFilename, nCells, &cullCell[0] );
-
-	// Build cellsOnVertex information
-	cellsonvertex_list = new int[nVertices * vertexDegree];
+	// Read cellsOnVertex, verticesOnEdge and cellsOnEdge, which are needed
+	// through the whole run. They are kept flat, to keep the footprint of
+	// large meshes down.
+	cellsOnVertex.resize((size_t) nVertices * vertexDegree);
+	verticesOnEdge.resize((size_t) nEdges * 2);
+	cellsOnEdge.resize((size_t) nEdges * 2);
 
 #ifdef _DEBUG
 	cout << " Read cellsOnVertex" << endl;
 #endif
-	netcdf_mpas_read_cellsonvertex ( inputFilename, nVertices, vertexDegree, cellsonvertex_list );
-	cellsOnVertex.resize(nVertices);
-
-	for(int i = 0; i < nVertices; i++){
-		for(int j = 0; j < vertexDegree; j++){
-			// Subtract 1 to convert into base 0 (c index space).
-			cellsOnVertex.at(i).push_back(cellsonvertex_list[i*vertexDegree + j] - 1);
-		}
-	}
-
-	delete[] cellsonvertex_list;
-
-	// Build verticesOnEdge information
-	verticesonedge_list = new int[nEdges * 2];
-	verticesOnEdge.clear();
-	verticesOnEdge.resize(nEdges);
-
+	netcdf_mpas_read_cellsonvertex ( inputFilename, nVertices, vertexDegree, &cellsOnVertex[0] );
 #ifdef _DEBUG
 	cout << " Read verticesOnEdge" << endl;
 #endif
-	netcdf_mpas_read_verticesonedge ( inputFilename, nEdges, verticesonedge_list );
-	for(int i = 0; i < nEdges; i++){
-		// Subtract 1 to convert into base 0 (c index space).
-		verticesOnEdge.at(i).push_back(verticesonedge_list[i*2] - 1);
-		verticesOnEdge.at(i).push_back(verticesonedge_list[i*2+1] - 1);
-	}
-
-	delete[] verticesonedge_list;
-
-	// Build cellsOnEdge information
-	cellsonedge_list = new int[nEdges * 2];
-	cellsOnEdge.clear();
-	cellsOnEdge.resize(nEdges);
-
+	netcdf_mpas_read_verticesonedge ( inputFilename, nEdges, &verticesOnEdge[0] );
 #ifdef _DEBUG
 	cout << " Read cellsOnEdge" << endl;
 #endif
-	netcdf_mpas_read_cellsonedge ( inputFilename, nEdges, cellsonedge_list );
-	for(int i = 0; i < nEdges; i++){
-		// Subtract 1 to convert into base 0 (c index space).
-		cellsOnEdge.at(i).push_back(cellsonedge_list[i*2] - 1);
-		cellsOnEdge.at(i).push_back(cellsonedge_list[i*2+1] - 1);
-	}
+	netcdf_mpas_read_cellsonedge ( inputFilename, nEdges, &cellsOnEdge[0] );
 
-	delete[] cellsonedge_list;
+	// Subtract 1 to convert into base 0 (c index space).
+	for(size_t i = 0; i < cellsOnVertex.size(); i++){
+		cellsOnVertex[i]--;
+	}
+	for(size_t i = 0; i < cellsOnEdge.size(); i++){
+		verticesOnEdge[i]--;
+		cellsOnEdge[i]--;
+	}
 
 	return 0;
 }/*}}}*/
-int mergeCellMasks(const string masksFilename, const int maskOp){/*{{{*/
-	int nRegions, nTransects;
-	int *regionCellMasks, *transectCellMasks, *cellSeedMask, *flattenedMask;
-	int i, j;
-
-	nRegions = netcdf_mpas_read_dim(masksFilename, "nRegions");
-	nTransects = netcdf_mpas_read_dim(masksFilename, "nTransects");
-
-	regionCellMasks = new int[nCells*nRegions];
-	transectCellMasks = new int[nCells*nTransects];
-	cellSeedMask = new int[nCells];
-	flattenedMask = new int[nCells];
-
-	netcdf_mpas_read_regioncellmasks(masksFilename, nCells, nRegions, regionCellMasks);
-	netcdf_mpas_read_transectcellmasks(masksFilename, nCells, nTransects, transectCellMasks);
-	netcdf_mpas_read_cellseedmask(masksFilename, nCells, cellSeedMask);
-
-	for ( i = 0; i < nCells; i++){
-		flattenedMask[i] = cellSeedMask[i];
-		for ( j = 0; j < nRegions; j++){
-			flattenedMask[i] = max(flattenedMask[i], regionCellMasks[i * nRegions + j]);
-		}
+int readCullCell(const string inputFilename){/*{{{*/
+	/*
+	 * Reads cullCell from the input grid into one bit per cell. It is read
+	 * by runCull rather than readGridInput, so that with --batch it runs in
+	 * each job, and the parent runs no OpenMP region before forking.
+	 */
+#ifdef _DEBUG
+	cout << " Read cullCell" << endl;
+#endif
+	cullCell.assign(maskWords(nCells), 0);
 
-		for ( j = 0; j < nTransects; j++ ) {
-			flattenedMask[i] = max(flattenedMask[i], transectCellMasks[i * nTransects + j]);
-		}
+	NcFile in(inputFilename.c_str(), NcFile::ReadOnly);
+	if ( orMaskVariable(in, "cullCell", nCells, memoryBudget, cullCell) ) {
+		cout << " ERROR: Can't read cullCell from " << inputFilename << "." << endl;
+		return 1;
 	}
 
-	if ( maskOp == invertOp || maskOp == mergeOp ) {
-		if ( maskOp == invertOp ) {
-			for (i = 0; i < nCells; i++){
-				flattenedMask[i] = (flattenedMask[i] + 1) % 2;
-			}
-		}
+	return 0;
+}/*}}}*/
+int mergeCellMasks(const string masksFilename, const int maskOp){/*{{{*/
+	/*
+	 * Folds the cell seed, region and transect masks of masksFilename into
+	 * cullCell. The masks are read as bytes, a block of cells at a time, and
+	 * ORed into one bit per cell, so no more than memoryBudget bytes of them
+	 * are held whatever the number of regions and transects.
+	 */
+	vector<uint64_t> flattenedMask(maskWords(nCells), 0);
+	const char *maskNames[] = { "cellSeedMask", "regionCellMasks", "transectCellMasks" };
+	NcFile masks(masksFilename.c_str(), NcFile::ReadOnly);
+
+	if ( !masks.is_valid() ) {
+		cout << " ERROR: Can't open " << masksFilename << "." << endl;
+		return 1;
+	}
+	if ( netcdf_mpas_check_dims(masksFilename) ) {
+		return 1;
+	}
 
-		for ( i = 0; i < nCells; i++ ){
-			cullCell[i] = max(cullCell[i], flattenedMask[i]);
-		}
-	} else if ( maskOp == preserveOp ) {
-		for ( i = 0; i < nCells; i++ ) {
-			if ( flattenedMask[i] && cullCell[i] ) {
-				cullCell[i] = 0;
-			}
+	for ( int i = 0; i < 3; i++ ) {
+		if ( orMaskVariable(masks, maskNames[i], nCells, memoryBudget, flattenedMask) ) {
+			cout << " ERROR: " << maskNames[i] << " in " << masksFilename << " does not have the cells of the input grid." << endl;
+			return 1;
 		}
 	}
 
-	delete[] cellSeedMask;
-	delete[] transectCellMasks;
-	delete[] regionCellMasks;
-	delete[] flattenedMask;
+	if ( maskOp == preserveOp ) {
+		preserveMaskBits(cullCell, flattenedMask, nCells);
+	} else {
+		mergeMaskBits(cullCell, flattenedMask, nCells, maskOp == invertOp);
+	}
 
 	return 0;
 }/*}}}*/
 int markCells(){/*{{{*/
-	int new_idx;
+	/*
+	 * Flags the kept cells in cellMap in parallel, and numbers them with a
+	 * prefix sum (compactMap), so they keep their order.
+	 */
 	int cells_removed;
-	cellMap.clear();
+
 	cellMap.resize(nCells);
 
-	new_idx = 0;
-	cells_removed = 0;
+	#pragma omp parallel for default(shared) schedule(static)
 	for(int iCell = 0; iCell < nCells; iCell++){
 		// Remove all cells with negative area, and cells that shouldn't be in the grid.
-		if(areaCell.at(iCell) < 0 || cullCell.at(iCell) == 1){
-			cellMap.at(iCell) = -1;
-			cells_removed++;
-		} else {
-			cellMap.at(iCell) = new_idx;
-			new_idx++;
-		}
+		cellMap[iCell] = !(areaCell[iCell] < 0 || maskBit(cullCell, iCell));
 	}
 
+	cells_removed = nCells - compactMap(cellMap, cellKeep);
+
+	// Neither is needed once the cells are marked.
+	vector<double>().swap(areaCell);
+	vector<uint64_t>().swap(cullCell);
+
 	cout << "Removing " << cells_removed << " cells." << endl;
 
 	return 0;
 }/*}}}*/
 int markVertices(){/*{{{*/
-	bool keep_vertex;
-	int iCell, new_idx;
 	int vertices_removed;
 
-	vertexMap.clear();
 	vertexMap.resize(nVertices);
 
-	new_idx = 0;
-	vertices_removed = 0;
+	#pragma omp parallel for default(shared) schedule(static)
 	for(int iVertex = 0; iVertex < nVertices; iVertex++){
+		const int *cov = &cellsOnVertex[(size_t) iVertex * vertexDegree];
+		bool keep_vertex = false;
 
 		// Only keep vertices that have at least one cell connected to them
 		// after cell removal.
-		keep_vertex = false;
-		for(int j = 0; j < cellsOnVertex.at(iVertex).size(); j++){
-			iCell = cellsOnVertex.at(iVertex).at(j);
-			if(iCell != -1) {
-				keep_vertex = keep_vertex || (cellMap.at(iCell) != -1);
+		for(int j = 0; j < vertexDegree; j++){
+			if(cov[j] != -1) {
+				keep_vertex = keep_vertex || (cellMap[cov[j]] != -1);
 			}
 		}
 
-		if(keep_vertex){
-			vertexMap.at(iVertex) = new_idx;
-			new_idx++;
-		} else {
-			vertexMap.at(iVertex) = -1;
-			vertices_removed++;
-		}
+		vertexMap[iVertex] = keep_vertex;
 	}
 
+	vertices_removed = nVertices - compactMap(vertexMap, vertexKeep);
+
 	cout << "Removing " << vertices_removed << " vertices." << endl;
 
 	return 0;
 }/*}}}*/
 int markEdges(){/*{{{*/
-	bool keep_edge;
-	int vertex1, vertex2;
-	int cell1, cell2;
-	int new_idx;
 	int edges_removed;
 
-	edgeMap.clear();
 	edgeMap.resize(nEdges);
 
-	new_idx = 0;
-	edges_removed = 0;
+	#pragma omp parallel for default(shared) schedule(static)
 	for(int iEdge = 0; iEdge < nEdges; iEdge++){
-		vertex1 = verticesOnEdge.at(iEdge).at(0);
-		vertex2 = verticesOnEdge.at(iEdge).at(1);
-		cell1 = cellsOnEdge.at(iEdge).at(0);
-		cell2 = cellsOnEdge.at(iEdge).at(1);
+		const int vertex1 = verticesOnEdge[(size_t) iEdge * 2];
+		const int vertex2 = verticesOnEdge[(size_t) iEdge * 2 + 1];
+		const int cell1 = cellsOnEdge[(size_t) iEdge * 2];
+		const int cell2 = cellsOnEdge[(size_t) iEdge * 2 + 1];
+		bool keep_edge;
 
 		// Only keep an edge if it has two vertices
 		// after vertex removal and at least one cell
 		// after cell removal.
-		if(vertex2 != -1){
-			keep_edge = (vertexMap.at(vertex1) != -1 && vertexMap.at(vertex2) != -1);
-		} else {
-			keep_edge = false;
-		}
-
-		if(cell2 != -1){
-			keep_edge = keep_edge && (cellMap.at(cell1) != -1 || cellMap.at(cell2) != -1);
-		} else {
-			keep_edge = keep_edge && (cellMap.at(cell1) != -1);
-		}
+		keep_edge = (vertex1 != -1 && vertex2 != -1 && vertexMap[vertex1] != -1 && vertexMap[vertex2] != -1);
+		keep_edge = keep_edge && ((cell1 != -1 && cellMap[cell1] != -1) || (cell2 != -1 && cellMap[cell2] != -1));
 
-		if(keep_edge){
-			edgeMap.at(iEdge) = new_idx;
-			new_idx++;
-		} else {
-			edgeMap.at(iEdge) = -1;
-			edges_removed++;
-		}
+		edgeMap[iEdge] = keep_edge;
 	}
 
+	edges_removed = nEdges - compactMap(edgeMap, edgeKeep);
+
 	cout << "Removing " << edges_removed << " edges." << endl;
 
 	return 0;
@@ -619,7 +976,7 @@ int outputGridDimensions( const string outputFilename ){/*{{{*/
 	NcError err(NcError::verbose_nonfatal);
 
 	// open the scvtmesh file
-	NcFile grid(outputFilename.c_str(), NcFile::Replace, NULL, 0, NcFile::Offset64Bits);
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Replace, outputFormat);
 
 	/*
 	for(vec_int_itr = edgesOnCell.begin(); vec_int_itr != edgesOnCell.end(); ++vec_int_itr){
@@ -680,7 +1037,7 @@ int outputGridAttributes( const string inputFilename, const string outputFilenam
 	NcError err(NcError::verbose_nonfatal);
 
 	// open the scvtmesh file
-	NcFile grid(outputFilename.c_str(), NcFile::Write);
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Write, outputFormat);
 
 	// check to see if the file was opened
 	if(!grid.is_valid()) return NC_ERR;
@@ -749,202 +1106,49 @@ int mapAndOutputGridCoordinates( const string inputFilename, const string output
 	 * **********************************************************************/
 	// Return this code to the OS in case of failure.
 	static const int NC_ERR = 2;
+	static const char *dimNames[] = { "nCells", "nEdges", "nVertices" };
+	static const char *elements[] = { "Cell", "Edge", "Vertex" };
+	static const char *coordinates[] = { "lat", "lon", "x", "y", "z" };
+	const vector<int> *keeps[] = { &cellKeep, &edgeKeep, &vertexKeep };
 
 	// set error behaviour (matches fortran behaviour)
 	NcError err(NcError::verbose_nonfatal);
 
-	// open the scvtmesh file
-	NcFile grid(outputFilename.c_str(), NcFile::Write);
+	// open the input and scvtmesh files
+	NcFile in(inputFilename.c_str(), NcFile::ReadOnly);
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Write, outputFormat);
 
-	// check to see if the file was opened
-	if(!grid.is_valid()) return NC_ERR;
+	// check to see if the files were opened
+	if(!in.is_valid() || !grid.is_valid()) return NC_ERR;
 
-	// fetch dimensions
-	NcDim *nCellsDim = grid.get_dim( "nCells" );
-	NcDim *nEdgesDim = grid.get_dim( "nEdges" );
-	NcDim *nVerticesDim = grid.get_dim( "nVertices" );
-
-	int nCellsNew = nCellsDim->size();
-	int nEdgesNew = nEdgesDim->size();
-	int nVerticesNew = nVerticesDim->size();
-
-	//Define nc variables
-	NcVar *xCellVar, *yCellVar, *zCellVar, *xEdgeVar, *yEdgeVar, *zEdgeVar, *xVertexVar, *yVertexVar, *zVertexVar;
-	NcVar *lonCellVar, *latCellVar, *lonEdgeVar, *latEdgeVar, *lonVertexVar, *latVertexVar;
-	NcVar *idx2cellVar, *idx2edgeVar, *idx2vertexVar;
-
-	int i, idx_map;
+	//Define nc variables. Coordinates first, then the index of each element.
+	NcVar *outVars[3][6];
 
-	double *xOld, *yOld, *zOld, *latOld, *lonOld;
-	double *xNew, *yNew, *zNew, *latNew, *lonNew;
-	int *idxToNew;
+	for(int m = 0; m < 3; m++){
+		NcDim *dim = grid.get_dim( dimNames[m] );
 
-	// Build and write cell coordinate arrays
-	xOld = new double[nCells];
-	yOld = new double[nCells];
-	zOld = new double[nCells];
-	latOld = new double[nCells];
-	lonOld = new double[nCells];
-
-	xNew = new double[nCellsNew];
-	yNew = new double[nCellsNew];
-	zNew = new double[nCellsNew];
-	latNew = new double[nCellsNew];
-	lonNew = new double[nCellsNew];
-	idxToNew = new int[nCellsNew];
-
-	netcdf_mpas_read_xyzcell ( inputFilename, nCells, xOld, yOld, zOld );
-	netcdf_mpas_read_latloncell ( inputFilename, nCells, latOld, lonOld );
-
-	idx_map = 0;
-	for(int iCell = 0; iCell < nCells; iCell++){
-		if(cellMap.at(iCell) != -1){
-			xNew[idx_map] = xOld[iCell];
-			yNew[idx_map] = yOld[iCell];
-			zNew[idx_map] = zOld[iCell];
-			latNew[idx_map] = latOld[iCell];
-			lonNew[idx_map] = lonOld[iCell];
-			idxToNew[idx_map] = idx_map+1;
-			idx_map++;
+		for(int c = 0; c < 5; c++){
+			string name = string(coordinates[c]) + elements[m];
+			if (!(outVars[m][c] = grid.add_var(name.c_str(), ncDouble, dim))) return NC_ERR;
 		}
+		string name = string("indexTo") + elements[m] + "ID";
+		if (!(outVars[m][5] = grid.add_var(name.c_str(), ncInt, dim))) return NC_ERR;
 	}
 
-	if (!(latCellVar = grid.add_var("latCell", ncDouble, nCellsDim))) return NC_ERR;
-	if (!latCellVar->put(latNew,nCellsNew)) return NC_ERR;
-	if (!(lonCellVar = grid.add_var("lonCell", ncDouble, nCellsDim))) return NC_ERR;
-	if (!lonCellVar->put(lonNew,nCellsNew)) return NC_ERR;
-	if (!(xCellVar = grid.add_var("xCell", ncDouble, nCellsDim))) return NC_ERR;
-	if (!xCellVar->put(xNew,nCellsNew)) return NC_ERR;
-	if (!(yCellVar = grid.add_var("yCell", ncDouble, nCellsDim))) return NC_ERR;
-	if (!yCellVar->put(yNew,nCellsNew)) return NC_ERR;
-	if (!(zCellVar = grid.add_var("zCell", ncDouble, nCellsDim))) return NC_ERR;
-	if (!zCellVar->put(zNew,nCellsNew)) return NC_ERR;
-	if (!(idx2cellVar = grid.add_var("indexToCellID", ncInt, nCellsDim))) return NC_ERR;
-	if (!idx2cellVar->put(idxToNew,nCellsNew)) return NC_ERR;
-	delete[] xOld;
-	delete[] yOld;
-	delete[] zOld;
-	delete[] latOld;
-	delete[] lonOld;
-
-	delete[] xNew;
-	delete[] yNew;
-	delete[] zNew;
-	delete[] latNew;
-	delete[] lonNew;
-	delete[] idxToNew;
-
-	//Build and write edge coordinate arrays
-	xOld = new double[nEdges];
-	yOld = new double[nEdges];
-	zOld = new double[nEdges];
-	latOld = new double[nEdges];
-	lonOld = new double[nEdges];
-
-	xNew = new double[nEdgesNew];
-	yNew = new double[nEdgesNew];
-	zNew = new double[nEdgesNew];
-	latNew = new double[nEdgesNew];
-	lonNew = new double[nEdgesNew];
-	idxToNew = new int[nEdgesNew];
-
-	netcdf_mpas_read_xyzedge ( inputFilename, nEdges, xOld, yOld, zOld );
-	netcdf_mpas_read_latlonedge ( inputFilename, nEdges, latOld, lonOld );
-
-	idx_map = 0;
-	for(int iEdge = 0; iEdge < nEdges; iEdge++){
-		if(edgeMap.at(iEdge) != -1){
-			xNew[idx_map] = xOld[iEdge];
-			yNew[idx_map] = yOld[iEdge];
-			zNew[idx_map] = zOld[iEdge];
-			latNew[idx_map] = latOld[iEdge];
-			lonNew[idx_map] = lonOld[iEdge];
-			idxToNew[idx_map] = idx_map+1;
-			idx_map++;
-		}
-	}
+	// Cull each coordinate on its own, a block at a time.
+	for(int m = 0; m < 3; m++){
+		for(int c = 0; c < 5; c++){
+			string name = string(coordinates[c]) + elements[m];
+			NcVar *inVar;
 
-	if (!(latEdgeVar = grid.add_var("latEdge", ncDouble, nEdgesDim))) return NC_ERR;
-	if (!latEdgeVar->put(latNew,nEdgesNew)) return NC_ERR;
-	if (!(lonEdgeVar = grid.add_var("lonEdge", ncDouble, nEdgesDim))) return NC_ERR;
-	if (!lonEdgeVar->put(lonNew,nEdgesNew)) return NC_ERR;
-	if (!(xEdgeVar = grid.add_var("xEdge", ncDouble, nEdgesDim))) return NC_ERR;
-	if (!xEdgeVar->put(xNew,nEdgesNew)) return NC_ERR;
-	if (!(yEdgeVar = grid.add_var("yEdge", ncDouble, nEdgesDim))) return NC_ERR;
-	if (!yEdgeVar->put(yNew,nEdgesNew)) return NC_ERR;
-	if (!(zEdgeVar = grid.add_var("zEdge", ncDouble, nEdgesDim))) return NC_ERR;
-	if (!zEdgeVar->put(zNew,nEdgesNew)) return NC_ERR;
-	if (!(idx2edgeVar = grid.add_var("indexToEdgeID", ncInt, nEdgesDim))) return NC_ERR;
-	if (!idx2edgeVar->put(idxToNew, nEdgesNew)) return NC_ERR;
-	delete[] xOld;
-	delete[] yOld;
-	delete[] zOld;
-	delete[] latOld;
-	delete[] lonOld;
-
-	delete[] xNew;
-	delete[] yNew;
-	delete[] zNew;
-	delete[] latNew;
-	delete[] lonNew;
-	delete[] idxToNew;
-
-	//Build and write vertex coordinate arrays
-	xOld = new double[nVertices];
-	yOld = new double[nVertices];
-	zOld = new double[nVertices];
-	latOld = new double[nVertices];
-	lonOld = new double[nVertices];
-
-	xNew = new double[nVerticesNew];
-	yNew = new double[nVerticesNew];
-	zNew = new double[nVerticesNew];
-	latNew = new double[nVerticesNew];
-	lonNew = new double[nVerticesNew];
-	idxToNew = new int[nVerticesNew];
-
-	netcdf_mpas_read_xyzvertex ( inputFilename, nVertices, xOld, yOld, zOld );
-	netcdf_mpas_read_latlonvertex ( inputFilename, nVertices, latOld, lonOld );
-
-	idx_map = 0;
-	for(int iVertex = 0; iVertex < nVertices; iVertex++){
-		if(vertexMap.at(iVertex) != -1){
-			xNew[idx_map] = xOld[iVertex];
-			yNew[idx_map] = yOld[iVertex];
-			zNew[idx_map] = zOld[iVertex];
-			latNew[idx_map] = latOld[iVertex];
-			lonNew[idx_map] = lonOld[iVertex];
-			idxToNew[idx_map] = idx_map+1;
-			idx_map++;
+			if (!(inVar = in.get_var(name.c_str()))) return NC_ERR;
+			if (!cullRows<double>(inVar, outVars[m][c], *keeps[m], 1)) return NC_ERR;
 		}
+		if (!outputIndices(outVars[m][5], keeps[m]->size())) return NC_ERR;
 	}
 
-	if (!(latVertexVar = grid.add_var("latVertex", ncDouble, nVerticesDim))) return NC_ERR;
-	if (!latVertexVar->put(latNew,nVerticesNew)) return NC_ERR;
-	if (!(lonVertexVar = grid.add_var("lonVertex", ncDouble, nVerticesDim))) return NC_ERR;
-	if (!lonVertexVar->put(lonNew,nVerticesNew)) return NC_ERR;
-	if (!(xVertexVar = grid.add_var("xVertex", ncDouble, nVerticesDim))) return NC_ERR;
-	if (!xVertexVar->put(xNew,nVerticesNew)) return NC_ERR;
-	if (!(yVertexVar = grid.add_var("yVertex", ncDouble, nVerticesDim))) return NC_ERR;
-	if (!yVertexVar->put(yNew,nVerticesNew)) return NC_ERR;
-	if (!(zVertexVar = grid.add_var("zVertex", ncDouble, nVerticesDim))) return NC_ERR;
-	if (!zVertexVar->put(zNew,nVerticesNew)) return NC_ERR;
-	if (!(idx2vertexVar = grid.add_var("indexToVertexID", ncInt, nVerticesDim))) return NC_ERR;
-	if (!idx2vertexVar->put(idxToNew, nVerticesNew)) return NC_ERR;
-	delete[] xOld;
-	delete[] yOld;
-	delete[] zOld;
-	delete[] latOld;
-	delete[] lonOld;
-
-	delete[] xNew;
-	delete[] yNew;
-	delete[] zNew;
-	delete[] latNew;
-	delete[] lonNew;
-	delete[] idxToNew;
-
 	grid.close();
+	in.close();
 
 	return 0;
 }/*}}}*/
@@ -968,173 +1172,107 @@ int mapAndOutputCellFields( const string inputFilename, const string outputFilen
 	// set error behaviour (matches fortran behaviour)
 	NcError err(NcError::verbose_nonfatal);
 
-	// open the scvtmesh file
-	NcFile grid(outputFilename.c_str(), NcFile::Write);
+	// open the input and scvtmesh files
+	NcFile in(inputFilename.c_str(), NcFile::ReadOnly);
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Write, outputFormat);
 
-	// check to see if the file was opened
-	if(!grid.is_valid()) return NC_ERR;
+	// check to see if the files were opened
+	if(!in.is_valid() || !grid.is_valid()) return NC_ERR;
 
 	// fetch dimensions
 	NcDim *nCellsDim = grid.get_dim( "nCells" );
-	NcDim *nEdgesDim = grid.get_dim( "nEdges" );
 	NcDim *maxEdgesDim;
 	NcDim *maxEdges2Dim;
 
-	int nCellsNew = nCellsDim->size();
-	int nEdgesNew = nEdgesDim->size();
+	long nCellsNew = nCellsDim->size();
 	int maxEdgesNew;
-	int edgeCount;
 
 	// define nc variables
 	NcVar *cocVar, *nEocVar, *eocVar, *vocVar, *areacVar;
 	NcVar *cDensVar;
+	NcVar *nEocIn, *eocIn, *cocIn, *vocIn, *areacIn, *cDensIn;
 
-	double *meshDensityOld, *meshDensityNew;
-	double *areaCellNew;
-	int *tmp_arr_old, *nEdgesOnCellOld, *nEdgesOnCellNew;
-	int *tmp_arr_new;
-
-	tmp_arr_old = new int[nCells*maxEdges];
-	nEdgesOnCellOld = new int[nCells];
-	nEdgesOnCellNew = new int[nCellsNew];
-
-	netcdf_mpas_read_edgesoncell ( inputFilename, nCells, maxEdges, tmp_arr_old );
-	netcdf_mpas_read_nedgesoncell ( inputFilename, nCells, nEdgesOnCellOld );
+	if (!(nEocIn = in.get_var("nEdgesOnCell"))) return NC_ERR;
+	if (!(eocIn = in.get_var("edgesOnCell"))) return NC_ERR;
+	if (!(cocIn = in.get_var("cellsOnCell"))) return NC_ERR;
+	if (!(vocIn = in.get_var("verticesOnCell"))) return NC_ERR;
+	if (!(areacIn = in.get_var("areaCell"))) return NC_ERR;
+	{
+		NcError quiet(NcError::silent_nonfatal); // Don't error if meshDensity isn't found.
+		cDensIn = in.get_var("meshDensity");
+	}
 
 	// Need to map nEdgesOnCell to get maxEdges
 	maxEdgesNew = 0;
-	for(int iCell = 0; iCell < nCells; iCell++){
-		if(cellMap.at(iCell) != -1){
-			nEdgesOnCellNew[cellMap.at(iCell)] = nEdgesOnCellOld[iCell];
-			maxEdgesNew = max(maxEdgesNew, nEdgesOnCellNew[cellMap.at(iCell)]);
+	{
+		const long rows = blockRows(sizeof(int));
+		vector<int> nEdgesOnCellOld;
+
+		for(long firstRow = 0; firstRow < nCells; firstRow += rows){
+			const long lastRow = min(firstRow + rows, (long) nCells);
+			long firstNew, lastNew;
+
+			keptRows(cellKeep, firstRow, lastRow, firstNew, lastNew);
+			if(firstNew == lastNew) continue;
+
+			nEdgesOnCellOld.resize(lastRow - firstRow);
+			if (!readRows(nEocIn, firstRow, lastRow - firstRow, 1, &nEdgesOnCellOld[0])) return NC_ERR;
+			for(long k = firstNew; k < lastNew; k++){
+				maxEdgesNew = max(maxEdgesNew, nEdgesOnCellOld[cellKeep[k] - firstRow]);
+			}
 		}
 	}
-	tmp_arr_new = new int[nCells * maxEdgesNew];
 
 	// Write maxEdges and maxEdges2 to output file.
 	if (!(maxEdgesDim =		grid.add_dim(	"maxEdges",		maxEdgesNew)			)) return NC_ERR;
 	if (!(maxEdges2Dim =	grid.add_dim(	"maxEdges2",	maxEdgesNew*2)			)) return NC_ERR;
 
-	// Write nEdgesOncell to output file
 	if (!(nEocVar = grid.add_var("nEdgesOnCell", ncInt, nCellsDim))) return NC_ERR;
-	if (!nEocVar->put(nEdgesOnCellNew,nCellsNew)) return NC_ERR;
-
-	// Map edgesOnCell
-	for(int iCell = 0; iCell < nCells; iCell++){
-#ifdef _DEBUG
-		cout << "On cell: " << iCell << endl;
-#endif
-		if(cellMap.at(iCell) != -1){
-			for(int j = 0; j < maxEdgesNew; j++){
-				int iEdge = tmp_arr_old[iCell*maxEdges + j] - 1;
-
-				if(iEdge != -1 && iEdge < edgeMap.size()){
-					tmp_arr_new[cellMap.at(iCell)*maxEdgesNew + j] = edgeMap.at(iEdge)+1;
-				} else {
-					tmp_arr_new[cellMap.at(iCell)*maxEdgesNew + j] = 0;
-				}
-
-#ifdef _DEBUG
-				cout << "    Mapping edge: " << iEdge << " to " << tmp_arr_new[cellMap.at(iCell)*maxEdgesNew + j] << " dbg info: " << tmp_arr_old[iCell*maxEdges + j] << " " << j << endl;
-#endif
-			}
-		}
-	}
-
 	if (!(eocVar = grid.add_var("edgesOnCell", ncInt, nCellsDim, maxEdgesDim))) return NC_ERR;
-	if (!eocVar->put(tmp_arr_new,nCellsNew,maxEdgesNew)) return NC_ERR;
-
-	netcdf_mpas_read_cellsoncell ( inputFilename, nCells, maxEdges, tmp_arr_old );
-
-	// Map cellsOnCell, and determine number of edges in graph.
-	edgeCount = 0;
-	for(int iCell = 0; iCell < nCells; iCell++){
-		if(cellMap.at(iCell) != -1){
-			for(int j = 0; j < nEdgesOnCellOld[iCell]; j++){
-				int coc = tmp_arr_old[iCell*maxEdges + j] - 1;
-
-				if(coc != -1 && coc < nCells && cellMap.at(coc) < nCellsNew && cellMap.at(coc) != -1){
-					tmp_arr_new[cellMap.at(iCell)*maxEdgesNew + j] = cellMap.at(coc)+1;
-					edgeCount++;
-				} else {
-					tmp_arr_new[cellMap.at(iCell)*maxEdgesNew + j] = 0;
-				}
-			}
-		}
-	}
-	edgeCount = edgeCount / 2;
-
-	// Build graph.info file
-	ofstream graph("culled_graph.info");
-	graph << nCellsNew << " " << edgeCount << endl;
-	for(int iCell = 0; iCell < nCellsNew; iCell++){
-		for(int j = 0; j < nEdgesOnCellNew[iCell]; j++){
-			if (tmp_arr_new[iCell * maxEdgesNew + j] != 0) {
-				graph << tmp_arr_new[iCell * maxEdgesNew + j] << " ";
-			}
-		}
-		graph << endl;
-	}
-	graph.close();
-
 	if (!(cocVar = grid.add_var("cellsOnCell", ncInt, nCellsDim, maxEdgesDim))) return NC_ERR;
-	if (!cocVar->put(tmp_arr_new,nCellsNew,maxEdgesNew)) return NC_ERR;
-	delete[] nEdgesOnCellNew;
-	delete[] nEdgesOnCellOld;
-
-	netcdf_mpas_read_verticesoncell ( inputFilename, nCells, maxEdges, tmp_arr_old );
-
-	// Map verticesOnCell
-	for(int iCell = 0; iCell < nCells; iCell++){
-		if(cellMap.at(iCell) != -1){
-			for(int j = 0; j < maxEdgesNew; j++){
-				int iVertex = tmp_arr_old[iCell*maxEdges + j] - 1;
-
-				if(iVertex != -1 && iVertex < vertexMap.size()){
-					tmp_arr_new[cellMap.at(iCell)*maxEdgesNew + j] = vertexMap.at(iVertex)+1;
-				} else {
-					tmp_arr_new[cellMap.at(iCell)*maxEdgesNew + j] = 0;
-				}
-			}
-		}
-	}
-
 	if (!(vocVar = grid.add_var("verticesOnCell", ncInt, nCellsDim, maxEdgesDim))) return NC_ERR;
-	if (!vocVar->put(tmp_arr_new,nCellsNew,maxEdgesNew)) return NC_ERR;
-
-	delete[] tmp_arr_old;
-	delete[] tmp_arr_new;
-
-	// Map areaCell
-	areaCellNew = new double[nCellsNew];
-
-	for(int iCell = 0; iCell < nCells; iCell++){
-		if(cellMap.at(iCell) != -1){
-			areaCellNew[cellMap.at(iCell)] = areaCell.at(iCell);
-		}
-	}
-
 	if (!(areacVar = grid.add_var("areaCell", ncDouble, nCellsDim))) return NC_ERR;
-	if (!areacVar->put(areaCellNew,nCellsNew)) return NC_ERR;
-
-	delete[] areaCellNew;
-
-	// Map meshDensity
-	meshDensityOld = new double[nCells];
-	meshDensityNew = new double[nCellsNew];
+	if (!(cDensVar = grid.add_var("meshDensity", ncDouble, nCellsDim))) return NC_ERR;
 
-	netcdf_mpas_read_mesh_density ( inputFilename, nCells, meshDensityOld );
+	// Map nEdgesOnCell, edgesOnCell and cellsOnCell
+	if (!cullRows<int>(nEocIn, nEocVar, cellKeep, 1)) return NC_ERR;
+	if (!cullConnectivity(eocIn, eocVar, cellKeep, maxEdges, maxEdgesNew, edgeMap)) return NC_ERR;
+	if (!cullConnectivity(cocIn, cocVar, cellKeep, maxEdges, maxEdgesNew, cellMap)) return NC_ERR;
 
-	for(int iCell = 0; iCell < nCells; iCell++){
-		if(cellMap.at(iCell) != -1){
-			meshDensityNew[cellMap.at(iCell)] = meshDensityOld[iCell];
+	// Build graph.info file
+	if (!outputGraph(graphFilename, nEocVar, cocVar, nCellsNew, maxEdgesNew)) return NC_ERR;
+
+	// Partition the culled graph along a Hilbert curve through the kept cells.
+	// The partitioner needs the whole culled graph, so it is read back from
+	// the culled file.
+	if(!partitionCounts.empty()){
+		vector<double> xCellNew(nCellsNew), yCellNew(nCellsNew), zCellNew(nCellsNew);
+		vector<int> nEdgesOnCellNew(nCellsNew), cellsOnCellNew(nCellsNew * maxEdgesNew);
+		vector<int> curve;
+
+		if (!readRows(grid.get_var("xCell"), 0, nCellsNew, 1, &xCellNew[0])) return NC_ERR;
+		if (!readRows(grid.get_var("yCell"), 0, nCellsNew, 1, &yCellNew[0])) return NC_ERR;
+		if (!readRows(grid.get_var("zCell"), 0, nCellsNew, 1, &zCellNew[0])) return NC_ERR;
+		if (!readRows(nEocVar, 0, nCellsNew, 1, &nEdgesOnCellNew[0])) return NC_ERR;
+		if (!readRows(cocVar, 0, nCellsNew, maxEdgesNew, &cellsOnCellNew[0])) return NC_ERR;
+
+		surfaceCurveOrder(&xCellNew[0], &yCellNew[0], &zCellNew[0], nCellsNew, spherical, curve);
+		if(writePartitionFiles(graphFilename, curve, &cellsOnCellNew[0], &nEdgesOnCellNew[0], maxEdgesNew, 1, partitionCounts)){
+			return 1;
 		}
 	}
 
+	// Map verticesOnCell, areaCell and meshDensity
+	if (!cullConnectivity(vocIn, vocVar, cellKeep, maxEdges, maxEdgesNew, vertexMap)) return NC_ERR;
+	if (!cullRows<double>(areacIn, areacVar, cellKeep, 1)) return NC_ERR;
+	if(cDensIn){
+		if (!cullRows<double>(cDensIn, cDensVar, cellKeep, 1)) return NC_ERR;
+	} else {
+		if (!fillRows(cDensVar, nCellsNew, 1.0)) return NC_ERR;
+	}
 
-	//Write meshDensity
-	if (!(cDensVar = grid.add_var("meshDensity", ncDouble, nCellsDim))) return NC_ERR;
-	if (!cDensVar->put(meshDensityNew,nCellsNew)) return NC_ERR;
+	grid.close();
+	in.close();
 
 	return 0;
 }/*}}}*/
@@ -1158,227 +1296,183 @@ int mapAndOutputEdgeFields( const string inputFilename, const string outputFilen
 	// set error behaviour (matches fortran behaviour)
 	NcError err(NcError::verbose_nonfatal);
 
-	// open the scvtmesh file
-	NcFile grid(outputFilename.c_str(), NcFile::Write);
+	// open the input and scvtmesh files
+	NcFile in(inputFilename.c_str(), NcFile::ReadOnly);
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Write, outputFormat);
 
-	// check to see if the file was opened
-	if(!grid.is_valid()) return NC_ERR;
+	// check to see if the files were opened
+	if(!in.is_valid() || !grid.is_valid()) return NC_ERR;
 
 	// fetch dimensions
 	NcDim *nEdgesDim = grid.get_dim( "nEdges" );
 	NcDim *maxEdges2Dim = grid.get_dim( "maxEdges2" );
-	NcDim *vertexDegreeDim = grid.get_dim( "vertexDegree" );
 	NcDim *twoDim = grid.get_dim( "TWO" );
 
 	// define nc variables
 	NcVar *coeVar, *nEoeVar, *eoeVar, *voeVar, *woeVar;
 	NcVar *angleVar;
 	NcVar *dcEdgeVar, *dvEdgeVar;
+	NcVar *nEoeIn, *eoeIn, *woeIn, *angleIn, *dcEdgeIn, *dvEdgeIn;
 
-	int nEdgesNew = nEdgesDim->size();
-	int maxEdges2New = maxEdges2Dim->size();
-	int vertexDegree = vertexDegreeDim->size();
-	int two = twoDim->size();
-
-	int *nEdgesOnEdgeOld, *nEdgesOnEdgeNew;
-	int *edgesOnEdgeOld, *edgesOnEdgeNew;
-	int *cellsOnEdgeOld, *cellsOnEdgeNew;
-	int *verticesOnEdgeOld, *verticesOnEdgeNew;
-	double *weightsOnEdgeOld, *weightsOnEdgeNew;
-	double *dvEdgeOld, *dvEdgeNew;
-	double *dcEdgeOld, *dcEdgeNew;
-	double *angleEdgeOld, *angleEdgeNew;
-
-	// Need to map cellsOnEdge and verticesOnEdge
-	cellsOnEdgeOld = new int[nEdges*2];
-	cellsOnEdgeNew = new int[nEdgesNew*2];
-	verticesOnEdgeOld = new int[nEdges*2];
-	verticesOnEdgeNew = new int[nEdgesNew*2];
-
-	netcdf_mpas_read_cellsonedge( inputFilename, nEdges, cellsOnEdgeOld);
-	netcdf_mpas_read_verticesonedge( inputFilename, nEdges, verticesOnEdgeOld);
-
-	// Map cellsOnEdge and verticesOnEdge
-	for(int iEdge = 0; iEdge < nEdges; iEdge++){
-		if(edgeMap.at(iEdge) != -1){
-			int cell1, cell2;
-			int vertex1, vertex2;
+	const long nEdgesNew = nEdgesDim->size();
+	const long maxEdges2New = maxEdges2Dim->size();
+	long maxEdges2Old;
+
+	if (!(nEoeIn = in.get_var("nEdgesOnEdge"))) return NC_ERR;
+	if (!(eoeIn = in.get_var("edgesOnEdge"))) return NC_ERR;
+	if (!(woeIn = in.get_var("weightsOnEdge"))) return NC_ERR;
+	if (!(dcEdgeIn = in.get_var("dcEdge"))) return NC_ERR;
+	if (!(dvEdgeIn = in.get_var("dvEdge"))) return NC_ERR;
+	if (!(angleIn = in.get_var("angleEdge"))) return NC_ERR;
+	maxEdges2Old = eoeIn->get_dim(1)->size();
+
+	if (!(voeVar = grid.add_var("verticesOnEdge", ncInt, nEdgesDim, twoDim))) return NC_ERR;
+	if (!(coeVar = grid.add_var("cellsOnEdge", ncInt, nEdgesDim, twoDim))) return NC_ERR;
+	if (!(nEoeVar = grid.add_var("nEdgesOnEdge", ncInt, nEdgesDim))) return NC_ERR;
+	if (!(eoeVar = grid.add_var("edgesOnEdge", ncInt, nEdgesDim, maxEdges2Dim))) return NC_ERR;
+	if (!(woeVar = grid.add_var("weightsOnEdge", ncDouble, nEdgesDim, maxEdges2Dim))) return NC_ERR;
+	if (!(dcEdgeVar = grid.add_var("dcEdge", ncDouble, nEdgesDim))) return NC_ERR;
+	if (!(dvEdgeVar = grid.add_var("dvEdge", ncDouble, nEdgesDim))) return NC_ERR;
+	if (!(angleVar = grid.add_var("angleEdge", ncDouble, nEdgesDim))) return NC_ERR;
 
-			cell1 = cellsOnEdgeOld[iEdge * 2] - 1;
-			cell2 = cellsOnEdgeOld[iEdge * 2 + 1] - 1;
-			vertex1 = verticesOnEdgeOld[iEdge * 2] - 1;
-			vertex2 = verticesOnEdgeOld[iEdge * 2 + 1] - 1;
+	// Map cellsOnEdge and verticesOnEdge, which are already in memory.
+	{
+		const long rows = blockRows(4 * sizeof(int));
+		vector<int> cellsOnEdgeNew, verticesOnEdgeNew;
+
+		for(long firstNew = 0; firstNew < nEdgesNew; firstNew += rows){
+			const long lastNew = min(firstNew + rows, nEdgesNew);
+
+			cellsOnEdgeNew.assign((lastNew - firstNew) * 2, 0);
+			verticesOnEdgeNew.assign((lastNew - firstNew) * 2, 0);
+
+			for(long k = firstNew; k < lastNew; k++){
+				const int iEdge = edgeKeep[k];
+				const int cell1 = cellsOnEdge[iEdge * 2];
+				const int cell2 = cellsOnEdge[iEdge * 2 + 1];
+				const int vertex1 = verticesOnEdge[iEdge * 2];
+				const int vertex2 = verticesOnEdge[iEdge * 2 + 1];
+				const bool kept1 = (cell1 != -1 && cellMap.at(cell1) != -1);
+				const bool kept2 = (cell2 != -1 && cellMap.at(cell2) != -1);
+				int *coe = &cellsOnEdgeNew[(k - firstNew) * 2];
+				int *voe = &verticesOnEdgeNew[(k - firstNew) * 2];
 
 #ifdef _DEBUG
-			cout << "Defining edge: " << endl;
-			cout << "   Old cell1: " << cell1 << endl;
-			cout << "   Old cell2: " << cell2 << endl;
-			cout << "   Old vertex1: " << vertex1 << endl;
-			cout << "   Old vertex2: " << vertex2 << endl;
+				cout << "Defining edge: " << endl;
+				cout << "   Old cell1: " << cell1 << endl;
+				cout << "   Old cell2: " << cell2 << endl;
+				cout << "   Old vertex1: " << vertex1 << endl;
+				cout << "   Old vertex2: " << vertex2 << endl;
 #endif
 
-			if(cell1 != -1 && cell2 != -1){
-				if(cellMap.at(cell1) != -1 && cellMap.at(cell2) != -1){
-					cellsOnEdgeNew[edgeMap.at(iEdge)*2] = cellMap.at(cell1) + 1;
-					cellsOnEdgeNew[edgeMap.at(iEdge)*2+1] = cellMap.at(cell2) + 1;
-
-					verticesOnEdgeNew[edgeMap.at(iEdge)*2] = vertexMap.at(vertex1) + 1;
-					verticesOnEdgeNew[edgeMap.at(iEdge)*2+1] = vertexMap.at(vertex2) + 1;
-				} else if (cellMap.at(cell2) == -1){
-					cellsOnEdgeNew[edgeMap.at(iEdge)*2] = cellMap.at(cell1) + 1;
-					cellsOnEdgeNew[edgeMap.at(iEdge)*2+1] = 0;
-
-					verticesOnEdgeNew[edgeMap.at(iEdge)*2] = vertexMap.at(vertex1) + 1;
-					verticesOnEdgeNew[edgeMap.at(iEdge)*2+1] = vertexMap.at(vertex2) + 1;
-				} else if (cellMap.at(cell1) == -1){
-					cellsOnEdgeNew[edgeMap.at(iEdge)*2] = cellMap.at(cell2) + 1;
-					cellsOnEdgeNew[edgeMap.at(iEdge)*2+1] = 0;
-
-					verticesOnEdgeNew[edgeMap.at(iEdge)*2] = vertexMap.at(vertex2) + 1;
-					verticesOnEdgeNew[edgeMap.at(iEdge)*2+1] = vertexMap.at(vertex1) + 1;
-				}
-			} else if(cell2 == -1){
-				if(cellMap.at(cell1) != -1){
-					cellsOnEdgeNew[edgeMap.at(iEdge)*2] = cellMap.at(cell1) + 1;
-					cellsOnEdgeNew[edgeMap.at(iEdge)*2+1] = 0;
-
-					verticesOnEdgeNew[edgeMap.at(iEdge)*2] = vertexMap.at(vertex1) + 1;
-					verticesOnEdgeNew[edgeMap.at(iEdge)*2+1] = vertexMap.at(vertex2) + 1;
+				// The remaining cell goes first, and the vertices are
+				// flipped with it to keep the orientation of the edge.
+				if(kept1){
+					coe[0] = cellMap.at(cell1) + 1;
+					coe[1] = kept2 ? cellMap.at(cell2) + 1 : 0;
+					voe[0] = vertexMap.at(vertex1) + 1;
+					voe[1] = vertexMap.at(vertex2) + 1;
+				} else if(kept2){
+					coe[0] = cellMap.at(cell2) + 1;
+					coe[1] = 0;
+					voe[0] = vertexMap.at(vertex2) + 1;
+					voe[1] = vertexMap.at(vertex1) + 1;
 				} else {
 					cout << "ERROR: Edge mask is 1, but has no cells." << endl;
 				}
-			} else if(cell1 == -1){
-				cellsOnEdgeNew[edgeMap.at(iEdge)*2] = cellMap.at(cell2) + 1;
-				cellsOnEdgeNew[edgeMap.at(iEdge)*2+1] = 0;
-
-				verticesOnEdgeNew[edgeMap.at(iEdge)*2] = vertexMap.at(vertex2) + 1;
-				verticesOnEdgeNew[edgeMap.at(iEdge)*2+1] = vertexMap.at(vertex1) + 1;
-			} else {
-				cout << "ERROR: Edge mask is 1, but has no cells." << endl;
-			}
 
 #ifdef _DEBUG
-			cout << "   New cell1: " << cellsOnEdgeNew[edgeMap.at(iEdge)*2] << endl;
-			cout << "   New cell2: " << cellsOnEdgeNew[edgeMap.at(iEdge)*2+1] << endl;
-			cout << "   New vertex1: " << verticesOnEdgeNew[edgeMap.at(iEdge)*2] << endl;
-			cout << "   New vertex2: " << verticesOnEdgeNew[edgeMap.at(iEdge)*2+1] << endl;
+				cout << "   New cell1: " << coe[0] << endl;
+				cout << "   New cell2: " << coe[1] << endl;
+				cout << "   New vertex1: " << voe[0] << endl;
+				cout << "   New vertex2: " << voe[1] << endl;
 #endif
+			}
+
+			if (!writeRows(voeVar, firstNew, lastNew - firstNew, 2, &verticesOnEdgeNew[0])) return NC_ERR;
+			if (!writeRows(coeVar, firstNew, lastNew - firstNew, 2, &cellsOnEdgeNew[0])) return NC_ERR;
 		}
 	}
 
-	if (!(voeVar = grid.add_var("verticesOnEdge", ncInt, nEdgesDim, twoDim))) return NC_ERR;
-	if (!voeVar->put(verticesOnEdgeNew,nEdgesNew,2)) return NC_ERR;
-	if (!(coeVar = grid.add_var("cellsOnEdge", ncInt, nEdgesDim, twoDim))) return NC_ERR;
-	if (!coeVar->put(cellsOnEdgeNew,nEdgesNew,2)) return NC_ERR;
-
-	// Don't delete cellsOnEdgeOld yet. It's needed to map edgesOnEdge and weightsOnEdge
-	delete[] cellsOnEdgeNew;
-	delete[] verticesOnEdgeOld;
-	delete[] verticesOnEdgeNew;
-
 	// Map edgesOnEdge, nEdgesOnEdge, and weightsOnEdge
-	nEdgesOnEdgeOld = new int[nEdges];
-	nEdgesOnEdgeNew = new int[nEdges];
-	edgesOnEdgeOld = new int[nEdges*maxEdges*2];
-	edgesOnEdgeNew = new int[nEdgesNew*maxEdges2New];
-	weightsOnEdgeOld = new double[nEdges*maxEdges*2];
-	weightsOnEdgeNew = new double[nEdgesNew*maxEdges2New];
-
-	netcdf_mpas_read_nedgesonedge( inputFilename, nEdges, nEdgesOnEdgeOld );
-	netcdf_mpas_read_edgesonedge( inputFilename, nEdges, maxEdges*2, edgesOnEdgeOld );
-	netcdf_mpas_read_weightsonedge( inputFilename, nEdges, maxEdges*2, weightsOnEdgeOld );
-
-	for(int iEdge = 0; iEdge < nEdges; iEdge++){
-		int edgeCount = 0;
-		if(edgeMap.at(iEdge) != -1){
-			int cell1, cell2;
-
-			cell1 = cellsOnEdgeOld[iEdge * 2] - 1;
-			cell2 = cellsOnEdgeOld[iEdge * 2 + 1] - 1;
-
-			if(cell1 != -1){
-				cell1 == cellMap.at(cell1);
-			}
+	{
+		const long rowWidth = max(maxEdges2Old, maxEdges2New);
+		const long rows = blockRows((maxEdges2Old + rowWidth) * (sizeof(int) + sizeof(double)) + 2 * sizeof(int));
+		vector<int> nEdgesOnEdgeOld, edgesOnEdgeOld, nEdgesOnEdgeNew, edgesOnEdgeNew;
+		vector<double> weightsOnEdgeOld, weightsOnEdgeNew;
+
+		for(long firstRow = 0; firstRow < nEdges; firstRow += rows){
+			const long lastRow = min(firstRow + rows, (long) nEdges);
+			long firstNew, lastNew;
+
+			keptRows(edgeKeep, firstRow, lastRow, firstNew, lastNew);
+			if(firstNew == lastNew) continue;
+
+			nEdgesOnEdgeOld.resize(lastRow - firstRow);
+			edgesOnEdgeOld.resize((lastRow - firstRow) * maxEdges2Old);
+			weightsOnEdgeOld.resize((lastRow - firstRow) * maxEdges2Old);
+			if (!readRows(nEoeIn, firstRow, lastRow - firstRow, 1, &nEdgesOnEdgeOld[0])) return NC_ERR;
+			if (!readRows(eoeIn, firstRow, lastRow - firstRow, maxEdges2Old, &edgesOnEdgeOld[0])) return NC_ERR;
+			if (!readRows(woeIn, firstRow, lastRow - firstRow, maxEdges2Old, &weightsOnEdgeOld[0])) return NC_ERR;
+
+			// Rows are built rowWidth wide, in case an edge lost a cell with
+			// more edges than any kept cell, and then cut to maxEdges2New.
+			nEdgesOnEdgeNew.resize(lastNew - firstNew);
+			edgesOnEdgeNew.assign((lastNew - firstNew) * rowWidth, 0);
+			weightsOnEdgeNew.assign((lastNew - firstNew) * rowWidth, 0.0);
+
+			#pragma omp parallel for default(shared)
+			for(long k = firstNew; k < lastNew; k++){
+				const long iEdge = edgeKeep[k];
+				const int *eoeOld = &edgesOnEdgeOld[(iEdge - firstRow) * maxEdges2Old];
+				const double *woeOld = &weightsOnEdgeOld[(iEdge - firstRow) * maxEdges2Old];
+				int *eoe = &edgesOnEdgeNew[(k - firstNew) * rowWidth];
+				double *woe = &weightsOnEdgeNew[(k - firstNew) * rowWidth];
+				const int nOld = min((long) nEdgesOnEdgeOld[iEdge - firstRow], maxEdges2Old);
+				int edgeCount = 0;
+
+				// Only edges that had two cells have neighbours.
+				if(cellsOnEdge[iEdge * 2] != -1 && cellsOnEdge[iEdge * 2 + 1] != -1){
+					for(int j = 0; j < nOld; j++){
+						int jEdge = eoeOld[j] - 1;
+
+						if(jEdge >= 0 && jEdge < nEdges){
+							eoe[j] = edgeMap[jEdge] + 1;
+							woe[j] = woeOld[j];
+							edgeCount++;
+						}
+					}
+				}
 
-			if(cell2 != -1){
-				cell2 == cellMap.at(cell1);
+				for(int j = edgeCount; j < rowWidth; j++){
+					eoe[j] = 0;
+					woe[j] = 0.0;
+				}
+				nEdgesOnEdgeNew[k - firstNew] = edgeCount;
 			}
 
-			if(cell1 != -1 && cell2 != -1){
-				for(int j = 0; j < nEdgesOnEdgeOld[iEdge]; j++){
-					int eoe = edgesOnEdgeOld[iEdge*maxEdges*2 + j] - 1;
-
-					if(eoe != -1 && eoe < edgeMap.size()){
-						edgesOnEdgeNew[edgeMap.at(iEdge)*maxEdges2New + j] = edgeMap.at(eoe) + 1;
-						weightsOnEdgeNew[edgeMap.at(iEdge)*maxEdges2New + j] = weightsOnEdgeOld[iEdge*maxEdges*2 + j];
-						edgeCount++;
-					} else {
-						edgesOnEdgeNew[edgeMap.at(iEdge)*maxEdges2New + j] = 0;
-						weightsOnEdgeNew[edgeMap.at(iEdge)*maxEdges2New + j] = 0;
+			if(rowWidth != maxEdges2New){
+				for(long k = 0; k < lastNew - firstNew; k++){
+					for(long j = 0; j < maxEdges2New; j++){
+						edgesOnEdgeNew[k * maxEdges2New + j] = edgesOnEdgeNew[k * rowWidth + j];
+						weightsOnEdgeNew[k * maxEdges2New + j] = weightsOnEdgeNew[k * rowWidth + j];
 					}
 				}
-			} else if ( cell1 == -1  || cell2 == -1){
-				for(int j = 0; j < nEdgesOnEdgeOld[iEdge]; j++){
-					edgesOnEdgeNew[edgeMap.at(iEdge)*maxEdges2New + j] = 0;
-					weightsOnEdgeNew[edgeMap.at(iEdge)*maxEdges2New + j] = 0;
-				}
 			}
 
-			for(int j = edgeCount; j < maxEdges2New; j++){
-				edgesOnEdgeNew[edgeMap.at(iEdge)*maxEdges2New + j] = 0;
-				weightsOnEdgeNew[edgeMap.at(iEdge)*maxEdges2New + j] = 0;
-			}
-			nEdgesOnEdgeNew[edgeMap.at(iEdge)] = edgeCount;
+			if (!writeRows(nEoeVar, firstNew, lastNew - firstNew, 1, &nEdgesOnEdgeNew[0])) return NC_ERR;
+			if (!writeRows(eoeVar, firstNew, lastNew - firstNew, maxEdges2New, &edgesOnEdgeNew[0])) return NC_ERR;
+			if (!writeRows(woeVar, firstNew, lastNew - firstNew, maxEdges2New, &weightsOnEdgeNew[0])) return NC_ERR;
 		}
 	}
 
-	if (!(nEoeVar = grid.add_var("nEdgesOnEdge", ncInt, nEdgesDim))) return NC_ERR;
-	if (!nEoeVar->put(nEdgesOnEdgeNew,nEdgesNew)) return NC_ERR;
-	if (!(eoeVar = grid.add_var("edgesOnEdge", ncInt, nEdgesDim, maxEdges2Dim))) return NC_ERR;
-	if (!eoeVar->put(edgesOnEdgeNew,nEdgesNew,maxEdges2New)) return NC_ERR;
-	if (!(woeVar = grid.add_var("weightsOnEdge", ncDouble, nEdgesDim, maxEdges2Dim))) return NC_ERR;
-	if (!woeVar->put(weightsOnEdgeNew,nEdgesNew,maxEdges2New)) return NC_ERR;
-
-	delete[] nEdgesOnEdgeOld;
-	delete[] cellsOnEdgeOld;
-	delete[] edgesOnEdgeOld;
-	delete[] edgesOnEdgeNew;
-	delete[] weightsOnEdgeOld;
-	delete[] weightsOnEdgeNew;
-
 	// Map dvEdge, dcEdge, and angleEdge
-	dvEdgeOld = new double[nEdges];
-	dcEdgeOld = new double[nEdges];
-	angleEdgeOld = new double[nEdges];
-	dvEdgeNew = new double[nEdgesNew];
-	dcEdgeNew = new double[nEdgesNew];
-	angleEdgeNew = new double[nEdgesNew];
-
-	netcdf_mpas_read_dvedge ( inputFilename, nEdges, dvEdgeOld );
-	netcdf_mpas_read_dcedge ( inputFilename, nEdges, dcEdgeOld );
-	netcdf_mpas_read_angleedge ( inputFilename, nEdges, angleEdgeOld );
-
-	for(int iEdge = 0; iEdge < nEdges; iEdge++){
-		if(edgeMap.at(iEdge) != -1){
-			dvEdgeNew[edgeMap.at(iEdge)] = dvEdgeOld[iEdge];
-			dcEdgeNew[edgeMap.at(iEdge)] = dcEdgeOld[iEdge];
-			angleEdgeNew[edgeMap.at(iEdge)] = angleEdgeOld[iEdge];
-		}
-	}
-
-	if (!(dcEdgeVar = grid.add_var("dcEdge", ncDouble, nEdgesDim))) return NC_ERR;
-	if (!dcEdgeVar->put(dcEdgeNew,nEdgesNew)) return NC_ERR;
-	if (!(dvEdgeVar = grid.add_var("dvEdge", ncDouble, nEdgesDim))) return NC_ERR;
-	if (!dvEdgeVar->put(dvEdgeNew,nEdgesNew)) return NC_ERR;
-	if (!(angleVar = grid.add_var("angleEdge", ncDouble, nEdgesDim))) return NC_ERR;
-	if (!angleVar->put(angleEdgeNew,nEdgesNew)) return NC_ERR;
+	if (!cullRows<double>(dcEdgeIn, dcEdgeVar, edgeKeep, 1)) return NC_ERR;
+	if (!cullRows<double>(dvEdgeIn, dvEdgeVar, edgeKeep, 1)) return NC_ERR;
+	if (!cullRows<double>(angleIn, angleVar, edgeKeep, 1)) return NC_ERR;
 
-	delete[] dvEdgeOld;
-	delete[] dvEdgeNew;
-	delete[] dcEdgeOld;
-	delete[] dcEdgeNew;
-	delete[] angleEdgeOld;
-	delete[] angleEdgeNew;
+	grid.close();
+	in.close();
 
 	return 0;
 }/*}}}*/
@@ -1398,11 +1492,12 @@ int mapAndOutputVertexFields( const string inputFilename, const string outputFil
 	// set error behaviour (matches fortran behaviour)
 	NcError err(NcError::verbose_nonfatal);
 
-	// open the scvtmesh file
-	NcFile grid(outputFilename.c_str(), NcFile::Write);
+	// open the input and scvtmesh files
+	NcFile in(inputFilename.c_str(), NcFile::ReadOnly);
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Write, outputFormat);
 
-	// check to see if the file was opened
-	if(!grid.is_valid()) return NC_ERR;
+	// check to see if the files were opened
+	if(!in.is_valid() || !grid.is_valid()) return NC_ERR;
 
 	// fetch dimensions
 	NcDim *nVerticesDim = grid.get_dim( "nVertices" );
@@ -1410,93 +1505,591 @@ int mapAndOutputVertexFields( const string inputFilename, const string outputFil
 
 	// define nc variables
 	NcVar *covVar, *eovVar, *kaovVar, *atVar;
+	NcVar *eovIn, *kaovIn;
 
-	int nVerticesNew = nVerticesDim->size();
+	if (!(eovIn = in.get_var("edgesOnVertex"))) return NC_ERR;
+	if (!(kaovIn = in.get_var("kiteAreasOnVertex"))) return NC_ERR;
 
-	int *cellsOnVertexOld, *cellsOnVertexNew;
-	int *edgesOnVertexOld, *edgesOnVertexNew;
-	double *kiteAreasOnVertexOld, *kiteAreasOnVertexNew;
-	double *areaTriangleOld, *areaTriangleNew;
+	if (!(eovVar = grid.add_var("edgesOnVertex", ncInt, nVerticesDim, vertexDegreeDim))) return NC_ERR;
+	if (!(covVar = grid.add_var("cellsOnVertex", ncInt, nVerticesDim, vertexDegreeDim))) return NC_ERR;
+	if (!(atVar = grid.add_var("areaTriangle", ncDouble, nVerticesDim))) return NC_ERR;
+	if (!(kaovVar = grid.add_var("kiteAreasOnVertex", ncDouble, nVerticesDim, vertexDegreeDim))) return NC_ERR;
 
-	cellsOnVertexOld = new int[nVertices * vertexDegree];
-	cellsOnVertexNew = new int[nVerticesNew * vertexDegree];
-	edgesOnVertexOld = new int[nVertices * vertexDegree];
-	edgesOnVertexNew = new int[nVerticesNew * vertexDegree];
-	kiteAreasOnVertexOld = new double[nVertices * vertexDegree];
-	kiteAreasOnVertexNew = new double[nVerticesNew * vertexDegree];
-	areaTriangleOld = new double[nVertices];
-	areaTriangleNew = new double[nVerticesNew];
+	const long rows = blockRows(vertexDegree * (3 * sizeof(int) + 2 * sizeof(double)) + sizeof(double));
+	vector<int> edgesOnVertexOld, cellsOnVertexNew, edgesOnVertexNew;
+	vector<double> kiteAreasOnVertexOld, kiteAreasOnVertexNew, areaTriangleNew;
 
-	netcdf_mpas_read_cellsonvertex ( inputFilename, nVertices, vertexDegree, cellsOnVertexOld );
-	netcdf_mpas_read_edgesonvertex ( inputFilename, nVertices, vertexDegree, edgesOnVertexOld );
-	netcdf_mpas_read_kiteareasonvertex ( inputFilename, nVertices, vertexDegree, kiteAreasOnVertexOld );
-	netcdf_mpas_read_areatriangle ( inputFilename, nVertices, areaTriangleOld );
+	for(long firstRow = 0; firstRow < nVertices; firstRow += rows){
+		const long lastRow = min(firstRow + rows, (long) nVertices);
+		long firstNew, lastNew;
 
-	for(int iVertex = 0; iVertex < nVertices; iVertex++){
-		double area = 0.0;
-		if(vertexMap.at(iVertex) != -1){
-			for(int j = 0; j < vertexDegree; j++){
-				int iCell, iEdge;
+		keptRows(vertexKeep, firstRow, lastRow, firstNew, lastNew);
+		if(firstNew == lastNew) continue;
+
+		edgesOnVertexOld.resize((lastRow - firstRow) * vertexDegree);
+		kiteAreasOnVertexOld.resize((lastRow - firstRow) * vertexDegree);
+		if (!readRows(eovIn, firstRow, lastRow - firstRow, vertexDegree, &edgesOnVertexOld[0])) return NC_ERR;
+		if (!readRows(kaovIn, firstRow, lastRow - firstRow, vertexDegree, &kiteAreasOnVertexOld[0])) return NC_ERR;
 
-				iCell = cellsOnVertexOld[iVertex*vertexDegree + j] - 1;
-				iEdge = edgesOnVertexOld[iVertex*vertexDegree + j] - 1;
+		cellsOnVertexNew.resize((lastNew - firstNew) * vertexDegree);
+		edgesOnVertexNew.resize((lastNew - firstNew) * vertexDegree);
+		kiteAreasOnVertexNew.resize((lastNew - firstNew) * vertexDegree);
+		areaTriangleNew.resize(lastNew - firstNew);
+
+		// Kites of removed cells are dropped from areaTriangle.
+		#pragma omp parallel for default(shared)
+		for(long k = firstNew; k < lastNew; k++){
+			const long iVertex = vertexKeep[k];
+			const long oldRow = (iVertex - firstRow) * vertexDegree;
+			const long newRow = (k - firstNew) * vertexDegree;
+			double area = 0.0;
+
+			for(int j = 0; j < vertexDegree; j++){
+				int iCell = cellsOnVertex[iVertex * vertexDegree + j];
+				int iEdge = edgesOnVertexOld[oldRow + j] - 1;
 
 				if(iCell != -1){
-					cellsOnVertexNew[ vertexMap.at(iVertex) * vertexDegree + j] = cellMap.at(iCell) + 1;
-					if(cellMap.at(iCell) == -1){
-						kiteAreasOnVertexNew[ vertexMap.at(iVertex) * vertexDegree + j] = 0.0;
-					} else {
-						kiteAreasOnVertexNew[ vertexMap.at(iVertex) * vertexDegree + j] = kiteAreasOnVertexOld[iVertex*vertexDegree + j];
-					}
-					area += kiteAreasOnVertexNew[ vertexMap.at(iVertex) * vertexDegree + j];
+					cellsOnVertexNew[newRow + j] = cellMap[iCell] + 1;
+					kiteAreasOnVertexNew[newRow + j] = ( cellMap[iCell] == -1 ) ? 0.0 : kiteAreasOnVertexOld[oldRow + j];
+					area += kiteAreasOnVertexNew[newRow + j];
 				} else {
-					cellsOnVertexNew[ vertexMap.at(iVertex) * vertexDegree + j] = 0;
-					kiteAreasOnVertexNew[ vertexMap.at(iVertex) * vertexDegree + j] = 0.0;
+					cellsOnVertexNew[newRow + j] = 0;
+					kiteAreasOnVertexNew[newRow + j] = 0.0;
 				}
 
-				if(iEdge != -1){
-					edgesOnVertexNew[ vertexMap.at(iVertex) * vertexDegree + j] = edgeMap.at(iEdge) + 1;
+				if(iEdge >= 0 && iEdge < nEdges){
+					edgesOnVertexNew[newRow + j] = edgeMap[iEdge] + 1;
 				} else {
-					edgesOnVertexNew[ vertexMap.at(iVertex) * vertexDegree + j] = 0;
+					edgesOnVertexNew[newRow + j] = 0;
 				}
 			}
 
-			areaTriangleNew[vertexMap.at(iVertex)] = area;
+			areaTriangleNew[k - firstNew] = area;
 		}
-	}
 
 #ifdef _DEBUG
-	cout << "   Writing edgesOnVertex" << endl;
-#endif
-	if (!(eovVar = grid.add_var("edgesOnVertex", ncInt, nVerticesDim, vertexDegreeDim))) return NC_ERR;
-	if (!eovVar->put(edgesOnVertexNew,nVerticesNew,vertexDegree)) return NC_ERR;
-#ifdef _DEBUG
-	cout << "   Writing cellsOnVertex" << endl;
-#endif
-	if (!(covVar = grid.add_var("cellsOnVertex", ncInt, nVerticesDim, vertexDegreeDim))) return NC_ERR;
-	if (!covVar->put(cellsOnVertexNew,nVerticesNew,vertexDegree)) return NC_ERR;
-#ifdef _DEBUG
-	cout << "   Writing areaTriangle" << endl;
+		cout << "   Writing vertex fields " << firstNew << " to " << lastNew << endl;
 #endif
-	if (!(atVar = grid.add_var("areaTriangle", ncDouble, nVerticesDim))) return NC_ERR;
-	if (!atVar->put(areaTriangleNew, nVerticesNew)) return NC_ERR;
-#ifdef _DEBUG
-	cout << "   Writing kiteAreasOnVertex" << endl;
-#endif
-	if (!(kaovVar = grid.add_var("kiteAreasOnVertex", ncDouble, nVerticesDim, vertexDegreeDim))) return NC_ERR;
-	if (!kaovVar->put(kiteAreasOnVertexNew, nVerticesNew, vertexDegree)) return NC_ERR;
+		if (!writeRows(eovVar, firstNew, lastNew - firstNew, vertexDegree, &edgesOnVertexNew[0])) return NC_ERR;
+		if (!writeRows(covVar, firstNew, lastNew - firstNew, vertexDegree, &cellsOnVertexNew[0])) return NC_ERR;
+		if (!writeRows(atVar, firstNew, lastNew - firstNew, 1, &areaTriangleNew[0])) return NC_ERR;
+		if (!writeRows(kaovVar, firstNew, lastNew - firstNew, vertexDegree, &kiteAreasOnVertexNew[0])) return NC_ERR;
+	}
+
+	grid.close();
+	in.close();
+
+	return 0;
+}/*}}}*/
+int mapAndOutputOtherFields( const string inputFilename, const string outputFilename) {/*{{{*/
+	/*****************************************************************
+	 *
+	 * This function carries every other variable of the input file into the
+	 * culled file (e.g. bottomDepth, initial conditions or masks), so they
+	 * don't have to be culled separately with the cell map.
+	 *
+	 * Variables with an nCells, nEdges or nVertices dimension are compacted
+	 * along it, whatever their type and other dimensions (e.g. Time or
+	 * nVertLevels). Integer variables that hold indices (cellsOn*, edgesOn*,
+	 * verticesOn*, and *CellID, *EdgeID, *VertexID or *GlobalID names) are
+	 * renumbered through cellMap, edgeMap or vertexMap, with or without a
+	 * mesh dimension. boundaryVertex is also set on vertices that lost a
+	 * cell. Other variables are copied as they are.
+	 *
+	 * Variables the culler already wrote are skipped, as is cullCell, which
+	 * this run has used up.
+	 *
+	 * ***************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	static const char *meshDims[] = { "nCells", "nEdges", "nVertices" };
+	int inId, outId, status, nVars, inUnlimited, outUnlimited;
+	vector<carried_variable> carried;
+
+	if ( ( status = nc_open(inputFilename.c_str(), NC_NOWRITE, &inId) ) != NC_NOERR ) {
+		cout << "ERROR: " << nc_strerror(status) << endl;
+		return NC_ERR;
+	}
+	if ( ( status = nc_open(outputFilename.c_str(), NC_WRITE, &outId) ) != NC_NOERR ) {
+		cout << "ERROR: " << nc_strerror(status) << endl;
+		nc_close(inId);
+		return NC_ERR;
+	}
 
-	delete[] cellsOnVertexOld;
-	delete[] cellsOnVertexNew;
-	delete[] edgesOnVertexOld;
-	delete[] edgesOnVertexNew;
-	delete[] kiteAreasOnVertexOld;
-	delete[] kiteAreasOnVertexNew;
-	delete[] areaTriangleOld;
-	delete[] areaTriangleNew;
+	nc_inq_nvars(inId, &nVars);
+	nc_inq_unlimdim(inId, &inUnlimited);
+	nc_inq_unlimdim(outId, &outUnlimited);
+	status = nc_redef(outId);
+
+	for(int varid = 0; varid < nVars && status == NC_NOERR; varid++){
+		char name[NC_MAX_NAME+1];
+		int ndims, natts, dimids[NC_MAX_VAR_DIMS], outDimids[NC_MAX_VAR_DIMS], existing;
+		nc_type type;
+		carried_variable var;
+		bool skip = false;
+
+		nc_inq_var(inId, varid, name, &type, &ndims, dimids, &natts);
+		if ( string(name) == "cullCell" || nc_inq_varid(outId, name, &existing) == NC_NOERR ) continue;
+
+		var.inVarid = varid;
+		var.type = type;
+		var.ndims = ndims;
+		var.meshDim = -1;
+		var.keep = NULL;
+		var.indexMap = NULL;
+		var.boundaryVertex = ( string(name) == "boundaryVertex" );
+
+		if ( type < NC_BYTE || type > NC_UINT64 ) {
+			cout << "WARNING: Not carrying " << name << ", which has a non-atomic type." << endl;
+			continue;
+		}
+
+		// Find (or define) the output dimensions. Only the mesh dimension
+		// may change length.
+		for(int d = 0; d < ndims && !skip; d++){
+			char dimName[NC_MAX_NAME+1];
+			size_t len, outLen;
+
+			nc_inq_dim(inId, dimids[d], dimName, &len);
+			var.count[d] = len;
+			for(int m = 0; m < 3; m++){
+				if ( string(dimName) == meshDims[m] ) {
+					if ( var.meshDim != -1 ) {
+						cout << "WARNING: Not carrying " << name << ", which has more than one mesh dimension." << endl;
+						skip = true;
+					}
+					var.meshDim = d;
+					var.keep = ( m == 0 ) ? &cellKeep : ( m == 1 ) ? &edgeKeep : &vertexKeep;
+				}
+			}
+
+			if ( nc_inq_dimid(outId, dimName, &outDimids[d]) == NC_NOERR ) {
+				nc_inq_dimlen(outId, outDimids[d], &outLen);
+				if ( var.meshDim != d && outDimids[d] != outUnlimited && outLen != len ) {
+					cout << "WARNING: Not carrying " << name << ", since dimension " << dimName
+						<< " is " << outLen << " in the culled mesh instead of " << len << "." << endl;
+					skip = true;
+				}
+			} else if ( ( status = nc_def_dim(outId, dimName, dimids[d] == inUnlimited ? NC_UNLIMITED : len, &outDimids[d]) ) != NC_NOERR ) {
+				break;
+			}
+		}
+		if ( skip || status != NC_NOERR ) continue;
+
+		if ( type == NC_SHORT || type == NC_INT || type == NC_INT64 ) {
+			var.indexMap = indexMapFor(name);
+		}
+
+		status = nc_def_var(outId, name, netcdf_mpas_output_type(outputFormat, name, type), ndims, outDimids, &var.outVarid);
+		if ( status == NC_NOERR && outputFormat.cmode == NC_NETCDF4 ) {
+			status = netcdf_mpas_define_storage(outId, var.outVarid, outputFormat);
+		}
+
+		for(int a = 0; a < natts && status == NC_NOERR; a++){
+			char attName[NC_MAX_NAME+1];
+			nc_type outType;
+
+			nc_inq_attname(inId, varid, a, attName);
+			nc_inq_vartype(outId, var.outVarid, &outType);
+
+			// _FillValue has to have the type of the variable, which may
+			// have been narrowed or widened by the output format.
+			if ( string(attName) == "_FillValue" && outType != type ) {
+				double fill;
+				nc_get_att_double(inId, varid, attName, &fill);
+				status = nc_put_att_double(outId, var.outVarid, attName, outType, 1, &fill);
+			} else {
+				status = nc_copy_att(inId, varid, attName, outId, var.outVarid);
+			}
+		}
+
+		if ( status == NC_NOERR ) {
+			cout << "    Carrying " << name << ( var.indexMap ? " (renumbered)" : "" ) << endl;
+			carried.push_back(var);
+		}
+	}
+
+	if ( status == NC_NOERR ) status = nc_enddef(outId);
+
+	for(size_t v = 0; v < carried.size() && status == NC_NOERR; v++){
+		switch ( carried[v].type ) {
+			case NC_BYTE: status = cullVariable<signed char>(inId, outId, carried[v]); break;
+			case NC_CHAR: status = cullVariable<char>(inId, outId, carried[v]); break;
+			case NC_SHORT: status = cullVariable<short>(inId, outId, carried[v]); break;
+			case NC_INT: status = cullVariable<int>(inId, outId, carried[v]); break;
+			case NC_FLOAT: status = cullVariable<float>(inId, outId, carried[v]); break;
+			case NC_DOUBLE: status = cullVariable<double>(inId, outId, carried[v]); break;
+			case NC_UBYTE: status = cullVariable<unsigned char>(inId, outId, carried[v]); break;
+			case NC_USHORT: status = cullVariable<unsigned short>(inId, outId, carried[v]); break;
+			case NC_UINT: status = cullVariable<unsigned int>(inId, outId, carried[v]); break;
+			case NC_INT64: status = cullVariable<long long>(inId, outId, carried[v]); break;
+			case NC_UINT64: status = cullVariable<unsigned long long>(inId, outId, carried[v]); break;
+		}
+	}
+
+	if ( status != NC_NOERR ) {
+		cout << "ERROR: " << nc_strerror(status) << endl;
+		nc_close(outId);
+		nc_close(inId);
+		return NC_ERR;
+	}
+
+	nc_close(outId);
+	nc_close(inId);
 
 	return 0;
 }/*}}}*/
+const vector<int>* indexMapFor( const string name ){/*{{{*/
+	/*
+	 * Returns the map to renumber an integer variable with, from the MPAS
+	 * naming conventions for index variables, or NULL if it holds no indices.
+	 */
+	static const char *prefixes[] = { "cellsOn", "edgesOn", "verticesOn" };
+	static const char *infixes[] = { "CellID", "EdgeID", "VertexID" };
+	static const char *globalInfixes[] = { "CellGlobalID", "EdgeGlobalID", "VertexGlobalID" };
+	const vector<int> *maps[] = { &cellMap, &edgeMap, &vertexMap };
+
+	for(int m = 0; m < 3; m++){
+		if ( name.compare(0, strlen(prefixes[m]), prefixes[m]) == 0
+				|| name.find(infixes[m]) != string::npos
+				|| name.find(globalInfixes[m]) != string::npos ) {
+			return maps[m];
+		}
+	}
+
+	return NULL;
+}/*}}}*/
+template <class T>
+int cullVariable( const int inId, const int outId, const carried_variable &var ){/*{{{*/
+	/*
+	 * Reads the variable a block of rows (along the mesh dimension) at a time,
+	 * compacts the kept rows and writes them, so memory use stays within
+	 * memoryBudget for large 3D fields. Dimensions in front of the mesh
+	 * dimension (e.g. Time) are walked one entry at a time.
+	 */
+	const int p = var.meshDim;
+	size_t start[NC_MAX_VAR_DIMS], count[NC_MAX_VAR_DIMS], outStart[NC_MAX_VAR_DIMS];
+	size_t nOuter = 1, rowLen = 1, nRows, rowsPerBlock;
+	vector<T> in, out;
+	int status = NC_NOERR;
+
+	if ( p == -1 ) {
+		// No mesh dimension, so the variable is copied in one piece.
+		size_t n = 1;
+		for(int d = 0; d < var.ndims; d++){
+			start[d] = 0;
+			count[d] = var.count[d];
+			n *= count[d];
+		}
+		in.resize(max(n, (size_t) 1));
+		status = nc_get_vara(inId, var.inVarid, start, count, &in[0]);
+		if ( var.indexMap ) {
+			remapIndices(&in[0], n, *var.indexMap);
+		}
+		if ( status == NC_NOERR ) status = putRows(outId, var.outVarid, start, count, &in[0]);
+		return status;
+	}
+
+	for(int d = 0; d < p; d++){
+		nOuter *= var.count[d];
+	}
+	for(int d = p + 1; d < var.ndims; d++){
+		rowLen *= var.count[d];
+	}
+	nRows = var.count[p];
+	rowsPerBlock = blockRows(2 * rowLen * sizeof(T));
+
+	for(int d = 0; d < var.ndims; d++){
+		start[d] = 0;
+		count[d] = ( d < p ) ? 1 : var.count[d];
+	}
+
+	for(size_t outer = 0; outer < nOuter && status == NC_NOERR; outer++){
+		// Position in the dimensions in front of the mesh dimension.
+		size_t rest = outer;
+		for(int d = p - 1; d >= 0; d--){
+			start[d] = rest % var.count[d];
+			rest /= var.count[d];
+		}
+
+		for(size_t firstRow = 0; firstRow < nRows && status == NC_NOERR; firstRow += rowsPerBlock){
+			const size_t lastRow = min(firstRow + rowsPerBlock, nRows);
+			const size_t firstNew = lower_bound(var.keep->begin(), var.keep->end(), (int) firstRow) - var.keep->begin();
+			const size_t lastNew = lower_bound(var.keep->begin(), var.keep->end(), (int) lastRow) - var.keep->begin();
+
+			if ( lastNew == firstNew ) continue;
+
+			start[p] = firstRow;
+			count[p] = lastRow - firstRow;
+			in.resize(count[p] * rowLen);
+			if ( ( status = nc_get_vara(inId, var.inVarid, start, count, &in[0]) ) != NC_NOERR ) break;
+
+			out.resize((lastNew - firstNew) * rowLen);
+			compactRows(&in[0], &out[0], &(*var.keep)[firstNew], lastNew - firstNew, firstRow, rowLen);
+
+			if ( var.indexMap ) {
+				remapIndices(&out[0], out.size(), *var.indexMap);
+			}
+			if ( var.boundaryVertex ) {
+				#pragma omp parallel for default(shared)
+				for(size_t k = firstNew; k < lastNew; k++){
+					int iVertex = (*var.keep)[k];
+					for(int j = 0; j < vertexDegree; j++){
+						int iCell = cellsOnVertex[(size_t) iVertex * vertexDegree + j];
+						if ( iCell != -1 && cellMap.at(iCell) == -1 ) {
+							for(size_t i = 0; i < rowLen; i++){
+								out[(k - firstNew) * rowLen + i] = 1;
+							}
+						}
+					}
+				}
+			}
+
+			for(int d = 0; d < var.ndims; d++){
+				outStart[d] = start[d];
+			}
+			outStart[p] = firstNew;
+			count[p] = lastNew - firstNew;
+			status = putRows(outId, var.outVarid, outStart, count, &out[0]);
+		}
+	}
+
+	return status;
+}/*}}}*/
+template <class T>
+void compactRows( const T *in, T *out, const int *keep, const size_t nKeep, const size_t firstRow, const size_t rowLen ){/*{{{*/
+	/*
+	 * Gathers rows keep[0..nKeep) of in, which holds rows from firstRow on,
+	 * into out. Rows of one value are copied directly, so the loop
+	 * vectorizes as a gather.
+	 */
+	if ( rowLen == 1 ) {
+		#pragma omp parallel for default(shared)
+		for(size_t k = 0; k < nKeep; k++){
+			out[k] = in[keep[k] - firstRow];
+		}
+	} else {
+		#pragma omp parallel for default(shared)
+		for(size_t k = 0; k < nKeep; k++){
+			const T *row = in + (keep[k] - firstRow) * rowLen;
+			for(size_t i = 0; i < rowLen; i++){
+				out[k * rowLen + i] = row[i];
+			}
+		}
+	}
+}/*}}}*/
+template <class T>
+void remapIndices( T *values, const size_t n, const vector<int> &indexMap ){/*{{{*/
+	/*
+	 * Renumbers 1-based indices through indexMap. Removed elements become 0,
+	 * and values that are not indices (0 or fill values) are left alone.
+	 */
+	const long long nMap = indexMap.size();
+
+	#pragma omp parallel for default(shared)
+	for(size_t i = 0; i < n; i++){
+		long long value = (long long) values[i];
+		if ( value >= 1 && value <= nMap ) {
+			values[i] = (T) ( indexMap[value - 1] + 1 );
+		}
+	}
+}/*}}}*/
+template <class T>
+int putRows( const int outId, const int varid, const size_t *start, const size_t *count, const T *values ){/*{{{*/
+	/*
+	 * Writes values in their own type. Doubles and ints go through the typed
+	 * calls, so netCDF converts them when --float32 or --int64 changed the
+	 * type of the output variable.
+	 */
+	nc_type outType;
+	nc_inq_vartype(outId, varid, &outType);
+
+	if ( outType == NC_FLOAT && sizeof(T) == sizeof(double) && ! numeric_limits<T>::is_integer ) {
+		return nc_put_vara_double(outId, varid, start, count, (const double *) values);
+	} else if ( outType == NC_INT64 && sizeof(T) == sizeof(int) && numeric_limits<T>::is_signed ) {
+		return nc_put_vara_int(outId, varid, start, count, (const int *) values);
+	}
+
+	return nc_put_vara(outId, varid, start, count, values);
+}/*}}}*/
+long blockRows( const size_t rowBytes ){/*{{{*/
+	/*
+	 * Returns how many rows of rowBytes bytes (counting every buffer a stage
+	 * holds per row) fit in memoryBudget, and at least one.
+	 */
+	return max(memoryBudget / max(rowBytes, (size_t) 1), (size_t) 1);
+}/*}}}*/
+void keptRows( const vector<int> &keep, const long firstRow, const long lastRow, long &firstNew, long &lastNew ){/*{{{*/
+	/*
+	 * Finds the new indices [firstNew, lastNew) of the kept rows among the old
+	 * rows [firstRow, lastRow). keep is in increasing order.
+	 */
+	firstNew = lower_bound(keep.begin(), keep.end(), (int) firstRow) - keep.begin();
+	lastNew = lower_bound(keep.begin(), keep.end(), (int) lastRow) - keep.begin();
+}/*}}}*/
+template <class T>
+NcBool readRows( NcVar *var, const long firstRow, const long nRows, const long width, T *values ){/*{{{*/
+	/*
+	 * Reads nRows rows from firstRow on of a variable with one or two
+	 * dimensions, converting to T.
+	 */
+	if ( var == NULL ) return false;
+	if ( var->num_dims() == 1 ) {
+		return var->set_cur(firstRow) && var->get(values, nRows);
+	}
+	return var->set_cur(firstRow, 0) && var->get(values, nRows, width);
+}/*}}}*/
+template <class T>
+NcBool writeRows( NcVar *var, const long firstRow, const long nRows, const long width, const T *values ){/*{{{*/
+	/*
+	 * Writes nRows rows from firstRow on of a variable with one or two
+	 * dimensions.
+	 */
+	if ( var->num_dims() == 1 ) {
+		return var->set_cur(firstRow) && var->put(values, nRows);
+	}
+	return var->set_cur(firstRow, 0) && var->put(values, nRows, width);
+}/*}}}*/
+template <class T>
+NcBool cullRows( NcVar *inVar, NcVar *outVar, const vector<int> &keep, const long width ){/*{{{*/
+	/*
+	 * Copies the kept rows of inVar to outVar, a block of rows at a time.
+	 */
+	const long nRows = inVar->get_dim(0)->size();
+	const long rows = blockRows(2 * width * sizeof(T));
+	vector<T> in, out;
+
+	for(long firstRow = 0; firstRow < nRows; firstRow += rows){
+		const long lastRow = min(firstRow + rows, nRows);
+		long firstNew, lastNew;
+
+		keptRows(keep, firstRow, lastRow, firstNew, lastNew);
+		if(firstNew == lastNew) continue;
+
+		in.resize((lastRow - firstRow) * width);
+		out.resize((lastNew - firstNew) * width);
+		if (!readRows(inVar, firstRow, lastRow - firstRow, width, &in[0])) return false;
+		compactRows(&in[0], &out[0], &keep[firstNew], lastNew - firstNew, firstRow, width);
+		if (!writeRows(outVar, firstNew, lastNew - firstNew, width, &out[0])) return false;
+	}
+
+	return true;
+}/*}}}*/
+NcBool cullConnectivity( NcVar *inVar, NcVar *outVar, const vector<int> &keep, const long oldWidth, const long newWidth, const vector<int> &indexMap ){/*{{{*/
+	/*
+	 * Copies the kept rows of a connectivity variable to outVar, a block of
+	 * rows at a time, cut to newWidth columns and renumbered through indexMap.
+	 * Removed elements and padding become 0.
+	 */
+	const long nRows = inVar->get_dim(0)->size();
+	const long nMap = indexMap.size();
+	const long rows = blockRows((oldWidth + newWidth) * sizeof(int));
+	vector<int> in, out;
+
+	for(long firstRow = 0; firstRow < nRows; firstRow += rows){
+		const long lastRow = min(firstRow + rows, nRows);
+		long firstNew, lastNew;
+
+		keptRows(keep, firstRow, lastRow, firstNew, lastNew);
+		if(firstNew == lastNew) continue;
+
+		in.resize((lastRow - firstRow) * oldWidth);
+		out.resize((lastNew - firstNew) * newWidth);
+		if (!readRows(inVar, firstRow, lastRow - firstRow, oldWidth, &in[0])) return false;
+
+		#pragma omp parallel for default(shared)
+		for(long k = firstNew; k < lastNew; k++){
+			const int *row = &in[(keep[k] - firstRow) * oldWidth];
+			for(long j = 0; j < newWidth; j++){
+				int index = row[j] - 1;
+				out[(k - firstNew) * newWidth + j] = ( index >= 0 && index < nMap ) ? indexMap[index] + 1 : 0;
+			}
+		}
+
+		if (!writeRows(outVar, firstNew, lastNew - firstNew, newWidth, &out[0])) return false;
+	}
+
+	return true;
+}/*}}}*/
+NcBool outputIndices( NcVar *outVar, const long nRows ){/*{{{*/
+	/*
+	 * Writes 1..nRows to outVar (e.g. indexToCellID), a block at a time.
+	 */
+	const long rows = blockRows(sizeof(int));
+	vector<int> out;
+
+	for(long firstNew = 0; firstNew < nRows; firstNew += rows){
+		const long lastNew = min(firstNew + rows, nRows);
+
+		out.resize(lastNew - firstNew);
+		for(long k = firstNew; k < lastNew; k++){
+			out[k - firstNew] = k + 1;
+		}
+		if (!writeRows(outVar, firstNew, lastNew - firstNew, 1, &out[0])) return false;
+	}
+
+	return true;
+}/*}}}*/
+NcBool fillRows( NcVar *outVar, const long nRows, const double value ){/*{{{*/
+	/*
+	 * Writes value to every row of outVar, a block at a time.
+	 */
+	const long rows = blockRows(sizeof(double));
+	vector<double> out;
+
+	for(long firstNew = 0; firstNew < nRows; firstNew += rows){
+		const long lastNew = min(firstNew + rows, nRows);
+
+		out.assign(lastNew - firstNew, value);
+		if (!writeRows(outVar, firstNew, lastNew - firstNew, 1, &out[0])) return false;
+	}
+
+	return true;
+}/*}}}*/
+NcBool outputGraph( const string graphFilename, NcVar *nEocVar, NcVar *cocVar, const long nCellsNew, const long maxEdgesNew ){/*{{{*/
+	/*
+	 * Writes graph.info from the culled nEdgesOnCell and cellsOnCell, read
+	 * back a block at a time. The edge count in the header takes a first pass.
+	 */
+	const long rows = blockRows((maxEdgesNew + 1) * sizeof(int));
+	vector<int> nEdgesOnCellNew, cellsOnCellNew;
+	long edgeCount = 0;
+
+	for(int pass = 0; pass < 2; pass++){
+		ofstream graph;
+
+		if(pass == 1){
+			graph.open(graphFilename.c_str());
+			graph << nCellsNew << " " << edgeCount / 2 << endl;
+		}
+
+		for(long firstNew = 0; firstNew < nCellsNew; firstNew += rows){
+			const long lastNew = min(firstNew + rows, nCellsNew);
+
+			nEdgesOnCellNew.resize(lastNew - firstNew);
+			cellsOnCellNew.resize((lastNew - firstNew) * maxEdgesNew);
+			if (!readRows(nEocVar, firstNew, lastNew - firstNew, 1, &nEdgesOnCellNew[0])) return false;
+			if (!readRows(cocVar, firstNew, lastNew - firstNew, maxEdgesNew, &cellsOnCellNew[0])) return false;
+
+			for(long k = 0; k < lastNew - firstNew; k++){
+				for(int j = 0; j < nEdgesOnCellNew[k]; j++){
+					if (cellsOnCellNew[k * maxEdgesNew + j] != 0) {
+						if(pass == 0){
+							edgeCount++;
+						} else {
+							graph << cellsOnCellNew[k * maxEdgesNew + j] << " ";
+						}
+					}
+				}
+				if(pass == 1){
+					graph << endl;
+				}
+			}
+		}
+	}
+
+	return true;
+}/*}}}*/
 /*}}}*/
 
 string gen_random(const int len) {/*{{{*/
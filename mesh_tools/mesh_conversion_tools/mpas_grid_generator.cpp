@@ -0,0 +1,566 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <math.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "netcdf_utils.h"
+
+using namespace std;
+
+/*
+ * MpasGridGenerator.x writes synthetic grid.nc inputs for MpasMeshConverter.x,
+ * so the conversion tools can be benchmarked on meshes of any size:
+ *
+ *	- icosahedral N: a quasi-uniform spherical grid, made by splitting every
+ *	  face of an icosahedron into N x N triangles and projecting them onto the
+ *	  unit sphere. It has 10 N^2 + 2 cells and 20 N^2 vertices.
+ *	- hex NX NY: a doubly periodic planar grid of NX x NY regular hexagons.
+ *	  NY has to be even. It has NX NY cells and 2 NX NY vertices.
+ *
+ * Vertices of the spherical grid are written one icosahedron face at a time,
+ * so only the cell locations have to be held in memory.
+ */
+
+// Grid description {{{
+int nCells, nVertices;
+double sphereRadius = 1.0;
+double dcEdge = 1000.0;
+netcdf_mpas_output_format outputFormat;
+string history_str = "";
+// }}}
+
+// Icosahedron {{{
+static const int N_ICO_VERTICES = 12;
+static const int N_ICO_EDGES = 30;
+static const int N_ICO_FACES = 20;
+
+double icoVertices[N_ICO_VERTICES][3];
+int icoFaces[N_ICO_FACES][3] = {
+	{0,11,5}, {0,5,1}, {0,1,7}, {0,7,10}, {0,10,11},
+	{1,5,9}, {5,11,4}, {11,10,2}, {10,7,6}, {7,1,8},
+	{3,9,4}, {3,4,2}, {3,2,6}, {3,6,8}, {3,8,9},
+	{4,9,5}, {2,4,11}, {6,2,10}, {8,6,7}, {9,8,1} };
+int icoEdges[N_ICO_EDGES][2];
+// }}}
+
+/* Building functions {{{ */
+void buildIcosahedron();
+int icoEdgeIndex(const int a, const int b);
+int latticeIndex(const int n, const int face, const int i, const int j);
+void latticePoint(const int n, const int face, const int i, const int j, double p[3]);
+void normalizeToSphere(double p[3]);
+/*}}}*/
+
+/* Output functions {{{*/
+int defineGrid(netcdf_mpas_output_file &grid, const bool spherical, const double xPeriod, const double yPeriod);
+int writeIcosahedralGrid(const int n, const string outputFilename);
+int writeHexGrid(const int nx, const int ny, const string outputFilename);
+/*}}}*/
+
+void print_usage(){/*{{{*/
+	cout << endl << endl;
+	cout << "Usage:" << endl;
+	cout << "\tMpasGridGenerator.x icosahedral N [output_name] [--radius R] [--format F]" << endl;
+	cout << "\tMpasGridGenerator.x hex NX NY [output_name] [--dc D] [--format F]" << endl;
+	cout << endl;
+	cout << "\t\ticosahedral N:" << endl;
+	cout << "\t\t\tQuasi-uniform spherical grid with 10 N^2 + 2 cells, made by" << endl;
+	cout << "\t\t\tsplitting each face of an icosahedron into N x N triangles." << endl;
+	cout << "\t\thex NX NY:" << endl;
+	cout << "\t\t\tDoubly periodic planar grid of NX x NY hexagons. NY has to be even." << endl;
+	cout << "\t\toutput_name:" << endl;
+	cout << "\t\t\tThe grid file to write. Defaults to grid.nc." << endl;
+	cout << "\t\t--radius R:" << endl;
+	cout << "\t\t\tSphere radius written to the spherical grid (default 1)." << endl;
+	cout << "\t\t--dc D:" << endl;
+	cout << "\t\t\tDistance between neighbouring planar cell centers (default 1000)." << endl;
+	netcdf_mpas_print_output_usage();
+}/*}}}*/
+
+int main ( int argc, char *argv[] ) {
+	int error;
+	string out_name = "grid.nc";
+	vector<string> args;
+
+	cout << endl << endl;
+	cout << "************************************************************" << endl;
+	cout << "MPAS_GRID_GENERATOR:\n";
+	cout << "  C++ version\n";
+	cout << "  Write a synthetic grid.nc input for MpasMeshConverter.x. \n";
+	cout << endl << endl;
+	cout << "  Compiled on " << __DATE__ << " at " << __TIME__ << ".\n";
+	cout << "************************************************************" << endl;
+	cout << endl << endl;
+
+	if ( netcdf_mpas_parse_output_flags(argc, argv, outputFormat) ) {
+		print_usage();
+		return 1;
+	}
+
+	history_str = "MpasGridGenerator.x";
+	for ( int i = 1; i < argc; i++ ) {
+		string str_flag = argv[i];
+
+		history_str += " ";
+		history_str += str_flag;
+
+		if ( str_flag == "--radius" || str_flag == "--dc" ) {
+			if ( i + 1 >= argc || atof(argv[i+1]) <= 0.0 ) {
+				cout << " ERROR: " << str_flag << " requires a positive value." << endl;
+				return 1;
+			}
+			if ( str_flag == "--radius" ) {
+				sphereRadius = atof(argv[i+1]);
+			} else {
+				dcEdge = atof(argv[i+1]);
+			}
+			history_str += " ";
+			history_str += argv[i+1];
+			i++;
+		} else {
+			args.push_back(str_flag);
+		}
+	}
+
+	if ( args.size() >= 2 && args[0] == "icosahedral" ) {
+		int n = atoi(args[1].c_str());
+
+		if ( n <= 0 || args.size() > 3 ) {
+			print_usage();
+			return 1;
+		}
+		if ( args.size() == 3 ) out_name = args[2];
+		if ( 20.0 * n * n > INT_MAX ) {
+			cout << " ERROR: An icosahedral grid with N = " << n << " has more than " << INT_MAX << " vertices." << endl;
+			return 1;
+		}
+
+		cout << "Writing icosahedral grid with " << 10L * n * n + 2 << " cells to " << out_name << endl;
+		if(error = writeIcosahedralGrid(n, out_name)){
+			cout << "Error - " << error << endl;
+			exit(error);
+		}
+	} else if ( args.size() >= 3 && args[0] == "hex" ) {
+		int nx = atoi(args[1].c_str());
+		int ny = atoi(args[2].c_str());
+
+		if ( nx < 3 || ny < 4 || ny % 2 != 0 || args.size() > 4 ) {
+			cout << " ERROR: hex needs NX >= 3 and an even NY >= 4." << endl;
+			print_usage();
+			return 1;
+		}
+		if ( args.size() == 4 ) out_name = args[3];
+		if ( 2.0 * nx * ny > INT_MAX ) {
+			cout << " ERROR: A hex grid of " << nx << " x " << ny << " cells has more than " << INT_MAX << " vertices." << endl;
+			return 1;
+		}
+
+		cout << "Writing periodic hex grid with " << (long)nx * ny << " cells to " << out_name << endl;
+		if(error = writeHexGrid(nx, ny, out_name)){
+			cout << "Error - " << error << endl;
+			exit(error);
+		}
+	} else {
+		print_usage();
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Building functions {{{ */
+void buildIcosahedron(){/*{{{*/
+	/*
+	 * Fills icoVertices with the unit icosahedron, and icoEdges with its 30
+	 * edges, each stored with the lower vertex index first.
+	 */
+	const double g = (1.0 + sqrt(5.0)) / 2.0;
+	const double base[N_ICO_VERTICES][3] = {
+		{-1, g, 0}, {1, g, 0}, {-1, -g, 0}, {1, -g, 0},
+		{0, -1, g}, {0, 1, g}, {0, -1, -g}, {0, 1, -g},
+		{g, 0, -1}, {g, 0, 1}, {-g, 0, -1}, {-g, 0, 1} };
+	int nEdges = 0;
+
+	for(int v = 0; v < N_ICO_VERTICES; v++){
+		for(int d = 0; d < 3; d++){
+			icoVertices[v][d] = base[v][d];
+		}
+		normalizeToSphere(icoVertices[v]);
+	}
+
+	for(int f = 0; f < N_ICO_FACES; f++){
+		for(int k = 0; k < 3; k++){
+			int a = min(icoFaces[f][k], icoFaces[f][(k+1)%3]);
+			int b = max(icoFaces[f][k], icoFaces[f][(k+1)%3]);
+			bool found = false;
+
+			for(int e = 0; e < nEdges && !found; e++){
+				found = (icoEdges[e][0] == a && icoEdges[e][1] == b);
+			}
+			if(!found){
+				icoEdges[nEdges][0] = a;
+				icoEdges[nEdges][1] = b;
+				nEdges++;
+			}
+		}
+	}
+
+	assert(nEdges == N_ICO_EDGES);
+}/*}}}*/
+int icoEdgeIndex(const int a, const int b){/*{{{*/
+	for(int e = 0; e < N_ICO_EDGES; e++){
+		if(icoEdges[e][0] == min(a, b) && icoEdges[e][1] == max(a, b)){
+			return e;
+		}
+	}
+	return -1;
+}/*}}}*/
+int latticeIndex(const int n, const int face, const int i, const int j){/*{{{*/
+	/*
+	 * Returns the cell index of lattice point (i, j) of face, which sits at
+	 * A + i/n (B - A) + j/n (C - A) for face corners A, B, C. Points shared
+	 * between faces get the same index from every face:
+	 *		- the 12 corners come first,
+	 *		- then the n-1 interior points of each of the 30 edges, counted
+	 *		  from the edge's lower corner,
+	 *		- then the (n-1)(n-2)/2 interior points of each face.
+	 */
+	const int A = icoFaces[face][0];
+	const int B = icoFaces[face][1];
+	const int C = icoFaces[face][2];
+	int from, to, k;
+
+	if(i == 0 && j == 0) return A;
+	if(i == n && j == 0) return B;
+	if(i == 0 && j == n) return C;
+
+	if(j == 0){
+		from = A; to = B; k = i;
+	} else if(i == 0){
+		from = A; to = C; k = j;
+	} else if(i + j == n){
+		from = B; to = C; k = j;
+	} else {
+		// (i-1) full rows of the interior triangle come before row i.
+		return N_ICO_VERTICES + N_ICO_EDGES * (n - 1)
+			+ face * (n - 1) * (n - 2) / 2
+			+ (i - 1) * (n - 1) - (i - 1) * i / 2 + (j - 1);
+	}
+
+	if(from > to){
+		k = n - k;
+	}
+	return N_ICO_VERTICES + icoEdgeIndex(from, to) * (n - 1) + (k - 1);
+}/*}}}*/
+void latticePoint(const int n, const int face, const int i, const int j, double p[3]){/*{{{*/
+	const double *A = icoVertices[icoFaces[face][0]];
+	const double *B = icoVertices[icoFaces[face][1]];
+	const double *C = icoVertices[icoFaces[face][2]];
+
+	for(int d = 0; d < 3; d++){
+		p[d] = (A[d] * (n - i - j) + B[d] * i + C[d] * j) / n;
+	}
+	normalizeToSphere(p);
+}/*}}}*/
+void normalizeToSphere(double p[3]){/*{{{*/
+	double norm = sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+
+	for(int d = 0; d < 3; d++){
+		p[d] /= norm;
+	}
+}/*}}}*/
+/*}}}*/
+
+/* Output functions {{{*/
+int defineGrid(netcdf_mpas_output_file &grid, const bool spherical, const double xPeriod, const double yPeriod){/*{{{*/
+	/************************************************************************
+	 *
+	 * This function defines the dimensions, attributes and variables
+	 * MpasMeshConverter.x reads, then takes the file out of define mode.
+	 *
+	 * **********************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+
+	NcDim *nCellsDim, *nVerticesDim, *vertexDegreeDim;
+
+	if(!grid.is_valid()) return NC_ERR;
+
+	if (!(nCellsDim =		grid.add_dim(	"nCells",		nCells)			)) return NC_ERR;
+	if (!(nVerticesDim =	grid.add_dim(	"nVertices",	nVertices)		)) return NC_ERR;
+	if (!(vertexDegreeDim =	grid.add_dim(	"vertexDegree",	3)				)) return NC_ERR;
+
+	if(spherical){
+		if (!grid.add_att(   "on_a_sphere", "YES\0")) return NC_ERR;
+		if (!grid.add_att(   "sphere_radius", sphereRadius)) return NC_ERR;
+		if (!grid.add_att(   "is_periodic", "NO\0")) return NC_ERR;
+	} else {
+		if (!grid.add_att(   "on_a_sphere", "NO\0")) return NC_ERR;
+		if (!grid.add_att(   "sphere_radius", 0.0)) return NC_ERR;
+		if (!grid.add_att(   "is_periodic", "YES\0")) return NC_ERR;
+		if (!grid.add_att(   "x_period", xPeriod)) return NC_ERR;
+		if (!grid.add_att(   "y_period", yPeriod)) return NC_ERR;
+	}
+	if (!grid.add_att(   "history", history_str.c_str() )) return NC_ERR;
+
+	if (!grid.add_var("xCell", ncDouble, nCellsDim)) return NC_ERR;
+	if (!grid.add_var("yCell", ncDouble, nCellsDim)) return NC_ERR;
+	if (!grid.add_var("zCell", ncDouble, nCellsDim)) return NC_ERR;
+	if (!grid.add_var("xVertex", ncDouble, nVerticesDim)) return NC_ERR;
+	if (!grid.add_var("yVertex", ncDouble, nVerticesDim)) return NC_ERR;
+	if (!grid.add_var("zVertex", ncDouble, nVerticesDim)) return NC_ERR;
+	if (!grid.add_var("cellsOnVertex", ncInt, nVerticesDim, vertexDegreeDim)) return NC_ERR;
+
+	if (!grid.end_define(0)) return NC_ERR;
+
+	return 0;
+}/*}}}*/
+int writeIcosahedralGrid(const int n, const string outputFilename){/*{{{*/
+	/************************************************************************
+	 *
+	 * This function writes the icosahedral grid. Cells are the points of the
+	 * triangular lattice on each face, and vertices are the circumcenters of
+	 * the lattice triangles, so cellsOnVertex lists the corners of each
+	 * triangle. Each face contributes n^2 vertices, written as one block.
+	 *
+	 * **********************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+
+	const long nPerFace = (long)n * n;
+	vector<double> xCell, yCell, zCell;
+	vector<double> xVertex(nPerFace), yVertex(nPerFace), zVertex(nPerFace);
+	vector<int> cellsOnVertex(nPerFace * 3);
+	NcVar *xVar, *yVar, *zVar, *covVar;
+	int error;
+
+	nCells = 10 * n * n + 2;
+	nVertices = 20 * n * n;
+
+	buildIcosahedron();
+
+	xCell.resize(nCells);
+	yCell.resize(nCells);
+	zCell.resize(nCells);
+
+	// Corners and edge points are computed from the icosahedron alone, so every
+	// face they lie on sees the same location.
+	for(int v = 0; v < N_ICO_VERTICES; v++){
+		xCell[v] = icoVertices[v][0] * sphereRadius;
+		yCell[v] = icoVertices[v][1] * sphereRadius;
+		zCell[v] = icoVertices[v][2] * sphereRadius;
+	}
+
+	for(int e = 0; e < N_ICO_EDGES; e++){
+		const double *from = icoVertices[icoEdges[e][0]];
+		const double *to = icoVertices[icoEdges[e][1]];
+
+		for(int k = 1; k < n; k++){
+			int iCell = N_ICO_VERTICES + e * (n - 1) + (k - 1);
+			double p[3];
+
+			for(int d = 0; d < 3; d++){
+				p[d] = (from[d] * (n - k) + to[d] * k) / n;
+			}
+			normalizeToSphere(p);
+
+			xCell[iCell] = p[0] * sphereRadius;
+			yCell[iCell] = p[1] * sphereRadius;
+			zCell[iCell] = p[2] * sphereRadius;
+		}
+	}
+
+	#pragma omp parallel for default(shared)
+	for(int f = 0; f < N_ICO_FACES; f++){
+		for(int i = 1; i < n; i++){
+			for(int j = 1; i + j < n; j++){
+				int iCell = latticeIndex(n, f, i, j);
+				double p[3];
+
+				latticePoint(n, f, i, j, p);
+
+				xCell[iCell] = p[0] * sphereRadius;
+				yCell[iCell] = p[1] * sphereRadius;
+				zCell[iCell] = p[2] * sphereRadius;
+			}
+		}
+	}
+
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Replace, outputFormat);
+	if(!grid.is_valid()) return NC_ERR;
+
+	if(error = defineGrid(grid, true, 0.0, 0.0)) return error;
+
+	if (!(xVar = grid.get_var("xCell"))) return NC_ERR;
+	if (!xVar->put(&xCell[0], nCells)) return NC_ERR;
+	if (!(yVar = grid.get_var("yCell"))) return NC_ERR;
+	if (!yVar->put(&yCell[0], nCells)) return NC_ERR;
+	if (!(zVar = grid.get_var("zCell"))) return NC_ERR;
+	if (!zVar->put(&zCell[0], nCells)) return NC_ERR;
+
+	if (!(xVar = grid.get_var("xVertex"))) return NC_ERR;
+	if (!(yVar = grid.get_var("yVertex"))) return NC_ERR;
+	if (!(zVar = grid.get_var("zVertex"))) return NC_ERR;
+	if (!(covVar = grid.get_var("cellsOnVertex"))) return NC_ERR;
+
+	for(int f = 0; f < N_ICO_FACES; f++){
+		// Row i holds 2(n-i)-1 triangles: n-i pointing up, n-i-1 pointing down.
+		#pragma omp parallel for default(shared) schedule(dynamic)
+		for(int i = 0; i < n; i++){
+			long iVertex = (long)n * n - (long)(n - i) * (n - i);
+
+			for(int j = 0; i + j < n; j++){
+				int tri[2][3];
+				int nTri = (i + j < n - 1) ? 2 : 1;
+
+				tri[0][0] = latticeIndex(n, f, i, j);
+				tri[0][1] = latticeIndex(n, f, i+1, j);
+				tri[0][2] = latticeIndex(n, f, i, j+1);
+				if(nTri == 2){
+					tri[1][0] = latticeIndex(n, f, i+1, j);
+					tri[1][1] = latticeIndex(n, f, i+1, j+1);
+					tri[1][2] = latticeIndex(n, f, i, j+1);
+				}
+
+				for(int t = 0; t < nTri; t++, iVertex++){
+					double a[3], u[3], w[3], c[3];
+
+					for(int d = 0; d < 3; d++){
+						const double *coords[3] = { &xCell[0], &yCell[0], &zCell[0] };
+						a[d] = coords[d][tri[t][0]];
+						u[d] = coords[d][tri[t][1]] - a[d];
+						w[d] = coords[d][tri[t][2]] - a[d];
+					}
+
+					// The spherical circumcenter is along the normal of the
+					// plane through the three corners.
+					c[0] = u[1]*w[2] - u[2]*w[1];
+					c[1] = u[2]*w[0] - u[0]*w[2];
+					c[2] = u[0]*w[1] - u[1]*w[0];
+					if(c[0]*a[0] + c[1]*a[1] + c[2]*a[2] < 0.0){
+						c[0] = -c[0]; c[1] = -c[1]; c[2] = -c[2];
+					}
+					normalizeToSphere(c);
+
+					xVertex[iVertex] = c[0] * sphereRadius;
+					yVertex[iVertex] = c[1] * sphereRadius;
+					zVertex[iVertex] = c[2] * sphereRadius;
+					for(int k = 0; k < 3; k++){
+						cellsOnVertex[iVertex*3 + k] = tri[t][k] + 1;
+					}
+				}
+			}
+		}
+
+		xVar->set_cur((long)f * nPerFace);
+		if (!xVar->put(&xVertex[0], nPerFace)) return NC_ERR;
+		yVar->set_cur((long)f * nPerFace);
+		if (!yVar->put(&yVertex[0], nPerFace)) return NC_ERR;
+		zVar->set_cur((long)f * nPerFace);
+		if (!zVar->put(&zVertex[0], nPerFace)) return NC_ERR;
+		covVar->set_cur((long)f * nPerFace, 0);
+		if (!covVar->put(&cellsOnVertex[0], nPerFace, 3)) return NC_ERR;
+	}
+
+	grid.close();
+
+	return 0;
+}/*}}}*/
+int writeHexGrid(const int nx, const int ny, const string outputFilename){/*{{{*/
+	/************************************************************************
+	 *
+	 * This function writes the periodic hex grid. Cell (i, j) is centered at
+	 * ((i + (j%2)/2) dc, j dc sqrt(3)/2). Each cell owns two vertices: the one
+	 * above its center, shared with the two cells in the next row, and the one
+	 * up and to the right, shared with its right neighbour and the cell above
+	 * that.
+	 *
+	 * **********************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+
+	const double dy = dcEdge * sqrt(3.0) / 2.0;
+	const double r = dcEdge / sqrt(3.0);
+	vector<double> xCell, yCell, zCell;
+	vector<double> xVertex, yVertex, zVertex;
+	vector<int> cellsOnVertex;
+	NcVar *var;
+	int error;
+
+	nCells = nx * ny;
+	nVertices = 2 * nCells;
+
+	xCell.resize(nCells);
+	yCell.resize(nCells);
+	zCell.assign(nCells, 0.0);
+	xVertex.resize(nVertices);
+	yVertex.resize(nVertices);
+	zVertex.assign(nVertices, 0.0);
+	cellsOnVertex.resize(nVertices * 3);
+
+	#pragma omp parallel for default(shared)
+	for(int j = 0; j < ny; j++){
+		for(int i = 0; i < nx; i++){
+			int iCell = j * nx + i;
+			int jUp = (j + 1) % ny;
+			int right = j * nx + (i + 1) % nx;
+			// Odd rows are shifted half a cell to the right.
+			int upRight = jUp * nx + ((j % 2) ? (i + 1) % nx : i);
+			int upLeft = jUp * nx + ((j % 2) ? i : (i + nx - 1) % nx);
+
+			xCell[iCell] = dcEdge * (i + 0.5 * (j % 2));
+			yCell[iCell] = dy * j;
+
+			xVertex[2*iCell] = xCell[iCell];
+			yVertex[2*iCell] = yCell[iCell] + r;
+			cellsOnVertex[6*iCell + 0] = iCell + 1;
+			cellsOnVertex[6*iCell + 1] = upRight + 1;
+			cellsOnVertex[6*iCell + 2] = upLeft + 1;
+
+			xVertex[2*iCell+1] = xCell[iCell] + dcEdge / 2.0;
+			yVertex[2*iCell+1] = yCell[iCell] + r / 2.0;
+			cellsOnVertex[6*iCell + 3] = iCell + 1;
+			cellsOnVertex[6*iCell + 4] = right + 1;
+			cellsOnVertex[6*iCell + 5] = upRight + 1;
+		}
+	}
+
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Replace, outputFormat);
+	if(!grid.is_valid()) return NC_ERR;
+
+	if(error = defineGrid(grid, false, nx * dcEdge, ny * dy)) return error;
+
+	if (!(var = grid.get_var("xCell"))) return NC_ERR;
+	if (!var->put(&xCell[0], nCells)) return NC_ERR;
+	if (!(var = grid.get_var("yCell"))) return NC_ERR;
+	if (!var->put(&yCell[0], nCells)) return NC_ERR;
+	if (!(var = grid.get_var("zCell"))) return NC_ERR;
+	if (!var->put(&zCell[0], nCells)) return NC_ERR;
+	if (!(var = grid.get_var("xVertex"))) return NC_ERR;
+	if (!var->put(&xVertex[0], nVertices)) return NC_ERR;
+	if (!(var = grid.get_var("yVertex"))) return NC_ERR;
+	if (!var->put(&yVertex[0], nVertices)) return NC_ERR;
+	if (!(var = grid.get_var("zVertex"))) return NC_ERR;
+	if (!var->put(&zVertex[0], nVertices)) return NC_ERR;
+	if (!(var = grid.get_var("cellsOnVertex"))) return NC_ERR;
+	if (!var->put(&cellsOnVertex[0], nVertices, 3)) return NC_ERR;
+
+	grid.close();
+
+	return 0;
+}/*}}}*/
+/*}}}*/
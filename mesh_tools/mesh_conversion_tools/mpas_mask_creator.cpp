@@ -19,6 +19,9 @@
 #include "netcdf_utils.h"
 #include "pnt.h"
 #include "edge.h"
+#include "coord_array.h"
+#include "stage_profiler.h"
+#include "mpas_mask_creator.h"
 
 #define MESH_SPEC 1.0
 #define ID_LEN 10
@@ -27,6 +30,8 @@
 
 using namespace std;
 
+namespace mask_creator {
+
 bool lonRangePositive = false;
 int nCells, nVertices, nEdges;
 int maxEdges, vertexDegree;
@@ -48,6 +53,10 @@ bool spherical, periodic;
 string in_history = "";
 string in_file_id = "";
 string in_parent_id = "";
+netcdf_mpas_output_format outputFormat;
+string profileFilename = "";
+stage_profiler profiler;
+const mask_input_mesh *inputMesh = NULL;
 
 enum types { num_int, num_double, text };
 
@@ -66,6 +75,7 @@ vector< vector<int> > regionsInGroup;
 vector<string> regionGroupNames;
 vector< vector< vector<double> > > polygonConstants;
 vector< vector< vector<double> > > polygonMultiples;
+vector< vector< vector<double> > > polygonLats;
 
 // Transect information
 vector< vector< vector<pnt> > > transectPoints;
@@ -137,10 +147,17 @@ int outputMaskAttributes( const string outputFilename, const string inputFilenam
 int outputMaskFields( const string outputFilename);
 /*}}}*/
 
+string gen_random(const int len);
+
+} // namespace mask_creator
+
+#ifndef MPAS_MASK_CREATOR_NO_MAIN
+using namespace mask_creator;
+
 void print_usage() {/*{{{*/
 	cout << endl << endl;
 	cout << " USAGE:" << endl;
-	cout << "\tMpasMaskCreator.x in_file out_file [ [-f/-s] file.geojson ] [--positive_lon]" << endl;
+	cout << "\tMpasMaskCreator.x in_file out_file [ [-f/-s] file.geojson ] [--positive_lon] [--profile file] [--format F] [--deflate N] [--shuffle]" << endl;
 	cout << "\t\tin_file: This argument defines the input file that masks will be created for." << endl;
 	cout << "\t\tout_file: This argument defines the file that masks will be written to." << endl;
 	cout << "\t\t-s file.geojson: This argument pair defines a set of points (from the geojson point definition)" << endl;
@@ -154,10 +171,10 @@ void print_usage() {/*{{{*/
 	cout << "\t\t\tThe fact that longitudes in the input MPAS mesh range from 0 to 360 is not relevant to this flag," << endl;
 	cout << "\t\t\tas latitude and longitude are recomputed internally from Cartesian coordinates." << endl;
 	cout << "\t\t\tWhether this flag is passed in or not, any longitudes written are in the 0-360 range." << endl;
+	printProfileUsage();
+	netcdf_mpas_print_output_usage();
 }/*}}}*/
 
-string gen_random(const int len);
-
 int main ( int argc, char *argv[] ) {
 	int error;
 	vector<string> mask_files;
@@ -175,6 +192,12 @@ int main ( int argc, char *argv[] ) {
 	cout << "************************************************************" << endl;
 	cout << endl << endl;
 
+	if ( netcdf_mpas_parse_output_flags(argc, argv, outputFormat)
+			|| parseProfileFlags(argc, argv, profileFilename) ) {
+		print_usage();
+		exit(1);
+	}
+
 	if ( argc < 5 ) {
 		cout << " ERROR: Incorrect usage. See usage statement." << endl;
 		print_usage();
@@ -247,6 +270,32 @@ int main ( int argc, char *argv[] ) {
 
 	}
 
+	error = createMasks(in_name, out_name, mask_files, seed_files);
+	if(error) exit(error);
+
+	profiler.report(cout);
+	if(profileFilename != ""){
+		if(profiler.write_json(profileFilename, "MpasMaskCreator.x")) return 1;
+	}
+
+	return 0;
+}
+#endif
+
+namespace mask_creator {
+
+void setInputMesh(const mask_input_mesh *mesh){/*{{{*/
+	inputMesh = mesh;
+}/*}}}*/
+int createMasks(const string in_name, const string out_name, const vector<string> &mask_files, const vector<string> &seed_files){/*{{{*/
+	/*
+	 * createMasks runs the stages of MpasMaskCreator.x, from reading the
+	 * mesh to writing out_name. The mesh is read from in_name, or taken from
+	 * setInputMesh when one was given, in which case in_name only goes into
+	 * the history attribute.
+	 */
+	int error;
+
 	// Write out the longitude range that is being used
 	cout << endl;
 	if ( lonRangePositive ) {
@@ -260,151 +309,205 @@ int main ( int argc, char *argv[] ) {
 	srand(time(NULL));
 
 	cout << "Reading input grid." << endl;
+	profiler.start("readGridInfo");
 	error = readGridInfo(in_name);
-	if(error) exit(1);
+	if(error) return 1;
+	profiler.stop(nCells, "cells");
 
 	error = resetFeatureInfo();
 
 	if ( mask_files.size() > 0 ) {
 		cout << "Building feature information." << endl;
-		for ( vector<string>::iterator mask_itr = mask_files.begin(); mask_itr != mask_files.end(); mask_itr++ ) {
+		for ( vector<string>::const_iterator mask_itr = mask_files.begin(); mask_itr != mask_files.end(); mask_itr++ ) {
+			profiler.start("getFeatureInfo");
 			error = getFeatureInfo( (*mask_itr) );
-			if(error) exit(1);
+			if(error) return 1;
+			profiler.stop();
 		}
 	}
 
 	if ( seed_files.size() > 0 ) {
 		cout << "Building seed locations." << endl;
-		for ( vector<string>::iterator seed_itr = seed_files.begin(); seed_itr != seed_files.end(); seed_itr++ ) {
+		for ( vector<string>::const_iterator seed_itr = seed_files.begin(); seed_itr != seed_files.end(); seed_itr++ ) {
+			profiler.start("getSeedInfo");
 			error = getSeedInfo( (*seed_itr) );
-			if(error) exit(1);
+			if(error) return 1;
+			profiler.stop();
 		}
 	}
 
 	cout << "Building 'all' feature groups." << endl;
+	profiler.start("buildAllFeatureGroups");
 	if ( error = buildAllFeatureGroups()){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop();
 
 	cout << "Building polygon edge lines" << endl;
+	profiler.start("buildPolygonValues");
 	if(error = buildPolygonValues()){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop();
 
 	cout << "Reading cell center locations" << endl;
+	profiler.start("readCells");
 	if(error = readCells(in_name)){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop(cells.size(), "cells");
 
 	cout << "Marking cells based on region definitions" << endl;
 	cellMasks = new int[cells.size() * regionPolygons.size()];
+	profiler.start("buildCellMasks");
 	if(error = buildMasks(cells, &cellMasks[0])){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop(cells.size(), "cells");
 
 	cout << "Marking points based on cell centers" << endl;
 	pointCellIndices = new int[pointLocations.size()];
+	profiler.start("buildCellPointIndices");
 	if(error = buildPointIndices(pointLocations, cells, &pointCellIndices[0])){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop(cells.size(), "cells");
 
 	cout << " Building closest point location for line segments" << endl;
+	profiler.start("buildCellTransectPoints");
 	closestIndexToTransectPoint = buildClosestValuesForTransects(transectPoints, cells);
+	profiler.stop(cells.size(), "cells");
 
 	cout << " Reading cell graph" << endl;
+	profiler.start("readCellGraph");
 	connectivityGraph = readCellGraph(in_name);
+	profiler.stop(cells.size(), "cells");
 
 	cout << " Building cell transects" << endl;
 	cellPaths.clear();
+	profiler.start("buildCellTransects");
 	cellPaths = buildLinePaths(closestIndexToTransectPoint, connectivityGraph);
+	profiler.stop(cells.size(), "cells");
 
 	cellSeedMask.clear();
+	profiler.start("buildMaskFromFloodFill");
 	buildMaskFromFloodFill( seedPoints, cells, connectivityGraph, &cellSeedMask );
+	profiler.stop(cells.size(), "cells");
 
 	cout << "Deleting cell center information" << endl;
 	cells.clear();
 	connectivityGraph.clear();
 
 	cout << "Reading vertex locations" << endl;
+	profiler.start("readVertices");
 	if(error = readVertices(in_name)){
 		cout << " Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop(vertices.size(), "vertices");
 
 	cout << "Marking vertices based on region definitions" << endl;
 	vertexMasks = new int[vertices.size() * regionPolygons.size()];
+	profiler.start("buildVertexMasks");
 	if(error = buildMasks(vertices, &vertexMasks[0])){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop(vertices.size(), "vertices");
 
 	cout << "Marking points based on vertices" << endl;
 	pointVertexIndices = new int[pointLocations.size()];
+	profiler.start("buildVertexPointIndices");
 	if(error = buildPointIndices(pointLocations, vertices, &pointVertexIndices[0])){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop(vertices.size(), "vertices");
 
 	cout << " Building closest vertex location for line segments" << endl;
+	profiler.start("buildVertexTransectPoints");
 	closestIndexToTransectPoint = buildClosestValuesForTransects(transectPoints, vertices);
+	profiler.stop(vertices.size(), "vertices");
 
 	cout << " Reading vertex graph" << endl;
+	profiler.start("readVertexGraph");
 	connectivityGraph = readVertexGraph(in_name);
+	profiler.stop(vertices.size(), "vertices");
 
 	cout << " Building vertex transects" << endl;
 	vertexPaths.clear();
+	profiler.start("buildVertexTransects");
 	vertexPaths = buildLinePaths(closestIndexToTransectPoint, connectivityGraph);
+	profiler.stop(vertices.size(), "vertices");
 
 	cout << "Deleting vertex information" << endl;
 	vertices.clear();
 	connectivityGraph.clear();
 
 	cout << "Reading edge locations" << endl;
+	profiler.start("readEdges");
 	if(error = readEdges(in_name)){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop(edges.size(), "edges");
 
 	cout << " Building closest edge location for line segments" << endl;
+	profiler.start("buildEdgeTransectPoints");
 	closestIndexToTransectPoint = buildClosestValuesForTransects(transectPoints, edges);
+	profiler.stop(edges.size(), "edges");
 
 	cout << " Reading edge graph" << endl;
+	profiler.start("readEdgeGraph");
 	connectivityGraph = readEdgeGraph(in_name);
+	profiler.stop(edges.size(), "edges");
 
 	cout << " Building edge transects" << endl;
 	edgePaths.clear();
+	profiler.start("buildEdgeTransects");
 	edgePaths = buildLinePaths(closestIndexToTransectPoint, connectivityGraph);
+	profiler.stop(edges.size(), "edges");
 
 	cout << " Building edge transect path signs" << endl;
 	edgePathSigns.clear();
+	profiler.start("buildEdgePathSigns");
 	edgePathSigns = buildEdgePathSigns( in_name, edgePaths );
+	profiler.stop(edges.size(), "edges");
 
 	cout << "Deleting edge information" << endl;
 	edges.clear();
 	connectivityGraph.clear();
 
 	cout << "Writing mask dimensions" << endl;
+	profiler.start("outputMaskDimensions");
 	if(error = outputMaskDimensions(out_name)){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop();
 
 	cout << "Writing mask attributes" << endl;
+	profiler.start("outputMaskAttributes");
 	if(error = outputMaskAttributes(out_name, in_name)){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
+	profiler.stop();
 	cout << "Writing mask fields" << endl;
+	profiler.start("outputMaskFields");
 	if(error = outputMaskFields(out_name)){
 		cout << "Error - " << error << endl;
-		exit(error);
+		return error;
 	}
-}
+	profiler.stop(nCells + nVertices + nEdges, "elements");
+
+	return 0;
+}/*}}}*/
 
 /* Utility functions {{{*/
 int featureIndex( const string featureName, const vector<string> featureNames ) {/*{{{*/
@@ -618,11 +721,11 @@ vector<int> walkGraph( const vector< vector< pair<int, double> > > graph, const
 void buildMaskFromFloodFill( const vector<pnt> seedLocations, const vector<pnt> staticLocations, const vector< vector< pair<int, double> > > graph, vector<int> *mask ){/*{{{*/
 	int i;
 	int numLocs = staticLocations.size();
-	double dist, min_dist;
-	int min_loc, idx;
+	int idx;
 
-	vector<pnt>::const_iterator seed_itr, stat_itr;
+	vector<pnt>::const_iterator seed_itr;
 	vector<int> toCheck;
+	coord_array staticCoords(staticLocations);
 
 	toCheck.clear();
 	(*mask).clear();
@@ -634,18 +737,10 @@ void buildMaskFromFloodFill( const vector<pnt> seedLocations, const vector<pnt>
 
 	// Find seed locations, and add them to the toCheck vector
 	for ( seed_itr = seedLocations.begin(); seed_itr != seedLocations.end(); seed_itr++ ) {
-		min_dist = INFINITY;
-
-		for ( stat_itr = staticLocations.begin(), idx = 0; stat_itr != staticLocations.end(); stat_itr++, idx++ ) {
-			dist = (*seed_itr).dotForAngle( (*stat_itr) );
-
-			if ( min_dist > dist ) {
-				min_dist = dist;
-				min_loc = idx;
-			}
+		idx = nearestPoint(staticCoords, (*seed_itr));
+		if ( idx >= 0 ) {
+			toCheck.push_back(idx);
 		}
-
-		toCheck.push_back(min_loc);
 	}
 
 	// Mark all of the seed points as masked
@@ -675,32 +770,47 @@ int readGridInfo(const string inputFilename){/*{{{*/
 	cout << endl << endl << "Begin function: readGridInput" << endl << endl;
 #endif
 
-	nCells = netcdf_mpas_read_dim(inputFilename, "nCells");
-	nVertices = netcdf_mpas_read_dim(inputFilename, "nVertices");
-	nEdges = netcdf_mpas_read_dim(inputFilename, "nEdges");
-	maxEdges = netcdf_mpas_read_dim(inputFilename, "maxEdges");
-	vertexDegree = netcdf_mpas_read_dim(inputFilename, "vertexDegree");
+	if(inputMesh){
+		nCells = inputMesh->nCells;
+		nVertices = inputMesh->nVertices;
+		nEdges = inputMesh->nEdges;
+		maxEdges = inputMesh->maxEdges;
+		vertexDegree = inputMesh->vertexDegree;
+		spherical = inputMesh->spherical;
+		sphereRadius = inputMesh->sphereRadius;
+		in_history = inputMesh->history;
+		in_file_id = inputMesh->fileId;
+		in_parent_id = inputMesh->parentId;
+	} else {
+		if ( netcdf_mpas_check_dims(inputFilename) ) return 1;
+
+		nCells = netcdf_mpas_read_dim(inputFilename, "nCells");
+		nVertices = netcdf_mpas_read_dim(inputFilename, "nVertices");
+		nEdges = netcdf_mpas_read_dim(inputFilename, "nEdges");
+		maxEdges = netcdf_mpas_read_dim(inputFilename, "maxEdges");
+		vertexDegree = netcdf_mpas_read_dim(inputFilename, "vertexDegree");
 #ifdef _DEBUG
-	cout << "   Reading on_a_sphere" << endl;
+		cout << "   Reading on_a_sphere" << endl;
 #endif
-	spherical = netcdf_mpas_read_onsphere(inputFilename);
+		spherical = netcdf_mpas_read_onsphere(inputFilename);
 #ifdef _DEBUG
-	cout << "   Reading sphere_radius" << endl;
+		cout << "   Reading sphere_radius" << endl;
 #endif
-	sphereRadius = netcdf_mpas_read_sphereradius(inputFilename);
+		sphereRadius = netcdf_mpas_read_sphereradius(inputFilename);
 #ifdef _DEBUG
-	cout << "   Reading history" << endl;
+		cout << "   Reading history" << endl;
 #endif
-	in_history = netcdf_mpas_read_history(inputFilename);
+		in_history = netcdf_mpas_read_history(inputFilename);
 #ifdef _DEBUG
-	cout << "   Reading file_id" << endl;
+		cout << "   Reading file_id" << endl;
 #endif
-	in_file_id = netcdf_mpas_read_fileid(inputFilename);
+		in_file_id = netcdf_mpas_read_fileid(inputFilename);
 
 #ifdef _DEBUG
-	cout << "   Reading parent_id" << endl;
+		cout << "   Reading parent_id" << endl;
 #endif
-	in_parent_id = netcdf_mpas_read_parentid(inputFilename);
+		in_parent_id = netcdf_mpas_read_parentid(inputFilename);
+	}
 
 	cout << "Read dimensions:" << endl;
 	cout << "    nCells = " << nCells << endl;
@@ -728,12 +838,16 @@ int readCells(const string inputFilename){/*{{{*/
 	latcell = new double[nCells];
 	loncell = new double[nCells];
 
-	netcdf_mpas_read_latloncell ( inputFilename, nCells, latcell, loncell );
+	if(inputMesh){
+		copy(inputMesh->latCell.begin(), inputMesh->latCell.end(), latcell);
+		copy(inputMesh->lonCell.begin(), inputMesh->lonCell.end(), loncell);
+	} else {
+		netcdf_mpas_read_latloncell ( inputFilename, nCells, latcell, loncell );
+	}
 
 	cells.clear();
 	for(int i = 0; i < nCells; i++){
 		new_location = pntFromLatLon(latcell[i], loncell[i]);
-		new_location.setPositiveLonRange( lonRangePositive );
 		new_location.idx = i;
 
 		if(spherical) new_location.normalize();
@@ -758,7 +872,12 @@ int readVertices(const string inputFilename){/*{{{*/
 	latvertex = new double[nVertices];
 	lonvertex = new double[nVertices];
 
-	netcdf_mpas_read_latlonvertex ( inputFilename, nVertices, latvertex, lonvertex );
+	if(inputMesh){
+		copy(inputMesh->latVertex.begin(), inputMesh->latVertex.end(), latvertex);
+		copy(inputMesh->lonVertex.begin(), inputMesh->lonVertex.end(), lonvertex);
+	} else {
+		netcdf_mpas_read_latlonvertex ( inputFilename, nVertices, latvertex, lonvertex );
+	}
 
 	vertices.clear();
 	for(int i = 0; i < nVertices; i++){
@@ -787,7 +906,12 @@ int readEdges(const string inputFilename){/*{{{*/
 	latedge = new double[nEdges];
 	lonedge = new double[nEdges];
 
-	netcdf_mpas_read_latlonedge ( inputFilename, nEdges, latedge, lonedge );
+	if(inputMesh){
+		copy(inputMesh->latEdge.begin(), inputMesh->latEdge.end(), latedge);
+		copy(inputMesh->lonEdge.begin(), inputMesh->lonEdge.end(), lonedge);
+	} else {
+		netcdf_mpas_read_latlonedge ( inputFilename, nEdges, latedge, lonedge );
+	}
 
 	edges.clear();
 	for(int i = 0; i < nEdges; i++){
@@ -818,10 +942,17 @@ vector< vector< pair<int, double> > > readCellGraph(const string inputFilename){
 	cellsoncell = new int[nCells * maxEdges];
 	edgesoncell = new int[nCells * maxEdges];
 	dcedge = new double[nEdges];
-	netcdf_mpas_read_nedgesoncell ( inputFilename, nCells, nedgesoncell );
-	netcdf_mpas_read_edgesoncell ( inputFilename, nCells, maxEdges, edgesoncell );
-	netcdf_mpas_read_cellsoncell ( inputFilename, nCells, maxEdges, cellsoncell );
-	netcdf_mpas_read_dcedge ( inputFilename, nEdges, dcedge );
+	if(inputMesh){
+		copy(inputMesh->nEdgesOnCell.begin(), inputMesh->nEdgesOnCell.end(), nedgesoncell);
+		copy(inputMesh->edgesOnCell.begin(), inputMesh->edgesOnCell.end(), edgesoncell);
+		copy(inputMesh->cellsOnCell.begin(), inputMesh->cellsOnCell.end(), cellsoncell);
+		copy(inputMesh->dcEdge.begin(), inputMesh->dcEdge.end(), dcedge);
+	} else {
+		netcdf_mpas_read_nedgesoncell ( inputFilename, nCells, nedgesoncell );
+		netcdf_mpas_read_edgesoncell ( inputFilename, nCells, maxEdges, edgesoncell );
+		netcdf_mpas_read_cellsoncell ( inputFilename, nCells, maxEdges, cellsoncell );
+		netcdf_mpas_read_dcedge ( inputFilename, nEdges, dcedge );
+	}
 
 	for ( int i = 0; i < nCells; i++ ) {
 		cellList.clear();
@@ -859,9 +990,15 @@ vector< vector< pair<int, double> > > readVertexGraph(const string inputFilename
 	verticesonedge = new int[nEdges * 2];
 	edgesonvertex = new int[nVertices * vertexDegree];
 	dvedge = new double[nEdges];
-	netcdf_mpas_read_verticesonedge ( inputFilename, nEdges, verticesonedge );
-	netcdf_mpas_read_edgesonvertex ( inputFilename, nVertices, vertexDegree, edgesonvertex );
-	netcdf_mpas_read_dvedge ( inputFilename, nEdges, dvedge );
+	if(inputMesh){
+		copy(inputMesh->verticesOnEdge.begin(), inputMesh->verticesOnEdge.end(), verticesonedge);
+		copy(inputMesh->edgesOnVertex.begin(), inputMesh->edgesOnVertex.end(), edgesonvertex);
+		copy(inputMesh->dvEdge.begin(), inputMesh->dvEdge.end(), dvedge);
+	} else {
+		netcdf_mpas_read_verticesonedge ( inputFilename, nEdges, verticesonedge );
+		netcdf_mpas_read_edgesonvertex ( inputFilename, nVertices, vertexDegree, edgesonvertex );
+		netcdf_mpas_read_dvedge ( inputFilename, nEdges, dvedge );
+	}
 
 	for ( int i = 0; i < nVertices; i++ ) {
 		vertexList.clear();
@@ -922,9 +1059,15 @@ vector< vector< pair<int, double> > > readEdgeGraph(const string inputFilename){
 	verticesonedge = new int[nEdges * 2];
 	edgesonvertex = new int[nVertices * vertexDegree];
 	dvedge = new double[nEdges];
-	netcdf_mpas_read_verticesonedge ( inputFilename, nEdges, verticesonedge );
-	netcdf_mpas_read_edgesonvertex ( inputFilename, nVertices, vertexDegree, edgesonvertex );
-	netcdf_mpas_read_dvedge ( inputFilename, nEdges, dvedge );
+	if(inputMesh){
+		copy(inputMesh->verticesOnEdge.begin(), inputMesh->verticesOnEdge.end(), verticesonedge);
+		copy(inputMesh->edgesOnVertex.begin(), inputMesh->edgesOnVertex.end(), edgesonvertex);
+		copy(inputMesh->dvEdge.begin(), inputMesh->dvEdge.end(), dvedge);
+	} else {
+		netcdf_mpas_read_verticesonedge ( inputFilename, nEdges, verticesonedge );
+		netcdf_mpas_read_edgesonvertex ( inputFilename, nVertices, vertexDegree, edgesonvertex );
+		netcdf_mpas_read_dvedge ( inputFilename, nEdges, dvedge );
+	}
 
 	for ( int i = 0; i < nEdges; i++ ) {
 		edgeList.clear();
@@ -977,6 +1120,7 @@ int resetFeatureInfo(){/*{{{*/
 
 	polygonConstants.clear();
 	polygonMultiples.clear();
+	polygonLats.clear();
 	pointLocations.clear();
 
 	return 0;
@@ -1058,7 +1202,6 @@ int getFeatureInfo(const string featureFilename){/*{{{*/
 						cout << " Added a region vertex: " << lat << ", " << lon << endl;
 #endif
 						pnt point = pntFromLatLon(lat, lon);
-						point.setPositiveLonRange( lonRangePositive );
 						regionVertices.push_back(point);
 					}
 #ifdef _DEBUG
@@ -1077,7 +1220,6 @@ int getFeatureInfo(const string featureFilename){/*{{{*/
 							cout << " Added a region vertex: " << lat << ", " << lon << endl;
 #endif
 							pnt point = pntFromLatLon(lat, lon);
-							point.setPositiveLonRange( lonRangePositive );
 							regionVertices.push_back(point);
 						}
 #ifdef _DEBUG
@@ -1161,7 +1303,6 @@ int getFeatureInfo(const string featureFilename){/*{{{*/
 #endif
 
 						pnt point = pntFromLatLon(lat, lon);
-						point.setPositiveLonRange( lonRangePositive );
 						transectVertices.push_back(point);
 					}
 
@@ -1181,7 +1322,6 @@ int getFeatureInfo(const string featureFilename){/*{{{*/
 							cout << " Added a transect vertex: " << lat << ", " << lon << endl;
 #endif
 							pnt point = pntFromLatLon(lat, lon);
-							point.setPositiveLonRange( lonRangePositive );
 							transectVertices.push_back(point);
 						}
 
@@ -1246,7 +1386,6 @@ int getFeatureInfo(const string featureFilename){/*{{{*/
 #endif
 
 				pnt point = pntFromLatLon(lat, lon);
-				point.setPositiveLonRange( lonRangePositive );
 				point.idx = pointIdx;
 
 				properties.clear();
@@ -1323,7 +1462,6 @@ int getSeedInfo(const string seedFilename){/*{{{*/
 			double lat = feature["geometry"]["coordinates"][1].asDouble() * M_PI/180.0;
 
 			pnt point = pntFromLatLon(lat, lon);
-			point.setPositiveLonRange( lonRangePositive );
 			point.idx = seedPoints.size();
 
 #ifdef _DEBUG
@@ -1344,8 +1482,7 @@ vector< vector< vector<int> > > buildClosestValuesForTransects(const vector< vec
 	vector<int> minLocPoints;
 	vector< vector<int> > minLocLines;
 
-	double dist, min_dist;
-	int min_loc, idx;;
+	coord_array staticCoords(staticLocations);
 
 	closestIndices.clear();
 
@@ -1355,17 +1492,7 @@ vector< vector< vector<int> > > buildClosestValuesForTransects(const vector< vec
 		for ( cline_itr = (*cseg_itr).begin(); cline_itr != (*cseg_itr).end(); cline_itr++ ) {
 			minLocPoints.clear();
 			for ( cpnt_itr = (*cline_itr).begin(); cpnt_itr != (*cline_itr).end(); cpnt_itr++ ){
-				min_dist = 4.0 * M_PI;
-				for ( idx = 0; idx < staticLocations.size(); idx++ ){
-					dist = (*cpnt_itr).dotForAngle( staticLocations[idx] );
-
-					if ( dist < min_dist ) {
-						min_dist = dist;
-						min_loc = idx;
-					}
-				}
-
-				minLocPoints.push_back(min_loc);
+				minLocPoints.push_back( nearestPoint(staticCoords, (*cpnt_itr)) );
 			}
 
 			minLocLines.push_back(minLocPoints);
@@ -1426,7 +1553,11 @@ vector< vector<int> > buildEdgePathSigns( const string inputFilename, const vect
 	pathSigns.clear();
 	verticesonedge = new int [nEdges * 2];
 
-	netcdf_mpas_read_verticesonedge ( inputFilename, nEdges, verticesonedge );
+	if(inputMesh){
+		copy(inputMesh->verticesOnEdge.begin(), inputMesh->verticesOnEdge.end(), verticesonedge);
+	} else {
+		netcdf_mpas_read_verticesonedge ( inputFilename, nEdges, verticesonedge );
+	}
 
 #ifdef _DEBUG
 	cout << " Building signs for: " << edgePaths.size() << " paths." << endl;
@@ -1506,24 +1637,30 @@ int buildPolygonValues(){/*{{{*/
 
 	// Build the constants and multiples arrays for each polygon, as is done in markCells()
 	// These define the line segment of each edge, so we can test if a ray intersects the edges.
+	// The latitude of each polygon vertex is also kept, since buildMasks needs it for every location.
 
 	polygonConstants.resize(regionPolygons.size());
 	polygonMultiples.resize(regionPolygons.size());
+	polygonLats.resize(regionPolygons.size());
 
 	for (reg_itr = regionPolygons.begin(), iReg = 0; reg_itr != regionPolygons.end(); reg_itr++, iReg++){
 		polygonConstants.at(iReg).resize((*reg_itr).size());
 		polygonMultiples.at(iReg).resize((*reg_itr).size());
+		polygonLats.at(iReg).resize((*reg_itr).size());
 
 		for (poly_itr = (*reg_itr).begin(), iPoly = 0; poly_itr != (*reg_itr).end(); poly_itr++, iPoly++){
 			polygonConstants.at(iReg).at(iPoly).resize((*poly_itr).size());
 			polygonMultiples.at(iReg).at(iPoly).resize((*poly_itr).size());
+			polygonLats.at(iReg).at(iPoly).resize((*poly_itr).size());
 
 			for ( i = 0, j = (*poly_itr).size()-1; i < (*poly_itr).size(); j=i, i++){
 				vert1Lat = (*poly_itr).at(j).getLat();
-				vert1Lon = (*poly_itr).at(j).getLon();
+				vert1Lon = (*poly_itr).at(j).getLon(lonRangePositive);
 
 				vert2Lat = (*poly_itr).at(i).getLat();
-				vert2Lon = (*poly_itr).at(i).getLon();
+				vert2Lon = (*poly_itr).at(i).getLon(lonRangePositive);
+
+				polygonLats.at(iReg).at(iPoly).at(i) = vert2Lat;
 
 				if ( vert1Lat == vert2Lat ) {
 					polygonConstants.at(iReg).at(iPoly).at(i) = vert1Lat;
@@ -1546,8 +1683,7 @@ int buildMasks(vector<pnt> locations, int *masks){/*{{{*/
 	double dot;
 
 	double locLat, locLon;
-	double vert1Lat, vert1Lon;
-	double vert2Lat, vert2Lon;
+	double vert1Lat, vert2Lat;
 	bool oddSides;
 
 	int iReg, iPoly;
@@ -1557,14 +1693,14 @@ int buildMasks(vector<pnt> locations, int *masks){/*{{{*/
 		return 0;
 	}
 
-	#pragma omp parallel for default(shared) private(locLat, locLon, iReg, reg_itr, inReg, poly_itr, iPoly, oddSides, i, j, vert1Lat, vert1Lon, vert2Lat, vert2Lon)
+	#pragma omp parallel for default(shared) private(locLat, locLon, iReg, reg_itr, inReg, poly_itr, iPoly, oddSides, i, j, vert1Lat, vert2Lat)
 	for ( iLoc = 0; iLoc < locations.size(); iLoc++ ){
 #ifdef _DEBUG
 		cout << " Masking location: " << iLoc << " of " << locations.size() << endl;
 #endif
 
 		locLat = locations.at(iLoc).getLat();
-		locLon = locations.at(iLoc).getLon();
+		locLon = locations.at(iLoc).getLon(lonRangePositive);
 		for (reg_itr = regionPolygons.begin(), iReg = 0; reg_itr != regionPolygons.end(); reg_itr++, iReg++){
 			inReg = false;
 			for (poly_itr = (*reg_itr).begin(), iPoly = 0; poly_itr != (*reg_itr).end() && !inReg; poly_itr++, iPoly++){
@@ -1572,16 +1708,17 @@ int buildMasks(vector<pnt> locations, int *masks){/*{{{*/
 				// Test for the number of edge intersections with a zonal ray.
 				// If the number is odd, the point is inside the polygon
 				// If the number is even, the point is outside the polygon
-				oddSides = false;
-				for ( i = 0, j = (*poly_itr).size()-1; i < (*poly_itr).size(); j=i, i++){
-					vert1Lat = (*poly_itr).at(j).getLat();
-					vert1Lon = (*poly_itr).at(j).getLon();
+				const vector<double> &lats = polygonLats[iReg][iPoly];
+				const vector<double> &multiples = polygonMultiples[iReg][iPoly];
+				const vector<double> &constants = polygonConstants[iReg][iPoly];
 
-					vert2Lat = (*poly_itr).at(i).getLat();
-					vert2Lon = (*poly_itr).at(i).getLon();
+				oddSides = false;
+				for ( i = 0, j = lats.size()-1; i < lats.size(); j=i, i++){
+					vert1Lat = lats[j];
+					vert2Lat = lats[i];
 
 					if ( (vert1Lat < locLat && vert2Lat >= locLat) || (vert2Lat < locLat && vert1Lat >= locLat) ) {
-						oddSides = oddSides^(locLat * polygonMultiples.at(iReg).at(iPoly).at(i) + polygonConstants.at(iReg).at(iPoly).at(i) < locLon);
+						oddSides = oddSides^(locLat * multiples[i] + constants[i] < locLon);
 					}
 				}
 				if ( oddSides ) {
@@ -1598,27 +1735,20 @@ int buildMasks(vector<pnt> locations, int *masks){/*{{{*/
 	return 0;
 }/*}}}*/
 int buildPointIndices(vector<pnt> testLocations, vector<pnt> staticLocations, int *indices){/*{{{*/
-	int iTestLoc, iStaticLoc, idx;
-	double minDist, dist;
+	int iTestLoc, idx;
+	coord_array staticCoords(staticLocations);
 
-	#pragma omp parallel for default(shared) private(idx, minDist, iStaticLoc, dist)
+	#pragma omp parallel for default(shared) private(idx)
 	for ( iTestLoc = 0; iTestLoc < testLocations.size(); iTestLoc++){
-		idx = -1;
-		minDist = HUGE_VAL;
-		for ( iStaticLoc = 0; iStaticLoc < staticLocations.size(); iStaticLoc++){
-			dist = testLocations[iTestLoc].dotForAngle(staticLocations[iStaticLoc]);
+		idx = nearestPoint(staticCoords, testLocations[iTestLoc]);
 
-			if ( dist < minDist ) {
 #ifdef _DEBUG
-				cout << "    Old dist / idx: " << minDist << " " << idx << endl;
-				cout << "    New dist / idx: " << dist << " " << iStaticLoc << endl;
-				cout << "    Static Lat/Lon: " << staticLocations[iStaticLoc].getLat() << " " << staticLocations[iStaticLoc].getLon() << endl;
-				cout << "    Test Lat/Lon: " << testLocations[iTestLoc].getLat() << " " << testLocations[iTestLoc].getLon() << endl;
-#endif
-				minDist = dist;
-				idx = iStaticLoc;
-			}
+		if ( idx != -1 ) {
+			cout << "    Closest idx: " << idx << endl;
+			cout << "    Static Lat/Lon: " << staticLocations[idx].getLat() << " " << staticLocations[idx].getLon() << endl;
+			cout << "    Test Lat/Lon: " << testLocations[iTestLoc].getLat() << " " << testLocations[iTestLoc].getLon() << endl;
 		}
+#endif
 
 		if ( idx == -1 ) {
 			cout << " ERROR: No locations found for test location " << iTestLoc << endl;
@@ -1687,7 +1817,7 @@ int outputMaskDimensions( const string outputFilename ){/*{{{*/
 	NcError err(NcError::verbose_nonfatal);
 
 	// open the mpas file
-	NcFile grid(outputFilename.c_str(), NcFile::Replace, NULL, 0, NcFile::Offset64Bits);
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Replace, outputFormat);
 
 	// check to see if the file was opened
 	if(!grid.is_valid()) return NC_ERR;
@@ -1753,7 +1883,7 @@ int outputMaskAttributes( const string outputFilename, const string inputFilenam
 	NcError err(NcError::verbose_nonfatal);
 
 	// open the mpas file
-	NcFile grid(outputFilename.c_str(), NcFile::Write);
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Write, outputFormat);
 
 	// check to see if the file was opened
 	if(!grid.is_valid()) return NC_ERR;
@@ -1811,7 +1941,7 @@ int outputMaskFields( const string outputFilename) {/*{{{*/
 	NcError err(NcError::verbose_nonfatal);
 
 	// open the mpas file
-	NcFile grid(outputFilename.c_str(), NcFile::Write);
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Write, outputFormat);
 
 	// check to see if the file was opened
 	if(!grid.is_valid()) return NC_ERR;
@@ -2372,10 +2502,8 @@ int outputMaskFields( const string outputFilename) {/*{{{*/
 			x[i] = (*pnt_itr).x;
 			y[i] = (*pnt_itr).y;
 			z[i] = (*pnt_itr).z;
-			if ( !lonRangePositive ) (*pnt_itr).setPositiveLonRange(true);
 			lat[i] = (*pnt_itr).getLat();
 			lon[i] = (*pnt_itr).getLon();
-			if ( !lonRangePositive ) (*pnt_itr).setPositiveLonRange(lonRangePositive);
 		}
 
 		if (!(tempVar = grid.add_var("xPoint", ncDouble, nPointsDim))) return NC_ERR;
@@ -2488,3 +2616,4 @@ string gen_random(const int len) {/*{{{*/
 	return rand_str;
 }/*}}}*/
 
+} // namespace mask_creator
@@ -0,0 +1,48 @@
+#ifndef MPAS_MASK_CREATOR_H
+#define MPAS_MASK_CREATOR_H
+
+#include <string>
+#include <vector>
+
+#include "netcdf_utils.h"
+#include "stage_profiler.h"
+
+/*
+ * The mesh fields MpasMaskCreator.x reads from its input file, for tools that
+ * already hold the mesh in memory (MpasMeshPipeline.x). Everything is laid
+ * out as in mesh.nc: indices are 1-based with 0 for none, connectivity is
+ * nRows x maxEdges (etc.), and dcEdge and dvEdge are scaled by sphereRadius.
+ */
+struct mask_input_mesh {
+	int nCells, nVertices, nEdges, maxEdges, vertexDegree;
+	bool spherical;
+	double sphereRadius;
+	std::string history, fileId, parentId;
+
+	std::vector<double> latCell, lonCell;
+	std::vector<double> latVertex, lonVertex;
+	std::vector<double> latEdge, lonEdge;
+	std::vector<int> nEdgesOnCell, cellsOnCell, edgesOnCell;
+	std::vector<int> verticesOnEdge, edgesOnVertex;
+	std::vector<double> dcEdge, dvEdge;
+};
+
+/*
+ * MpasMaskCreator.x keeps its state in globals, which live in this namespace
+ * so it can be linked with MpasMeshBuilder. Build mpas_mask_creator.cpp with
+ * MPAS_MASK_CREATOR_NO_MAIN to use it from another tool.
+ */
+namespace mask_creator {
+	extern bool lonRangePositive;
+	extern netcdf_mpas_output_format outputFormat;
+	extern stage_profiler profiler;
+
+	// Reads the mesh from mesh instead of the input file. mesh has to
+	// outlive createMasks. NULL goes back to reading the file.
+	void setInputMesh(const mask_input_mesh *mesh);
+
+	int createMasks(const std::string in_name, const std::string out_name,
+			const std::vector<std::string> &mask_files, const std::vector<std::string> &seed_files);
+}
+
+#endif
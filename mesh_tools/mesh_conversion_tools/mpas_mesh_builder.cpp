@@ -0,0 +1,2897 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <utility>
+#include <math.h>
+#include <assert.h>
+//#include <tr1/unordered_set>
+#include <unordered_set>
+#include <time.h>
+#include <float.h>
+#include <limits.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "pnt.h"
+#include "edge.h"
+#include "stride_array.h"
+#include "radix_sort.h"
+#include "compact_map.h"
+#include "ccw_order.h"
+#include "coord_array.h"
+#include "mesh_geometry.h"
+#include "mesh_reorder.h"
+#include "stage_profiler.h"
+#include "checkpoint_file.h"
+#include "mpas_mesh_builder.h"
+#include "mpas_mesh_builder_state.h"
+
+using namespace std;
+//using namespace tr1;
+
+/*
+ * The mesh and the build stages live in namespace mpas_mesh_builder, so the
+ * only global symbols of the library are the mpas_mesh_builder_* functions
+ * of its C interface. The state declared in mpas_mesh_builder_state.h is
+ * shared with the converter and writer; everything else has internal
+ * linkage.
+ */
+namespace mpas_mesh_builder {
+
+int nCells, nVertices, vertex_degree;
+int maxEdges;
+int obtuseTriangles = 0;
+bool spherical, periodic;
+double sphereRadius, xPeriod, yPeriod;
+
+stage_profiler profiler;
+
+// Connectivity and location information {{{
+
+vector<pnt> cells;
+vector<pnt> edges;
+vector<pnt> vertices;
+vector<int> completeCellMask;
+vector<int> nEdgesOnCell;
+stride_array<int> cellsOnEdge;
+stride_array<int> verticesOnEdge;
+stride_array<int> edgesOnVertex;
+stride_array<int> cellsOnVertex;
+stride_array<int> cellsOnCell;
+stride_array<int> edgesOnCell;
+stride_array<int> verticesOnCell;
+stride_array<int> edgesOnEdge;
+stride_array<double> weightsOnEdge;
+stride_array<double> kiteAreasOnVertex;
+vector<double> dvEdge;
+vector<double> dcEdge;
+vector<double> areaCell;
+vector<double> areaTriangle;
+vector<double> angleEdge;
+vector<double> meshDensity;
+vector<double> cellQuality;
+vector<double> gridSpacing;
+vector<double> triangleQuality;
+vector<double> triangleAngleQuality;
+vector<int> obtuseTriangle;
+vector<int> boundaryVertex;
+
+// }}}
+
+namespace {
+
+double xCellRange[2];
+double yCellRange[2];
+double zCellRange[2];
+double xVertexRange[2];
+double yVertexRange[2];
+double zVertexRange[2];
+double xCellDistance, yCellDistance, zCellDistance;
+double xVertexDistance, yVertexDistance, zVertexDistance;
+double xPeriodicFix, yPeriodicFix;
+
+// Checkpoints {{{
+
+// Stages after which the mesh is checkpointed, in build order.
+enum checkpoint_stage {
+	CHECKPOINT_NONE = 0,
+	CHECKPOINT_VERTICES_ON_CELL,
+	CHECKPOINT_EDGES,
+	CHECKPOINT_ORDERED_ARRAYS,
+	CHECKPOINT_AREAS,
+	CHECKPOINT_MESH
+};
+const char *checkpointStageNames[] = {"", "verticesOnCell", "edges", "ordered vertex and cell arrays", "areas", "mesh"};
+
+string checkpointDirectory = "";
+uint64_t inputChecksum = 0;
+
+// }}}
+
+// Input grid {{{
+
+class grid_cells_on_vertex {/*{{{*/
+	/*
+	 * cellsOnVertex as passed to set_grid (1-based, 0 for none), read as
+	 * 0-based indices with -1 for none, so the caller's buffer can be used
+	 * without converting it first.
+	 */
+	public:
+		grid_cells_on_vertex() : values(NULL), degree(0) { }
+
+		void set(const int *values_, const int degree_){ values = values_; degree = degree_; }
+		void clear(){ values = NULL; degree = 0; }
+		bool empty() const { return values == NULL; }
+		int stride() const { return degree; }
+		int size(const int) const { return degree; }
+		int at(const int i, const int j) const { return values[(size_t)i * degree + j] - 1; }
+
+	private:
+		const int *values;
+		int degree;
+};/*}}}*/
+
+// With borrowing, set_grid keeps pointers to the caller's buffers instead of
+// copying them (see mpas_mesh_builder_set_borrowing).
+bool borrowGrid = false;
+
+// The input cellsOnVertex, either the caller's buffer or gridCellsOnVertexCopy.
+// Only the stages before orderVertexArrays read it, as orderVertexArrays
+// builds cellsOnVertex from the edges.
+grid_cells_on_vertex gridCellsOnVertex;
+vector<int> gridCellsOnVertexCopy;
+
+// The caller's coordinates, if they are borrowed and the same as cells and
+// vertices (always in the plane, and on the sphere if they are normalized
+// already). buildAreas reads them in place of a copy.
+coord_array gridCellCoords, gridVertexCoords;
+
+// }}}
+
+struct int_hasher {/*{{{*/
+	size_t operator()(const int i) const {
+		return (size_t)i;
+	}
+};/*}}}*/
+
+/* Building/Ordering functions {{{ */
+template <class Geometry> int buildMesh(const Geometry &geometry);
+int buildUnorderedCellConnectivity();
+template <class Geometry> int firstOrderingVerticesOnCell(const Geometry &geometry);
+template <class Geometry> int buildCompleteCellMask(const Geometry &geometry);
+template <class Geometry> int buildEdges(const Geometry &geometry);
+template <class Geometry> int orderVertexArrays(const Geometry &geometry);
+template <class Geometry> int orderCellArrays(const Geometry &geometry);
+template <class Geometry> int buildAreas(const Geometry &geometry);
+int buildEdgesOnEdgeArrays();
+template <class Geometry> int buildAngleEdge(const Geometry &geometry);
+int buildMeshQualities();
+int buildBoundaryVertices();
+int reorderMesh(const string method);
+int cullMesh(const int *cullCell);
+/*}}}*/
+
+/* Checkpoint functions {{{ */
+string checkpointFilename();
+int writeCheckpoint(const int stage);
+int readCheckpoint();
+/*}}}*/
+
+/* C interface helpers {{{ */
+void setView(mpas_mesh_builder_view *view, const int type, const void *data, const int nRows, const int nColumns, const int rowStride, const int *counts);
+void setView(mpas_mesh_builder_view *view, stride_array<int> &values);
+void setView(mpas_mesh_builder_view *view, stride_array<double> &values);
+void setView(mpas_mesh_builder_view *view, vector<int> &values);
+void setView(mpas_mesh_builder_view *view, vector<double> &values);
+void setView(mpas_mesh_builder_view *view, vector<pnt> &points, const int component);
+bool sameCoordinates(const pnt &p, const double x, const double y, const double z);
+void releaseGrid();
+template <class T> void freeVector(vector<T> &values);
+/*}}}*/
+
+} // namespace
+
+} // namespace mpas_mesh_builder
+
+using namespace mpas_mesh_builder;
+
+/* C interface {{{ */
+int mpas_mesh_builder_set_grid(int nCells, int nVertices, int vertexDegree,/*{{{*/
+		const double *xCell, const double *yCell, const double *zCell,
+		const double *xVertex, const double *yVertex, const double *zVertex,
+		const int *cellsOnVertex_, const double *meshDensity_,
+		int onSphere, double sphereRadius_,
+		int isPeriodic, double xPeriod_, double yPeriod_){
+	/*
+	 * mpas_mesh_builder_set_grid replaces the mesh with a new input grid, and
+	 * works out the ranges and periodicity the build stages need. This is
+	 * what MpasMeshConverter.x does after reading grid.nc.
+	 */
+	pnt new_location;
+	bool cellsExact = borrowGrid, verticesExact = borrowGrid;
+
+#ifdef _DEBUG
+	cout << endl << endl << "Begin function: mpas_mesh_builder_set_grid" << endl << endl;
+#endif
+
+	// There are about nCells + nVertices edges, and they are numbered with
+	// int like the cells and vertices.
+	if((long long)nCells + nVertices > INT_MAX){
+		cout << " ERROR: " << nCells << " cells and " << nVertices << " vertices give more than "
+			<< INT_MAX << " edges, which is more than the builder supports." << endl;
+		return 1;
+	}
+
+	mpas_mesh_builder_clear();
+
+	vertex_degree = vertexDegree;
+	spherical = onSphere != 0;
+	sphereRadius = sphereRadius_;
+	periodic = isPeriodic != 0;
+	xPeriod = xPeriod_;
+	yPeriod = yPeriod_;
+
+	if(checkpointDirectory != ""){
+		// Checkpoints are only resumed for exactly the same input.
+		const size_t nCellBytes = (size_t)nCells * sizeof(double);
+		const size_t nVertexBytes = (size_t)nVertices * sizeof(double);
+		const int flags[3] = {vertexDegree, onSphere != 0, isPeriodic != 0};
+		const double scalars[3] = {sphereRadius_, xPeriod_, yPeriod_};
+		uint64_t hash = 14695981039346656037ULL;
+
+		hash = checksumBytes(flags, sizeof(flags), hash);
+		hash = checksumBytes(scalars, sizeof(scalars), hash);
+		hash = checksumBytes(xCell, nCellBytes, hash);
+		hash = checksumBytes(yCell, nCellBytes, hash);
+		hash = checksumBytes(zCell, nCellBytes, hash);
+		hash = checksumBytes(xVertex, nVertexBytes, hash);
+		hash = checksumBytes(yVertex, nVertexBytes, hash);
+		hash = checksumBytes(zVertex, nVertexBytes, hash);
+		hash = checksumBytes(cellsOnVertex_, (size_t)nVertices * vertexDegree * sizeof(int), hash);
+		if(meshDensity_ != NULL){
+			hash = checksumBytes(meshDensity_, nCellBytes, hash);
+		}
+		inputChecksum = hash;
+	}
+
+	// Initialize range mins with huge values.
+	xCellRange[0] = 1E10;
+	yCellRange[0] = 1E10;
+	zCellRange[0] = 1E10;
+	xVertexRange[0] = 1E10;
+	yVertexRange[0] = 1E10;
+	zVertexRange[0] = 1E10;
+
+	// Initialize range maxes with small values.
+	xCellRange[1] = -1E10;
+	yCellRange[1] = -1E10;
+	zCellRange[1] = -1E10;
+	xVertexRange[1] = -1E10;
+	yVertexRange[1] = -1E10;
+	zVertexRange[1] = -1E10;
+
+	// Build cell center location information
+	cells.reserve(nCells);
+	for(int i = 0; i < nCells; i++){
+		xCellRange[0] = min(xCellRange[0], xCell[i]);
+		xCellRange[1] = max(xCellRange[1], xCell[i]);
+
+		yCellRange[0] = min(yCellRange[0], yCell[i]);
+		yCellRange[1] = max(yCellRange[1], yCell[i]);
+
+		zCellRange[0] = min(zCellRange[0], zCell[i]);
+		zCellRange[1] = max(zCellRange[1], zCell[i]);
+
+		new_location = pnt(xCell[i], yCell[i], zCell[i], i);
+
+		if(spherical) new_location.normalize();
+		cellsExact = cellsExact && sameCoordinates(new_location, xCell[i], yCell[i], zCell[i]);
+		cells.push_back(new_location);
+	}
+	if(cellsExact) gridCellCoords.borrow(nCells, xCell, yCell, zCell);
+
+	cout << "Built " << cells.size() << " cells." << endl;
+
+	// Build vertex location information
+	vertices.reserve(nVertices);
+	for(int i = 0; i < nVertices; i++){
+		xVertexRange[0] = min(xVertexRange[0], xVertex[i]);
+		xVertexRange[1] = max(xVertexRange[1], xVertex[i]);
+
+		yVertexRange[0] = min(yVertexRange[0], yVertex[i]);
+		yVertexRange[1] = max(yVertexRange[1], yVertex[i]);
+
+		zVertexRange[0] = min(zVertexRange[0], zVertex[i]);
+		zVertexRange[1] = max(zVertexRange[1], zVertex[i]);
+
+		new_location = pnt(xVertex[i], yVertex[i], zVertex[i], i);
+		if(spherical) new_location.normalize();
+		verticesExact = verticesExact && sameCoordinates(new_location, xVertex[i], yVertex[i], zVertex[i]);
+		vertices.push_back(new_location);
+	}
+	if(verticesExact) gridVertexCoords.borrow(nVertices, xVertex, yVertex, zVertex);
+
+	cout << "Built " << vertices.size() << " vertices." << endl;
+
+	// Unordered cellsOnVertex information, still 1-based. The stages convert
+	// it to base 0 (c index space) as they read it.
+	if(borrowGrid){
+		gridCellsOnVertex.set(cellsOnVertex_, vertexDegree);
+	} else {
+		gridCellsOnVertexCopy.assign(cellsOnVertex_, cellsOnVertex_ + (size_t)nVertices * vertexDegree);
+		gridCellsOnVertex.set(gridCellsOnVertexCopy.data(), vertexDegree);
+	}
+
+	if(meshDensity_ != NULL){
+		meshDensity.assign(meshDensity_, meshDensity_ + nCells);
+	} else {
+		meshDensity.assign(nCells, 1.0);
+	}
+
+	xCellDistance = fabs(xCellRange[1] - xCellRange[0]);
+	yCellDistance = fabs(yCellRange[1] - yCellRange[0]);
+	zCellDistance = fabs(zCellRange[1] - zCellRange[0]);
+
+	xVertexDistance = fabs(xVertexRange[1] - xVertexRange[0]);
+	yVertexDistance = fabs(yVertexRange[1] - yVertexRange[0]);
+	zVertexDistance = fabs(zVertexRange[1] - zVertexRange[0]);
+
+	if(periodic){
+		// Quads are not staggered in the y direction, so need to period by
+		// max distance + min distance
+		if(vertexDegree == 4){
+			if(xPeriod < 0.0){
+				xPeriodicFix = xCellRange[0] + xCellRange[1];
+			} else {
+				xPeriodicFix = xPeriod;
+			}
+
+			if(yPeriod < 0.0){
+				yPeriodicFix = yCellRange[0] + yCellRange[1];
+			} else {
+				yPeriodicFix = yPeriod;
+			}
+		// Triangles can be staggered, so only period my max distance
+		} else {
+			if(xPeriod < 0.0){
+				xPeriodicFix = xCellRange[1];
+			} else {
+				xPeriodicFix = xPeriod;
+			}
+
+			if(yPeriod < 0.0){
+				yPeriodicFix = yCellRange[1];
+			} else {
+				yPeriodicFix = yPeriod;
+			}
+		}
+	} else {
+		xPeriodicFix = 1.0e5 * abs(xCellRange[1] + xCellRange[0]);
+		yPeriodicFix = 1.0e5 * abs(yCellRange[1] + yCellRange[0]);
+	}
+
+#ifdef _DEBUG
+	xPeriod = xPeriodicFix;
+	yPeriod = yPeriodicFix;
+	cout << "cell Mins: " << xCellRange[0] << " " << yCellRange[0] << " " << zCellRange[0] << endl;
+	cout << "vertex Mins: " << xVertexRange[0] << " " << yVertexRange[0] << " " << zVertexRange[0] << endl;
+	cout << "cell Maxes: " << xCellRange[1] << " " << yCellRange[1] << " " << zCellRange[1] << endl;
+	cout << "vertex Maxes: " << xVertexRange[1] << " " << yVertexRange[1] << " " << zVertexRange[1] << endl;
+	cout << "cell Distances: " << xCellDistance << " " << yCellDistance << " " << zCellDistance << endl;
+	cout << "vertex Distances: " << xVertexDistance << " " << yVertexDistance << " " << zVertexDistance << endl;
+	cout << "xPeriodicFix: " << xPeriodicFix << endl;
+	cout << "yPeriodicFix: " << yPeriodicFix << endl;
+	cout << "xPeriod: " << xPeriod << endl;
+	cout << "yPeriod: " << yPeriod << endl;
+#endif
+
+	if(!spherical && (zCellDistance > 0.0 || zVertexDistance > 0.0)){
+		cout << "ERROR:" << endl;
+		cout << "  This point set is defined in the plane, but has non-zero Z coordinates." << endl;
+		cout << endl;
+		return 1;
+	}
+
+	return 0;
+}/*}}}*/
+int mpas_mesh_builder_build(){/*{{{*/
+	/*
+	 * mpas_mesh_builder_build runs the build stages on the grid given to
+	 * mpas_mesh_builder_set_grid. The stages are compiled for each geometry
+	 * (see mesh_geometry.h), so the geometry is only tested here.
+	 */
+	int error;
+
+	if(cells.empty() || vertices.empty()){
+		cout << " ERROR: No grid has been set." << endl;
+		return 1;
+	}
+
+	if(spherical){
+		error = buildMesh(spherical_geometry());
+	} else if(periodic){
+		error = buildMesh(periodic_planar_geometry(xPeriodicFix, yPeriodicFix));
+	} else {
+		error = buildMesh(planar_geometry());
+	}
+
+	// Borrowed buffers are not read after this.
+	releaseGrid();
+
+	return error;
+}/*}}}*/
+int mpas_mesh_builder_set_borrowing(int borrow){/*{{{*/
+	borrowGrid = (borrow != 0);
+
+	return 0;
+}/*}}}*/
+int mpas_mesh_builder_set_checkpoint(const char *directory){/*{{{*/
+	checkpointDirectory = (directory == NULL) ? "" : directory;
+
+	// Strip trailing slashes, except for the root directory.
+	while(checkpointDirectory.size() > 1 && checkpointDirectory[checkpointDirectory.size() - 1] == '/'){
+		checkpointDirectory.erase(checkpointDirectory.size() - 1);
+	}
+
+	return 0;
+}/*}}}*/
+int mpas_mesh_builder_reorder(const char *method){/*{{{*/
+	if(edges.empty()){
+		cout << " ERROR: The mesh has not been built." << endl;
+		return 1;
+	}
+
+	return reorderMesh(method);
+}/*}}}*/
+int mpas_mesh_builder_cull(const int *cullCell){/*{{{*/
+	if(edges.empty()){
+		cout << " ERROR: The mesh has not been built." << endl;
+		return 1;
+	}
+
+	return cullMesh(cullCell);
+}/*}}}*/
+int mpas_mesh_builder_get_dimension(const char *name){/*{{{*/
+	const string dim = name;
+
+	if(dim == "nCells") return cells.size();
+	if(dim == "nEdges") return edges.size();
+	if(dim == "nVertices") return vertices.size();
+	if(dim == "maxEdges") return maxEdges;
+	if(dim == "maxEdges2") return maxEdges * 2;
+	if(dim == "vertexDegree") return vertex_degree;
+
+	return -1;
+}/*}}}*/
+int mpas_mesh_builder_get_view(const char *name, mpas_mesh_builder_view *view){/*{{{*/
+	const string field = name;
+
+	if(edges.empty()){
+		return 1;
+	}
+
+	if(field == "xCell") setView(view, cells, 0);
+	else if(field == "yCell") setView(view, cells, 1);
+	else if(field == "zCell") setView(view, cells, 2);
+	else if(field == "xEdge") setView(view, edges, 0);
+	else if(field == "yEdge") setView(view, edges, 1);
+	else if(field == "zEdge") setView(view, edges, 2);
+	else if(field == "xVertex") setView(view, vertices, 0);
+	else if(field == "yVertex") setView(view, vertices, 1);
+	else if(field == "zVertex") setView(view, vertices, 2);
+	else if(field == "cellsOnCell") setView(view, cellsOnCell);
+	else if(field == "edgesOnCell") setView(view, edgesOnCell);
+	else if(field == "verticesOnCell") setView(view, verticesOnCell);
+	else if(field == "nEdgesOnCell") setView(view, MPAS_MESH_BUILDER_INT, edgesOnCell.sizes(), edgesOnCell.size(), 1, 1, NULL);
+	else if(field == "cellsOnEdge") setView(view, cellsOnEdge);
+	else if(field == "verticesOnEdge") setView(view, verticesOnEdge);
+	else if(field == "edgesOnEdge") setView(view, edgesOnEdge);
+	else if(field == "nEdgesOnEdge") setView(view, MPAS_MESH_BUILDER_INT, edgesOnEdge.sizes(), edgesOnEdge.size(), 1, 1, NULL);
+	else if(field == "weightsOnEdge") setView(view, weightsOnEdge);
+	else if(field == "cellsOnVertex") setView(view, cellsOnVertex);
+	else if(field == "edgesOnVertex") setView(view, edgesOnVertex);
+	else if(field == "kiteAreasOnVertex") setView(view, kiteAreasOnVertex);
+	else if(field == "areaCell") setView(view, areaCell);
+	else if(field == "areaTriangle") setView(view, areaTriangle);
+	else if(field == "dvEdge") setView(view, dvEdge);
+	else if(field == "dcEdge") setView(view, dcEdge);
+	else if(field == "angleEdge") setView(view, angleEdge);
+	else if(field == "meshDensity") setView(view, meshDensity);
+	else if(field == "cellQuality") setView(view, cellQuality);
+	else if(field == "gridSpacing") setView(view, gridSpacing);
+	else if(field == "triangleQuality") setView(view, triangleQuality);
+	else if(field == "triangleAngleQuality") setView(view, triangleAngleQuality);
+	else if(field == "obtuseTriangle") setView(view, obtuseTriangle);
+	else if(field == "boundaryVertex") setView(view, boundaryVertex);
+	else return 1;
+
+	return 0;
+}/*}}}*/
+void mpas_mesh_builder_clear(){/*{{{*/
+	freeVector(cells);
+	freeVector(edges);
+	freeVector(vertices);
+	freeVector(completeCellMask);
+	freeVector(nEdgesOnCell);
+	cellsOnEdge.clear();
+	verticesOnEdge.clear();
+	edgesOnVertex.clear();
+	cellsOnVertex.clear();
+	cellsOnCell.clear();
+	edgesOnCell.clear();
+	verticesOnCell.clear();
+	edgesOnEdge.clear();
+	weightsOnEdge.clear();
+	kiteAreasOnVertex.clear();
+	freeVector(dvEdge);
+	freeVector(dcEdge);
+	freeVector(areaCell);
+	freeVector(areaTriangle);
+	freeVector(angleEdge);
+	freeVector(meshDensity);
+	freeVector(cellQuality);
+	freeVector(gridSpacing);
+	freeVector(triangleQuality);
+	freeVector(triangleAngleQuality);
+	freeVector(obtuseTriangle);
+	freeVector(boundaryVertex);
+	releaseGrid();
+	maxEdges = 0;
+	obtuseTriangles = 0;
+}/*}}}*/
+/*}}}*/
+
+namespace mpas_mesh_builder {
+
+namespace {
+
+/* Building/Ordering functions {{{ */
+template <class Geometry>
+int buildMesh(const Geometry &geometry){/*{{{*/
+	/*
+	 * buildMesh runs all stages that build the mesh arrays from the input
+	 * grid, for one geometry policy. With a checkpoint directory, the mesh is
+	 * saved after each group of stages below, and the stages already in the
+	 * checkpoint of this input are skipped.
+	 */
+	int error;
+	int resumed;
+
+	resumed = readCheckpoint();
+	if(resumed < 0) return 1;
+
+	if(resumed < CHECKPOINT_ORDERED_ARRAYS && gridCellsOnVertex.empty()){
+		cout << " ERROR: The input grid has already been built. Set it again to rebuild it." << endl;
+		return 1;
+	}
+
+	if(resumed < CHECKPOINT_VERTICES_ON_CELL){
+		cout << "Build prelimiary cell connectivity." << endl;
+		profiler.start("buildUnorderedCellConnectivity");
+		error = buildUnorderedCellConnectivity();
+		if(error) return 1;
+		profiler.stop(cells.size(), "cells");
+
+		cout << "Order vertices on cell." << endl;
+		profiler.start("firstOrderingVerticesOnCell");
+		error = firstOrderingVerticesOnCell(geometry);
+		if(error) return 1;
+		profiler.stop(cells.size(), "cells");
+
+		cout << "Build complete cell mask." << endl;
+		profiler.start("buildCompleteCellMask");
+		error = buildCompleteCellMask(geometry);
+		if(error) return 1;
+		profiler.stop(cells.size(), "cells");
+
+		writeCheckpoint(CHECKPOINT_VERTICES_ON_CELL);
+	}
+
+	if(resumed < CHECKPOINT_EDGES){
+		cout << "Build and order edges, dvEdge, and dcEdge." << endl;
+		profiler.start("buildEdges");
+		error = buildEdges(geometry);
+		if(error) return 1;
+		profiler.stop(edges.size(), "edges");
+
+		writeCheckpoint(CHECKPOINT_EDGES);
+	}
+
+	if(resumed < CHECKPOINT_ORDERED_ARRAYS){
+		cout << "Build and order vertex arrays," << endl;
+		profiler.start("orderVertexArrays");
+		error = orderVertexArrays(geometry);
+		if(error) return 1;
+		profiler.stop(vertices.size(), "vertices");
+
+		cout << "Build and order cell arrays," << endl;
+		profiler.start("orderCellArrays");
+		error = orderCellArrays(geometry);
+		if(error) return 1;
+		profiler.stop(cells.size(), "cells");
+
+		writeCheckpoint(CHECKPOINT_ORDERED_ARRAYS);
+	}
+
+	if(resumed < CHECKPOINT_AREAS){
+		cout << "Build areaCell, areaTriangle, and kiteAreasOnVertex." << endl;
+		profiler.start("buildAreas");
+		error = buildAreas(geometry);
+		if(error) return 1;
+		profiler.stop(cells.size(), "cells");
+
+		writeCheckpoint(CHECKPOINT_AREAS);
+	}
+
+	if(resumed < CHECKPOINT_MESH){
+		cout << "Build edgesOnEdge and weightsOnEdge." << endl;
+		profiler.start("buildEdgesOnEdgeArrays");
+		error = buildEdgesOnEdgeArrays();
+		if(error) return 1;
+		profiler.stop(edges.size(), "edges");
+
+		cout << "Build angleEdge." << endl;
+		profiler.start("buildAngleEdge");
+		error = buildAngleEdge(geometry);
+		if(error) return 1;
+		profiler.stop(edges.size(), "edges");
+
+		cout << "Building mesh qualities." << endl;
+		profiler.start("buildMeshQualities");
+		error = buildMeshQualities();
+		if(error) return 1;
+		profiler.stop(cells.size(), "cells");
+
+		writeCheckpoint(CHECKPOINT_MESH);
+	}
+
+	// Derived from cellsOnVertex, so it is not checkpointed.
+	buildBoundaryVertices();
+
+	return 0;
+}/*}}}*/
+int buildUnorderedCellConnectivity(){/*{{{*/
+	// buildUnorderedCellConnectivity should assume that cellsOnVertex hasn't been ordered properly yet.
+	//    It should compute the inverse of cellsOnVertex (verticesOnCell) unordered.
+	//    It will also compute an unordered cellsOnCell that can be considered invalid for actual use (e.g. quad grids).
+	//    This ordering should happen regardless of it the mesh is planar or spherical.
+	//
+	//    verticesOnCell is built as a transpose of cellsOnVertex: vertices
+	//    are counted per cell, and then written to their cell's row at a
+	//    position taken from an atomic counter. Each row is sorted afterwards,
+	//    so rows list vertices in increasing order independent of threading.
+	//
+	//    A cell shares a vertex with another cell exactly when that vertex
+	//    lists both cells, so the shared vertices of iCell and each
+	//    neighbouring cell are counted directly from cellsOnVertex.
+	
+	int iVertex, iCell, newCell, vertex, j, k, l, pos;
+	int maxVertices, nVertexCells;
+	int *cellVertices;
+	bool add;
+	vector<int> vertexCount;
+
+#ifdef _DEBUG
+	cout << endl << endl << "Begin function: buildUnorderedCellConnectivity" << endl << endl;
+#endif
+
+	// Count the distinct vertices around each cell. A cell listed twice by
+	// the same vertex is only counted once.
+	vertexCount.resize(cells.size(), 0);
+	#pragma omp parallel for default(shared) private(j, k, iCell, add, nVertexCells)
+	for(iVertex = 0; iVertex < vertices.size(); iVertex++){
+		nVertexCells = gridCellsOnVertex.size(iVertex);
+		for(j = 0; j < nVertexCells; j++){
+			iCell = gridCellsOnVertex.at(iVertex, j);
+			add = (iCell != -1);
+			for(k = 0; k < j && add; k++){
+				add = (gridCellsOnVertex.at(iVertex, k) != iCell);
+			}
+
+			if(add){
+				#pragma omp atomic
+				vertexCount[iCell]++;
+			}
+		}
+	}
+
+	maxVertices = 0;
+	#pragma omp parallel for default(shared) reduction(max:maxVertices)
+	for(iCell = 0; iCell < cells.size(); iCell++){
+		maxVertices = max(maxVertices, vertexCount[iCell]);
+	}
+
+	verticesOnCell.clear();
+	verticesOnCell.resize(cells.size(), maxVertices, -1);
+
+	#pragma omp parallel for default(shared)
+	for(iCell = 0; iCell < cells.size(); iCell++){
+		verticesOnCell.set_size(iCell, vertexCount[iCell]);
+		vertexCount[iCell] = 0;
+	}
+
+	// Fill each row, reusing vertexCount as the next free slot of each row.
+	#pragma omp parallel for default(shared) private(j, k, iCell, add, pos, nVertexCells)
+	for(iVertex = 0; iVertex < vertices.size(); iVertex++){
+		nVertexCells = gridCellsOnVertex.size(iVertex);
+		for(j = 0; j < nVertexCells; j++){
+			iCell = gridCellsOnVertex.at(iVertex, j);
+			add = (iCell != -1);
+			for(k = 0; k < j && add; k++){
+				add = (gridCellsOnVertex.at(iVertex, k) != iCell);
+			}
+
+			if(add){
+				#pragma omp atomic capture
+				pos = vertexCount[iCell]++;
+				verticesOnCell.row(iCell)[pos] = iVertex;
+			}
+		}
+	}
+	vertexCount.clear();
+
+	#pragma omp parallel for default(shared)
+	for(iCell = 0; iCell < cells.size(); iCell++){
+		sort(verticesOnCell.row(iCell), verticesOnCell.row(iCell) + verticesOnCell.size(iCell));
+	}
+
+	// Each vertex on a cell can contribute at most vertexDegree neighbors.
+	// Each cell only writes its own row of cellsOnCell.
+	cellsOnCell.clear();
+	cellsOnCell.resize(cells.size(), maxVertices * gridCellsOnVertex.stride(), -1);
+	#pragma omp parallel default(shared) private(iCell, j, k, l, newCell, vertex, add, nVertexCells, cellVertices)
+	{
+		// Cells around the vertices of iCell, in the order they are first
+		// found, and how many vertices of iCell each one shares.
+		vector<int> candidates(cellsOnCell.stride());
+		vector<int> matchCount(cellsOnCell.stride());
+		int nCandidates;
+
+		#pragma omp for
+		for(iCell = 0; iCell < cells.size(); iCell++){
+			nCandidates = 0;
+			cellVertices = verticesOnCell.row(iCell);
+			for(j = 0; j < verticesOnCell.size(iCell); j++){
+				vertex = cellVertices[j];
+				nVertexCells = gridCellsOnVertex.size(vertex);
+				for(k = 0; k < nVertexCells; k++){
+					newCell = gridCellsOnVertex.at(vertex, k);
+
+					add = (newCell != iCell);
+					for(l = 0; l < k && add; l++){
+						add = (gridCellsOnVertex.at(vertex, l) != newCell);
+					}
+
+					if(add){
+						for(l = 0; l < nCandidates; l++){
+							if(candidates[l] == newCell){
+								break;
+							}
+						}
+
+						if(l == nCandidates){
+							candidates[l] = newCell;
+							matchCount[l] = 0;
+							nCandidates++;
+						}
+						matchCount[l]++;
+					}
+				}
+			}
+
+			// A neighbor across an edge shares exactly two vertices with iCell.
+			for(l = 0; l < nCandidates; l++){
+				if(candidates[l] == -1){
+					cellsOnCell.push_back(iCell, candidates[l]);
+				} else if(matchCount[l] == 2){
+					cellsOnCell.push_back(iCell, candidates[l]);
+#ifdef _DEBUG
+					cout << "   Found two shared vertices for cell edge. Adding cell." << endl;
+#endif
+				} else {
+#ifdef _DEBUG
+					cout << "   Only found " << matchCount[l] << " shared vertices for cell edge. Not adding cell." << endl;
+#endif
+				}
+			}
+		}
+	}
+
+	return 0;
+}/*}}}*/
+template <class Geometry>
+int firstOrderingVerticesOnCell(const Geometry &geometry){/*{{{*/
+	/*
+	 * firstOrderingVerticesOnCell should order the vertices around a cell such that they are connected.
+	 *		i.e. verticesOnCell.at(iCell, i) should be the tail of a vector pointing to
+	 *		     verticesOnCell.at(iCell, i+1)
+	 *
+	 *		This is done by sorting the vertices counter-clockwise around the cell center,
+	 *		starting from the first vertex in the list (see ccw_order.h).
+	 *
+	 */
+
+	ccw_order<Geometry> ccw(geometry);
+	int iCell, j, k;
+
+#ifdef _DEBUG
+	cout << endl << endl << "Begin function: firstOrderingVerticesOnCell" << endl << endl;
+#endif
+
+	// Each cell only reorders its own row of verticesOnCell.
+	#pragma omp parallel for default(shared) private(j, k)
+	for(iCell = 0; iCell < cells.size(); iCell++){
+#ifdef _DEBUG
+		cout << "new cell: " << iCell << endl;
+		cout << "    " << cells.at(iCell) << endl;
+		cout << "  Unsorted verticesOnCell: ";
+		for(j = 0; j < verticesOnCell.size(iCell); j++){
+			cout << verticesOnCell.at(iCell, j) << " ";
+		}
+		cout << endl;
+		for(j = 0; j < verticesOnCell.size(iCell); j++){
+			cout << "  cellsOnVertex " << verticesOnCell.at(iCell, j) << ": ";
+			for(k = 0; k < gridCellsOnVertex.size(verticesOnCell.at(iCell, j)); k++){
+				cout <<  gridCellsOnVertex.at(verticesOnCell.at(iCell, j), k) << " ";
+			}
+			cout << endl;
+		}
+#endif
+
+		ccw.sort(cells.at(iCell), vertices, verticesOnCell.row(iCell), verticesOnCell.size(iCell));
+
+#ifdef _DEBUG
+		cout << "  Sorted verticesOnCell: ";
+		for(j = 0; j < verticesOnCell.size(iCell); j++){
+			cout << verticesOnCell.at(iCell, j) << " ";
+		}
+		cout << endl;
+		for(j = 0; j < verticesOnCell.size(iCell); j++){
+			cout << "  cellsOnVertex " << verticesOnCell.at(iCell, j) << ": ";
+			for(k = 0; k < gridCellsOnVertex.size(verticesOnCell.at(iCell, j)); k++){
+				cout <<  gridCellsOnVertex.at(verticesOnCell.at(iCell, j), k) << " ";
+			}
+			cout << endl;
+		}
+#endif
+	}
+
+	return 0;
+}/*}}}*/
+template <class Geometry>
+int buildCompleteCellMask(const Geometry &geometry){/*{{{*/
+	/*
+	 * The buildCompleteCellMask function parses an ordered 
+	 * verticesOnCell field to determine if a cell is complete. It takes each
+	 * vertex-vertex pair (from verticesOnCell) and determines the angle
+	 * between them. If only one vertex is shared, the "edge" is skipped.
+	 *
+	 * These angles are summed up around each cell. If the total
+	 * angle is close to 2.0*Pi then the cell is marked as complete. Otherwise
+	 * it is marked as incomplete.
+	 *
+	 * The complete check is used when building edges. If an edge only has one
+	 * vertex, but is connected to two complete cells, the edge is not added to
+	 * the set. This resolves an issue related to quad grids, where a possible
+	 * edge connects two cells across a vertex (where the edge mid point would
+	 * be the vertex location). Using this check removes these edges from the
+	 * possible set of edges.
+	 *
+	 */
+	int iCell, iCell2, vertex1, vertex2;
+	int j, k, l;
+	pnt vert_loc1, vert_loc2;
+	pnt vec1, vec2;
+	pnt cross, normal;
+	double angle, angle_sum, dot;
+	bool complete;
+
+	completeCellMask.clear();
+	completeCellMask.resize(cells.size());
+
+	// Iterate over all cells
+	#pragma omp parallel for default(shared) private(normal, vertex1, vertex2, j, vert_loc1, vert_loc2, vec1, vec2, cross, angle, angle_sum, dot, complete)
+	for(iCell = 0; iCell < cells.size(); iCell++){
+		complete = false;
+		angle_sum = 0.0;
+
+		normal = geometry.normal(cells.at(iCell));
+
+#ifdef _DEBUG
+		cout << "  Checking " << iCell << " for completeness" << endl;
+		cout << "           " << cells.at(iCell) << endl;
+#endif
+
+		// Since verticesOnEdge is ordered already, compute angles between
+		// neighboring vertex/vertex pairs if they are both valid vertices. Sum
+		// the angles, and if the angles are close to 2.0 * Pi then the cell is
+		// "complete"
+		if(verticesOnCell.size(iCell) >= cellsOnCell.size(iCell)){
+			for(j = 0; j < verticesOnCell.size(iCell)-1; j++){
+				vertex1 = verticesOnCell.at(iCell, j);
+				vertex2 = verticesOnCell.at(iCell, j+1);
+
+				if(vertex1 != -1 && vertex2 != -1){
+					vert_loc1 = vertices.at(vertex1);
+					vert_loc2 = vertices.at(vertex2);
+
+					geometry.fixPeriodicity(vert_loc1, cells.at(iCell));
+					geometry.fixPeriodicity(vert_loc2, cells.at(iCell));
+
+					vec1 = vert_loc1 - cells.at(iCell);
+					vec2 = vert_loc2 - cells.at(iCell);
+
+					cross = vec1.cross(vec2);
+					dot = cross.dot(normal);
+
+#ifdef _DEBUG
+					cout << "         vec1 : " << vec1 << endl;
+					cout << "         vec2 : " << vec2 << endl;
+					cout << "        cross : " << cross << endl;
+					cout << "          dot : " << dot << endl;
+#endif
+
+					if(dot > 0){
+
+						angle = acos( vec2.dot(vec1) / (vec1.magnitude() * vec2.magnitude()));
+						angle_sum += angle;
+
+#ifdef _DEBUG
+						cout << "        adding angle (rad) : " << angle << endl;
+						cout << "        adding angle (deg) : " << angle * 180.0 / M_PI << endl;
+						cout << "        new sum : " << angle_sum << endl;
+#endif
+					} else {
+						cout << "     complete check has non CCW edge..." << endl;
+					}
+				}
+			}
+
+			vertex1 = verticesOnCell.at(iCell, verticesOnCell.size(iCell) - 1);
+			vertex2 = verticesOnCell.at(iCell, 0);
+
+			if(vertex1 != -1 && vertex2 != -1){
+				vert_loc1 = vertices.at(vertex1);
+				vert_loc2 = vertices.at(vertex2);
+
+				geometry.fixPeriodicity(vert_loc1, cells.at(iCell));
+				geometry.fixPeriodicity(vert_loc2, cells.at(iCell));
+
+				vec1 = vert_loc1 - cells.at(iCell);
+				vec2 = vert_loc2 - cells.at(iCell);
+
+				cross = vec1.cross(vec2);
+				dot = cross.dot(normal);
+
+#ifdef _DEBUG
+				cout << "         vec1 : " << vec1 << endl;
+				cout << "         vec2 : " << vec2 << endl;
+				cout << "        cross : " << cross << endl;
+				cout << "          dot : " << dot << endl;
+#endif
+
+				if(dot > 0) {
+
+					angle = acos( vec2.dot(vec1) / (vec1.magnitude() * vec2.magnitude()));
+					angle_sum += angle;
+
+#ifdef _DEBUG
+					cout << "        adding angle (rad) : " << angle << endl;
+					cout << "        adding angle (deg) : " << angle * 180.0 / M_PI << endl;
+					cout << "        new sum : " << angle_sum << endl;
+#endif
+				} else {
+					cout << "     complete check has non CCW edge..." << endl;
+				}
+			}
+		}
+
+		if(angle_sum > 2.0 * M_PI * 0.98){
+			complete = true;
+		}
+
+#ifdef _DEBUG
+		cout << "   Vertices on cell: " << verticesOnCell.size(iCell);
+		cout << "   Cells on cell: " << cellsOnCell.size(iCell);
+		if(complete){
+			cout << "   Is complete!" << endl;
+		} else {
+			cout << "   Is not complete!" << endl;
+		}
+#endif
+
+		if(complete){
+			completeCellMask.at(iCell) = 1;
+		} else {
+			completeCellMask.at(iCell) = 0;
+		}
+	}
+
+	return 0;
+}/*}}}*/
+template <class Geometry>
+int buildEdges(const Geometry &geometry){/*{{{*/
+	/*
+	 * buildEdges is intended to build a list of candidate edges that contains
+	 *    the cellsOnEdge and verticesonEdge pairs for each edge.  The actual
+	 *    edge location is not constructed at this point in time, as we need to
+	 *    determine the four constituent locations for each edge before we can
+	 *    compute it.
+	 *
+	 *    This function assumes the cellsOnVertex array is ordered such that
+	 *    two consecutive cell indices make up an edge.  This isn't an issue
+	 *    for triangular dual grids, but quadrilateral dual grids have an issue
+	 *    where every cell is not connected with every other cell. So, the tool
+	 *    that generates input data for this program needs to ensure that
+	 *    ordering.
+	 *
+	 *    Every cell writes its candidate edges into its own range of slots,
+	 *    so candidates can be generated in parallel. Each candidate is keyed
+	 *    by its packed vertex pair (edge::key), and the keys are radix sorted.
+	 *    The sort is stable, so for duplicate keys the candidate from the
+	 *    lowest cell is kept, and edges are numbered in key order. This makes
+	 *    the edge numbering deterministic.
+	 *
+	 *    The unique edges are then processed to create each individual edge
+	 *    and ensure ordering is properly right handed.
+	 *
+	 */
+	const uint64_t NO_EDGE = UINT64_MAX;
+	vector<edge> candidates;
+	vector<uint64_t> keys;
+	vector<int> order;
+	vector<int> firstSlot;
+
+	int iCell, iVertex, iEdge, i, j, k, l;
+	int cell1, cell2;
+	int vertex1, vertex2, swp;
+	int land, slot, nSlots, nEdges, error;
+	edge new_edge;
+	pnt edge_loc, normal;
+	pnt cell_loc1, cell_loc2, vert_loc1, vert_loc2, dist_vec;
+	pnt u_vec, v_vec, cross;
+	double vert1_x_movement, vert1_y_movement;
+	double vert2_x_movement, vert2_y_movement;
+	double temp, dot;
+	bool fixed_edge, add_edge;
+
+#ifdef _DEBUG
+	cout << endl << endl << "Begin function: buildEdges" << endl << endl;
+#endif
+
+	land = 0;
+
+	// Complete cells add at most one edge per vertex pair, and other cells at
+	// most one edge per neighbor. Give each cell that many slots.
+	firstSlot.resize(cells.size() + 1);
+	firstSlot.at(0) = 0;
+	for(iCell = 0; iCell < cells.size(); iCell++){
+		if(completeCellMask.at(iCell) == 1) {
+			firstSlot.at(iCell+1) = firstSlot.at(iCell) + verticesOnCell.size(iCell);
+		} else {
+			firstSlot.at(iCell+1) = firstSlot.at(iCell) + cellsOnCell.size(iCell);
+		}
+	}
+	nSlots = firstSlot.at(cells.size());
+
+	candidates.resize(nSlots);
+	keys.assign(nSlots, NO_EDGE);
+
+	// Build all edges
+	#pragma omp parallel for default(shared) private(slot, l, j, k, vertex1, vertex2, cell1, cell2, add_edge, new_edge)
+	for(iCell = 0; iCell < cells.size(); iCell++){
+		slot = firstSlot.at(iCell);
+		if(completeCellMask.at(iCell) == 1) {
+			// Build edges from every vertex/vertex pair around a cell if the cell is complete
+			for(l = 0; l < verticesOnCell.size(iCell)-1; l++){
+				vertex1 = verticesOnCell.at(iCell, l);	
+				vertex2 = verticesOnCell.at(iCell, l+1);	
+
+				// Find cell shaerd by vertices, that's not iCell
+				cell1 = iCell;
+				cell2 = -1;
+				for(j = 0; j < gridCellsOnVertex.size(vertex1); j++){
+					if(gridCellsOnVertex.at(vertex1, j) != -1 && gridCellsOnVertex.at(vertex1, j) != iCell){
+						for(k = 0; k < gridCellsOnVertex.size(vertex2); k++){
+							if(gridCellsOnVertex.at(vertex1, j) == gridCellsOnVertex.at(vertex2, k)){
+								cell2 = gridCellsOnVertex.at(vertex1, j);
+							}
+						}
+					}
+				}
+
+				add_edge = true;
+
+#ifdef _DEBUG
+				cout << "1 Starting edge: " << endl;
+				cout << "      vertex 1 : " << vertex1 << endl;
+				cout << "      vertex 2 : " << vertex2 << endl;
+				cout << "      cell 1 : " << cell1 << endl;
+				cout << "      cell 2 : " << cell2 << endl;
+#endif
+
+				if(vertex1 != -1 && vertex2 != -1){
+					new_edge.vertex1 = min(vertex1, vertex2);
+					new_edge.vertex2 = max(vertex1, vertex2);
+
+					if(cell2 != -1){
+						new_edge.cell1 = min(cell1, cell2);
+						new_edge.cell2 = max(cell1, cell2);
+					} else {
+						new_edge.cell1 = cell1;
+						new_edge.cell2 = cell2;
+					}
+
+				} else {
+					add_edge = false;
+				}
+
+				if(add_edge){
+#ifdef _DEBUG
+					cout << " Adding edge" << endl;
+#endif
+					candidates.at(slot) = new_edge;
+					keys.at(slot) = new_edge.key();
+					slot++;
+				} else {
+#ifdef _DEBUG
+					cout << " Not adding edge" << endl;
+#endif
+				}
+
+			}
+
+			vertex1 = verticesOnCell.at(iCell, verticesOnCell.size(iCell) - 1);
+			vertex2 = verticesOnCell.at(iCell, 0);
+
+			// Find cell shaerd by vertices, that's not iCell
+			cell1 = iCell;
+			cell2 = -1;
+			for(j = 0; j < gridCellsOnVertex.size(vertex1); j++){
+				if(gridCellsOnVertex.at(vertex1, j) != -1 && gridCellsOnVertex.at(vertex1, j) != iCell){
+					for(k = 0; k < gridCellsOnVertex.size(vertex2); k++){
+						if(gridCellsOnVertex.at(vertex1, j) == gridCellsOnVertex.at(vertex2, k)){
+							cell2 = gridCellsOnVertex.at(vertex1, j);
+						}
+					}
+				}
+			}
+
+			add_edge = true;
+
+#ifdef _DEBUG
+			cout << "  Starting edge: " << endl;
+			cout << "      vertex 1 : " << vertex1 << endl;
+			cout << "      vertex 2 : " << vertex2 << endl;
+			cout << "      cell 1 : " << cell1 << endl;
+			cout << "      cell 2 : " << cell2 << endl;
+#endif
+
+			if(vertex1 != -1 && vertex2 != -1){
+				new_edge.vertex1 = min(vertex1, vertex2);
+				new_edge.vertex2 = max(vertex1, vertex2);
+
+				if(cell2 != -1){
+					new_edge.cell1 = min(cell1, cell2);
+					new_edge.cell2 = max(cell1, cell2);
+				} else {
+					new_edge.cell1 = cell1;
+					new_edge.cell2 = cell2;
+				}
+
+			} else {
+				add_edge = false;
+			}
+
+			if(add_edge){
+#ifdef _DEBUG
+				cout << " Adding edge" << endl;
+#endif
+				candidates.at(slot) = new_edge;
+				keys.at(slot) = new_edge.key();
+				slot++;
+			} else {
+#ifdef _DEBUG
+				cout << " Not adding edge" << endl;
+#endif
+			}
+
+		} else {
+			// Build edges from every cell/cell pair only if cell is not complete
+			for(l = 0; l < cellsOnCell.size(iCell); l++){
+				cell1 = iCell;
+				cell2 = cellsOnCell.at(iCell, l);
+
+				// Find vertex pair for cell pair
+				vertex1 = -1;
+				vertex2 = -1;
+
+				for(j = 0; j < verticesOnCell.size(cell1); j++){
+					if(cell2 != -1){
+						for(k = 0; k < verticesOnCell.size(cell2); k++){
+							if(verticesOnCell.at(cell1, j) == verticesOnCell.at(cell2, k)) {
+								if(vertex1 == -1){
+									vertex1 = verticesOnCell.at(cell1, j);	
+								} else if(vertex2 == -1) {
+									vertex2 = verticesOnCell.at(cell1, j);
+								} else {
+									cout << " Found more than 2 vertices for edge? " << endl;
+								}
+							}
+						}
+					}
+				}
+
+				if(vertex2 == -1) {
+					new_edge.vertex1 = vertex1;
+					new_edge.vertex2 = vertex2;
+				} else {
+					new_edge.vertex1 = min(vertex1, vertex2);
+					new_edge.vertex2 = max(vertex1, vertex2);
+				}
+
+#ifdef _DEBUG
+				cout << "  Starting edge: " << endl;
+				cout << "      vertex 1 : " << vertex1 << endl;
+				cout << "      vertex 2 : " << vertex2 << endl;
+				cout << "      cell 1 : " << cell1 << endl;
+				cout << "      cell 2 : " << cell2 << endl;
+
+				if(new_edge.vertex1 == -1){
+					cout << "  Edge is missing vertex 1" << endl;
+				} else if(new_edge.vertex2 == -1){
+					cout << "  Edge is missing vertex 2" << endl;
+				}
+#endif
+
+				if(cell2 == -1){
+					new_edge.cell1 = cell1;
+					new_edge.cell2 = -1;
+				} else {
+					new_edge.cell1 = min(cell1, cell2);
+					new_edge.cell2 = max(cell1, cell2);
+				}
+				add_edge = true;
+
+				if(new_edge.vertex1 == -1 || new_edge.vertex2 == -1){
+					if(new_edge.cell1 == -1 || new_edge.cell2 == -1){
+						add_edge = false;
+					}
+
+#ifdef _DEBUG
+					cout << "   Cell 1 complete: " << completeCellMask.at(new_edge.cell1) << endl;
+					if(new_edge.cell2 != -1) {
+						cout << "   Cell 2 complete: " << completeCellMask.at(new_edge.cell2) << endl;
+					}
+#endif
+
+					if(completeCellMask.at(new_edge.cell1) != 0 || (new_edge.cell2 != -1 && completeCellMask.at(new_edge.cell2) != 0) ){
+						add_edge = false;
+					}
+				}
+
+
+				if(add_edge){
+#ifdef _DEBUG
+					cout << " Adding edge" << endl;
+#endif
+					candidates.at(slot) = new_edge;
+					keys.at(slot) = new_edge.key();
+					slot++;
+				} else {
+#ifdef _DEBUG
+					cout << " Not adding edge" << endl;
+#endif
+				}
+			}
+		}
+	}
+
+	// Sort candidate slots by key, then keep the first candidate of each
+	// distinct key. Unused slots hold NO_EDGE, and sort to the end.
+	order.resize(nSlots);
+	for(slot = 0; slot < nSlots; slot++){
+		order.at(slot) = slot;
+	}
+	radixSortKeys(keys, order);
+
+	nEdges = 0;
+	for(i = 0; i < nSlots && keys.at(i) != NO_EDGE; i++){
+		if(i == 0 || keys.at(i) != keys.at(i-1)){
+			order.at(nEdges) = order.at(i);
+			nEdges++;
+		}
+	}
+	keys.clear();
+	firstSlot.clear();
+
+	cout << "Built " << nEdges << " edge indices..." << endl;
+
+	edges.clear();
+	cellsOnEdge.clear();
+	verticesOnEdge.clear();
+	dvEdge.clear();
+	dcEdge.clear();
+	edges.resize(nEdges);
+	cellsOnEdge.resize(nEdges, 2, -1);
+	verticesOnEdge.resize(nEdges, 2, -1);
+	dvEdge.resize(nEdges);
+	dcEdge.resize(nEdges);
+
+	error = 0;
+	#pragma omp parallel for default(shared) private(normal, fixed_edge, cell1, cell2, vertex1, vertex2, cell_loc1, cell_loc2, vert_loc1, vert_loc2, edge_loc, u_vec, v_vec, cross, dot, swp) reduction(+:error)
+	for(iEdge = 0; iEdge < nEdges; iEdge++){
+#ifdef _DEBUG
+		cout << "new edge: " << endl;
+#endif
+		fixed_edge = false;
+		cell1 = candidates.at(order.at(iEdge)).cell1;
+		cell2 = candidates.at(order.at(iEdge)).cell2;
+		vertex1 = candidates.at(order.at(iEdge)).vertex1;
+		vertex2 = candidates.at(order.at(iEdge)).vertex2;
+
+		cell_loc1 = cells.at(cell1);
+		vert_loc1 = vertices.at(vertex1);
+		if(vertex2 != -1) {
+			vert_loc2 = vertices.at(vertex2);
+		} else {
+			vert_loc2 = vert_loc1;
+		}
+
+		normal = geometry.normal(cell_loc1);
+
+		// Clean up periodic edges. See mesh specification document for how periodicity is defined.
+		// These edges are special in the sense that they must be across a "uniform" edge.
+		// So, they are exactly the mid point between vertices.
+		// Since the edge will be "owned" by whatever processor owns cell1, make sure edge is close to cell1.
+		// So, fix periodicity relative to cell1.
+		geometry.fixPeriodicity(vert_loc1, cell_loc1);
+
+		if(cell2 != -1){
+			cell_loc2 = cells.at(cell2);
+			if(vertex2 != -1){
+				vert_loc2 = vertices.at(vertex2);
+
+				geometry.fixPeriodicity(cell_loc2, cell_loc1);
+				geometry.fixPeriodicity(vert_loc2, cell_loc1);
+				edge_loc = geometry.intersect(cell_loc1, cell_loc2, vert_loc1, vert_loc2);
+				dvEdge.at(iEdge) = geometry.distance(vert_loc2, vert_loc1);
+				dcEdge.at(iEdge) = geometry.distance(cell_loc2, cell_loc1);
+			} else {
+				edge_loc = (cell_loc1 + cell_loc2) * 0.5;
+				vert_loc2 = edge_loc;
+				dcEdge.at(iEdge) = geometry.distance(cell_loc2, cell_loc1);
+				dvEdge.at(iEdge) = dcEdge.at(iEdge) / sqrt(3.0);
+			}
+		} else {
+			if(vertex2 != -1){
+				vert_loc2 = vertices.at(vertex2);
+				geometry.fixPeriodicity(vert_loc2, cell_loc1);
+				edge_loc = (vert_loc1 + vert_loc2) * 0.5;
+				geometry.project(edge_loc);
+				dvEdge.at(iEdge) = geometry.distance(vert_loc2, vert_loc1);
+				dcEdge.at(iEdge) = sqrt(3.0) * dvEdge.at(iEdge);
+				cell_loc2 = edge_loc;
+			} else {
+				cout << " ERROR: Edge found with only 1 cell and 1 vertex...." << endl;
+				error++;
+				continue;
+			}
+		}
+
+		geometry.project(edge_loc);
+
+		edge_loc.idx = iEdge;
+
+#ifdef _DEBUG
+		cout << "New Edge At: " << edge_loc << endl;
+		cout << "         c1: " << cells.at(cell1) << endl;
+		if(cell2 > -1) { 
+			cout << "         c2: " << cells.at(cell2) << endl;
+			cout << "    mod? c2: " << cell_loc2 << endl;
+		} else {
+			cout << "         c2: land" << endl;
+			cout << "    mod? c2: " << cell_loc2 << endl;
+		}
+		cout << "         v1: " << vertices.at(vertex1) << endl;
+		cout << "    mod? v1: " << vert_loc1 << endl;
+		if(vertex2 != -1) {
+			cout << "         v2: " << vertices.at(vertex2) << endl;
+			cout << "    mod? v2: " << vert_loc2 << endl;
+		} else {
+			cout << "         v2: land" << endl;
+			cout << "    mod? v2: " << vert_loc2 << endl;
+		}
+#endif
+
+		u_vec = cell_loc2 - cell_loc1;
+		v_vec = vert_loc2 - vert_loc1;
+
+		cross = u_vec.cross(v_vec);
+		dot = cross.dot(normal);
+
+		if(dot < 0){
+			if(vertex2 != -1){
+#ifdef _DEBUG
+				cout << "   swapping vertex " << vertex1 << " and " << vertex2 << endl;
+#endif
+				swp = vertex2;
+				vertex2 = vertex1;
+				vertex1 = swp;
+			} else {
+#ifdef _DEBUG
+				cout << "   swapping cell " << cell1 << " and " << cell2 << endl;
+#endif
+				swp = cell2;
+				cell2 = cell1;
+				cell1 = swp;
+			}
+		}
+
+		edges.at(iEdge) = edge_loc;
+		cellsOnEdge.push_back(iEdge, cell1);
+		cellsOnEdge.push_back(iEdge, cell2);
+		verticesOnEdge.push_back(iEdge, vertex1);
+		verticesOnEdge.push_back(iEdge, vertex2);
+	}
+
+	candidates.clear();
+	order.clear();
+
+	if(error){
+		return 1;
+	}
+
+	return 0;
+}/*}}}*/
+template <class Geometry>
+int orderVertexArrays(const Geometry &geometry){/*{{{*/
+	/*
+	 * orderVertexArrays builds and orders the connectivity arrays for vertices.
+	 *		This includes edgesOnVertex and cellsOnvertex.
+	 *      First, edgeSOnVertex is built and ordered correctly, then using
+	 *      that ordering cellsOnVertex is built and ordered correctly as well.
+	 */
+	ccw_order<Geometry> ccw(geometry);
+	int iEdge, iVertex, vertex1, vertex2, edge1;
+	int j;
+
+#ifdef _DEBUG
+	cout << endl << endl << "Begin function: orderVertexArrays" << endl << endl;
+#endif
+
+	// The input cellsOnVertex is not read from here on.
+	gridCellsOnVertex.clear();
+	freeVector(gridCellsOnVertexCopy);
+
+	edgesOnVertex.clear();
+	edgesOnVertex.resize(vertices.size(), vertex_degree, -1);
+	cellsOnVertex.clear();
+	cellsOnVertex.resize(vertices.size(), vertex_degree, -1);
+
+	// Get lists of edges for each vertex
+	for(iEdge = 0; iEdge < edges.size(); iEdge++){/*{{{*/
+		vertex1 = verticesOnEdge.at(iEdge, 0);
+		vertex2 = verticesOnEdge.at(iEdge, 1);
+
+		if(vertex1 != -1) {
+			if(edgesOnVertex.size(vertex1) == vertex_degree){
+				cout << " ERROR: Vertex " << vertex1 << " has more than vertexDegree edges." << endl;
+				return 1;
+			}
+			edgesOnVertex.push_back(vertex1, iEdge);
+		} 
+
+		if(vertex2 != -1){
+			if(edgesOnVertex.size(vertex2) == vertex_degree){
+				cout << " ERROR: Vertex " << vertex2 << " has more than vertexDegree edges." << endl;
+				return 1;
+			}
+			edgesOnVertex.push_back(vertex2, iEdge);
+		}
+	}/*}}}*/
+
+	// Order edges counter-clockwise. Each vertex only touches its own rows
+	// of edgesOnVertex and cellsOnVertex.
+	#pragma omp parallel for default(shared) private(j, edge1)
+	for(iVertex = 0; iVertex < vertices.size(); iVertex++){/*{{{*/
+		ccw.sort(vertices.at(iVertex), edges, edgesOnVertex.row(iVertex), edgesOnVertex.size(iVertex));
+
+#ifdef _DEBUG
+		cout << "edgesOnVertex("<< iVertex <<"): ";
+		for(j = 0; j < edgesOnVertex.size(iVertex); j++){
+			cout << edgesOnVertex.at(iVertex, j) << " ";
+		}
+		cout << endl;
+#endif
+
+#ifdef _DEBUG
+		cout << "CellsOnVertex("<< iVertex << "): ";
+#endif
+
+		// Using the ordered edges. Buld cellsOnVertex in the correct order.
+		for(j = 0; j < edgesOnVertex.size(iVertex); j++){
+			edge1 = edgesOnVertex.at(iVertex, j);
+
+			// Get cell id and add it to list of cells
+			if(iVertex == verticesOnEdge.at(edge1, 0)){
+				cellsOnVertex.push_back(iVertex, cellsOnEdge.at(edge1, 0));
+#ifdef _DEBUG
+				cout << cellsOnEdge.at(edge1, 0) << " ";
+#endif
+			} else {
+				cellsOnVertex.push_back(iVertex, cellsOnEdge.at(edge1, 1));
+#ifdef _DEBUG
+				cout << cellsOnEdge.at(edge1, 1) << " ";
+#endif
+			}
+		}
+#ifdef _DEBUG
+		cout << endl << endl;
+#endif
+	}/*}}}*/
+
+	return 0;
+}/*}}}*/
+template <class Geometry>
+int orderCellArrays(const Geometry &geometry){/*{{{*/
+	/*
+	 * orderCellArrays assumes verticesOnCell are ordered CCW already.
+	 *
+	 */
+	ccw_order<Geometry> ccw(geometry);
+	int iCell, iEdge, iEdge2;
+	int cell1, cell2, vertex1, vertex2;
+	int edge_idx, loc_edge_idx;
+	int i, j, k;
+	pnt normal, cross;
+	pnt vec1, vec2;
+	pnt edge_loc1, edge_loc2;
+	double dot, mag1, mag2;
+	vector<int> edgeCount;
+
+#ifdef _DEBUG
+	cout << endl << endl << "Begin function: orderCellArrays" << endl << endl;
+#endif
+
+	// Count edges on each cell first. The largest count is maxEdges, which
+	// is the stride of all *OnCell arrays.
+	edgeCount.resize(cells.size(), 0);
+	for(iEdge = 0; iEdge < edges.size(); iEdge++){
+		edgeCount.at(cellsOnEdge.at(iEdge, 0))++;
+		if(cellsOnEdge.at(iEdge, 1) != -1){
+			edgeCount.at(cellsOnEdge.at(iEdge, 1))++;
+		}
+	}
+
+	maxEdges = 0;
+	for(iCell = 0; iCell < cells.size(); iCell++){
+		maxEdges = max(maxEdges, edgeCount.at(iCell));
+	}
+	edgeCount.clear();
+
+	verticesOnCell.clear();
+	edgesOnCell.clear();
+	cellsOnCell.clear();
+
+	verticesOnCell.resize(cells.size(), maxEdges, -1);
+	edgesOnCell.resize(cells.size(), maxEdges, -1);
+	cellsOnCell.resize(cells.size(), maxEdges, -1);
+
+	// First, build full list of edges on cell.
+	for(iEdge = 0; iEdge < edges.size(); iEdge++){
+		cell1 = cellsOnEdge.at(iEdge, 0);	
+		cell2 = cellsOnEdge.at(iEdge, 1);	
+
+		edgesOnCell.push_back(cell1, iEdge);
+		if(cell2 != -1){
+			edgesOnCell.push_back(cell2, iEdge);
+		}
+	}
+
+	// Loop over all cells. Each cell only touches its own rows of the *OnCell arrays.
+	#pragma omp parallel for default(shared) private(normal, iEdge, iEdge2, vertex1, vertex2, edge_idx, loc_edge_idx, i, j, k, vec1, vec2, edge_loc1, edge_loc2, cross, dot, mag1, mag2)
+	for(iCell = 0; iCell < cells.size(); iCell++){
+#ifdef _DEBUG
+		cout << "New Cell " << cells.at(iCell) << endl;
+#endif
+		normal = geometry.normal(cells.at(iCell));
+
+		edge_idx = -1;
+		loc_edge_idx = 0;
+
+		if ( edgesOnCell.size(iCell) != 0 ) {
+#ifdef _DEBUG
+		cout << endl;
+			cout << "   Starting edgesOnCell on cell: " << iCell << endl;
+			cout << "   Starting edgesOnCell size: " << edgesOnCell.size(iCell) << endl;
+			cout << "   Starting edgesOnCell: ";
+			for(i = 0; i < edgesOnCell.size(iCell); ++i){
+				cout << edgesOnCell.at(iCell, i) << " ";
+			}
+			cout << endl;
+#endif
+
+			// /*
+			// Determine starting edge. It should either be the first edge in the set, 
+			// or the only edge such that all other edges are CCW from it.
+			edge_idx = edgesOnCell.at(iCell, 0);
+			loc_edge_idx = 0;
+	#ifdef _DEBUG
+					cout << "Finding starting edge for cell " << iCell << endl;
+	#endif
+			for(j = 0; j < edgesOnCell.size(iCell); j++){
+				iEdge = edgesOnCell.at(iCell, j);
+				vertex1 = verticesOnEdge.at(iEdge, 0);
+				vertex2 = verticesOnEdge.at(iEdge, 1);
+
+				if(vertex2 == -1){
+	#ifdef _DEBUG
+					cout << "   Start edge: " << iEdge << endl;
+					cout << "               " << edges.at(iEdge) << endl;
+					cout << "           v1: " << vertex1 << endl;
+					cout << "           v2: " << vertex2 << endl;
+	#endif
+					edge_loc1 = edges.at(iEdge);
+					edge_loc1 = vertices.at(vertex1);
+					geometry.fixPeriodicity(edge_loc1, cells.at(iCell));
+
+					vec1 = edge_loc1 - cells.at(iCell);
+					mag1 = vec1.magnitude();
+
+					// If edge only has one vertex. Need to find edge that shares the vertex.
+					// This edge is kept if the neighboring edge is CCW from it.
+					for(k = 0; k < edgesOnCell.size(iCell); k++){
+						if(j != k){
+							iEdge2 = edgesOnCell.at(iCell, k);
+	#ifdef _DEBUG
+							cout << "    Test edge: " << iEdge2 << endl;
+							cout << "               " << edges.at(iEdge2) << endl;
+							cout << "           v1: " << verticesOnEdge.at(iEdge2, 0) << endl;
+							cout << "           v2: " << verticesOnEdge.at(iEdge2, 1) << endl;
+	#endif
+
+							if(vertex1 == verticesOnEdge.at(iEdge2, 0) || vertex1 == verticesOnEdge.at(iEdge2, 1)){
+								// This edge is a neighboring edge. Check for CCW ordering.
+								if(vertex1 == verticesOnEdge.at(iEdge2, 0)) {
+									vertex2 = verticesOnEdge.at(iEdge2, 1);
+								} else {
+									vertex2 = verticesOnEdge.at(iEdge2, 0);
+								}
+								edge_loc2 = edges.at(iEdge2);
+								edge_loc2 = vertices.at(vertex2);
+
+								geometry.fixPeriodicity(edge_loc2, cells.at(iCell));
+
+								vec2 = edge_loc2 - cells.at(iCell);
+								mag2 = vec2.magnitude();
+
+								cross = vec1.cross(vec2);
+								dot = cross.dot(normal) / (cross.magnitude() * normal.magnitude());
+
+	#ifdef _DEBUG
+								cout << "     Vec1: " << vec1 << endl;
+								cout << "     Vec2: " << vec2 << endl;
+								cout << "    Cross: " << cross << endl;
+								cout << "      dot: " << dot << endl;
+	#endif
+								if(dot > 0){
+	#ifdef _DEBUG
+									cout << "       Found edge: " << iEdge << endl;
+	#endif
+									edge_idx = iEdge;
+									loc_edge_idx = j;
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+
+		// Swap edge_idx with first edge.
+		if(loc_edge_idx != 0){
+#ifdef _DEBUG
+			cout << "     Swapping edges: " << edgesOnCell.at(iCell, loc_edge_idx) << " and " << edgesOnCell.at(iCell, 0) << endl;
+#endif
+			edgesOnCell.at(iCell, loc_edge_idx) = edgesOnCell.at(iCell, 0);
+			edgesOnCell.at(iCell, 0) = edge_idx;
+		}
+		// */
+
+		// Order all edges in CCW relative to the first edge.
+		ccw.sort(cells.at(iCell), edges, edgesOnCell.row(iCell), edgesOnCell.size(iCell));
+
+		for(j = 0; j < edgesOnCell.size(iCell); j++){
+			iEdge = edgesOnCell.at(iCell, j);
+
+			// Add cell across edge to cellsOnCell
+			// Also, add vertex that is CCW relative to current edge location.
+			if(cellsOnEdge.at(iEdge, 0) == iCell){
+				cellsOnCell.push_back(iCell, cellsOnEdge.at(iEdge, 1));
+
+				if(verticesOnEdge.at(iEdge, 1) != -1){
+					verticesOnCell.push_back(iCell, verticesOnEdge.at(iEdge, 1));
+				}
+			} else {
+				cellsOnCell.push_back(iCell, cellsOnEdge.at(iEdge, 0));
+				verticesOnCell.push_back(iCell, verticesOnEdge.at(iEdge, 0));
+			}
+		}
+
+#ifdef _DEBUG
+		cout << "   cellsOnCell: ";
+		for(i = 0; i < cellsOnCell.size(iCell); i++){
+			cout << cellsOnCell.at(iCell, i) << " ";
+		}
+		cout << endl;
+		cout << "   verticesOnCell: ";
+		for(i = 0; i < verticesOnCell.size(iCell); i++){
+			cout << verticesOnCell.at(iCell, i) << " ";
+		}
+		cout << endl;
+		cout << "   edgesOnCell: ";
+		for(i = 0; i < edgesOnCell.size(iCell); i++){
+			cout << edgesOnCell.at(iCell, i) << " ";
+		}
+		cout << endl;
+#endif
+	}
+
+	return 0;
+}/*}}}*/
+template <class Geometry>
+int buildAreas(const Geometry &geometry){/*{{{*/
+	/*
+	 * buildAreas constructs the area arrays.
+	 *    This includes areaCell, areaTriangle, and kiteAreasOnVertex
+	 *
+	 * Before constructing areaCell, the cell is checked for completeness.
+	 *    This is accomplished by looping over each edge. For each edge,
+	 *    the angle between it's vertices is computed and added to a running total.
+	 *    If the total is significantly less than 2*Pi, the cell is not complete.
+	 *
+	 * Non-complete cells are given a negative area, to ease removal at a later stage.
+	 *
+	 * The triangles making up each cell and kite are listed first, and their
+	 * areas are then computed in one batch (see coord_array.h) and summed.
+	 */
+	int iVertex, iCell, iEdge, i, j;
+	int vertex1, vertex2;
+	int incomplete_cells;
+	int nTriangles, nKites;
+	vector<int> firstTriangle, triCell, triVertex1, triVertex2;
+	vector<int> firstKite, kiteVertex, kiteCell, kiteEdge1, kiteEdge2;
+	vector<double> triAreas, kiteAreas1, kiteAreas2;
+	coord_array cellCopy, vertexCopy, edgeCoords(edges);
+
+	// Coordinates borrowed by set_grid are read in place.
+	const bool borrowedCells = (gridCellCoords.size() > 0 && gridCellCoords.size() == (int)cells.size());
+	const bool borrowedVertices = (gridVertexCoords.size() > 0 && gridVertexCoords.size() == (int)vertices.size());
+	if(!borrowedCells) cellCopy.assign(cells);
+	if(!borrowedVertices) vertexCopy.assign(vertices);
+	const coord_array &cellCoords = borrowedCells ? gridCellCoords : cellCopy;
+	const coord_array &vertexCoords = borrowedVertices ? gridVertexCoords : vertexCopy;
+
+#ifdef _DEBUG
+	cout << endl << endl << "Begin function: buildAreas" << endl << endl;
+#endif
+
+	areaCell.clear();
+	areaTriangle.clear();
+	kiteAreasOnVertex.clear();
+
+	areaCell.resize(cells.size());
+	areaTriangle.resize(vertices.size());
+	kiteAreasOnVertex.resize(vertices.size(), cellsOnVertex.stride(), 0.0);
+
+	// Each complete cell is split into triangles between the cell center and
+	// the two vertices of each of its edges.
+	firstTriangle.resize(cells.size() + 1);
+	nTriangles = 0;
+	for(iCell = 0; iCell < cells.size(); iCell++){
+		firstTriangle.at(iCell) = nTriangles;
+		if(completeCellMask.at(iCell) == 1){
+			for(j = 0; j < edgesOnCell.size(iCell); j++){
+				iEdge = edgesOnCell.at(iCell, j);
+				if(verticesOnEdge.at(iEdge, 0) != -1 && verticesOnEdge.at(iEdge, 1) != -1){
+					nTriangles++;
+				}
+			}
+		}
+	}
+	firstTriangle.at(cells.size()) = nTriangles;
+
+	triCell.resize(nTriangles);
+	triVertex1.resize(nTriangles);
+	triVertex2.resize(nTriangles);
+	triAreas.resize(nTriangles);
+
+	#pragma omp parallel for default(shared) private(i, j, iEdge, vertex1, vertex2)
+	for(iCell = 0; iCell < cells.size(); iCell++){
+		i = firstTriangle.at(iCell);
+		for(j = 0; i < firstTriangle.at(iCell+1); j++){
+			iEdge = edgesOnCell.at(iCell, j);
+
+			if(cellsOnEdge.at(iEdge, 0) == iCell){
+				vertex1 = verticesOnEdge.at(iEdge, 0);
+				vertex2 = verticesOnEdge.at(iEdge, 1);
+			} else {
+				vertex1 = verticesOnEdge.at(iEdge, 1);
+				vertex2 = verticesOnEdge.at(iEdge, 0);
+			}
+
+			if(vertex1 != -1 && vertex2 != -1){
+				triCell.at(i) = iCell;
+				triVertex1.at(i) = vertex1;
+				triVertex2.at(i) = vertex2;
+				i++;
+			}
+		}
+	}
+
+	// Each kite is split into two triangles, between the vertex, the cell
+	// center and the two edges of the vertex on either side of the cell.
+	firstKite.resize(vertices.size() + 1);
+	nKites = 0;
+	for(iVertex = 0; iVertex < vertices.size(); iVertex++){
+		firstKite.at(iVertex) = nKites;
+		for(j = 0; j < cellsOnVertex.size(iVertex); j++){
+			if(cellsOnVertex.at(iVertex, j) != -1){
+				nKites++;
+			}
+		}
+	}
+	firstKite.at(vertices.size()) = nKites;
+
+	kiteVertex.resize(nKites);
+	kiteCell.resize(nKites);
+	kiteEdge1.resize(nKites);
+	kiteEdge2.resize(nKites);
+	kiteAreas1.resize(nKites);
+	kiteAreas2.resize(nKites);
+
+	#pragma omp parallel for default(shared) private(i, j, iCell)
+	for(iVertex = 0; iVertex < vertices.size(); iVertex++){
+		i = firstKite.at(iVertex);
+		for(j = 0; j < cellsOnVertex.size(iVertex); j++){
+			iCell = cellsOnVertex.at(iVertex, j);
+
+			if(iCell != -1){
+				kiteVertex.at(i) = iVertex;
+				kiteCell.at(i) = iCell;
+				kiteEdge1.at(i) = edgesOnVertex.at(iVertex, j);
+				if(j == cellsOnVertex.size(iVertex)-1){
+					kiteEdge2.at(i) = edgesOnVertex.at(iVertex, 0);
+				} else {
+					kiteEdge2.at(i) = edgesOnVertex.at(iVertex, j+1);
+				}
+				i++;
+			}
+		}
+	}
+
+	if(nTriangles > 0){
+		geometry.triangleAreas(cellCoords, &triCell[0], vertexCoords, &triVertex1[0], vertexCoords, &triVertex2[0], nTriangles, &triAreas[0]);
+	}
+	if(nKites > 0){
+		geometry.triangleAreas(vertexCoords, &kiteVertex[0], edgeCoords, &kiteEdge1[0], cellCoords, &kiteCell[0], nKites, &kiteAreas1[0]);
+		geometry.triangleAreas(vertexCoords, &kiteVertex[0], cellCoords, &kiteCell[0], edgeCoords, &kiteEdge2[0], nKites, &kiteAreas2[0]);
+	}
+
+	incomplete_cells = 0;
+
+	#pragma omp parallel for default(shared) private(i) reduction(+:incomplete_cells)
+	for(iCell = 0; iCell < cells.size(); iCell++){
+		areaCell.at(iCell) = 0.0;
+
+		if(completeCellMask.at(iCell) == 1){
+			for(i = firstTriangle.at(iCell); i < firstTriangle.at(iCell+1); i++){
+				areaCell.at(iCell) += triAreas.at(i);
+			}
+		} else {
+			incomplete_cells++;
+#ifdef _DEBUG
+			cout << "   Non complete cell found at " << iCell << endl;
+#endif
+			areaCell.at(iCell) = -1;
+		}
+	}
+
+	#pragma omp parallel for default(shared) private(i, j)
+	for(iVertex = 0; iVertex < vertices.size(); iVertex++){
+		areaTriangle.at(iVertex) = 0.0;
+		kiteAreasOnVertex.set_size(iVertex, cellsOnVertex.size(iVertex));
+		i = firstKite.at(iVertex);
+		for(j = 0; j < cellsOnVertex.size(iVertex); j++){
+			kiteAreasOnVertex.at(iVertex, j) = 0.0;
+
+			if(cellsOnVertex.at(iVertex, j) != -1){
+				kiteAreasOnVertex.at(iVertex, j) += kiteAreas1.at(i);
+				kiteAreasOnVertex.at(iVertex, j) += kiteAreas2.at(i);
+				areaTriangle.at(iVertex) += kiteAreasOnVertex.at(iVertex, j);
+				i++;
+			}
+		}
+	}
+
+	cout << "     Found " << incomplete_cells << " incomplete cells. Each is marked with an area of -1." << endl;
+
+	return 0;
+}/*}}}*/
+int buildEdgesOnEdgeArrays(){/*{{{*/
+	/*
+	 * buildEdgesOnEdgeArrays builds both edgesOnEdge and weightsOnEdge
+	 *
+	 * The weights correspond to edgesOnEdge and allow MPAS to reconstruct the
+	 * edge perpendicular (previously defined as v) velocity using the edge
+	 * neighbors
+	 *
+	 * Weight formulation is defined in J. Thurburn, et al. JCP 2009
+	 * Numerical representation of geostrophic modes on arbitrarily
+	 * structured C-grids
+	 *
+	 * Before using this function, dcEdge, dvEdge, areaCell, and kiteAreasOnVertex
+	 * all need to be computed correctly.
+	 */
+	int iEdge, iCell, cell1, cell2;
+	int i, j, k;
+	int shared_vertex;
+	int last_edge, cur_edge;
+	double area_sum;
+	bool found;
+
+#ifdef _DEBUG
+	cout << endl << endl << "Begin function: buildEdgesOnEdgeArrays" << endl << endl;
+#endif
+
+	edgesOnEdge.clear();
+	edgesOnEdge.resize(edges.size(), maxEdges * 2, -1);
+
+	weightsOnEdge.clear();
+	weightsOnEdge.resize(edges.size(), maxEdges * 2, 0.0);
+
+	for(iEdge = 0; iEdge < edges.size(); iEdge++){
+#ifdef _DEBUG
+		cout << "New edge: " << edges.at(iEdge) << endl;
+#endif
+		cell1 = cellsOnEdge.at(iEdge, 0);
+		cell2 = cellsOnEdge.at(iEdge, 1);
+		found = false;
+
+		// Loop over cell 1. Starting from the edge after the current edge, add
+		// all edges counter clockwise around the cell.  Don't add the current
+		// edge to the list.
+#ifdef _DEBUG
+		cout << "   On cell1: " << cell1 << endl;
+#endif
+		last_edge = iEdge;
+		area_sum = 0;
+		for(i = 0; i < edgesOnCell.size(cell1); i++){
+#ifdef _DEBUG
+			cout << "      checking edge: " << edgesOnCell.at(cell1, i) << endl;
+#endif
+			if(edgesOnCell.at(cell1, i) == iEdge){
+				found = true;
+#ifdef _DEBUG
+				cout << "        -- found -- " << endl;
+#endif
+			}
+
+			if(found && edgesOnCell.at(cell1, i) != iEdge){
+				cur_edge = edgesOnCell.at(cell1, i);
+				edgesOnEdge.push_back(iEdge, cur_edge);
+
+				// Find shared vertex between newly added edge
+				// and last_edge
+				if(verticesOnEdge.at(last_edge, 0) == verticesOnEdge.at(cur_edge, 0) ||
+						verticesOnEdge.at(last_edge, 0) == verticesOnEdge.at(cur_edge, 1)){
+
+					shared_vertex = verticesOnEdge.at(last_edge, 0);
+
+				} else if(verticesOnEdge.at(last_edge, 1) == verticesOnEdge.at(cur_edge, 0) ||
+						verticesOnEdge.at(last_edge, 1) == verticesOnEdge.at(cur_edge, 1)){
+
+					shared_vertex = verticesOnEdge.at(last_edge, 1);
+				}
+
+				if(shared_vertex != -1) {
+					// Find cell 1 on shared vertex (to get kite area)
+					for(j = 0; j < cellsOnVertex.size(shared_vertex); j++){
+						iCell = cellsOnVertex.at(shared_vertex, j);
+
+						if(iCell == cell1){
+							area_sum += kiteAreasOnVertex.at(shared_vertex, j) / areaCell.at(cell1);
+						}
+					}
+				}
+
+				if(cell1 == cellsOnEdge.at(cur_edge, 0)){
+					weightsOnEdge.push_back(iEdge, 1.0 * (0.5 - area_sum) * dvEdge.at(cur_edge) / dcEdge.at(iEdge));
+				} else {
+					weightsOnEdge.push_back(iEdge, -1.0 * (0.5 - area_sum) * dvEdge.at(cur_edge) / dcEdge.at(iEdge));
+				}
+
+				last_edge = edgesOnCell.at(cell1, i);
+#ifdef _DEBUG
+				cout << "        added " << edgesOnCell.at(cell1, i) << endl;
+#endif
+			}
+		}
+		if(!found) {
+			cout << "Error finding edge " << iEdge << " on cell " << cell1 << " 1" << endl;
+			return 1;
+		}
+
+		for(i = 0; i < edgesOnCell.size(cell1) && found; i++){
+#ifdef _DEBUG
+			cout << "      checking edge: " << edgesOnCell.at(cell1, i) << endl;
+#endif
+			if(edgesOnCell.at(cell1, i) == iEdge){
+#ifdef _DEBUG
+				cout << "        -- found -- " << endl;
+#endif
+				found = false;
+			}
+
+			if(found && edgesOnCell.at(cell1, i) != iEdge){
+				cur_edge = edgesOnCell.at(cell1, i);
+				edgesOnEdge.push_back(iEdge, cur_edge);
+
+				// Find shared vertex between newly added edge
+				// and last_edge
+				if(verticesOnEdge.at(last_edge, 0) == verticesOnEdge.at(cur_edge, 0) ||
+						verticesOnEdge.at(last_edge, 0) == verticesOnEdge.at(cur_edge, 1)){
+
+					shared_vertex = verticesOnEdge.at(last_edge, 0);
+
+				} else if(verticesOnEdge.at(last_edge, 1) == verticesOnEdge.at(cur_edge, 0) ||
+						verticesOnEdge.at(last_edge, 1) == verticesOnEdge.at(cur_edge, 1)){
+
+					shared_vertex = verticesOnEdge.at(last_edge, 1);
+				}
+
+				// Find cell 1 on shared vertex (to get kite area)
+				if(shared_vertex != -1){
+					for(j = 0; j < cellsOnVertex.size(shared_vertex); j++){
+						iCell = cellsOnVertex.at(shared_vertex, j);
+
+						if(iCell == cell1){
+							area_sum += kiteAreasOnVertex.at(shared_vertex, j) / areaCell.at(cell1);
+						}
+					}
+				}
+
+				if(cell1 == cellsOnEdge.at(cur_edge, 0)){
+					weightsOnEdge.push_back(iEdge, 1.0 * (0.5 - area_sum) * dvEdge.at(cur_edge) / dcEdge.at(iEdge));
+				} else {
+					weightsOnEdge.push_back(iEdge, -1.0 * (0.5 - area_sum) * dvEdge.at(cur_edge) / dcEdge.at(iEdge));
+				}
+
+				last_edge = edgesOnCell.at(cell1, i);
+#ifdef _DEBUG
+				cout << "        added " << edgesOnCell.at(cell1, i) << endl;
+#endif
+			}
+		}
+		if(found) {
+			cout << "Error finding edge " << iEdge << " on cell " << cell1 << " 1" << endl;
+			return 1;
+		}
+
+		// Check if cell1 is a real cell or not.
+		if(cell2 > -1){
+			last_edge = iEdge;
+			area_sum = 0.0;
+#ifdef _DEBUG
+			cout << "   On cell2: " << cell2 << endl;
+#endif
+			found = false;
+			// Loop over cell 2. Starting from the edge after the current edge,
+			// add all edges counter clockwise around the cell.  Don't add the
+			// current edge to the list.
+			for(i = 0; i < edgesOnCell.size(cell2); i++){
+#ifdef _DEBUG
+				cout << "      checking edge: " << edgesOnCell.at(cell2, i) << endl;
+#endif
+				if(edgesOnCell.at(cell2, i) == iEdge){
+					found = true;
+#ifdef _DEBUG
+					cout << "        -- found -- " << endl;
+#endif
+				}
+
+				if(found && edgesOnCell.at(cell2, i) != iEdge){
+					cur_edge = edgesOnCell.at(cell2, i);
+					edgesOnEdge.push_back(iEdge, cur_edge);
+
+					// Find shared vertex between newly added edge
+					// and last_edge
+					if(verticesOnEdge.at(last_edge, 0) == verticesOnEdge.at(cur_edge, 0) ||
+							verticesOnEdge.at(last_edge, 0) == verticesOnEdge.at(cur_edge, 1)){
+
+						shared_vertex = verticesOnEdge.at(last_edge, 0);
+
+					} else if(verticesOnEdge.at(last_edge, 1) == verticesOnEdge.at(cur_edge, 0) ||
+							verticesOnEdge.at(last_edge, 1) == verticesOnEdge.at(cur_edge, 1)){
+
+						shared_vertex = verticesOnEdge.at(last_edge, 1);
+					}
+
+					// Find cell 1 on shared vertex (to get kite area)
+					if(shared_vertex != -1){
+						for(j = 0; j < cellsOnVertex.size(shared_vertex); j++){
+							iCell = cellsOnVertex.at(shared_vertex, j);
+
+							if(iCell == cell2){
+								area_sum += kiteAreasOnVertex.at(shared_vertex, j) / areaCell.at(cell2);
+							}
+						}
+					}
+
+					if(cell2 == cellsOnEdge.at(cur_edge, 0)){
+						weightsOnEdge.push_back(iEdge, -1.0 * (0.5 - area_sum) * dvEdge.at(cur_edge) / dcEdge.at(iEdge));
+					} else {
+						weightsOnEdge.push_back(iEdge, 1.0 * (0.5 - area_sum) * dvEdge.at(cur_edge) / dcEdge.at(iEdge));
+					}
+
+					last_edge = edgesOnCell.at(cell2, i);
+#ifdef _DEBUG
+					cout << "        added " << edgesOnCell.at(cell2, i) << endl;
+#endif
+				}
+			}
+			if(!found) {
+				cout << "Error finding edge " << iEdge << " on cell " << cell2 << " 2" << endl;
+				return 1;
+			}
+
+			for(i = 0; i < edgesOnCell.size(cell2); i++){
+#ifdef _DEBUG
+				cout << "      checking edge: " << edgesOnCell.at(cell2, i) << endl;
+#endif
+				if(edgesOnCell.at(cell2, i) == iEdge){
+					found = false;
+#ifdef _DEBUG
+					cout << "        -- found -- " << endl;
+#endif
+				}
+
+				if(found && edgesOnCell.at(cell2, i) != iEdge){
+					cur_edge = edgesOnCell.at(cell2, i);
+					edgesOnEdge.push_back(iEdge, cur_edge);
+
+					// Find shared vertex between newly added edge
+					// and last_edge
+					if(verticesOnEdge.at(last_edge, 0) == verticesOnEdge.at(cur_edge, 0) ||
+							verticesOnEdge.at(last_edge, 0) == verticesOnEdge.at(cur_edge, 1)){
+
+						shared_vertex = verticesOnEdge.at(last_edge, 0);
+
+					} else if(verticesOnEdge.at(last_edge, 1) == verticesOnEdge.at(cur_edge, 0) ||
+							verticesOnEdge.at(last_edge, 1) == verticesOnEdge.at(cur_edge, 1)){
+
+						shared_vertex = verticesOnEdge.at(last_edge, 1);
+					}
+
+					// Find cell 1 on shared vertex (to get kite area)
+					if(shared_vertex != -1){
+						for(j = 0; j < cellsOnVertex.size(shared_vertex); j++){
+							iCell = cellsOnVertex.at(shared_vertex, j);
+
+							if(iCell == cell2){
+								area_sum += kiteAreasOnVertex.at(shared_vertex, j) / areaCell.at(cell2);
+							}
+						}
+					}
+
+					if(cell2 == cellsOnEdge.at(cur_edge, 0)){
+						weightsOnEdge.push_back(iEdge, -1.0 * (0.5 - area_sum) * dvEdge.at(cur_edge) / dcEdge.at(iEdge));
+					} else {
+						weightsOnEdge.push_back(iEdge, 1.0 * (0.5 - area_sum) * dvEdge.at(cur_edge) / dcEdge.at(iEdge));
+					}
+
+					last_edge = edgesOnCell.at(cell2, i);
+#ifdef _DEBUG
+					cout << "        added " << edgesOnCell.at(cell2, i) << endl;
+#endif
+				}
+			}
+			if(found) {
+				cout << "Error finding edge " << iEdge << " on cell " << cell2 << " 2" << endl;
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}/*}}}*/
+template <class Geometry>
+int buildAngleEdge(const Geometry &geometry){/*{{{*/
+	/*
+	 * buildAngleEdge constructs angle edge for each edge.
+	 *
+	 * angleEdge is either:
+	 * 1. The angle the positive tangential direction (v)
+	 *    makes with the local northward direction.
+	 *    or
+	 * 2. The angles the positive normal direction (u)
+	 * 	  makes with the local eastward direction.
+	 * 	  
+	 * 	  In a plane, local eastward is defined as the x axis, and
+	 * 	  nortward is defined as the y axis.
+	 */
+	int iEdge;
+	int cell1, cell2;
+	int vertex1, vertex2;
+	pnt np, x_axis, normal;
+	pnt cell_loc1, cell_loc2;
+	pnt vertex_loc1, vertex_loc2;
+	double angle, sign;
+
+#ifdef _DEBUG
+	cout << endl << endl << "Begin function: buildAngleEdge" << endl << endl;
+#endif
+
+	angleEdge.clear();
+	angleEdge.resize(edges.size());
+
+	x_axis = pnt(1.0, 0.0, 0.0);
+
+	#pragma omp parallel for default(shared) private(cell1, cell2, vertex1, vertex2, np, normal, cell_loc1, cell_loc2, vertex_loc1, vertex_loc2, angle, sign)
+	for(iEdge = 0; iEdge < edges.size(); iEdge++){
+
+#ifdef _DEBUG
+		cout << "New edge: " << edges.at(iEdge) << endl;
+#endif
+		cell1 = cellsOnEdge.at(iEdge, 0);
+		cell2 = cellsOnEdge.at(iEdge, 1);
+
+		vertex1 = verticesOnEdge.at(iEdge, 0);
+		vertex2 = verticesOnEdge.at(iEdge, 1);
+
+		cell_loc1 = cells.at(cell1);
+		if(cell2 != -1){
+			cell_loc2 = cells.at(cell2);
+		} else {
+			cell_loc2 = edges.at(iEdge);
+		}
+
+		vertex_loc1 = vertices.at(vertex1);
+		if(vertex2 != -1){
+			vertex_loc2 = vertices.at(vertex2);
+		} else {
+			vertex_loc2 = edges.at(iEdge);
+		}
+
+		if(!Geometry::isSpherical){
+			geometry.fixPeriodicity(cell_loc2, cell_loc1);
+
+			normal = cell_loc2 - cell_loc1;
+			angleEdge.at(iEdge) = acos( x_axis.dot(normal) / (x_axis.magnitude() * normal.magnitude()));
+		} else {
+
+			np = pntFromLatLon(edges.at(iEdge).getLat()+0.05, edges.at(iEdge).getLon());
+			np.normalize();
+
+#ifdef _DEBUG
+			cout << "     NP: " << np << endl;
+#endif
+
+			angle = (vertex_loc2.getLat() - vertex_loc1.getLat()) / dvEdge.at(iEdge);
+			angle = max( min(angle, 1.0), -1.0);
+			angle = acos(angle);
+
+#ifdef _DEBUG
+			cout << "  angle: " << angle << endl;
+#endif
+
+			sign = planeAngle(edges.at(iEdge), np, vertex_loc2, edges.at(iEdge));
+			if(sign != 0.0){
+				sign = sign / fabs(sign);
+			} else {
+				sign = 1.0;
+			}
+
+
+#ifdef _DEBUG
+			cout << "  sign : " << sign << endl;
+			cout << "  a*s  : " << angle * sign << endl;
+#endif
+
+			angle = angle * sign;
+			if(angle > M_PI) angle = angle - 2.0 * M_PI;
+			if(angle < -M_PI) angle = angle + 2.0 * M_PI;
+
+#ifdef _DEBUG
+			cout << " fangle: " << angle << endl;
+#endif
+
+			angleEdge.at(iEdge) = angle;
+		}
+	}
+
+	return 0;
+}/*}}}*/
+int buildMeshQualities(){/*{{{*/
+	/*
+	 * buildMeshQualities constructs fields describing the quality of the mesh, including:
+	 *		- cellQuality: a double between 0 and 1 describing how uniform the cell is
+	 *		- gridSpacing: an estimate of the grid spacing of each cell
+	 *		- triangleQuality: a double between 0 and 1 describing how uniform the cell is based on edge lenghts
+	 *		- triangleAngleQuality: a double between 0 and 1 describing how uniform the cell is based on the angles of the triangle
+	 *		- obtuseTriangle: an integer either 0 or 1 that flags triangles with an obtuse angle (set to 1)
+	 */
+
+	int iCell, iVertex, iEdge;
+	int i, j;
+	double maxEdge, minEdge, spacing;
+	double angle, maxAngle, minAngle;
+	int obtuse;
+
+	cellQuality.clear();
+	gridSpacing.clear();
+	triangleQuality.clear();
+	triangleAngleQuality.clear();
+	obtuseTriangle.clear();
+
+	cellQuality.resize(cells.size());
+	gridSpacing.resize(cells.size());
+
+	triangleQuality.resize(vertices.size());
+	triangleAngleQuality.resize(vertices.size());
+	obtuseTriangle.resize(vertices.size());
+
+#ifdef _DEBUG
+	cout << "Starting mesh quality calcs." <<endl;
+#endif
+
+	#pragma omp parallel for default(shared) private(j, iEdge, maxEdge, minEdge, spacing)
+	for ( iCell = 0; iCell < cells.size(); iCell++ ) {
+		maxEdge = 0.0;
+		minEdge = DBL_MAX;
+		spacing = 0.0;
+
+		for ( j = 0; j < edgesOnCell.size(iCell); j++ ) {
+			iEdge = edgesOnCell.at(iCell, j);
+
+			maxEdge = max(maxEdge, dvEdge.at(iEdge));
+			minEdge = min(minEdge, dvEdge.at(iEdge));
+
+			spacing += dcEdge.at(iEdge);
+		}
+		if (maxEdge > 0.0) {
+			cellQuality.at(iCell) = minEdge / maxEdge;
+		} else {
+			cellQuality.at(iCell) = 0.0;
+		}
+		gridSpacing.at(iCell) = spacing / edgesOnCell.size(iCell); 
+	}
+
+#ifdef _DEBUG
+	cout << "Starting loop over vertices." <<endl;
+#endif
+
+	#pragma omp parallel for default(shared) private(j, iEdge, maxEdge, minEdge, maxAngle, minAngle, obtuse) reduction(+:obtuseTriangles)
+	for ( iVertex = 0; iVertex < vertices.size(); iVertex++ ) {
+		maxEdge = 0.0;
+		minEdge = DBL_MAX;
+		maxAngle = 0.0;
+		minAngle = DBL_MAX;
+		obtuse = 0;
+
+#ifdef _DEBUG
+	cout << "vertex:" << iVertex <<endl;
+#endif
+
+		for ( j = 0; j < edgesOnVertex.size(iVertex); j++ ) {
+#ifdef _DEBUG
+			cout << "  edge:" << j <<endl;
+#endif
+			iEdge = edgesOnVertex.at(iVertex, j);
+
+			maxEdge = max(maxEdge, dcEdge.at(iEdge));
+			minEdge = min(minEdge, dcEdge.at(iEdge));
+			triangleQuality.at(iVertex) = minEdge / maxEdge;
+
+#ifdef _DEBUG
+			cout << "  triangleQuality:" << minEdge / maxEdge <<endl;
+#endif
+
+			if ( vertex_degree == 3 ) {
+				double a_len, b_len, c_len;
+				double angle1, angle2, angle3;
+
+				if (edgesOnVertex.size(iVertex) == 3) {
+					a_len = dcEdge.at(edgesOnVertex.at(iVertex, 0));
+#ifdef _DEBUG
+					cout << "  length 1:" << a_len <<endl;
+#endif
+
+					b_len = dcEdge.at(edgesOnVertex.at(iVertex, 1));
+#ifdef _DEBUG
+					cout << "  length 2:" << b_len<< endl;
+#endif
+
+					c_len = dcEdge.at(edgesOnVertex.at(iVertex, 2));
+#ifdef _DEBUG
+					cout << "  length 3:" << c_len <<endl;
+#endif
+
+					angle1 = acos( max(-1.0, min(1.0, (b_len * b_len + c_len * c_len - a_len * a_len) / (2 * b_len * c_len))));
+					angle2 = acos( max(-1.0, min(1.0, (a_len * a_len + c_len * c_len - b_len * b_len) / (2 * a_len * c_len))));
+					angle3 = acos( max(-1.0, min(1.0, (a_len * a_len + b_len * b_len - c_len * c_len) / (2 * a_len * b_len))));
+
+					minAngle = min(angle1, min(angle2, angle3));
+					maxAngle = max(angle1, max(angle2, angle3));
+
+					if ( maxAngle > M_PI_2 ) {
+						obtuse = 1;
+						obtuseTriangles++;
+					}
+
+					triangleAngleQuality.at(iVertex) = minAngle / maxAngle;
+					obtuseTriangle.at(iVertex) = obtuse;
+				} else {
+					triangleAngleQuality.at(iVertex) = 1.0;
+					obtuseTriangle.at(iVertex) = 0;
+				}
+			}
+		}
+	}
+
+	cout << "\tMesh contains: " << obtuseTriangles << " obtuse triangles." << endl;
+
+	return 0;
+}/*}}}*/
+int buildBoundaryVertices(){/*{{{*/
+	/*
+	 * buildBoundaryVertices flags the vertices that have fewer than
+	 * vertexDegree cells with 1.
+	 */
+	boundaryVertex.resize(vertices.size());
+
+	#pragma omp parallel for default(shared)
+	for(int iVertex = 0; iVertex < (int)vertices.size(); iVertex++){
+		boundaryVertex[iVertex] = (cellsOnVertex.size(iVertex) == vertex_degree) ? 0 : 1;
+	}
+
+	return 0;
+}/*}}}*/
+int reorderMesh(const string method){/*{{{*/
+	/*
+	 * reorderMesh renumbers cells, edges, and vertices so that elements which
+	 * are close in the mesh are also close in memory, and rewrites every
+	 * connectivity array and per element field to match.
+	 *
+	 * Cells are ordered by one of:
+	 *		- hilbert: position of the cell center along a Hilbert curve
+	 *		- morton: position of the cell center along a Morton (Z order) curve
+	 *		- rcm: reverse Cuthill-McKee ordering of the cellsOnCell graph
+	 *
+	 * Edges and vertices are then ordered by the first cell (in the new order)
+	 * that lists them in edgesOnCell and verticesOnCell.
+	 *
+	 * The idx of every pnt keeps its original value, so indexToCellID,
+	 * indexToEdgeID, and indexToVertexID hold the original (1-based) index of
+	 * each element, i.e. the permutation that was applied.
+	 */
+
+	vector<int> cellOrder, edgeOrder, vertexOrder;
+	vector<int> cellMap, edgeMap, vertexMap;
+
+	if(method == "hilbert" || method == "morton"){
+		curveOrder(cells, spherical, method == "hilbert", cellOrder);
+	} else if(method == "rcm"){
+		rcmOrder(cellsOnCell, cellOrder);
+	} else {
+		cout << "   ERROR: Unknown reordering " << method << "." << endl;
+		return 1;
+	}
+
+	firstTouchOrder(edgesOnCell, cellOrder, edges.size(), edgeOrder);
+	firstTouchOrder(verticesOnCell, cellOrder, vertices.size(), vertexOrder);
+
+	invertOrder(cellOrder, cellMap);
+	invertOrder(edgeOrder, edgeMap);
+	invertOrder(vertexOrder, vertexMap);
+
+	// Cell arrays
+	permuteVector(cells, cellOrder);
+	permuteVector(completeCellMask, cellOrder);
+	permuteVector(nEdgesOnCell, cellOrder);
+	permuteVector(areaCell, cellOrder);
+	permuteVector(meshDensity, cellOrder);
+	permuteVector(cellQuality, cellOrder);
+	permuteVector(gridSpacing, cellOrder);
+
+	cellsOnCell.permute_rows(cellOrder);
+	cellsOnCell.renumber(cellMap);
+	edgesOnCell.permute_rows(cellOrder);
+	edgesOnCell.renumber(edgeMap);
+	verticesOnCell.permute_rows(cellOrder);
+	verticesOnCell.renumber(vertexMap);
+
+	// Edge arrays
+	permuteVector(edges, edgeOrder);
+	permuteVector(dvEdge, edgeOrder);
+	permuteVector(dcEdge, edgeOrder);
+	permuteVector(angleEdge, edgeOrder);
+
+	cellsOnEdge.permute_rows(edgeOrder);
+	cellsOnEdge.renumber(cellMap);
+	verticesOnEdge.permute_rows(edgeOrder);
+	verticesOnEdge.renumber(vertexMap);
+	edgesOnEdge.permute_rows(edgeOrder);
+	edgesOnEdge.renumber(edgeMap);
+	weightsOnEdge.permute_rows(edgeOrder);
+
+	// Vertex arrays
+	permuteVector(vertices, vertexOrder);
+	permuteVector(areaTriangle, vertexOrder);
+	permuteVector(triangleQuality, vertexOrder);
+	permuteVector(triangleAngleQuality, vertexOrder);
+	permuteVector(obtuseTriangle, vertexOrder);
+	permuteVector(boundaryVertex, vertexOrder);
+
+	edgesOnVertex.permute_rows(vertexOrder);
+	edgesOnVertex.renumber(edgeMap);
+	cellsOnVertex.permute_rows(vertexOrder);
+	cellsOnVertex.renumber(cellMap);
+	kiteAreasOnVertex.permute_rows(vertexOrder);
+
+	return 0;
+}/*}}}*/
+int cullMesh(const int *cullCell){/*{{{*/
+	/*
+	 * cullMesh removes the cells where cullCell is 1 (none if cullCell is
+	 * NULL) and the incomplete cells (areaCell < 0), along with the vertices
+	 * left without cells and the edges left without two vertices or a cell.
+	 * The rules and the mapped fields are those of MpasCellCuller.x:
+	 *		- Kept elements keep their order, and are numbered from 0 again
+	 *		  (indexToCellID etc. become 1..n).
+	 *		- Entries referring to removed elements become -1.
+	 *		- cellsOnEdge lists the kept cell first, and verticesOnEdge is
+	 *		  swapped to match.
+	 *		- edgesOnEdge and weightsOnEdge are emptied on edges that were on
+	 *		  the boundary before culling.
+	 *		- kiteAreasOnVertex is 0 for removed cells, and areaTriangle is
+	 *		  the sum of the remaining kite areas.
+	 * maxEdges shrinks to the largest cell left.
+	 */
+	const int nCellsOld = cells.size();
+	const int nEdgesOld = edges.size();
+	const int nVerticesOld = vertices.size();
+	vector<int> cellOrder, edgeOrder, vertexOrder;
+	vector<int> cellMap(nCellsOld), edgeMap(nEdgesOld), vertexMap(nVerticesOld);
+	vector<int> lostCell(nVerticesOld, 0);
+	vector<int> wasBoundaryEdge(nEdgesOld);
+
+	// Flag the kept elements, then number them with a prefix sum.
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iCell = 0; iCell < nCellsOld; iCell++){
+		cellMap[iCell] = !(areaCell[iCell] < 0 || (cullCell != NULL && cullCell[iCell] == 1));
+	}
+	compactMap(cellMap, cellOrder);
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iVertex = 0; iVertex < nVerticesOld; iVertex++){
+		bool keep_vertex = false;
+
+		for(int j = 0; j < cellsOnVertex.size(iVertex); j++){
+			int iCell = cellsOnVertex.at(iVertex, j);
+			if(iCell >= 0){
+				keep_vertex = keep_vertex || (cellMap[iCell] != -1);
+				lostCell[iVertex] = lostCell[iVertex] || (cellMap[iCell] == -1);
+			}
+		}
+
+		vertexMap[iVertex] = keep_vertex;
+	}
+	compactMap(vertexMap, vertexOrder);
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iEdge = 0; iEdge < nEdgesOld; iEdge++){
+		int vertex1 = verticesOnEdge.at(iEdge, 0);
+		int vertex2 = verticesOnEdge.at(iEdge, 1);
+		int cell1 = cellsOnEdge.at(iEdge, 0);
+		int cell2 = cellsOnEdge.at(iEdge, 1);
+		bool keep_edge;
+
+		keep_edge = (vertex1 >= 0 && vertex2 >= 0 && vertexMap[vertex1] != -1 && vertexMap[vertex2] != -1);
+		keep_edge = keep_edge && ((cell1 >= 0 && cellMap[cell1] != -1) || (cell2 >= 0 && cellMap[cell2] != -1));
+		wasBoundaryEdge[iEdge] = (cell1 < 0 || cell2 < 0);
+
+		edgeMap[iEdge] = keep_edge;
+	}
+	compactMap(edgeMap, edgeOrder);
+
+	cout << "Removing " << nCellsOld - cellOrder.size() << " cells, "
+		<< nVerticesOld - vertexOrder.size() << " vertices, and "
+		<< nEdgesOld - edgeOrder.size() << " edges." << endl;
+
+	// Edges whose first cell is removed list the kept cell first.
+	#pragma omp parallel for default(shared)
+	for(int iEdge = 0; iEdge < nEdgesOld; iEdge++){
+		int cell1 = cellsOnEdge.at(iEdge, 0);
+
+		if(edgeMap[iEdge] != -1 && cell1 >= 0 && cellMap[cell1] == -1){
+			swap(cellsOnEdge.at(iEdge, 0), cellsOnEdge.at(iEdge, 1));
+			swap(verticesOnEdge.at(iEdge, 0), verticesOnEdge.at(iEdge, 1));
+		}
+	}
+
+	#pragma omp parallel for default(shared)
+	for(int iEdge = 0; iEdge < nEdgesOld; iEdge++){
+		if(wasBoundaryEdge[iEdge]){
+			edgesOnEdge.clear_row(iEdge);
+			weightsOnEdge.clear_row(iEdge);
+		}
+	}
+
+	#pragma omp parallel for default(shared)
+	for(int iVertex = 0; iVertex < nVerticesOld; iVertex++){
+		double area = 0.0;
+
+		for(int j = 0; j < kiteAreasOnVertex.size(iVertex); j++){
+			int iCell = (j < cellsOnVertex.size(iVertex)) ? cellsOnVertex.at(iVertex, j) : -1;
+
+			if(iCell < 0 || cellMap[iCell] == -1){
+				kiteAreasOnVertex.at(iVertex, j) = 0.0;
+			}
+			area += kiteAreasOnVertex.at(iVertex, j);
+		}
+		areaTriangle[iVertex] = area;
+
+		if(lostCell[iVertex]){
+			boundaryVertex[iVertex] = 1;
+		}
+	}
+
+	// Cell arrays
+	selectVector(cells, cellOrder, nCellsOld);
+	selectVector(completeCellMask, cellOrder, nCellsOld);
+	selectVector(nEdgesOnCell, cellOrder, nCellsOld);
+	selectVector(areaCell, cellOrder, nCellsOld);
+	selectVector(meshDensity, cellOrder, nCellsOld);
+	selectVector(cellQuality, cellOrder, nCellsOld);
+	selectVector(gridSpacing, cellOrder, nCellsOld);
+
+	cellsOnCell.select_rows(cellOrder);
+	cellsOnCell.renumber(cellMap);
+	edgesOnCell.select_rows(cellOrder);
+	edgesOnCell.renumber(edgeMap);
+	verticesOnCell.select_rows(cellOrder);
+	verticesOnCell.renumber(vertexMap);
+
+	// Edge arrays
+	selectVector(edges, edgeOrder, nEdgesOld);
+	selectVector(dvEdge, edgeOrder, nEdgesOld);
+	selectVector(dcEdge, edgeOrder, nEdgesOld);
+	selectVector(angleEdge, edgeOrder, nEdgesOld);
+
+	cellsOnEdge.select_rows(edgeOrder);
+	cellsOnEdge.renumber(cellMap);
+	verticesOnEdge.select_rows(edgeOrder);
+	verticesOnEdge.renumber(vertexMap);
+	edgesOnEdge.select_rows(edgeOrder);
+	edgesOnEdge.renumber(edgeMap);
+	weightsOnEdge.select_rows(edgeOrder);
+
+	// Vertex arrays
+	selectVector(vertices, vertexOrder, nVerticesOld);
+	selectVector(areaTriangle, vertexOrder, nVerticesOld);
+	selectVector(triangleQuality, vertexOrder, nVerticesOld);
+	selectVector(triangleAngleQuality, vertexOrder, nVerticesOld);
+	selectVector(obtuseTriangle, vertexOrder, nVerticesOld);
+	selectVector(boundaryVertex, vertexOrder, nVerticesOld);
+
+	edgesOnVertex.select_rows(vertexOrder);
+	edgesOnVertex.renumber(edgeMap);
+	cellsOnVertex.select_rows(vertexOrder);
+	cellsOnVertex.renumber(cellMap);
+	kiteAreasOnVertex.select_rows(vertexOrder);
+
+	for(int i = 0; i < (int)cells.size(); i++) cells[i].idx = i;
+	for(int i = 0; i < (int)edges.size(); i++) edges[i].idx = i;
+	for(int i = 0; i < (int)vertices.size(); i++) vertices[i].idx = i;
+
+	nCells = cells.size();
+	nVertices = vertices.size();
+
+	maxEdges = 0;
+	for(int iCell = 0; iCell < nCells; iCell++){
+		maxEdges = max(maxEdges, edgesOnCell.size(iCell));
+	}
+	cellsOnCell.restride(maxEdges);
+	edgesOnCell.restride(maxEdges);
+	verticesOnCell.restride(maxEdges);
+	edgesOnEdge.restride(maxEdges * 2);
+	weightsOnEdge.restride(maxEdges * 2);
+
+	obtuseTriangles = 0;
+	for(int iVertex = 0; iVertex < nVertices; iVertex++){
+		obtuseTriangles += obtuseTriangle[iVertex];
+	}
+
+	return 0;
+}/*}}}*/
+/*}}}*/
+
+/* Checkpoint functions {{{ */
+template <class T>
+bool transferCheckpoint(checkpoint_file &file, const bool reading, T &values){/*{{{*/
+	return reading ? file.read(values) : file.write(values);
+}/*}}}*/
+bool transferCheckpoint(checkpoint_file &file, const bool reading, int &value){/*{{{*/
+	return reading ? file.read_value(value) : file.write_value(value);
+}/*}}}*/
+bool transferMesh(checkpoint_file &file, const bool reading){/*{{{*/
+	/*
+	 * Reads or writes everything the build stages produce, in a fixed order.
+	 * Arrays that have not been built yet are empty and take no space.
+	 */
+	transferCheckpoint(file, reading, maxEdges);
+	transferCheckpoint(file, reading, obtuseTriangles);
+	transferCheckpoint(file, reading, cells);
+	transferCheckpoint(file, reading, edges);
+	transferCheckpoint(file, reading, vertices);
+	transferCheckpoint(file, reading, completeCellMask);
+	transferCheckpoint(file, reading, nEdgesOnCell);
+	transferCheckpoint(file, reading, cellsOnEdge);
+	transferCheckpoint(file, reading, verticesOnEdge);
+	transferCheckpoint(file, reading, edgesOnVertex);
+	transferCheckpoint(file, reading, cellsOnVertex);
+	transferCheckpoint(file, reading, cellsOnCell);
+	transferCheckpoint(file, reading, edgesOnCell);
+	transferCheckpoint(file, reading, verticesOnCell);
+	transferCheckpoint(file, reading, edgesOnEdge);
+	transferCheckpoint(file, reading, weightsOnEdge);
+	transferCheckpoint(file, reading, kiteAreasOnVertex);
+	transferCheckpoint(file, reading, dvEdge);
+	transferCheckpoint(file, reading, dcEdge);
+	transferCheckpoint(file, reading, areaCell);
+	transferCheckpoint(file, reading, areaTriangle);
+	transferCheckpoint(file, reading, angleEdge);
+	transferCheckpoint(file, reading, meshDensity);
+	transferCheckpoint(file, reading, cellQuality);
+	transferCheckpoint(file, reading, gridSpacing);
+	transferCheckpoint(file, reading, triangleQuality);
+	transferCheckpoint(file, reading, triangleAngleQuality);
+	return transferCheckpoint(file, reading, obtuseTriangle);
+}/*}}}*/
+string checkpointFilename(){/*{{{*/
+	// One checkpoint per input grid, so several grids can share a directory.
+	char name[64];
+
+	snprintf(name, sizeof(name), "/mesh_%016" PRIx64 ".ckpt", inputChecksum);
+	return checkpointDirectory + name;
+}/*}}}*/
+int writeCheckpoint(const int stage){/*{{{*/
+	/*
+	 * writeCheckpoint saves the mesh after the given stage. The checkpoint is
+	 * written to a temporary file first, so an interrupted write leaves the
+	 * previous checkpoint in place. A failed write is only a warning, as the
+	 * mesh itself is still fine.
+	 */
+	const string filename = checkpointFilename();
+	const string tmpFilename = filename + ".tmp";
+	checkpoint_file file;
+	bool ok;
+
+	if(checkpointDirectory == ""){
+		return 0;
+	}
+
+	cout << "Writing checkpoint after " << checkpointStageNames[stage] << "." << endl;
+	profiler.start("writeCheckpoint");
+	ok = file.open_write(tmpFilename);
+	ok = ok && file.write_header(inputChecksum, stage, sizeof(pnt));
+	ok = ok && transferMesh(file, false);
+	ok = ok && file.write_end();
+	ok = file.close() && ok;
+	ok = ok && rename(tmpFilename.c_str(), filename.c_str()) == 0;
+	profiler.stop(cells.size(), "cells");
+
+	if(!ok){
+		cout << "WARNING: Could not write checkpoint " << filename << "." << endl;
+		remove(tmpFilename.c_str());
+		return 1;
+	}
+
+	return 0;
+}/*}}}*/
+int readCheckpoint(){/*{{{*/
+	/*
+	 * readCheckpoint loads the checkpoint of the current input, if there is
+	 * one, and returns the stage it was written after (CHECKPOINT_NONE if
+	 * there is none, or it was written by another version). Returns -1 if the
+	 * checkpoint is damaged, since the mesh arrays have then been partly
+	 * overwritten.
+	 */
+	const string filename = checkpointFilename();
+	checkpoint_file file;
+	int stage = CHECKPOINT_NONE;
+	bool ok;
+
+	if(checkpointDirectory == "" || !file.open_read(filename)){
+		return CHECKPOINT_NONE;
+	}
+
+	if(!file.read_header(inputChecksum, stage, sizeof(pnt)) || stage <= CHECKPOINT_NONE || stage > CHECKPOINT_MESH){
+		cout << "WARNING: Ignoring incompatible checkpoint " << filename << "." << endl;
+		return CHECKPOINT_NONE;
+	}
+
+	profiler.start("readCheckpoint");
+	ok = transferMesh(file, true);
+	ok = ok && file.read_end();
+	profiler.stop(cells.size(), "cells");
+
+	if(!ok){
+		cout << "ERROR: Could not read checkpoint " << filename << "." << endl;
+		cout << "  Remove it to rebuild the mesh from the input grid." << endl;
+		return -1;
+	}
+
+	cout << "Resuming from checkpoint after " << checkpointStageNames[stage] << "." << endl;
+	return stage;
+}/*}}}*/
+/*}}}*/
+
+/* C interface helpers {{{ */
+void setView(mpas_mesh_builder_view *view, const int type, const void *data, const int nRows, const int nColumns, const int rowStride, const int *counts){/*{{{*/
+	view->type = type;
+	view->data = data;
+	view->nRows = nRows;
+	view->nColumns = nColumns;
+	view->rowStride = rowStride;
+	view->counts = counts;
+}/*}}}*/
+void setView(mpas_mesh_builder_view *view, stride_array<int> &values){/*{{{*/
+	setView(view, MPAS_MESH_BUILDER_INT, values.data(), values.size(), values.stride(), values.stride(), values.sizes());
+}/*}}}*/
+void setView(mpas_mesh_builder_view *view, stride_array<double> &values){/*{{{*/
+	setView(view, MPAS_MESH_BUILDER_DOUBLE, values.data(), values.size(), values.stride(), values.stride(), values.sizes());
+}/*}}}*/
+void setView(mpas_mesh_builder_view *view, vector<int> &values){/*{{{*/
+	setView(view, MPAS_MESH_BUILDER_INT, values.empty() ? NULL : &values[0], values.size(), 1, 1, NULL);
+}/*}}}*/
+void setView(mpas_mesh_builder_view *view, vector<double> &values){/*{{{*/
+	setView(view, MPAS_MESH_BUILDER_DOUBLE, values.empty() ? NULL : &values[0], values.size(), 1, 1, NULL);
+}/*}}}*/
+void setView(mpas_mesh_builder_view *view, vector<pnt> &points, const int component){/*{{{*/
+	// Points are stored as pnt structures, so one coordinate is every
+	// sizeof(pnt) / sizeof(double)-th value.
+	static_assert(sizeof(pnt) % sizeof(double) == 0, "pnt has to be a whole number of doubles");
+	const double *first = points.empty() ? NULL : &points[0].x + component;
+	setView(view, MPAS_MESH_BUILDER_DOUBLE, first, points.size(), 1, sizeof(pnt) / sizeof(double), NULL);
+}/*}}}*/
+bool sameCoordinates(const pnt &p, const double x, const double y, const double z){/*{{{*/
+	// Bitwise, so borrowed coordinates give exactly the same results.
+	const double xyz[3] = {x, y, z};
+	const double pxyz[3] = {p.x, p.y, p.z};
+
+	return memcmp(xyz, pxyz, sizeof(xyz)) == 0;
+}/*}}}*/
+void releaseGrid(){/*{{{*/
+	// Drops the input buffers of set_grid, whether borrowed or copied.
+	gridCellsOnVertex.clear();
+	freeVector(gridCellsOnVertexCopy);
+	gridCellCoords.clear();
+	gridVertexCoords.clear();
+}/*}}}*/
+template <class T>
+void freeVector(vector<T> &values){/*{{{*/
+	vector<T>().swap(values);
+}/*}}}*/
+/*}}}*/
+
+} // namespace
+
+} // namespace mpas_mesh_builder
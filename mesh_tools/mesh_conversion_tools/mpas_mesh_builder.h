@@ -0,0 +1,125 @@
+#ifndef MPAS_MESH_BUILDER_H
+#define MPAS_MESH_BUILDER_H
+
+/*
+ * C interface to MpasMeshBuilder, the library that builds an MPAS mesh from
+ * cell centers, vertices and cellsOnVertex. These are the stages of
+ * MpasMeshConverter.x between reading grid.nc and writing mesh.nc, so a mesh
+ * generator can build a mesh in memory without writing and re-reading a grid
+ * file.
+ *
+ * The library holds one mesh at a time, and calls must not be made from
+ * several threads at once (the stages themselves use OpenMP). A typical use
+ * is:
+ *
+ *     mpas_mesh_builder_set_grid(...);
+ *     mpas_mesh_builder_build();
+ *     mpas_mesh_builder_get_view("cellsOnEdge", &view);
+ *     ...
+ *     mpas_mesh_builder_clear();
+ *
+ * Functions returning int return 0 on success, except
+ * mpas_mesh_builder_get_dimension.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MPAS_MESH_BUILDER_INT 0
+#define MPAS_MESH_BUILDER_DOUBLE 1
+
+/*
+ * A read-only view of an array held by the library. Entry j of row i is at
+ * data[i * rowStride + j], for j < counts[i] (or j < nColumns if counts is
+ * NULL). Connectivity arrays are nRows x maxEdges (etc.) blocks laid out as
+ * in mesh.nc, but with 0-based indices and -1 for missing entries.
+ * Coordinates, lengths and areas of spherical meshes are on the unit sphere.
+ * mesh.nc holds them scaled by sphere_radius.
+ *
+ * Views stay valid until the next call to mpas_mesh_builder_set_grid,
+ * mpas_mesh_builder_reorder, mpas_mesh_builder_cull or
+ * mpas_mesh_builder_clear.
+ */
+typedef struct mpas_mesh_builder_view {
+	int type;
+	const void *data;
+	int nRows;
+	int nColumns;
+	int rowStride;
+	const int *counts;
+} mpas_mesh_builder_view;
+
+/*
+ * Sets the input grid, as read from grid.nc by MpasMeshConverter.x.
+ * cellsOnVertex is nVertices x vertexDegree with 1-based cell indices (0 for
+ * none), as in grid.nc. meshDensity may be NULL, in which case it is 1
+ * everywhere. By default set_grid copies cellsOnVertex, so the buffers can be
+ * freed or reused as soon as it returns. With mpas_mesh_builder_set_borrowing,
+ * it borrows them instead (see there). Returns non-zero if the mesh would have
+ * more than INT_MAX edges (about nCells + nVertices).
+ */
+int mpas_mesh_builder_set_grid(int nCells, int nVertices, int vertexDegree,
+		const double *xCell, const double *yCell, const double *zCell,
+		const double *xVertex, const double *yVertex, const double *zVertex,
+		const int *cellsOnVertex, const double *meshDensity,
+		int onSphere, double sphereRadius,
+		int isPeriodic, double xPeriod, double yPeriod);
+
+/*
+ * Saves the mesh to a file in directory after each major build stage, and
+ * lets mpas_mesh_builder_build resume from the last stage saved for the same
+ * input grid (compared by a checksum of the set_grid arguments). Has to be
+ * called before mpas_mesh_builder_set_grid. NULL or "" turns checkpoints off.
+ * The directory has to exist.
+ */
+int mpas_mesh_builder_set_checkpoint(const char *directory);
+
+/*
+ * With borrow non-zero, later calls to mpas_mesh_builder_set_grid keep
+ * pointers to the caller's cellsOnVertex and coordinate buffers instead of
+ * copying them. The stages up to building the edges read cellsOnVertex in
+ * place, and the area stage reads the coordinates in place if normalizing
+ * them (on the sphere) leaves them unchanged. The buffers then have to stay
+ * valid and unchanged until mpas_mesh_builder_build returns. The library
+ * still keeps its own copy of the points, normalized on the sphere, which
+ * every stage uses and which reorder and cull renumber.
+ */
+int mpas_mesh_builder_set_borrowing(int borrow);
+
+/*
+ * Runs all build stages, from cell connectivity to mesh qualities. The input
+ * grid is only built once: set it again before building it again.
+ */
+int mpas_mesh_builder_build(void);
+
+/* Renumbers the built mesh for locality: "hilbert", "morton" or "rcm". */
+int mpas_mesh_builder_reorder(const char *method);
+
+/*
+ * Removes the built mesh's incomplete cells and the cells where cullCell
+ * (nCells entries, may be NULL) is 1, as MpasCellCuller.x does, together with
+ * the vertices and edges left without cells.
+ */
+int mpas_mesh_builder_cull(const int *cullCell);
+
+/*
+ * Returns nCells, nEdges, nVertices, maxEdges, maxEdges2 or vertexDegree of
+ * the built mesh, or -1 for an unknown name.
+ */
+int mpas_mesh_builder_get_dimension(const char *name);
+
+/*
+ * Fills view with the array called name in mesh.nc (e.g. "cellsOnEdge",
+ * "areaCell", "xVertex"). Returns 1 if the array is unknown or not built.
+ */
+int mpas_mesh_builder_get_view(const char *name, mpas_mesh_builder_view *view);
+
+/* Frees the mesh. */
+void mpas_mesh_builder_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
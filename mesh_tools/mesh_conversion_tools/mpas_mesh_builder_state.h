@@ -0,0 +1,66 @@
+#ifndef MPAS_MESH_BUILDER_STATE_H
+#define MPAS_MESH_BUILDER_STATE_H
+
+#include <vector>
+
+#include "pnt.h"
+#include "stride_array.h"
+#include "stage_profiler.h"
+
+/*
+ * The mesh held by MpasMeshBuilder (mpas_mesh_builder.cpp), for C++ code
+ * that writes it out directly, like MpasMeshConverter.x. Other callers should
+ * use the C interface in mpas_mesh_builder.h.
+ *
+ * Arrays use 0-based indices, -1 for missing entries, and unit sphere lengths
+ * and areas for spherical meshes. Everything is in namespace
+ * mpas_mesh_builder, so it can't clash with the globals of the program the
+ * library is linked into.
+ */
+
+namespace mpas_mesh_builder {
+
+extern int nCells, nVertices, vertex_degree;
+extern int maxEdges;
+extern int obtuseTriangles;
+extern bool spherical, periodic;
+extern double sphereRadius, xPeriod, yPeriod;
+
+// Times the build stages, and is shared with the caller's own stages.
+extern stage_profiler profiler;
+
+// Connectivity and location information {{{
+
+extern std::vector<pnt> cells;
+extern std::vector<pnt> edges;
+extern std::vector<pnt> vertices;
+extern std::vector<int> completeCellMask;
+extern std::vector<int> nEdgesOnCell;
+extern stride_array<int> cellsOnEdge;
+extern stride_array<int> verticesOnEdge;
+extern stride_array<int> edgesOnVertex;
+extern stride_array<int> cellsOnVertex;
+extern stride_array<int> cellsOnCell;
+extern stride_array<int> edgesOnCell;
+extern stride_array<int> verticesOnCell;
+extern stride_array<int> edgesOnEdge;
+extern stride_array<double> weightsOnEdge;
+extern stride_array<double> kiteAreasOnVertex;
+extern std::vector<double> dvEdge;
+extern std::vector<double> dcEdge;
+extern std::vector<double> areaCell;
+extern std::vector<double> areaTriangle;
+extern std::vector<double> angleEdge;
+extern std::vector<double> meshDensity;
+extern std::vector<double> cellQuality;
+extern std::vector<double> gridSpacing;
+extern std::vector<double> triangleQuality;
+extern std::vector<double> triangleAngleQuality;
+extern std::vector<int> obtuseTriangle;
+extern std::vector<int> boundaryVertex;
+
+// }}}
+
+} // namespace mpas_mesh_builder
+
+#endif
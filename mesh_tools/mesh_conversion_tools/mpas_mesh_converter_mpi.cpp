@@ -0,0 +1,1737 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <utility>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <netcdf.h>
+#ifdef HAVE_NETCDF_PAR
+#include <netcdf_par.h>
+#endif
+
+#include "netcdf_utils.h"
+#include "pnt.h"
+#include "edge.h"
+#include "stride_array.h"
+#include "mesh_reorder.h"
+#include "stage_profiler.h"
+#include "mpas_mesh_builder.h"
+#include "mpas_mesh_builder_state.h"
+
+#define MESH_SPEC 1.0
+#define ID_LEN 10
+
+using namespace std;
+using namespace mpas_mesh_builder;
+
+/*
+ * MpasMeshConverterMPI.x is the distributed memory version of
+ * MpasMeshConverter.x, for meshes whose arrays do not fit in the memory of one
+ * node. It writes the same mesh.nc and graph.info as MpasMeshConverter.x.
+ *
+ * Every rank reads a contiguous slab of the input cells and vertices. The
+ * cells are then split into parts along a Hilbert curve (a sample sort of
+ * the curve keys), and each rank gathers the vertices of its part, plus two
+ * layers of ghost cells around it. The MpasMeshBuilder library builds that
+ * local mesh exactly as it builds a whole one, and everything it computes for
+ * the owned cells, their edges and their vertices is exact, since no stage
+ * looks further than two cells away. Local cells and vertices are kept in
+ * global order, so the builder makes the same choices as on the whole mesh.
+ *
+ * Cells and vertices keep their input numbering. Edges are numbered in the
+ * order of their vertex pairs, as the serial buildEdges does, by a
+ * distributed sort of the owned edges. Finally each rank sends the rows of
+ * its owned elements to the rank writing the slab they fall in, and the
+ * slabs are written either collectively (with a parallel netCDF library) or
+ * one rank at a time.
+ */
+
+static const size_t HEADER_PAD = 16384;
+static const int PARTITION_SAMPLES = 64;
+
+int mpiRank = 0, mpiSize = 1;
+
+// Input grid {{{
+int64_t nGlobalCells, nGlobalVertices;
+int vertexDegree;
+bool onSphere, isPeriodic;
+double radius, xPeriodIn, yPeriodIn;
+double cellMin[3], cellMax[3];
+string in_history = "";
+string in_file_id = "";
+string in_parent_id = "";
+netcdf_mpas_output_format outputFormat;
+string profileFilename = "";
+// }}}
+
+/* Records {{{ */
+class record_buffer {/*{{{*/
+	/*
+	 * A list of fixed size records, each made of nInts ints (the first of
+	 * which is the global index of the element) and nDoubles doubles, stored
+	 * as two flat arrays so they can be sent with one MPI call each.
+	 */
+	public:
+		int nInts, nDoubles;
+		vector<int> ints;
+		vector<double> doubles;
+
+		record_buffer() : nInts(1), nDoubles(0) { }
+		record_buffer(const int nInts_, const int nDoubles_) : nInts(nInts_), nDoubles(nDoubles_) { }
+
+		int size() const { return ints.size() / nInts; }
+		int id(const int i) const { return ints[(size_t)i * nInts]; }
+		int* int_row(const int i) { return &ints[(size_t)i * nInts]; }
+		const int* int_row(const int i) const { return &ints[(size_t)i * nInts]; }
+		double* double_row(const int i) { return nDoubles > 0 ? &doubles[(size_t)i * nDoubles] : NULL; }
+		const double* double_row(const int i) const { return nDoubles > 0 ? &doubles[(size_t)i * nDoubles] : NULL; }
+
+		void push_back(const record_buffer &other, const int i){/*{{{*/
+			ints.insert(ints.end(), other.ints.begin() + (size_t)i * nInts, other.ints.begin() + (size_t)(i + 1) * nInts);
+			doubles.insert(doubles.end(), other.doubles.begin() + (size_t)i * nDoubles, other.doubles.begin() + (size_t)(i + 1) * nDoubles);
+		}/*}}}*/
+		void clear(){/*{{{*/
+			vector<int>().swap(ints);
+			vector<double>().swap(doubles);
+		}/*}}}*/
+		void sort_by_id(){/*{{{*/
+			// Sorts the records by id, and drops duplicates.
+			const int n = size();
+			vector< pair<int, int> > order(n);
+			record_buffer sorted(nInts, nDoubles);
+
+			for(int i = 0; i < n; i++){
+				order[i] = make_pair(id(i), i);
+			}
+			sort(order.begin(), order.end());
+
+			sorted.ints.reserve(ints.size());
+			sorted.doubles.reserve(doubles.size());
+			for(int i = 0; i < n; i++){
+				if(i == 0 || order[i].first != order[i-1].first){
+					sorted.push_back(*this, order[i].second);
+				}
+			}
+
+			ints.swap(sorted.ints);
+			doubles.swap(sorted.doubles);
+		}/*}}}*/
+		int find(const int id_) const {/*{{{*/
+			// Position of the record with the given id, or -1. Records have to
+			// be sorted by id.
+			int lo = 0, hi = size();
+
+			while(lo < hi){
+				const int mid = lo + (hi - lo) / 2;
+				if(id(mid) < id_){
+					lo = mid + 1;
+				} else {
+					hi = mid;
+				}
+			}
+
+			return (lo < size() && id(lo) == id_) ? lo : -1;
+		}/*}}}*/
+};/*}}}*/
+/*}}}*/
+
+// Distributed mesh {{{
+record_buffer slabCells;		// [id], [x, y, z, meshDensity] of this rank's input slab
+record_buffer slabVertices;		// [id, cellsOnVertex], [x, y, z] of this rank's input slab
+vector<int> slabCellOwner;		// Part of each cell in the input slab
+record_buffer ownedCells;		// Cells of this rank's part, sorted by id
+record_buffer localVertices;	// [id, cellsOnVertex, owners of those cells], [x, y, z]
+record_buffer localCells;		// Owned and ghost cells, sorted by id
+vector<int> localCellOwner;
+vector<int> localVertexOwned;
+vector<int> localEdgeOwned;
+vector<int> edgeGlobal;			// Global index of each local edge that is needed, or -1
+int64_t nGlobalEdges = 0;
+int globalMaxEdges = 0;
+// }}}
+
+// Output slabs {{{
+map<string, vector<double> > slabDoubles;
+map<string, vector<int> > slabInts;
+
+struct mesh_variable {/*{{{*/
+	const char *name;
+	nc_type type;
+	const char *dim0;
+	const char *dim1;
+};/*}}}*/
+
+// The variables of mesh.nc, in the order MpasMeshConverter.x defines them.
+static const mesh_variable meshVariables[] = {
+	{"latCell", NC_DOUBLE, "nCells", NULL},
+	{"lonCell", NC_DOUBLE, "nCells", NULL},
+	{"xCell", NC_DOUBLE, "nCells", NULL},
+	{"yCell", NC_DOUBLE, "nCells", NULL},
+	{"zCell", NC_DOUBLE, "nCells", NULL},
+	{"indexToCellID", NC_INT, "nCells", NULL},
+	{"latEdge", NC_DOUBLE, "nEdges", NULL},
+	{"lonEdge", NC_DOUBLE, "nEdges", NULL},
+	{"xEdge", NC_DOUBLE, "nEdges", NULL},
+	{"yEdge", NC_DOUBLE, "nEdges", NULL},
+	{"zEdge", NC_DOUBLE, "nEdges", NULL},
+	{"indexToEdgeID", NC_INT, "nEdges", NULL},
+	{"latVertex", NC_DOUBLE, "nVertices", NULL},
+	{"lonVertex", NC_DOUBLE, "nVertices", NULL},
+	{"xVertex", NC_DOUBLE, "nVertices", NULL},
+	{"yVertex", NC_DOUBLE, "nVertices", NULL},
+	{"zVertex", NC_DOUBLE, "nVertices", NULL},
+	{"indexToVertexID", NC_INT, "nVertices", NULL},
+	{"cellsOnCell", NC_INT, "nCells", "maxEdges"},
+	{"edgesOnCell", NC_INT, "nCells", "maxEdges"},
+	{"verticesOnCell", NC_INT, "nCells", "maxEdges"},
+	{"nEdgesOnCell", NC_INT, "nCells", NULL},
+	{"edgesOnEdge", NC_INT, "nEdges", "maxEdges2"},
+	{"cellsOnEdge", NC_INT, "nEdges", "TWO"},
+	{"verticesOnEdge", NC_INT, "nEdges", "TWO"},
+	{"nEdgesOnEdge", NC_INT, "nEdges", NULL},
+	{"cellsOnVertex", NC_INT, "nVertices", "vertexDegree"},
+	{"edgesOnVertex", NC_INT, "nVertices", "vertexDegree"},
+	{"boundaryVertex", NC_INT, "nVertices", NULL},
+	{"areaCell", NC_DOUBLE, "nCells", NULL},
+	{"angleEdge", NC_DOUBLE, "nEdges", NULL},
+	{"dcEdge", NC_DOUBLE, "nEdges", NULL},
+	{"dvEdge", NC_DOUBLE, "nEdges", NULL},
+	{"weightsOnEdge", NC_DOUBLE, "nEdges", "maxEdges2"},
+	{"areaTriangle", NC_DOUBLE, "nVertices", NULL},
+	{"kiteAreasOnVertex", NC_DOUBLE, "nVertices", "vertexDegree"},
+	{"cellQuality", NC_DOUBLE, "nCells", NULL},
+	{"gridSpacing", NC_DOUBLE, "nCells", NULL},
+	{"triangleQuality", NC_DOUBLE, "nVertices", NULL},
+	{"triangleAngleQuality", NC_DOUBLE, "nVertices", NULL},
+	{"obtuseTriangle", NC_INT, "nVertices", NULL},
+	{"meshDensity", NC_DOUBLE, "nCells", NULL}
+};
+static const int nMeshVariables = sizeof(meshVariables) / sizeof(meshVariables[0]);
+// }}}
+
+/* MPI helpers {{{ */
+inline MPI_Datatype mpiType(const int *){ return MPI_INT; }
+inline MPI_Datatype mpiType(const double *){ return MPI_DOUBLE; }
+inline MPI_Datatype mpiType(const uint64_t *){ return MPI_UINT64_T; }
+int64_t slabFirst(const int64_t n, const int rank);
+int slabRank(const int64_t n, const int64_t i);
+int checkGlobalCount(const char *name, const int64_t n);
+int globalError(const int error);
+template <class T> void exchangeValues(const vector< vector<T> > &send, vector<T> &recv, vector<int> &recvCounts);
+void exchangeRecords(const vector<record_buffer> &send, record_buffer &recv, vector<int> &recvCounts);
+/*}}}*/
+
+/* Conversion stages {{{ */
+int readInputSlabs(const string inputFilename);
+int partitionCells();
+int distributeVertices();
+int gatherGhostLayers();
+int buildLocalMesh();
+int numberEdges();
+int gatherOutputSlabs();
+/*}}}*/
+
+/* Output functions {{{ */
+int defineMeshFile(const int ncid, const string outputFilename, const string inputFilename, const string fileId, const bool collective);
+int writeMeshSlabs(const int ncid, const bool collective);
+int writeMeshFile(const string outputFilename, const string inputFilename);
+int writeGraphFile(const string outputFilename);
+/*}}}*/
+
+string gen_random(const int len);
+
+int main ( int argc, char *argv[] ) {
+	int error;
+	int nThreads = 0;
+	string out_name = "mesh.nc";
+	string in_name = "grid.nc";
+	vector<string> args;
+
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
+	MPI_Comm_size(MPI_COMM_WORLD, &mpiSize);
+
+	// Only rank 0 reports progress. Errors from other ranks go to cerr.
+	if(mpiRank != 0){
+		cout.rdbuf(NULL);
+	}
+
+	cout << endl << endl;
+	cout << "************************************************************" << endl;
+	cout << "MPAS_MESH_CONVERTER_MPI:\n";
+	cout << "  C++ version\n";
+	cout << "  Convert a NetCDF file describing Cell Locations, \n";
+	cout << "  Vertex Location, and Connectivity into a valid MPAS mesh,\n";
+	cout << "  distributed over MPI ranks.\n";
+	cout << endl << endl;
+	cout << "  Compiled on " << __DATE__ << " at " << __TIME__ << ".\n";
+	cout << "************************************************************" << endl;
+	cout << endl << endl;
+
+	if ( netcdf_mpas_parse_output_flags(argc, argv, outputFormat) || parseProfileFlags(argc, argv, profileFilename) ) {
+		MPI_Finalize();
+		return 1;
+	}
+
+	for ( int i = 1; i < argc; i++ ) {
+		string str_flag = argv[i];
+
+		if ( str_flag == "--threads" ) {
+			if ( i + 1 >= argc || atoi(argv[i+1]) <= 0 ) {
+				cout << " ERROR: --threads requires a positive thread count." << endl;
+				MPI_Finalize();
+				return 1;
+			}
+			nThreads = atoi(argv[i+1]);
+			i++;
+		} else {
+			args.push_back(str_flag);
+		}
+	}
+
+	if ( args.size() < 1 || args.size() > 2 ) {
+		cout << " Usage: mpirun -np N MpasMeshConverterMPI.x input_name [output_name] [--threads N] [--profile file] [output format options]" << endl;
+		MPI_Finalize();
+		return 1;
+	}
+	in_name = args[0];
+	if ( args.size() == 2 ) {
+		out_name = args[1];
+	}
+
+	if(in_name == out_name){
+		cout << "   ERROR: Input and output names are the same." << endl;
+		MPI_Finalize();
+		return 1;
+	}
+
+#ifdef _OPENMP
+	if ( nThreads > 0 ) {
+		omp_set_num_threads(nThreads);
+	}
+	cout << "Using " << mpiSize << " MPI ranks with " << omp_get_max_threads() << " OpenMP threads each." << endl;
+#else
+	cout << "Using " << mpiSize << " MPI ranks." << endl;
+#endif
+
+	srand(time(NULL));
+
+	cout << "Reading input grid slabs." << endl;
+	profiler.start("readInputSlabs");
+	error = globalError(readInputSlabs(in_name));
+	if(error) { MPI_Finalize(); return 1; }
+	profiler.stop(slabCells.size(), "cells");
+
+	cout << "Partitioning cells along a Hilbert curve." << endl;
+	profiler.start("partitionCells");
+	error = globalError(partitionCells());
+	if(error) { MPI_Finalize(); return 1; }
+	profiler.stop(slabCells.size(), "cells");
+
+	cout << "Distributing vertices." << endl;
+	profiler.start("distributeVertices");
+	error = globalError(distributeVertices());
+	if(error) { MPI_Finalize(); return 1; }
+	profiler.stop(localVertices.size(), "vertices");
+
+	cout << "Gathering ghost layers." << endl;
+	profiler.start("gatherGhostLayers");
+	error = globalError(gatherGhostLayers());
+	if(error) { MPI_Finalize(); return 1; }
+	profiler.stop(localCells.size(), "cells");
+
+	cout << "Building local meshes." << endl;
+	profiler.start("buildLocalMesh");
+	error = globalError(buildLocalMesh());
+	if(error) { MPI_Finalize(); return 1; }
+	profiler.stop(localCells.size(), "cells");
+
+	cout << "Numbering edges." << endl;
+	profiler.start("numberEdges");
+	error = globalError(numberEdges());
+	if(error) { MPI_Finalize(); return 1; }
+	profiler.stop(edges.size(), "edges");
+
+	cout << "Gathering output slabs." << endl;
+	profiler.start("gatherOutputSlabs");
+	error = globalError(gatherOutputSlabs());
+	if(error) { MPI_Finalize(); return 1; }
+	profiler.stop(nGlobalCells, "cells");
+
+	cout << "Write graph.info file" << endl;
+	profiler.start("writeGraphFile");
+	error = globalError(writeGraphFile("graph.info"));
+	if(error) { MPI_Finalize(); return 1; }
+	profiler.stop(nGlobalCells, "cells");
+
+	cout << "Writing " << out_name << endl;
+	profiler.start("writeMeshFile");
+	error = globalError(writeMeshFile(out_name, in_name));
+	if(error) { MPI_Finalize(); return 1; }
+	profiler.stop(nGlobalCells, "cells");
+
+	// Timings are those of rank 0. Every stage ends in a collective step, so
+	// they include waiting for the slowest rank.
+	profiler.report(cout);
+	if(mpiRank == 0 && profileFilename != ""){
+		if(profiler.write_json(profileFilename, "MpasMeshConverterMPI.x")) error = 1;
+	}
+
+	MPI_Finalize();
+	return error;
+}
+
+/* MPI helpers {{{ */
+int64_t slabFirst(const int64_t n, const int rank){/*{{{*/
+	// First element of rank's slab, when n elements are split into mpiSize
+	// contiguous slabs of (nearly) equal size.
+	return n * rank / mpiSize;
+}/*}}}*/
+int slabRank(const int64_t n, const int64_t i){/*{{{*/
+	// The rank whose slab holds element i.
+	return (int)(((i + 1) * mpiSize - 1) / n);
+}/*}}}*/
+int checkGlobalCount(const char *name, const int64_t n){/*{{{*/
+	// Global counts are kept in 64 bits, but the records, the builder and
+	// the int variables of mesh.nc still hold element indices in an int.
+	if(n > INT_MAX){
+		if(mpiRank == 0){
+			cerr << "ERROR: The mesh has " << n << " " << name << ", but at most " << INT_MAX
+				<< " elements are supported." << endl;
+		}
+		return 1;
+	}
+	return 0;
+}/*}}}*/
+int globalError(const int error){/*{{{*/
+	// Every rank has to take the same branch after a stage, so errors are
+	// combined over all ranks.
+	int anyError = 0;
+	int localError = (error != 0);
+
+	MPI_Allreduce(&localError, &anyError, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+	return anyError;
+}/*}}}*/
+template <class T>
+void exchangeValues(const vector< vector<T> > &send, vector<T> &recv, vector<int> &recvCounts){/*{{{*/
+	/*
+	 * Sends send[r] to rank r, and receives what every rank sent to this one
+	 * into recv, ordered by source rank. recvCounts holds the number of values
+	 * from each rank.
+	 */
+	vector<int> sendCounts(mpiSize), sendDispls(mpiSize), recvDispls(mpiSize);
+	vector<T> sendValues;
+	int r;
+
+	recvCounts.assign(mpiSize, 0);
+	for(r = 0; r < mpiSize; r++){
+		sendCounts[r] = send[r].size();
+		sendDispls[r] = sendValues.size();
+		sendValues.insert(sendValues.end(), send[r].begin(), send[r].end());
+	}
+
+	MPI_Alltoall(&sendCounts[0], 1, MPI_INT, &recvCounts[0], 1, MPI_INT, MPI_COMM_WORLD);
+
+	recvDispls[0] = 0;
+	for(r = 1; r < mpiSize; r++){
+		recvDispls[r] = recvDispls[r-1] + recvCounts[r-1];
+	}
+	recv.resize(recvDispls[mpiSize-1] + recvCounts[mpiSize-1]);
+
+	// Buffers may be empty, but MPI still needs valid pointers.
+	sendValues.reserve(1);
+	recv.reserve(1);
+	MPI_Alltoallv(sendValues.data(), &sendCounts[0], &sendDispls[0], mpiType(sendValues.data()),
+			recv.data(), &recvCounts[0], &recvDispls[0], mpiType(recv.data()), MPI_COMM_WORLD);
+}/*}}}*/
+void exchangeRecords(const vector<record_buffer> &send, record_buffer &recv, vector<int> &recvCounts){/*{{{*/
+	/*
+	 * exchangeValues for records. recvCounts holds the number of records
+	 * from each rank.
+	 */
+	vector< vector<int> > sendInts(mpiSize);
+	vector< vector<double> > sendDoubles(mpiSize);
+	vector<int> doubleCounts;
+
+	for(int r = 0; r < mpiSize; r++){
+		sendInts[r] = send[r].ints;
+		sendDoubles[r] = send[r].doubles;
+	}
+
+	exchangeValues(sendInts, recv.ints, recvCounts);
+	exchangeValues(sendDoubles, recv.doubles, doubleCounts);
+
+	for(int r = 0; r < mpiSize; r++){
+		recvCounts[r] /= recv.nInts;
+	}
+}/*}}}*/
+/*}}}*/
+
+/* Conversion stages {{{ */
+int readInputSlabs(const string inputFilename){/*{{{*/
+	/*
+	 * readInputSlabs reads the global attributes of grid.nc on every rank, and
+	 * this rank's slab of the cell and vertex arrays.
+	 */
+	int ncid, varid, status;
+	size_t start[2], count[2];
+	int64_t firstCell, firstVertex;
+	int nSlabCells, nSlabVertices;
+	vector<double> x, y, z, density;
+	vector<int> cov;
+	int i, j;
+
+	if ( netcdf_mpas_check_dims(inputFilename) ) return 1;
+
+	nGlobalCells = netcdf_mpas_read_dim(inputFilename, "nCells");
+	nGlobalVertices = netcdf_mpas_read_dim(inputFilename, "nVertices");
+	vertexDegree = netcdf_mpas_read_dim(inputFilename, "vertexDegree");
+	onSphere = netcdf_mpas_read_onsphere(inputFilename);
+	radius = netcdf_mpas_read_sphereradius(inputFilename);
+	in_history = netcdf_mpas_read_history(inputFilename);
+	in_file_id = netcdf_mpas_read_fileid(inputFilename);
+	in_parent_id = netcdf_mpas_read_parentid(inputFilename);
+	isPeriodic = netcdf_mpas_read_isperiodic(inputFilename);
+	xPeriodIn = netcdf_mpas_read_xperiod(inputFilename);
+	yPeriodIn = netcdf_mpas_read_yperiod(inputFilename);
+
+	cout << "Read dimensions:" << endl;
+	cout << "    nCells = " << nGlobalCells << endl;
+	cout << "    nVertices = " << nGlobalVertices << endl;
+	cout << "    vertexDegree = " << vertexDegree << endl;
+	cout << "    Spherical? = " << onSphere << endl;
+	cout << "    Periodic? = " << isPeriodic << endl;
+	if ( isPeriodic ) {
+		cout << "    x_period = " << xPeriodIn << endl;
+		cout << "    y_period = " << yPeriodIn << endl;
+	}
+
+	if(nGlobalCells <= 0 || nGlobalVertices <= 0 || vertexDegree <= 0){
+		cerr << "Rank " << mpiRank << ": ERROR: Could not read the dimensions of " << inputFilename << endl;
+		return 1;
+	}
+
+	firstCell = slabFirst(nGlobalCells, mpiRank);
+	nSlabCells = (int)(slabFirst(nGlobalCells, mpiRank + 1) - firstCell);
+	firstVertex = slabFirst(nGlobalVertices, mpiRank);
+	nSlabVertices = (int)(slabFirst(nGlobalVertices, mpiRank + 1) - firstVertex);
+
+	if((status = nc_open(inputFilename.c_str(), NC_NOWRITE, &ncid)) != NC_NOERR){
+		cerr << "Rank " << mpiRank << ": ERROR: Could not open " << inputFilename << ": " << nc_strerror(status) << endl;
+		return 1;
+	}
+
+	// Cells
+	x.resize(nSlabCells + 1);
+	y.resize(nSlabCells + 1);
+	z.resize(nSlabCells + 1);
+	density.assign(nSlabCells + 1, 1.0);
+	start[0] = firstCell;
+	count[0] = nSlabCells;
+	status = NC_NOERR;
+	if(status == NC_NOERR) status = nc_inq_varid(ncid, "xCell", &varid);
+	if(status == NC_NOERR) status = nc_get_vara_double(ncid, varid, start, count, &x[0]);
+	if(status == NC_NOERR) status = nc_inq_varid(ncid, "yCell", &varid);
+	if(status == NC_NOERR) status = nc_get_vara_double(ncid, varid, start, count, &y[0]);
+	if(status == NC_NOERR) status = nc_inq_varid(ncid, "zCell", &varid);
+	if(status == NC_NOERR) status = nc_get_vara_double(ncid, varid, start, count, &z[0]);
+	// meshDensity is optional, and 1 where it is missing.
+	if(status == NC_NOERR && nc_inq_varid(ncid, "meshDensity", &varid) == NC_NOERR){
+		status = nc_get_vara_double(ncid, varid, start, count, &density[0]);
+	}
+
+	slabCells = record_buffer(1, 4);
+	slabCells.ints.resize(nSlabCells);
+	slabCells.doubles.resize((size_t)nSlabCells * 4);
+	for(i = 0; i < nSlabCells; i++){
+		double *values = slabCells.double_row(i);
+
+		slabCells.ints[i] = (int)(firstCell + i);
+		values[0] = x[i];
+		values[1] = y[i];
+		values[2] = z[i];
+		values[3] = density[i];
+	}
+
+	// Vertices, with cellsOnVertex converted to 0-based indices.
+	x.resize(nSlabVertices + 1);
+	y.resize(nSlabVertices + 1);
+	z.resize(nSlabVertices + 1);
+	cov.resize((size_t)nSlabVertices * vertexDegree + 1);
+	start[0] = firstVertex;
+	count[0] = nSlabVertices;
+	start[1] = 0;
+	count[1] = vertexDegree;
+	if(status == NC_NOERR) status = nc_inq_varid(ncid, "xVertex", &varid);
+	if(status == NC_NOERR) status = nc_get_vara_double(ncid, varid, start, count, &x[0]);
+	if(status == NC_NOERR) status = nc_inq_varid(ncid, "yVertex", &varid);
+	if(status == NC_NOERR) status = nc_get_vara_double(ncid, varid, start, count, &y[0]);
+	if(status == NC_NOERR) status = nc_inq_varid(ncid, "zVertex", &varid);
+	if(status == NC_NOERR) status = nc_get_vara_double(ncid, varid, start, count, &z[0]);
+	if(status == NC_NOERR) status = nc_inq_varid(ncid, "cellsOnVertex", &varid);
+	if(status == NC_NOERR) status = nc_get_vara_int(ncid, varid, start, count, &cov[0]);
+
+	nc_close(ncid);
+	if(status != NC_NOERR){
+		cerr << "Rank " << mpiRank << ": ERROR: Could not read " << inputFilename << ": " << nc_strerror(status) << endl;
+		return 1;
+	}
+
+	slabVertices = record_buffer(1 + vertexDegree, 3);
+	slabVertices.ints.resize((size_t)nSlabVertices * (1 + vertexDegree));
+	slabVertices.doubles.resize((size_t)nSlabVertices * 3);
+	for(i = 0; i < nSlabVertices; i++){
+		int *ids = slabVertices.int_row(i);
+		double *values = slabVertices.double_row(i);
+
+		ids[0] = (int)(firstVertex + i);
+		for(j = 0; j < vertexDegree; j++){
+			ids[1 + j] = cov[(size_t)i * vertexDegree + j] - 1;
+			if(ids[1 + j] >= nGlobalCells){
+				cerr << "Rank " << mpiRank << ": ERROR: cellsOnVertex of vertex " << ids[0] + 1 << " is out of range." << endl;
+				return 1;
+			}
+		}
+		values[0] = x[i];
+		values[1] = y[i];
+		values[2] = z[i];
+	}
+
+	return 0;
+}/*}}}*/
+int partitionCells(){/*{{{*/
+	/*
+	 * partitionCells splits the cells into mpiSize parts of about equal size
+	 * along a Hilbert curve through the cell centers, the same curve as
+	 * --reorder hilbert, and sends every slab cell to the rank owning its
+	 * part. The split points are chosen from a regular sample of the sorted
+	 * keys of every rank.
+	 */
+	const int nDims = onSphere ? 3 : 2;
+	const int bits = onSphere ? 21 : 31;
+	const double maxCoord = (double)((1u << bits) - 1);
+	const int n = slabCells.size();
+	vector< pair<uint64_t, int> > keys, splitters;
+	vector<uint64_t> sampleKeys, allKeys;
+	vector<int> sampleIds, allIds, sampleCounts(mpiSize), sampleDispls(mpiSize), counts;
+	vector<record_buffer> send(mpiSize, record_buffer(1, 4));
+	double scale[3];
+	int i, d, r, nSamples, nAllSamples;
+
+	for(d = 0; d < 3; d++){
+		cellMin[d] = HUGE_VAL;
+		cellMax[d] = -HUGE_VAL;
+	}
+	for(i = 0; i < n; i++){
+		const double *values = slabCells.double_row(i);
+		for(d = 0; d < 3; d++){
+			cellMin[d] = min(cellMin[d], values[d]);
+			cellMax[d] = max(cellMax[d], values[d]);
+		}
+	}
+	MPI_Allreduce(MPI_IN_PLACE, cellMin, 3, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+	MPI_Allreduce(MPI_IN_PLACE, cellMax, 3, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+	for(d = 0; d < 3; d++){
+		scale[d] = (cellMax[d] > cellMin[d]) ? maxCoord / (cellMax[d] - cellMin[d]) : 0.0;
+	}
+
+	keys.resize(n);
+	#pragma omp parallel for default(shared) private(d)
+	for(i = 0; i < n; i++){
+		const double *values = slabCells.double_row(i);
+		uint32_t q[3];
+
+		for(d = 0; d < nDims; d++){
+			q[d] = (uint32_t)min(maxCoord, max(0.0, (values[d] - cellMin[d]) * scale[d]));
+		}
+		keys[i] = make_pair(hilbertKey(q, nDims, bits), slabCells.id(i));
+	}
+	sort(keys.begin(), keys.end());
+
+	// Regular sample of the sorted keys of every rank.
+	nSamples = min(n, PARTITION_SAMPLES);
+	for(i = 0; i < nSamples; i++){
+		sampleKeys.push_back(keys[(size_t)i * n / nSamples].first);
+		sampleIds.push_back(keys[(size_t)i * n / nSamples].second);
+	}
+	MPI_Allgather(&nSamples, 1, MPI_INT, &sampleCounts[0], 1, MPI_INT, MPI_COMM_WORLD);
+	sampleDispls[0] = 0;
+	for(r = 1; r < mpiSize; r++){
+		sampleDispls[r] = sampleDispls[r-1] + sampleCounts[r-1];
+	}
+	nAllSamples = sampleDispls[mpiSize-1] + sampleCounts[mpiSize-1];
+	allKeys.resize(nAllSamples);
+	allIds.resize(nAllSamples);
+	sampleKeys.reserve(1);
+	sampleIds.reserve(1);
+	MPI_Allgatherv(sampleKeys.data(), nSamples, MPI_UINT64_T, &allKeys[0], &sampleCounts[0], &sampleDispls[0], MPI_UINT64_T, MPI_COMM_WORLD);
+	MPI_Allgatherv(sampleIds.data(), nSamples, MPI_INT, &allIds[0], &sampleCounts[0], &sampleDispls[0], MPI_INT, MPI_COMM_WORLD);
+
+	for(i = 0; i < nAllSamples; i++){
+		splitters.push_back(make_pair(allKeys[i], allIds[i]));
+	}
+	sort(splitters.begin(), splitters.end());
+	for(r = 1; r < mpiSize; r++){
+		splitters[r - 1] = splitters[(size_t)r * nAllSamples / mpiSize];
+	}
+	splitters.resize(mpiSize - 1);
+
+	// Part r holds the cells from splitter r-1 up to splitter r.
+	slabCellOwner.resize(n);
+	for(i = 0; i < n; i++){
+		const int iCell = keys[i].second - slabCells.id(0);
+		r = upper_bound(splitters.begin(), splitters.end(), keys[i]) - splitters.begin();
+		slabCellOwner[iCell] = r;
+	}
+
+	for(i = 0; i < n; i++){
+		send[slabCellOwner[i]].push_back(slabCells, i);
+	}
+
+	ownedCells = record_buffer(1, 4);
+	exchangeRecords(send, ownedCells, counts);
+	ownedCells.sort_by_id();
+	slabCells.clear();
+
+	return 0;
+}/*}}}*/
+int distributeVertices(){/*{{{*/
+	/*
+	 * distributeVertices sends every vertex to the owners of all cells
+	 * around it, along with those owners, which are looked up from the
+	 * slab ranks of the cells. Afterwards every rank has all vertices of its
+	 * own cells.
+	 */
+	const int64_t firstCell = slabFirst(nGlobalCells, mpiRank);
+	const int n = slabVertices.size();
+	vector< vector<int> > requests(mpiSize), replies(mpiSize);
+	vector<int> requested, answers, counts;
+	vector< pair<int, int> > cellOwner;
+	vector<record_buffer> send(mpiSize, record_buffer(1 + 2 * vertexDegree, 3));
+	record_buffer row(1 + 2 * vertexDegree, 3);
+	int i, j, k, r, pos;
+
+	for(i = 0; i < n; i++){
+		const int *ids = slabVertices.int_row(i);
+		for(j = 0; j < vertexDegree; j++){
+			if(ids[1 + j] >= 0){
+				requests[slabRank(nGlobalCells, ids[1 + j])].push_back(ids[1 + j]);
+			}
+		}
+	}
+	for(r = 0; r < mpiSize; r++){
+		sort(requests[r].begin(), requests[r].end());
+		requests[r].erase(unique(requests[r].begin(), requests[r].end()), requests[r].end());
+	}
+
+	exchangeValues(requests, requested, counts);
+	pos = 0;
+	for(r = 0; r < mpiSize; r++){
+		for(k = 0; k < counts[r]; k++){
+			replies[r].push_back(slabCellOwner[requested[pos++] - firstCell]);
+		}
+	}
+	exchangeValues(replies, answers, counts);
+
+	pos = 0;
+	for(r = 0; r < mpiSize; r++){
+		for(k = 0; k < (int)requests[r].size(); k++){
+			cellOwner.push_back(make_pair(requests[r][k], answers[pos++]));
+		}
+	}
+	sort(cellOwner.begin(), cellOwner.end());
+	vector<int>().swap(slabCellOwner);
+
+	row.ints.resize(row.nInts);
+	row.doubles.resize(row.nDoubles);
+	for(i = 0; i < n; i++){
+		const int *ids = slabVertices.int_row(i);
+		int *rowIds = row.int_row(0);
+		vector<int> owners;
+
+		rowIds[0] = ids[0];
+		for(j = 0; j < vertexDegree; j++){
+			rowIds[1 + j] = ids[1 + j];
+			rowIds[1 + vertexDegree + j] = -1;
+			if(ids[1 + j] >= 0){
+				rowIds[1 + vertexDegree + j] = lower_bound(cellOwner.begin(), cellOwner.end(), make_pair(ids[1 + j], -1))->second;
+				owners.push_back(rowIds[1 + vertexDegree + j]);
+			}
+		}
+		for(j = 0; j < 3; j++){
+			row.doubles[j] = slabVertices.double_row(i)[j];
+		}
+
+		if(owners.empty()){
+			cerr << "Rank " << mpiRank << ": ERROR: Vertex " << ids[0] + 1 << " is not on any cell, which MpasMeshConverterMPI.x does not support." << endl;
+			return 1;
+		}
+
+		sort(owners.begin(), owners.end());
+		owners.erase(unique(owners.begin(), owners.end()), owners.end());
+		for(j = 0; j < (int)owners.size(); j++){
+			send[owners[j]].push_back(row, 0);
+		}
+	}
+	slabVertices.clear();
+
+	localVertices = record_buffer(1 + 2 * vertexDegree, 3);
+	exchangeRecords(send, localVertices, counts);
+	localVertices.sort_by_id();
+
+	return 0;
+}/*}}}*/
+int gatherGhostLayers(){/*{{{*/
+	/*
+	 * gatherGhostLayers adds two layers of ghost cells around the owned cells,
+	 * each with all of its vertices, which the owners of the cells hand out.
+	 * Every local cell is then complete, and all values of the owned cells,
+	 * edges and vertices come out as in the whole mesh. Cells further out are
+	 * only referred to by the vertices of the second layer, and are left out
+	 * of the local mesh.
+	 */
+	vector< pair<int, int> > cellVertex, cellOwner, newCells;
+	vector< vector<int> > requests(mpiSize);
+	vector<int> requested, counts;
+	vector<record_buffer> send(mpiSize, record_buffer(1 + 2 * vertexDegree, 3));
+	vector<record_buffer> sendCells(mpiSize, record_buffer(1, 4));
+	record_buffer received(1 + 2 * vertexDegree, 3);
+	record_buffer receivedCells(1, 4);
+	int i, j, k, r, pos, layer;
+
+	// The vertices of each owned cell, which are all local already.
+	for(k = 0; k < localVertices.size(); k++){
+		const int *ids = localVertices.int_row(k);
+		for(j = 0; j < vertexDegree; j++){
+			if(ids[1 + j] >= 0 && ids[1 + vertexDegree + j] == mpiRank){
+				cellVertex.push_back(make_pair(ids[1 + j], k));
+			}
+		}
+	}
+	sort(cellVertex.begin(), cellVertex.end());
+	for(i = 0; i < ownedCells.size(); i++){
+		cellOwner.push_back(make_pair(ownedCells.id(i), mpiRank));
+	}
+
+	for(layer = 0; layer < 2; layer++){
+		// Cells around the local vertices that are not local yet.
+		newCells.clear();
+		for(k = 0; k < localVertices.size(); k++){
+			const int *ids = localVertices.int_row(k);
+			for(j = 0; j < vertexDegree; j++){
+				if(ids[1 + j] >= 0 && !binary_search(cellOwner.begin(), cellOwner.end(), make_pair(ids[1 + j], ids[1 + vertexDegree + j]))){
+					newCells.push_back(make_pair(ids[1 + j], ids[1 + vertexDegree + j]));
+				}
+			}
+		}
+		sort(newCells.begin(), newCells.end());
+		newCells.erase(unique(newCells.begin(), newCells.end()), newCells.end());
+
+		for(r = 0; r < mpiSize; r++){
+			requests[r].clear();
+			send[r].clear();
+		}
+		for(i = 0; i < (int)newCells.size(); i++){
+			requests[newCells[i].second].push_back(newCells[i].first);
+		}
+		cellOwner.insert(cellOwner.end(), newCells.begin(), newCells.end());
+		sort(cellOwner.begin(), cellOwner.end());
+
+		// Hand out the vertices of the requested cells.
+		exchangeValues(requests, requested, counts);
+		pos = 0;
+		for(r = 0; r < mpiSize; r++){
+			vector<int> records;
+
+			for(i = 0; i < counts[r]; i++, pos++){
+				vector< pair<int, int> >::iterator it = lower_bound(cellVertex.begin(), cellVertex.end(), make_pair(requested[pos], -1));
+				for(; it != cellVertex.end() && it->first == requested[pos]; ++it){
+					records.push_back(it->second);
+				}
+			}
+			sort(records.begin(), records.end());
+			records.erase(unique(records.begin(), records.end()), records.end());
+			for(i = 0; i < (int)records.size(); i++){
+				send[r].push_back(localVertices, records[i]);
+			}
+		}
+
+		exchangeRecords(send, received, counts);
+		for(k = 0; k < received.size(); k++){
+			localVertices.push_back(received, k);
+		}
+		received.clear();
+	}
+
+	// cellVertex points into the owned cells' vertices, which stay in front
+	// until now.
+	localVertices.sort_by_id();
+
+	// Coordinates of the ghost cells.
+	for(r = 0; r < mpiSize; r++){
+		requests[r].clear();
+	}
+	for(i = 0; i < (int)cellOwner.size(); i++){
+		if(cellOwner[i].second != mpiRank){
+			requests[cellOwner[i].second].push_back(cellOwner[i].first);
+		}
+	}
+
+	exchangeValues(requests, requested, counts);
+	pos = 0;
+	for(r = 0; r < mpiSize; r++){
+		for(i = 0; i < counts[r]; i++, pos++){
+			k = ownedCells.find(requested[pos]);
+			if(k < 0){
+				cerr << "Rank " << mpiRank << ": ERROR: Cell " << requested[pos] + 1 << " was requested, but is not owned here." << endl;
+				return 1;
+			}
+			sendCells[r].push_back(ownedCells, k);
+		}
+	}
+	exchangeRecords(sendCells, receivedCells, counts);
+
+	localCells = ownedCells;
+	for(k = 0; k < receivedCells.size(); k++){
+		localCells.push_back(receivedCells, k);
+	}
+	localCells.sort_by_id();
+
+	localCellOwner.resize(localCells.size());
+	for(i = 0; i < localCells.size(); i++){
+		localCellOwner[i] = lower_bound(cellOwner.begin(), cellOwner.end(), make_pair(localCells.id(i), -1))->second;
+	}
+
+	return 0;
+}/*}}}*/
+int buildLocalMesh(){/*{{{*/
+	/*
+	 * buildLocalMesh runs MpasMeshBuilder on the local cells and vertices.
+	 * The periods of periodic meshes are worked out from the global cell
+	 * ranges, as mpas_mesh_builder_set_grid would from the whole mesh.
+	 */
+	const int n = localCells.size();
+	const int nv = localVertices.size();
+	vector<double> xc(n), yc(n), zc(n), density(n);
+	vector<double> xv(nv), yv(nv), zv(nv);
+	vector<int> cov((size_t)nv * vertexDegree);
+	double xPeriodFix = xPeriodIn, yPeriodFix = yPeriodIn;
+	int i, j, k;
+
+	if(n == 0){
+		return 0;
+	}
+
+	for(i = 0; i < n; i++){
+		const double *values = localCells.double_row(i);
+		xc[i] = values[0];
+		yc[i] = values[1];
+		zc[i] = values[2];
+		density[i] = values[3];
+	}
+
+	// cellsOnVertex in local, 1-based indices. Cells beyond the ghost layers
+	// are missing (0), and missing cells keep their value from grid.nc.
+	for(i = 0; i < nv; i++){
+		const int *ids = localVertices.int_row(i);
+		const double *values = localVertices.double_row(i);
+
+		xv[i] = values[0];
+		yv[i] = values[1];
+		zv[i] = values[2];
+		for(j = 0; j < vertexDegree; j++){
+			if(ids[1 + j] >= 0){
+				k = localCells.find(ids[1 + j]);
+				cov[(size_t)i * vertexDegree + j] = k + 1;
+			} else {
+				cov[(size_t)i * vertexDegree + j] = ids[1 + j] + 1;
+			}
+		}
+	}
+
+	if(isPeriodic){
+		// Same choice as in mpas_mesh_builder_set_grid.
+		if(vertexDegree == 4){
+			if(xPeriodFix < 0.0) xPeriodFix = cellMin[0] + cellMax[0];
+			if(yPeriodFix < 0.0) yPeriodFix = cellMin[1] + cellMax[1];
+		} else {
+			if(xPeriodFix < 0.0) xPeriodFix = cellMax[0];
+			if(yPeriodFix < 0.0) yPeriodFix = cellMax[1];
+		}
+	}
+
+	// The local arrays outlive the build, so the builder can read them in place.
+	mpas_mesh_builder_set_borrowing(1);
+	if(mpas_mesh_builder_set_grid(n, nv, vertexDegree, &xc[0], &yc[0], &zc[0], &xv[0], &yv[0], &zv[0],
+				&cov[0], &density[0], onSphere, radius, isPeriodic, xPeriodFix, yPeriodFix)){
+		cerr << "Rank " << mpiRank << ": ERROR: Could not set the local grid." << endl;
+		return 1;
+	}
+
+	if(mpas_mesh_builder_build()){
+		cerr << "Rank " << mpiRank << ": ERROR: Could not build the local mesh." << endl;
+		return 1;
+	}
+
+	return 0;
+}/*}}}*/
+uint64_t globalEdgeKey(const int iEdge){/*{{{*/
+	// The key buildEdges sorts the edges by, from global vertex indices.
+	edge e;
+	int v1 = verticesOnEdge.at(iEdge, 0);
+	int v2 = verticesOnEdge.at(iEdge, 1);
+
+	v1 = (v1 >= 0) ? localVertices.id(v1) : -1;
+	v2 = (v2 >= 0) ? localVertices.id(v2) : -1;
+	e.vertex1 = min(v1, v2);
+	e.vertex2 = max(v1, v2);
+
+	return e.key();
+}/*}}}*/
+int edgeKeyRank(const uint64_t key){/*{{{*/
+	// Ranks sort the edge keys in contiguous ranges of the first vertex.
+	return (int)((key >> 32) * mpiSize / ((uint64_t)nGlobalVertices + 1));
+}/*}}}*/
+int lowestCellOwner(stride_array<int> &onElement, const int i){/*{{{*/
+	// Owner of the cell with the lowest index in row i, or -1 if there are
+	// none. Local cells are in global order, so that is the lowest global
+	// index as well.
+	int lowest = -1;
+
+	for(int j = 0; j < onElement.size(i); j++){
+		const int iCell = onElement.at(i, j);
+		if(iCell >= 0 && (lowest < 0 || iCell < lowest)){
+			lowest = iCell;
+		}
+	}
+
+	return (lowest >= 0) ? localCellOwner[lowest] : -1;
+}/*}}}*/
+int numberEdges(){/*{{{*/
+	/*
+	 * numberEdges gives every edge its index in the whole mesh, which is its
+	 * position in the sorted list of all vertex pairs (see buildEdges).
+	 *
+	 * Edges belong to the owner of their lowest cell, and vertices to the
+	 * owner of their lowest cell. Each rank sends the keys of its edges to the
+	 * rank sorting that key range, which numbers them after the keys of the
+	 * ranks before it. Then every rank looks up the indices of all edges
+	 * its owned elements refer to.
+	 */
+	const int nLocalEdges = edges.size();
+	vector< vector<uint64_t> > sendKeys(mpiSize);
+	vector< vector<int> > replies(mpiSize), localIndex(mpiSize);
+	vector<uint64_t> sortedKeys, requested;
+	vector<int> answers, counts;
+	vector<char> needed(nLocalEdges, 0);
+	int i, j, r, pos, nMissing;
+	int64_t offset, nSorted;
+	int64_t counted[3], totals[3];
+
+	localEdgeOwned.assign(nLocalEdges, 0);
+	localVertexOwned.assign(vertices.size(), 0);
+
+	for(i = 0; i < nLocalEdges; i++){
+		if(lowestCellOwner(cellsOnEdge, i) == mpiRank){
+			localEdgeOwned[i] = 1;
+			sendKeys[edgeKeyRank(globalEdgeKey(i))].push_back(globalEdgeKey(i));
+		}
+	}
+	for(i = 0; i < (int)vertices.size(); i++){
+		localVertexOwned[i] = (lowestCellOwner(cellsOnVertex, i) == mpiRank);
+	}
+
+	// Number the keys of each range, after those of the ranks before.
+	exchangeValues(sendKeys, sortedKeys, counts);
+	sort(sortedKeys.begin(), sortedKeys.end());
+	nSorted = sortedKeys.size();
+	i = (adjacent_find(sortedKeys.begin(), sortedKeys.end()) != sortedKeys.end());
+	if(i){
+		cerr << "Rank " << mpiRank << ": ERROR: An edge is owned by more than one rank." << endl;
+	}
+	if(globalError(i)) return 1;
+	offset = 0;
+	MPI_Exscan(&nSorted, &offset, 1, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+	if(mpiRank == 0) offset = 0;
+
+	// Every element has to be owned exactly once.
+	counted[0] = 0;
+	counted[1] = nSorted;
+	counted[2] = 0;
+	globalMaxEdges = 0;
+	for(i = 0; i < (int)cells.size(); i++){
+		if(localCellOwner[i] == mpiRank){
+			counted[0]++;
+			globalMaxEdges = max(globalMaxEdges, edgesOnCell.size(i));
+		}
+	}
+	for(i = 0; i < (int)vertices.size(); i++){
+		counted[2] += localVertexOwned[i];
+	}
+	MPI_Allreduce(counted, totals, 3, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+	MPI_Allreduce(MPI_IN_PLACE, &globalMaxEdges, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+	nGlobalEdges = totals[1];
+
+	cout << "Built " << nGlobalEdges << " edges." << endl;
+
+	// Edge indices are handed out as ints below.
+	if(checkGlobalCount("edges", nGlobalEdges)) return 1;
+
+	if(totals[0] != nGlobalCells || totals[2] != nGlobalVertices){
+		if(mpiRank == 0){
+			cerr << "ERROR: " << totals[0] << " of " << nGlobalCells << " cells and " << totals[2] << " of "
+				<< nGlobalVertices << " vertices are owned by a rank." << endl;
+		}
+		return 1;
+	}
+
+	// Look up every edge an owned element refers to.
+	for(i = 0; i < (int)cells.size(); i++){
+		if(localCellOwner[i] != mpiRank) continue;
+		for(j = 0; j < edgesOnCell.size(i); j++){
+			if(edgesOnCell.at(i, j) >= 0) needed[edgesOnCell.at(i, j)] = 1;
+		}
+	}
+	for(i = 0; i < (int)vertices.size(); i++){
+		if(!localVertexOwned[i]) continue;
+		for(j = 0; j < edgesOnVertex.size(i); j++){
+			if(edgesOnVertex.at(i, j) >= 0) needed[edgesOnVertex.at(i, j)] = 1;
+		}
+	}
+	for(i = 0; i < nLocalEdges; i++){
+		if(!localEdgeOwned[i]) continue;
+		needed[i] = 1;
+		for(j = 0; j < edgesOnEdge.size(i); j++){
+			if(edgesOnEdge.at(i, j) >= 0) needed[edgesOnEdge.at(i, j)] = 1;
+		}
+	}
+
+	for(r = 0; r < mpiSize; r++){
+		sendKeys[r].clear();
+	}
+	for(i = 0; i < nLocalEdges; i++){
+		if(needed[i]){
+			r = edgeKeyRank(globalEdgeKey(i));
+			sendKeys[r].push_back(globalEdgeKey(i));
+			localIndex[r].push_back(i);
+		}
+	}
+
+	exchangeValues(sendKeys, requested, counts);
+	pos = 0;
+	for(r = 0; r < mpiSize; r++){
+		for(i = 0; i < counts[r]; i++, pos++){
+			vector<uint64_t>::iterator it = lower_bound(sortedKeys.begin(), sortedKeys.end(), requested[pos]);
+			if(it != sortedKeys.end() && *it == requested[pos]){
+				replies[r].push_back((int)(offset + (it - sortedKeys.begin())));
+			} else {
+				replies[r].push_back(-1);
+			}
+		}
+	}
+	exchangeValues(replies, answers, counts);
+
+	edgeGlobal.assign(nLocalEdges, -1);
+	nMissing = 0;
+	pos = 0;
+	for(r = 0; r < mpiSize; r++){
+		for(i = 0; i < (int)localIndex[r].size(); i++, pos++){
+			edgeGlobal[localIndex[r][i]] = answers[pos];
+			nMissing += (answers[pos] < 0);
+		}
+	}
+	if(nMissing > 0){
+		cerr << "Rank " << mpiRank << ": ERROR: " << nMissing << " edges are not owned by any rank." << endl;
+		return 1;
+	}
+
+	return 0;
+}/*}}}*/
+void copyRow(stride_array<int> &values, const int i, const int width, const vector<int> *globalIndex, const record_buffer *globalIds, int *row){/*{{{*/
+	// Row i of values, mapped to global indices, padded with -1 to width.
+	int j;
+
+	for(j = 0; j < values.size(i) && j < width; j++){
+		const int v = values.at(i, j);
+		if(v < 0){
+			row[j] = v;
+		} else if(globalIndex != NULL){
+			row[j] = (*globalIndex)[v];
+		} else {
+			row[j] = globalIds->id(v);
+		}
+	}
+	for(; j < width; j++){
+		row[j] = -1;
+	}
+}/*}}}*/
+void copyRow(stride_array<double> &values, const int i, const int width, double *row){/*{{{*/
+	int j;
+
+	for(j = 0; j < values.size(i) && j < width; j++){
+		row[j] = values.at(i, j);
+	}
+	for(; j < width; j++){
+		row[j] = values.fill();
+	}
+}/*}}}*/
+void unpackCoordinates(const string &element, const record_buffer &rows, const int64_t first){/*{{{*/
+	// Coordinates as MpasMeshConverter.x writes them: scaled to the sphere
+	// radius, with latitude and longitude, or unchanged (and zero lat/lon) in
+	// the plane. The first three doubles of each row are the coordinates.
+	double *x = &slabDoubles["x" + element][0];
+	double *y = &slabDoubles["y" + element][0];
+	double *z = &slabDoubles["z" + element][0];
+	double *lat = &slabDoubles["lat" + element][0];
+	double *lon = &slabDoubles["lon" + element][0];
+
+	for(int k = 0; k < rows.size(); k++){
+		const double *xyz = rows.double_row(k);
+		const int i = (int)(rows.id(k) - first);
+		pnt p(xyz[0], xyz[1], xyz[2]);
+
+		if(onSphere){
+			x[i] = p.x * radius;
+			y[i] = p.y * radius;
+			z[i] = p.z * radius;
+			lat[i] = p.getLat();
+			lon[i] = p.getLon();
+		} else {
+			x[i] = p.x;
+			y[i] = p.y;
+			z[i] = p.z;
+			lat[i] = 0.0;
+			lon[i] = 0.0;
+		}
+	}
+}/*}}}*/
+int gatherOutputSlabs(){/*{{{*/
+	/*
+	 * gatherOutputSlabs sends the rows of every owned cell, edge and vertex to
+	 * the rank writing the slab they fall in, and unpacks them into one array
+	 * per mesh.nc variable, with 1-based indices.
+	 */
+	const int maxEdges = globalMaxEdges;
+	const int maxEdges2 = 2 * globalMaxEdges;
+	const int vd = vertexDegree;
+	record_buffer cellRows(2 + 3 * maxEdges, 7), edgeRows(6 + maxEdges2, 6 + maxEdges2), vertexRows(3 + 2 * vd, 6 + vd);
+	vector<record_buffer> send;
+	vector<int> counts;
+	int64_t first;
+	int i, j, k, nSlab;
+
+	if(mpiSize * (size_t)maxEdges2 > (size_t)INT_MAX / 8){
+		cerr << "ERROR: maxEdges is too large." << endl;
+		return 1;
+	}
+
+	// Cells: [id, nEdgesOnCell, cellsOnCell, edgesOnCell, verticesOnCell],
+	// [x, y, z, areaCell, meshDensity, cellQuality, gridSpacing]
+	send.assign(mpiSize, cellRows);
+	for(i = 0; i < (int)cells.size(); i++){
+		if(localCellOwner[i] != mpiRank) continue;
+
+		record_buffer &b = send[slabRank(nGlobalCells, localCells.id(i))];
+		const size_t ints = b.ints.size(), doubles = b.doubles.size();
+		b.ints.resize(ints + b.nInts);
+		b.doubles.resize(doubles + b.nDoubles);
+		int *row = &b.ints[ints];
+		double *values = &b.doubles[doubles];
+
+		row[0] = localCells.id(i);
+		row[1] = edgesOnCell.size(i);
+		copyRow(cellsOnCell, i, maxEdges, NULL, &localCells, row + 2);
+		copyRow(edgesOnCell, i, maxEdges, &edgeGlobal, NULL, row + 2 + maxEdges);
+		copyRow(verticesOnCell, i, maxEdges, NULL, &localVertices, row + 2 + 2 * maxEdges);
+		values[0] = cells[i].x;
+		values[1] = cells[i].y;
+		values[2] = cells[i].z;
+		values[3] = areaCell[i];
+		values[4] = meshDensity[i];
+		values[5] = cellQuality[i];
+		values[6] = gridSpacing[i];
+	}
+	exchangeRecords(send, cellRows, counts);
+
+	// Edges: [id, nEdgesOnEdge, cellsOnEdge, verticesOnEdge, edgesOnEdge],
+	// [x, y, z, angleEdge, dcEdge, dvEdge, weightsOnEdge]
+	send.assign(mpiSize, edgeRows);
+	for(i = 0; i < (int)edges.size(); i++){
+		if(!localEdgeOwned[i]) continue;
+
+		record_buffer &b = send[slabRank(nGlobalEdges, edgeGlobal[i])];
+		const size_t ints = b.ints.size(), doubles = b.doubles.size();
+		b.ints.resize(ints + b.nInts);
+		b.doubles.resize(doubles + b.nDoubles);
+		int *row = &b.ints[ints];
+		double *values = &b.doubles[doubles];
+
+		row[0] = edgeGlobal[i];
+		row[1] = edgesOnEdge.size(i);
+		copyRow(cellsOnEdge, i, 2, NULL, &localCells, row + 2);
+		copyRow(verticesOnEdge, i, 2, NULL, &localVertices, row + 4);
+		copyRow(edgesOnEdge, i, maxEdges2, &edgeGlobal, NULL, row + 6);
+		values[0] = edges[i].x;
+		values[1] = edges[i].y;
+		values[2] = edges[i].z;
+		values[3] = angleEdge[i];
+		values[4] = dcEdge[i];
+		values[5] = dvEdge[i];
+		copyRow(weightsOnEdge, i, maxEdges2, values + 6);
+	}
+	exchangeRecords(send, edgeRows, counts);
+
+	// Vertices: [id, cellsOnVertex, edgesOnVertex, boundaryVertex, obtuseTriangle],
+	// [x, y, z, areaTriangle, kiteAreasOnVertex, triangleQuality, triangleAngleQuality]
+	send.assign(mpiSize, vertexRows);
+	for(i = 0; i < (int)vertices.size(); i++){
+		if(!localVertexOwned[i]) continue;
+
+		record_buffer &b = send[slabRank(nGlobalVertices, localVertices.id(i))];
+		const size_t ints = b.ints.size(), doubles = b.doubles.size();
+		b.ints.resize(ints + b.nInts);
+		b.doubles.resize(doubles + b.nDoubles);
+		int *row = &b.ints[ints];
+		double *values = &b.doubles[doubles];
+
+		row[0] = localVertices.id(i);
+		copyRow(cellsOnVertex, i, vd, NULL, &localCells, row + 1);
+		copyRow(edgesOnVertex, i, vd, &edgeGlobal, NULL, row + 1 + vd);
+		row[1 + 2 * vd] = (cellsOnVertex.size(i) == vd) ? 0 : 1;
+		row[2 + 2 * vd] = obtuseTriangle[i];
+		values[0] = vertices[i].x;
+		values[1] = vertices[i].y;
+		values[2] = vertices[i].z;
+		values[3] = areaTriangle[i];
+		copyRow(kiteAreasOnVertex, i, vd, values + 4);
+		values[4 + vd] = triangleQuality[i];
+		values[5 + vd] = triangleAngleQuality[i];
+	}
+	exchangeRecords(send, vertexRows, counts);
+	send.clear();
+
+	// The local mesh is not needed any more.
+	mpas_mesh_builder_clear();
+	localCells.clear();
+	localVertices.clear();
+	ownedCells.clear();
+
+	// Unpack the cell slab.
+	first = slabFirst(nGlobalCells, mpiRank);
+	nSlab = (int)(slabFirst(nGlobalCells, mpiRank + 1) - first);
+	if(cellRows.size() != nSlab){
+		cerr << "Rank " << mpiRank << ": ERROR: Received " << cellRows.size() << " of " << nSlab << " cells." << endl;
+		return 1;
+	}
+	for(k = 0; k < nMeshVariables; k++){
+		const string dim0 = meshVariables[k].dim0;
+		const size_t width = (meshVariables[k].dim1 == NULL) ? 1 :
+			(string(meshVariables[k].dim1) == "maxEdges") ? maxEdges :
+			(string(meshVariables[k].dim1) == "maxEdges2") ? maxEdges2 :
+			(string(meshVariables[k].dim1) == "TWO") ? 2 : vd;
+		const int64_t dimLength = (dim0 == "nCells") ? nGlobalCells : (dim0 == "nEdges") ? nGlobalEdges : nGlobalVertices;
+		const int nRows = (int)(slabFirst(dimLength, mpiRank + 1) - slabFirst(dimLength, mpiRank));
+
+		if(meshVariables[k].type == NC_INT){
+			slabInts[meshVariables[k].name].resize((size_t)nRows * width + 1);
+		} else {
+			slabDoubles[meshVariables[k].name].resize((size_t)nRows * width + 1);
+		}
+	}
+	unpackCoordinates("Cell", cellRows, first);
+	{
+		int *indexToCellID = &slabInts["indexToCellID"][0];
+		int *cellsOnCell = &slabInts["cellsOnCell"][0];
+		int *edgesOnCell = &slabInts["edgesOnCell"][0];
+		int *verticesOnCell = &slabInts["verticesOnCell"][0];
+		int *nEdgesOnCell = &slabInts["nEdgesOnCell"][0];
+		double *areaCell = &slabDoubles["areaCell"][0];
+		double *meshDensity = &slabDoubles["meshDensity"][0];
+		double *cellQuality = &slabDoubles["cellQuality"][0];
+		double *gridSpacing = &slabDoubles["gridSpacing"][0];
+
+		for(k = 0; k < cellRows.size(); k++){
+			const int *row = cellRows.int_row(k);
+			const double *values = cellRows.double_row(k);
+			i = (int)(row[0] - first);
+
+			indexToCellID[i] = row[0] + 1;
+			for(j = 0; j < maxEdges; j++){
+				cellsOnCell[(size_t)i * maxEdges + j] = row[2 + j] + 1;
+				edgesOnCell[(size_t)i * maxEdges + j] = row[2 + maxEdges + j] + 1;
+				verticesOnCell[(size_t)i * maxEdges + j] = row[2 + 2 * maxEdges + j] + 1;
+			}
+			nEdgesOnCell[i] = row[1];
+			areaCell[i] = onSphere ? values[3] * radius * radius : values[3];
+			meshDensity[i] = values[4];
+			cellQuality[i] = values[5];
+			gridSpacing[i] = values[6];
+		}
+	}
+	cellRows.clear();
+
+	// Unpack the edge slab.
+	first = slabFirst(nGlobalEdges, mpiRank);
+	nSlab = (int)(slabFirst(nGlobalEdges, mpiRank + 1) - first);
+	if(edgeRows.size() != nSlab){
+		cerr << "Rank " << mpiRank << ": ERROR: Received " << edgeRows.size() << " of " << nSlab << " edges." << endl;
+		return 1;
+	}
+	unpackCoordinates("Edge", edgeRows, first);
+	{
+		int *indexToEdgeID = &slabInts["indexToEdgeID"][0];
+		int *cellsOnEdge = &slabInts["cellsOnEdge"][0];
+		int *verticesOnEdge = &slabInts["verticesOnEdge"][0];
+		int *edgesOnEdge = &slabInts["edgesOnEdge"][0];
+		int *nEdgesOnEdge = &slabInts["nEdgesOnEdge"][0];
+		double *weightsOnEdge = &slabDoubles["weightsOnEdge"][0];
+		double *angleEdge = &slabDoubles["angleEdge"][0];
+		double *dcEdge = &slabDoubles["dcEdge"][0];
+		double *dvEdge = &slabDoubles["dvEdge"][0];
+
+		for(k = 0; k < edgeRows.size(); k++){
+			const int *row = edgeRows.int_row(k);
+			const double *values = edgeRows.double_row(k);
+			i = (int)(row[0] - first);
+
+			indexToEdgeID[i] = row[0] + 1;
+			for(j = 0; j < 2; j++){
+				cellsOnEdge[(size_t)i * 2 + j] = row[2 + j] + 1;
+				verticesOnEdge[(size_t)i * 2 + j] = row[4 + j] + 1;
+			}
+			for(j = 0; j < maxEdges2; j++){
+				edgesOnEdge[(size_t)i * maxEdges2 + j] = row[6 + j] + 1;
+				weightsOnEdge[(size_t)i * maxEdges2 + j] = values[6 + j];
+			}
+			nEdgesOnEdge[i] = row[1];
+			angleEdge[i] = values[3];
+			dcEdge[i] = onSphere ? values[4] * radius : values[4];
+			dvEdge[i] = onSphere ? values[5] * radius : values[5];
+		}
+	}
+	edgeRows.clear();
+
+	// Unpack the vertex slab.
+	first = slabFirst(nGlobalVertices, mpiRank);
+	nSlab = (int)(slabFirst(nGlobalVertices, mpiRank + 1) - first);
+	if(vertexRows.size() != nSlab){
+		cerr << "Rank " << mpiRank << ": ERROR: Received " << vertexRows.size() << " of " << nSlab << " vertices." << endl;
+		return 1;
+	}
+	unpackCoordinates("Vertex", vertexRows, first);
+	{
+		int *indexToVertexID = &slabInts["indexToVertexID"][0];
+		int *cellsOnVertex = &slabInts["cellsOnVertex"][0];
+		int *edgesOnVertex = &slabInts["edgesOnVertex"][0];
+		int *boundaryVertex = &slabInts["boundaryVertex"][0];
+		int *obtuseTriangle = &slabInts["obtuseTriangle"][0];
+		double *kiteAreasOnVertex = &slabDoubles["kiteAreasOnVertex"][0];
+		double *areaTriangle = &slabDoubles["areaTriangle"][0];
+		double *triangleQuality = &slabDoubles["triangleQuality"][0];
+		double *triangleAngleQuality = &slabDoubles["triangleAngleQuality"][0];
+
+		for(k = 0; k < vertexRows.size(); k++){
+			const int *row = vertexRows.int_row(k);
+			const double *values = vertexRows.double_row(k);
+			i = (int)(row[0] - first);
+
+			indexToVertexID[i] = row[0] + 1;
+			for(j = 0; j < vd; j++){
+				cellsOnVertex[(size_t)i * vd + j] = row[1 + j] + 1;
+				edgesOnVertex[(size_t)i * vd + j] = row[1 + vd + j] + 1;
+				kiteAreasOnVertex[(size_t)i * vd + j] = onSphere ? values[4 + j] * radius * radius : values[4 + j];
+			}
+			boundaryVertex[i] = row[1 + 2 * vd];
+			obtuseTriangle[i] = row[2 + 2 * vd];
+			areaTriangle[i] = onSphere ? values[3] * radius * radius : values[3];
+			triangleQuality[i] = values[4 + vd];
+			triangleAngleQuality[i] = values[5 + vd];
+		}
+	}
+	vertexRows.clear();
+
+	return 0;
+}/*}}}*/
+/*}}}*/
+
+/* Output functions {{{ */
+int defineMeshFile(const int ncid, const string outputFilename, const string inputFilename, const string fileId, const bool collective){/*{{{*/
+	/*
+	 * defineMeshFile adds the dimensions, global attributes and variables of
+	 * mesh.nc, in the same order as MpasMeshConverter.x, and leaves define
+	 * mode with the same free space after the header. With collective, every
+	 * rank has to call it, since leaving define mode is a collective call.
+	 */
+	int dimids[8], varDims[2], varid, status, oldFill;
+	int error = 0;
+	string history_str, parent_str;
+	char mesh_spec_str[1024];
+	const char *dimNames[8] = {"nCells", "nEdges", "nVertices", "maxEdges", "maxEdges2", "TWO", "vertexDegree", "Time"};
+	const size_t dimSizes[8] = {(size_t)nGlobalCells, (size_t)nGlobalEdges, (size_t)nGlobalVertices, (size_t)globalMaxEdges,
+		(size_t)globalMaxEdges * 2, 2, (size_t)vertexDegree, NC_UNLIMITED};
+	const double zero = 0.0;
+	int d, k;
+
+	status = NC_NOERR;
+	for(d = 0; d < 8 && status == NC_NOERR; d++){
+		status = nc_def_dim(ncid, dimNames[d], dimSizes[d], &dimids[d]);
+	}
+
+	if(!onSphere){
+		if(status == NC_NOERR) status = nc_put_att_text(ncid, NC_GLOBAL, "on_a_sphere", 2, "NO");
+		if(status == NC_NOERR) status = nc_put_att_double(ncid, NC_GLOBAL, "sphere_radius", NC_DOUBLE, 1, &zero);
+	} else {
+		if(status == NC_NOERR) status = nc_put_att_text(ncid, NC_GLOBAL, "on_a_sphere", 3, "YES");
+		if(status == NC_NOERR) status = nc_put_att_double(ncid, NC_GLOBAL, "sphere_radius", NC_DOUBLE, 1, &radius);
+	}
+
+	if(!isPeriodic){
+		if(status == NC_NOERR) status = nc_put_att_text(ncid, NC_GLOBAL, "is_periodic", 2, "NO");
+	} else {
+		if(status == NC_NOERR) status = nc_put_att_text(ncid, NC_GLOBAL, "is_periodic", 3, "YES");
+		if(status == NC_NOERR) status = nc_put_att_double(ncid, NC_GLOBAL, "x_period", NC_DOUBLE, 1, &xPeriodIn);
+		if(status == NC_NOERR) status = nc_put_att_double(ncid, NC_GLOBAL, "y_period", NC_DOUBLE, 1, &yPeriodIn);
+	}
+
+	// The same provenance as MpasMeshConverter.x writes, so both tools'
+	// meshes are interchangeable.
+	history_str = "MpasMeshConverter.x " + inputFilename + " " + outputFilename;
+	if(in_history != ""){
+		history_str += "\n" + in_history;
+	}
+	if(in_file_id != ""){
+		parent_str = in_file_id;
+		if(in_parent_id != ""){
+			parent_str += "\n" + in_parent_id;
+		}
+		if(status == NC_NOERR) status = nc_put_att_text(ncid, NC_GLOBAL, "parent_id", parent_str.size(), parent_str.c_str());
+	}
+	sprintf(mesh_spec_str, "%2.1lf", (double)MESH_SPEC);
+
+	if(status == NC_NOERR) status = nc_put_att_text(ncid, NC_GLOBAL, "history", history_str.size(), history_str.c_str());
+	if(status == NC_NOERR) status = nc_put_att_text(ncid, NC_GLOBAL, "mesh_spec", strlen(mesh_spec_str), mesh_spec_str);
+	if(status == NC_NOERR) status = nc_put_att_text(ncid, NC_GLOBAL, "Conventions", 4, "MPAS");
+	if(status == NC_NOERR) status = nc_put_att_text(ncid, NC_GLOBAL, "source", 19, "MpasMeshConverter.x");
+	if(status == NC_NOERR) status = nc_put_att_text(ncid, NC_GLOBAL, "file_id", fileId.size(), fileId.c_str());
+
+	for(k = 0; k < nMeshVariables && status == NC_NOERR; k++){
+		const int nDims = (meshVariables[k].dim1 == NULL) ? 1 : 2;
+
+		for(d = 0; d < nDims; d++){
+			const char *name = (d == 0) ? meshVariables[k].dim0 : meshVariables[k].dim1;
+			status = nc_inq_dimid(ncid, name, &varDims[d]);
+		}
+		if(status == NC_NOERR) status = nc_def_var(ncid, meshVariables[k].name,
+				netcdf_mpas_output_type(outputFormat, meshVariables[k].name, meshVariables[k].type), nDims, varDims, &varid);
+		if(status == NC_NOERR && outputFormat.cmode == NC_NETCDF4){
+			status = netcdf_mpas_define_storage(ncid, varid, outputFormat);
+		}
+	}
+
+	if(status == NC_NOERR) status = nc_set_fill(ncid, NC_NOFILL, &oldFill);
+	if(collective) error = globalError(status != NC_NOERR);
+	if(status == NC_NOERR && !error) status = nc__enddef(ncid, HEADER_PAD, 4, 0, 4);
+
+	if(status != NC_NOERR){
+		cerr << "Rank " << mpiRank << ": ERROR: Could not define " << outputFilename << ": " << nc_strerror(status) << endl;
+		return 1;
+	}
+
+	return error;
+}/*}}}*/
+int writeMeshSlabs(const int ncid, const bool collective){/*{{{*/
+	/*
+	 * writeMeshSlabs writes this rank's slab of every variable, and frees
+	 * each slab once it is written. With
+	 * collective, every rank has to call it at the same time, even if its
+	 * slabs are empty, and the ranks agree on errors before and after each
+	 * write, so that they all stop at the same variable.
+	 */
+	size_t start[2], count[2], dimLength;
+	int varid, dimids[2], nDims, status;
+	int error = 0;
+	double dummyDouble = 0.0;
+	int dummyInt = 0;
+	int k;
+
+	status = NC_NOERR;
+	for(k = 0; k < nMeshVariables && !error; k++){
+		const string name = meshVariables[k].name;
+
+		status = nc_inq_varid(ncid, name.c_str(), &varid);
+		if(status == NC_NOERR) status = nc_inq_varndims(ncid, varid, &nDims);
+		if(status == NC_NOERR) status = nc_inq_vardimid(ncid, varid, dimids);
+		if(status == NC_NOERR) status = nc_inq_dimlen(ncid, dimids[0], &dimLength);
+		if(status == NC_NOERR){
+			start[0] = slabFirst(dimLength, mpiRank);
+			count[0] = slabFirst(dimLength, mpiRank + 1) - start[0];
+			if(nDims == 2){
+				start[1] = 0;
+				status = nc_inq_dimlen(ncid, dimids[1], &count[1]);
+			}
+		}
+
+#ifdef HAVE_NETCDF_PAR
+		if(collective && status == NC_NOERR) status = nc_var_par_access(ncid, varid, NC_COLLECTIVE);
+#endif
+		error = collective ? globalError(status != NC_NOERR) : (status != NC_NOERR);
+		if(error) break;
+
+		if(meshVariables[k].type == NC_INT){
+			vector<int> &values = slabInts[name];
+			status = nc_put_vara_int(ncid, varid, start, count, values.empty() ? &dummyInt : &values[0]);
+			vector<int>().swap(values);
+		} else {
+			vector<double> &values = slabDoubles[name];
+			status = nc_put_vara_double(ncid, varid, start, count, values.empty() ? &dummyDouble : &values[0]);
+			vector<double>().swap(values);
+		}
+		error = collective ? globalError(status != NC_NOERR) : (status != NC_NOERR);
+	}
+
+	if(status != NC_NOERR){
+		cerr << "Rank " << mpiRank << ": ERROR: Could not write the mesh: " << nc_strerror(status) << endl;
+	}
+
+	return error;
+}/*}}}*/
+int writeMeshFile(const string outputFilename, const string inputFilename){/*{{{*/
+	/*
+	 * writeMeshFile writes mesh.nc collectively if the netCDF library
+	 * supports parallel I/O for the requested format. Otherwise rank 0 defines
+	 * the file, and the ranks then write their slabs one after another.
+	 */
+	char fileId[ID_LEN + 1];
+	int ncid, error, status;
+
+	// file_id is drawn on rank 0, and has to be the same on every rank.
+	if(mpiRank == 0){
+		snprintf(fileId, sizeof(fileId), "%s", gen_random(ID_LEN).c_str());
+	}
+	MPI_Bcast(fileId, ID_LEN + 1, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+#ifdef HAVE_NETCDF_PAR
+	// Compression needs a recent parallel HDF5, so compressed files are
+	// written one rank at a time.
+	if(outputFormat.deflate_level == 0 && !outputFormat.shuffle){
+		status = nc_create_par(outputFilename.c_str(), outputFormat.cmode | NC_CLOBBER, MPI_COMM_WORLD, MPI_INFO_NULL, &ncid);
+		if(globalError(status != NC_NOERR) == 0){
+			cout << "Writing collectively." << endl;
+			error = defineMeshFile(ncid, outputFilename, inputFilename, fileId, true);
+			if(globalError(error) == 0){
+				error = writeMeshSlabs(ncid, true);
+			}
+			nc_close(ncid);
+			return error;
+		}
+		if(status == NC_NOERR){
+			nc_close(ncid);
+		}
+		cout << "The netCDF library cannot write this format in parallel. Writing one rank at a time." << endl;
+	}
+#endif
+
+	error = 0;
+	if(mpiRank == 0){
+		status = nc_create(outputFilename.c_str(), outputFormat.cmode | NC_CLOBBER, &ncid);
+		if(status != NC_NOERR){
+			cerr << "ERROR: Could not create " << outputFilename << ": " << nc_strerror(status) << endl;
+			error = 1;
+		} else {
+			error = defineMeshFile(ncid, outputFilename, inputFilename, fileId, false);
+			nc_close(ncid);
+		}
+	}
+	if(globalError(error)) return 1;
+
+	for(int r = 0; r < mpiSize; r++){
+		if(r == mpiRank){
+			status = nc_open(outputFilename.c_str(), NC_WRITE, &ncid);
+			if(status != NC_NOERR){
+				cerr << "Rank " << mpiRank << ": ERROR: Could not open " << outputFilename << ": " << nc_strerror(status) << endl;
+				error = 1;
+			} else {
+				error = writeMeshSlabs(ncid, false);
+				if(nc_close(ncid) != NC_NOERR) error = 1;
+			}
+		}
+		MPI_Barrier(MPI_COMM_WORLD);
+	}
+
+	return error;
+}/*}}}*/
+int writeGraphFile(const string outputFilename){/*{{{*/
+	/*
+	 * writeGraphFile writes graph.info from the cellsOnCell slabs, one rank
+	 * after another. It has to come before writeMeshFile, which frees them. The slabs are in cell order, so the file is the same as
+	 * MpasMeshConverter.x writes.
+	 */
+	const vector<int> &coc = slabInts["cellsOnCell"];
+	const int nSlab = (int)(slabFirst(nGlobalCells, mpiRank + 1) - slabFirst(nGlobalCells, mpiRank));
+	int64_t edgeCount = 0, totalCount = 0;
+	int error = 0;
+	int i, j;
+
+	for(i = 0; i < nSlab; i++){
+		for(j = 0; j < globalMaxEdges; j++){
+			const int neighbor = coc[(size_t)i * globalMaxEdges + j] - 1;
+			if(neighbor >= 0 && neighbor < nGlobalCells){
+				edgeCount++;
+			}
+		}
+	}
+	MPI_Allreduce(&edgeCount, &totalCount, 1, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+	for(int r = 0; r < mpiSize; r++){
+		if(r == mpiRank){
+			ofstream graph(outputFilename.c_str(), (r == 0) ? ios::out : ios::app);
+
+			if(r == 0){
+				graph << nGlobalCells << " " << totalCount / 2 << endl;
+			}
+			for(i = 0; i < nSlab; i++){
+				for(j = 0; j < globalMaxEdges; j++){
+					const int neighbor = coc[(size_t)i * globalMaxEdges + j] - 1;
+					if(neighbor >= 0){
+						graph << neighbor + 1 << " ";
+					}
+				}
+				graph << endl;
+			}
+
+			graph.close();
+			error = graph.fail();
+		}
+		MPI_Barrier(MPI_COMM_WORLD);
+	}
+
+	return error;
+}/*}}}*/
+/*}}}*/
+
+string gen_random(const int len) {/*{{{*/
+	static const char alphanum[] =
+		"0123456789"
+		"abcdefghijklmnopqrstuvwxyz";
+
+	string rand_str = "";
+
+	for (int i = 0; i < len; ++i) {
+		rand_str += alphanum[rand() % (sizeof(alphanum) - 1)];
+	}
+
+	return rand_str;
+}/*}}}*/
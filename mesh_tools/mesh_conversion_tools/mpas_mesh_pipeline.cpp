@@ -0,0 +1,472 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "netcdf_utils.h"
+#include "pnt.h"
+#include "stride_array.h"
+#include "mesh_partition.h"
+#include "stage_profiler.h"
+#include "mpas_mesh_builder.h"
+#include "mpas_mesh_builder_state.h"
+#include "mpas_mesh_writer.h"
+#include "mpas_mask_creator.h"
+#include "cell_mask_bits.h"
+
+using namespace std;
+using namespace mpas_mesh_builder;
+
+enum { mergeOp, invertOp, preserveOp };
+
+netcdf_mpas_output_format outputFormat;
+vector<int> partitionCounts;
+string profileFilename = "";
+
+vector<int> cullCell;
+
+/* Input functions {{{ */
+int readGridInput(const string inputFilename);
+int mergeCellMasks(const string masksFilename, const int maskOp);
+int buildMaskInputMesh(mask_input_mesh &mesh);
+/*}}}*/
+
+void print_usage(){/*{{{*/
+	cout << endl << endl;
+	cout << "Usage:" << endl;
+	cout << "\tMpasMeshPipeline.x in_file out_file [[-m/-i/-p] masks_name] [[-f/-s] file.geojson] [--masks file] [--reorder M] [--positive_lon] [--threads N] [--partitions N[,N...]] [--profile file] [--format F] [--deflate N] [--shuffle]" << endl;
+	cout << endl;
+	cout << "\t\tRuns MpasMeshConverter.x, MpasCellCuller.x and MpasMaskCreator.x" << endl;
+	cout << "\t\tin one process, without writing the intermediate meshes." << endl;
+	cout << "\t\tin_file:" << endl;
+	cout << "\t\t\tThe input grid, as read by MpasMeshConverter.x. Cells where" << endl;
+	cout << "\t\t\tits cullCell field is 1 are culled." << endl;
+	cout << "\t\tout_file:" << endl;
+	cout << "\t\t\tThe culled MPAS mesh. Its graph is written to culled_graph.info." << endl;
+	cout << "\t\t-m/-i/-p masks_name:" << endl;
+	cout << "\t\t\tCull where the masks are 1 (-m) or 0 (-i), or keep the cells" << endl;
+	cout << "\t\t\twhere they are 1 (-p), as MpasCellCuller.x does. The masks" << endl;
+	cout << "\t\t\tare on the cells of in_file." << endl;
+	cout << "\t\t-f/-s file.geojson:" << endl;
+	cout << "\t\t\tFeatures and seed points to make masks for on the culled mesh," << endl;
+	cout << "\t\t\tas MpasMaskCreator.x does." << endl;
+	cout << "\t\t--masks file:" << endl;
+	cout << "\t\t\tThe file the masks are written to (masks.nc by default). Only" << endl;
+	cout << "\t\t\twritten if -f or -s is given." << endl;
+	cout << "\t\t--reorder hilbert/morton/rcm:" << endl;
+	cout << "\t\t\tRenumber the culled mesh for locality." << endl;
+	cout << "\t\t--positive_lon:" << endl;
+	cout << "\t\t\tThe geojson longitudes range from 0 to 360 degrees." << endl;
+	cout << "\t\t--threads N:" << endl;
+	cout << "\t\t\tUse N OpenMP threads." << endl;
+	printPartitionUsage();
+	printProfileUsage();
+	netcdf_mpas_print_output_usage();
+}/*}}}*/
+
+int main ( int argc, char *argv[] ) {
+	int error;
+	int nThreads = 0;
+	string in_name = "grid.nc";
+	string out_name = "culled_mesh.nc";
+	string masks_name = "masks.nc";
+	string reorder = "";
+	vector<string> cull_names;
+	vector<int> cull_ops;
+	vector<string> mask_files;
+	vector<string> seed_files;
+	vector<string> args;
+
+	cout << endl << endl;
+	cout << "************************************************************" << endl;
+	cout << "MPAS_MESH_PIPELINE:\n";
+	cout << "  C++ version\n";
+	cout << "  Convert a NetCDF grid into a valid MPAS mesh, cull it, and\n";
+	cout << "  create masks for it, without intermediate files.\n";
+	cout << endl << endl;
+	cout << "  Compiled on " << __DATE__ << " at " << __TIME__ << ".\n";
+	cout << "************************************************************" << endl;
+	cout << endl << endl;
+
+	if ( netcdf_mpas_parse_output_flags(argc, argv, outputFormat)
+			|| parsePartitionFlags(argc, argv, partitionCounts)
+			|| parseProfileFlags(argc, argv, profileFilename) ) {
+		print_usage();
+		return 1;
+	}
+
+	for ( int i = 1; i < argc; i++ ) {
+		string str_flag = argv[i];
+		bool needsValue = ( str_flag == "-m" || str_flag == "-i" || str_flag == "-p"
+				|| str_flag == "-f" || str_flag == "-s" || str_flag == "--masks"
+				|| str_flag == "--reorder" || str_flag == "--threads" );
+
+		if ( needsValue && i + 1 >= argc ) {
+			cout << " ERROR: " << str_flag << " requires an argument. See usage statement." << endl;
+			print_usage();
+			return 1;
+		}
+
+		if ( str_flag == "-m" ) {
+			cull_ops.push_back(static_cast<int>(mergeOp));
+			cull_names.push_back(argv[++i]);
+		} else if ( str_flag == "-i" ) {
+			cull_ops.push_back(static_cast<int>(invertOp));
+			cull_names.push_back(argv[++i]);
+		} else if ( str_flag == "-p" ) {
+			cull_ops.push_back(static_cast<int>(preserveOp));
+			cull_names.push_back(argv[++i]);
+		} else if ( str_flag == "-f" ) {
+			mask_files.push_back(argv[++i]);
+		} else if ( str_flag == "-s" ) {
+			seed_files.push_back(argv[++i]);
+		} else if ( str_flag == "--masks" ) {
+			masks_name = argv[++i];
+		} else if ( str_flag == "--reorder" ) {
+			reorder = argv[++i];
+			if ( reorder != "hilbert" && reorder != "morton" && reorder != "rcm" ) {
+				cout << " ERROR: Unknown --reorder " << reorder << ". Use hilbert, morton, or rcm." << endl;
+				return 1;
+			}
+		} else if ( str_flag == "--threads" ) {
+			nThreads = atoi(argv[++i]);
+			if ( nThreads <= 0 ) {
+				cout << " ERROR: --threads requires a positive thread count." << endl;
+				return 1;
+			}
+		} else if ( str_flag == "--positive_lon" ) {
+			mask_creator::lonRangePositive = true;
+		} else if ( str_flag.size() > 1 && str_flag[0] == '-' ) {
+			cout << " ERROR: Invalid flag " << str_flag << " passed in. See usage statement." << endl;
+			print_usage();
+			return 1;
+		} else {
+			args.push_back(str_flag);
+		}
+	}
+
+	if ( args.size() != 2 ) {
+		cout << " ERROR: Incorrect usage. See usage statement." << endl;
+		print_usage();
+		return 1;
+	}
+	in_name = args[0];
+	out_name = args[1];
+
+	if ( in_name == out_name || in_name == masks_name || out_name == masks_name ) {
+		cout << "   ERROR: Input and output names are the same." << endl;
+		return 1;
+	}
+
+	// Check that the input files exist before the mesh is built.
+	{
+		vector<string> inputs;
+		struct stat buffer;
+		bool missing = false;
+
+		inputs.push_back(in_name);
+		inputs.insert(inputs.end(), cull_names.begin(), cull_names.end());
+		inputs.insert(inputs.end(), mask_files.begin(), mask_files.end());
+		inputs.insert(inputs.end(), seed_files.begin(), seed_files.end());
+
+		for ( size_t i = 0; i < inputs.size(); i++ ) {
+			if ( stat( inputs[i].c_str(), &buffer ) != 0 ) {
+				cout << "ERROR: Input file '" << inputs[i] << "' does not exist." << endl;
+				missing = true;
+			}
+		}
+
+		if ( missing ) {
+			cout << "ERROR: One or more missing input files. Exiting..." << endl;
+			return 1;
+		}
+	}
+
+#ifdef _OPENMP
+	if ( nThreads > 0 ) {
+		omp_set_num_threads(nThreads);
+	}
+	cout << "Using " << omp_get_max_threads() << " OpenMP threads." << endl;
+#else
+	if ( nThreads > 1 ) {
+		cout << "WARNING: Compiled without OpenMP support. Ignoring --threads " << nThreads << "." << endl;
+	}
+#endif
+
+	srand(time(NULL));
+
+	cout << "Reading input grid." << endl;
+	profiler.start("readGridInput");
+	error = readGridInput(in_name);
+	if(error) return 1;
+	profiler.stop(cullCell.size(), "cells");
+
+	for ( size_t i = 0; i < cull_names.size(); i++ ) {
+		cout << "Reading in mask information from " << cull_names[i] << "." << endl;
+		profiler.start("mergeCellMasks");
+		error = mergeCellMasks(cull_names[i], cull_ops[i]);
+		if(error) return 1;
+		profiler.stop(cullCell.size(), "cells");
+	}
+
+	error = mpas_mesh_builder_build();
+	if(error) return 1;
+
+	// The masks refer to the cells of the input grid, so cull before any
+	// reordering.
+	cout << "Culling cells, edges, and vertices." << endl;
+	profiler.start("cullMesh");
+	error = mpas_mesh_builder_cull(&cullCell[0]);
+	if(error) return 1;
+	profiler.stop(cullCell.size(), "cells");
+	vector<int>().swap(cullCell);
+
+	if(reorder != ""){
+		cout << "Reordering cells, edges, and vertices (" << reorder << ")." << endl;
+		profiler.start("reorderMesh");
+		error = mpas_mesh_builder_reorder(reorder.c_str());
+		if(error) return 1;
+		profiler.stop(cells.size(), "cells");
+	}
+
+	// The writer releases the mesh as it goes, so the masks are made first.
+	if ( mask_files.size() > 0 || seed_files.size() > 0 ) {
+		mask_input_mesh maskMesh;
+
+		profiler.start("buildMaskInputMesh");
+		buildMaskInputMesh(maskMesh);
+		profiler.stop(cells.size(), "cells");
+
+		mask_creator::outputFormat = outputFormat;
+		mask_creator::setInputMesh(&maskMesh);
+		error = mask_creator::createMasks(out_name, masks_name, mask_files, seed_files);
+		mask_creator::setInputMesh(NULL);
+		profiler.append(mask_creator::profiler);
+		if(error) return error;
+	}
+
+	error = writeMeshFile(out_name, in_name, "MpasMeshPipeline.x", outputFormat);
+	if(error) return error;
+
+	cout << "Write culled_graph.info file" << endl;
+	profiler.start("writeGraphFile");
+	if(error = writeGraphFile("culled_graph.info")){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop(cells.size(), "cells");
+
+	if(!partitionCounts.empty()){
+		cout << "Write culled_graph.info partitions" << endl;
+		profiler.start("writeGraphPartitions");
+		if(error = writeGraphPartitions("culled_graph.info", partitionCounts)){
+			cout << "Error - " << error << endl;
+			return error;
+		}
+		profiler.stop(cells.size() * partitionCounts.size(), "cells");
+	}
+
+	profiler.report(cout);
+	if(profileFilename != ""){
+		if(profiler.write_json(profileFilename, "MpasMeshPipeline.x")) return 1;
+	}
+
+	return 0;
+}
+
+/* Input functions {{{ */
+int readGridInput(const string inputFilename){/*{{{*/
+	/*
+	 * readGridInput reads grid.nc, as MpasMeshConverter.x does, and passes
+	 * it to the MpasMeshBuilder library. cullCell is read as well, and is 0
+	 * everywhere if grid.nc has none.
+	 */
+	int nCells, nVertices, vertexDegree;
+	int error;
+	bool onSphere, isPeriodic;
+	double radius, xPeriodIn, yPeriodIn;
+	vector<double> xcell, ycell, zcell;
+	vector<double> xvertex, yvertex, zvertex;
+	vector<int> cellsonvertex_list;
+	vector<double> density;
+
+#ifdef _DEBUG
+	cout << endl << endl << "Begin function: readGridInput" << endl << endl;
+#endif
+
+	if ( netcdf_mpas_check_dims(inputFilename) ) return 1;
+
+	nCells = netcdf_mpas_read_dim(inputFilename, "nCells");
+	nVertices = netcdf_mpas_read_dim(inputFilename, "nVertices");
+	vertexDegree = netcdf_mpas_read_dim(inputFilename, "vertexDegree");
+	onSphere = netcdf_mpas_read_onsphere(inputFilename);
+	radius = netcdf_mpas_read_sphereradius(inputFilename);
+	in_history = netcdf_mpas_read_history(inputFilename);
+	in_file_id = netcdf_mpas_read_fileid(inputFilename);
+	in_parent_id = netcdf_mpas_read_parentid(inputFilename);
+	isPeriodic = netcdf_mpas_read_isperiodic(inputFilename);
+	xPeriodIn = netcdf_mpas_read_xperiod(inputFilename);
+	yPeriodIn = netcdf_mpas_read_yperiod(inputFilename);
+
+	cout << "Read dimensions:" << endl;
+	cout << "    nCells = " << nCells << endl;
+	cout << "    nVertices = " << nVertices << endl;
+	cout << "    vertexDegree = " << vertexDegree << endl;
+	cout << "    Spherical? = " << onSphere << endl;
+	cout << "    Periodic? = " << isPeriodic << endl;
+	if ( isPeriodic ) {
+		cout << "    x_period = " << xPeriodIn << endl;
+		cout << "    y_period = " << yPeriodIn << endl;
+	}
+
+	xcell.resize(nCells);
+	ycell.resize(nCells);
+	zcell.resize(nCells);
+	netcdf_mpas_read_xyzcell ( inputFilename, nCells, &xcell[0], &ycell[0], &zcell[0] );
+
+	xvertex.resize(nVertices);
+	yvertex.resize(nVertices);
+	zvertex.resize(nVertices);
+	netcdf_mpas_read_xyzvertex ( inputFilename, nVertices, &xvertex[0], &yvertex[0], &zvertex[0] );
+
+	cellsonvertex_list.resize((size_t)nVertices * vertexDegree);
+	netcdf_mpas_read_cellsonvertex ( inputFilename, nVertices, vertexDegree, &cellsonvertex_list[0] );
+
+	density.resize(nCells);
+	netcdf_mpas_read_mesh_density ( inputFilename, nCells, &density[0]);
+
+	cullCell.resize(nCells);
+	netcdf_mpas_read_cullcell ( inputFilename, nCells, &cullCell[0] );
+
+	error = mpas_mesh_builder_set_grid(nCells, nVertices, vertexDegree,
+			&xcell[0], &ycell[0], &zcell[0], &xvertex[0], &yvertex[0], &zvertex[0],
+			&cellsonvertex_list[0], &density[0], onSphere, radius, isPeriodic,
+			xPeriodIn, yPeriodIn);
+
+	return error;
+}/*}}}*/
+int mergeCellMasks(const string masksFilename, const int maskOp){/*{{{*/
+	/*
+	 * mergeCellMasks folds the region, transect and seed masks of
+	 * masksFilename into cullCell, as MpasCellCuller.x does: the masks are
+	 * read as bytes a block at a time, and merged one bit per cell.
+	 */
+	const int nCells = cullCell.size();
+	const size_t maskBudget = (size_t) 64 << 20;
+	const char *maskNames[] = { "cellSeedMask", "regionCellMasks", "transectCellMasks" };
+	vector<uint64_t> cullBits(maskWords(nCells), 0), flattenedMask(maskWords(nCells), 0);
+
+	if ( netcdf_mpas_read_dim(masksFilename, "nCells") != (size_t) nCells ) {
+		cout << " ERROR: " << masksFilename << " does not have the cells of the input grid." << endl;
+		return 1;
+	}
+
+	NcFile masks(masksFilename.c_str(), NcFile::ReadOnly);
+	for ( int i = 0; i < 3; i++ ) {
+		if ( orMaskVariable(masks, maskNames[i], nCells, maskBudget, flattenedMask) ) {
+			cout << " ERROR: Can't read " << maskNames[i] << " from " << masksFilename << "." << endl;
+			return 1;
+		}
+	}
+
+	orMaskRows(&cullCell[0], nCells, 1, &cullBits[0]);
+
+	if ( maskOp == preserveOp ) {
+		preserveMaskBits(cullBits, flattenedMask, nCells);
+	} else {
+		mergeMaskBits(cullBits, flattenedMask, nCells, maskOp == invertOp);
+	}
+
+	#pragma omp parallel for default(shared)
+	for ( int i = 0; i < nCells; i++ ) {
+		cullCell[i] = maskBit(cullBits, i);
+	}
+
+	return 0;
+}/*}}}*/
+int buildMaskInputMesh(mask_input_mesh &mesh){/*{{{*/
+	/*
+	 * buildMaskInputMesh copies the fields MpasMaskCreator.x reads from the
+	 * culled mesh, in the form they would have in out_file.
+	 */
+	const int nEdges = edges.size();
+	const double scale = spherical ? sphereRadius : 1.0;
+
+	mesh.nCells = nCells;
+	mesh.nVertices = nVertices;
+	mesh.nEdges = nEdges;
+	mesh.maxEdges = maxEdges;
+	mesh.vertexDegree = vertex_degree;
+	mesh.spherical = spherical;
+	mesh.sphereRadius = spherical ? sphereRadius : 0.0;
+	mesh.history = in_history;
+	mesh.fileId = in_file_id;
+	mesh.parentId = in_parent_id;
+
+	mesh.latCell.assign(nCells, 0.0);
+	mesh.lonCell.assign(nCells, 0.0);
+	mesh.latVertex.assign(nVertices, 0.0);
+	mesh.lonVertex.assign(nVertices, 0.0);
+	mesh.latEdge.assign(nEdges, 0.0);
+	mesh.lonEdge.assign(nEdges, 0.0);
+	if ( spherical ) {
+		#pragma omp parallel for default(shared)
+		for(int i = 0; i < nCells; i++){
+			mesh.latCell[i] = cells[i].getLat();
+			mesh.lonCell[i] = cells[i].getLon();
+		}
+		#pragma omp parallel for default(shared)
+		for(int i = 0; i < nVertices; i++){
+			mesh.latVertex[i] = vertices[i].getLat();
+			mesh.lonVertex[i] = vertices[i].getLon();
+		}
+		#pragma omp parallel for default(shared)
+		for(int i = 0; i < nEdges; i++){
+			mesh.latEdge[i] = edges[i].getLat();
+			mesh.lonEdge[i] = edges[i].getLon();
+		}
+	}
+
+	mesh.nEdgesOnCell.resize(nCells);
+	mesh.cellsOnCell.assign((size_t)nCells * maxEdges, 0);
+	mesh.edgesOnCell.assign((size_t)nCells * maxEdges, 0);
+	#pragma omp parallel for default(shared)
+	for(int i = 0; i < nCells; i++){
+		mesh.nEdgesOnCell[i] = edgesOnCell.size(i);
+		for(int j = 0; j < edgesOnCell.size(i); j++){
+			mesh.cellsOnCell[(size_t)i * maxEdges + j] = cellsOnCell.at(i, j) + 1;
+			mesh.edgesOnCell[(size_t)i * maxEdges + j] = edgesOnCell.at(i, j) + 1;
+		}
+	}
+
+	mesh.verticesOnEdge.resize((size_t)nEdges * 2);
+	mesh.dcEdge.resize(nEdges);
+	mesh.dvEdge.resize(nEdges);
+	#pragma omp parallel for default(shared)
+	for(int i = 0; i < nEdges; i++){
+		mesh.verticesOnEdge[(size_t)i * 2] = verticesOnEdge.at(i, 0) + 1;
+		mesh.verticesOnEdge[(size_t)i * 2 + 1] = verticesOnEdge.at(i, 1) + 1;
+		mesh.dcEdge[i] = dcEdge[i] * scale;
+		mesh.dvEdge[i] = dvEdge[i] * scale;
+	}
+
+	mesh.edgesOnVertex.assign((size_t)nVertices * vertex_degree, 0);
+	#pragma omp parallel for default(shared)
+	for(int i = 0; i < nVertices; i++){
+		for(int j = 0; j < edgesOnVertex.size(i); j++){
+			mesh.edgesOnVertex[(size_t)i * vertex_degree + j] = edgesOnVertex.at(i, j) + 1;
+		}
+	}
+
+	return 0;
+}/*}}}*/
+/*}}}*/
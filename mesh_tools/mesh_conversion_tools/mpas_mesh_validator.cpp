@@ -0,0 +1,977 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <utility>
+#include <math.h>
+#include <assert.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "netcdf_utils.h"
+#include "pnt.h"
+#include "coord_array.h"
+#include "mesh_geometry.h"
+#include "stage_profiler.h"
+
+using namespace std;
+
+/*
+ * MpasMeshValidator.x checks the connectivity and geometry invariants of an
+ * MPAS mesh, as written by MpasMeshConverter.x, MpasCellCuller.x or
+ * MpasMeshPipeline.x:
+ *
+ *	- indexRanges: every index is in range, and 0 (none) only appears where
+ *	  a mesh boundary allows it.
+ *	- cellEdgeReciprocity, vertexEdgeReciprocity, cellVertexReciprocity:
+ *	  cellsOnEdge/edgesOnCell, verticesOnEdge/edgesOnVertex and
+ *	  cellsOnVertex/verticesOnCell list each other.
+ *	- cellsOnCell: entry j is the cell across edgesOnCell entry j.
+ *	- edgeVertexAlignment: edgesOnCell entry j joins verticesOnCell entries
+ *	  j-1 and j.
+ *	- ccwOrder: vertices around cells and cells around vertices are
+ *	  counter-clockwise, and the tangent from vertex 1 to vertex 2 of an edge
+ *	  points left of the normal from cell 1 to cell 2.
+ *	- edgesOnEdge: interior edges list the other edges of both their cells,
+ *	  and the weights are antisymmetric (w(e,f) dvEdge(e) dcEdge(e) =
+ *	  -w(f,e) dvEdge(f) dcEdge(f)).
+ *	- areas: lengths and areas are positive, areaCell and areaTriangle are
+ *	  the sums of their kite areas, and a closed mesh covers the sphere (or
+ *	  the periodic plane).
+ *
+ * Arrays are read with the netcdf_utils.cpp readers one group at a time, and
+ * released once the checks that need them are done. Each check is one pass
+ * over the elements in parallel.
+ */
+
+// Mesh description {{{
+int nCells, nEdges, nVertices, maxEdges, maxEdges2, vertexDegree;
+bool spherical, periodic;
+double sphereRadius, xPeriod, yPeriod;
+int maxReport = 10;
+double tolerance = 1.0e-6;
+string profileFilename = "";
+stage_profiler profiler;
+// }}}
+
+// Mesh arrays, with 0-based indices and -1 for none {{{
+vector<int> nEdgesOnCell, nEdgesOnEdge;
+vector<int> edgesOnCell, cellsOnCell, verticesOnCell;
+vector<int> cellsOnEdge, verticesOnEdge, edgesOnEdge;
+vector<int> edgesOnVertex, cellsOnVertex;
+vector<double> weightsOnEdge, dcEdge, dvEdge;
+vector<double> areaCell, areaTriangle, kiteAreasOnVertex;
+vector<pnt> cells, vertices;
+// }}}
+
+/*
+ * violation_log collects the violations of one check. Only the first
+ * maxReport violations (by element index) are kept for the report. Checks
+ * run their loops with schedule(static), so each thread sees its elements in
+ * increasing order, and the first maxReport of every thread include the
+ * first maxReport overall.
+ */
+class violation_log {/*{{{*/
+	public:
+		violation_log(const string &name_) : name(name_) {/*{{{*/
+			int nThreads = 1;
+#ifdef _OPENMP
+			nThreads = omp_get_max_threads();
+#endif
+			counts.assign(nThreads, 0);
+			found.resize(nThreads);
+		}/*}}}*/
+
+		void add(const string &element, const int index, const string &message){/*{{{*/
+			int tid = 0;
+#ifdef _OPENMP
+			tid = omp_get_thread_num();
+#endif
+			counts[tid]++;
+			if((int)found[tid].size() < maxReport){
+				ostringstream line;
+				line << element << " " << index + 1 << ": " << message;
+				found[tid].push_back(make_pair(index, line.str()));
+			}
+		}/*}}}*/
+
+		long long report(){/*{{{*/
+			vector< pair<int, string> > all;
+			long long total = 0;
+
+			for(size_t t = 0; t < found.size(); t++){
+				total += counts[t];
+				all.insert(all.end(), found[t].begin(), found[t].end());
+			}
+			sort(all.begin(), all.end());
+
+			cout << "  " << name << ": " << total << " violations" << endl;
+			for(int i = 0; i < (int)all.size() && i < maxReport; i++){
+				cout << "      " << all[i].second << endl;
+			}
+			if(total > maxReport){
+				cout << "      ..." << endl;
+			}
+
+			return total;
+		}/*}}}*/
+
+	private:
+		string name;
+		vector<long long> counts;
+		vector< vector< pair<int, string> > > found;
+};/*}}}*/
+
+/* Reading functions {{{ */
+int readMeshInfo(const string inputFilename);
+void readConnectivity(const string inputFilename, const string field, vector<int> &values, const int nRows, const int nColumns);
+template <class T> void freeVector(vector<T> &values);
+/*}}}*/
+
+/* Checking functions {{{ */
+long long checkCellEdges(const string inputFilename);
+long long checkCellsOnCell(const string inputFilename);
+long long checkVertices(const string inputFilename);
+long long checkCellsOnVertex(const string inputFilename);
+template <class Geometry> long long checkOrientation(const string inputFilename, const Geometry &geometry);
+long long checkAreas(const string inputFilename);
+long long checkEdgesOnEdge(const string inputFilename);
+/*}}}*/
+
+/* Utility functions {{{ */
+inline bool inRange(const int index, const int n){ return index >= 0 && index < n; }
+bool rowContains(const vector<int> &table, const int stride, const int row, const int n, const int value);
+bool closeTo(const double value, const double expected);
+/*}}}*/
+
+void print_usage() {/*{{{*/
+	cout << endl << endl;
+	cout << "Usage:" << endl;
+	cout << "\tMpasMeshValidator.x mesh_file [--max-report N] [--tolerance T] [--threads N] [--profile file]" << endl;
+	cout << endl;
+	cout << "\t\tChecks the connectivity and geometry of an MPAS mesh, and lists the" << endl;
+	cout << "\t\tviolations of each check with the (1-based) element indices." << endl;
+	cout << "\t\tExits with 1 if any check fails." << endl;
+	cout << "\t\t--max-report N:" << endl;
+	cout << "\t\t\tList at most N violations per check (default 10)." << endl;
+	cout << "\t\t--tolerance T:" << endl;
+	cout << "\t\t\tRelative tolerance of the area and weight checks (default 1e-6)." << endl;
+	cout << "\t\t--threads N:" << endl;
+	cout << "\t\t\tUse N OpenMP threads." << endl;
+	printProfileUsage();
+}/*}}}*/
+
+int main ( int argc, char *argv[] ) {
+	int nThreads = 0;
+	long long violations = 0;
+	string in_name = "";
+
+	cout << endl << endl;
+	cout << "************************************************************" << endl;
+	cout << "MPAS_MESH_VALIDATOR:\n";
+	cout << "  C++ version\n";
+	cout << "  Check the connectivity and geometry of an MPAS mesh.\n";
+	cout << endl << endl;
+	cout << "  Compiled on " << __DATE__ << " at " << __TIME__ << ".\n";
+	cout << "************************************************************" << endl;
+	cout << endl << endl;
+
+	if ( parseProfileFlags(argc, argv, profileFilename) ) {
+		print_usage();
+		return 2;
+	}
+
+	for ( int i = 1; i < argc; i++ ) {
+		string str_flag = argv[i];
+
+		if ( str_flag == "--max-report" || str_flag == "--tolerance" || str_flag == "--threads" ) {
+			if ( i + 1 >= argc ) {
+				cout << " ERROR: " << str_flag << " requires an argument." << endl;
+				print_usage();
+				return 2;
+			}
+			if ( str_flag == "--max-report" ) {
+				maxReport = atoi(argv[++i]);
+			} else if ( str_flag == "--tolerance" ) {
+				tolerance = atof(argv[++i]);
+			} else {
+				nThreads = atoi(argv[++i]);
+				if ( nThreads <= 0 ) {
+					cout << " ERROR: --threads requires a positive thread count." << endl;
+					return 2;
+				}
+			}
+		} else if ( in_name == "" && str_flag[0] != '-' ) {
+			in_name = str_flag;
+		} else {
+			cout << " ERROR: Invalid argument " << str_flag << ". See usage statement." << endl;
+			print_usage();
+			return 2;
+		}
+	}
+
+	if ( in_name == "" ) {
+		cout << " ERROR: No mesh file given. See usage statement." << endl;
+		print_usage();
+		return 2;
+	}
+
+#ifdef _OPENMP
+	if ( nThreads > 0 ) {
+		omp_set_num_threads(nThreads);
+	}
+	cout << "Using " << omp_get_max_threads() << " OpenMP threads." << endl;
+#else
+	if ( nThreads > 1 ) {
+		cout << "WARNING: Compiled without OpenMP support. Ignoring --threads " << nThreads << "." << endl;
+	}
+#endif
+
+	profiler.start("readMeshInfo");
+	if ( readMeshInfo(in_name) ) return 2;
+	profiler.stop();
+
+	cout << endl << "Checks:" << endl;
+
+	profiler.start("checkCellEdges");
+	violations += checkCellEdges(in_name);
+	profiler.stop(nCells + nEdges, "elements");
+
+	profiler.start("checkCellsOnCell");
+	violations += checkCellsOnCell(in_name);
+	profiler.stop(nCells, "cells");
+
+	profiler.start("checkVertices");
+	violations += checkVertices(in_name);
+	profiler.stop(nCells + nEdges + nVertices, "elements");
+
+	profiler.start("checkCellsOnVertex");
+	violations += checkCellsOnVertex(in_name);
+	profiler.stop(nCells + nVertices, "elements");
+
+	profiler.start("checkOrientation");
+	if ( spherical ) {
+		violations += checkOrientation(in_name, spherical_geometry());
+	} else if ( periodic ) {
+		violations += checkOrientation(in_name, periodic_planar_geometry(xPeriod, yPeriod));
+	} else {
+		violations += checkOrientation(in_name, planar_geometry());
+	}
+	profiler.stop(nCells + nEdges + nVertices, "elements");
+
+	profiler.start("checkAreas");
+	violations += checkAreas(in_name);
+	profiler.stop(nCells + nEdges + nVertices, "elements");
+
+	profiler.start("checkEdgesOnEdge");
+	violations += checkEdgesOnEdge(in_name);
+	profiler.stop(nEdges, "edges");
+
+	cout << endl;
+	if ( violations == 0 ) {
+		cout << in_name << " passed all checks." << endl;
+	} else {
+		cout << in_name << " has " << violations << " violations." << endl;
+	}
+
+	profiler.report(cout);
+	if(profileFilename != ""){
+		if(profiler.write_json(profileFilename, "MpasMeshValidator.x")) return 2;
+	}
+
+	return ( violations == 0 ) ? 0 : 1;
+}
+
+/* Reading functions {{{ */
+int readMeshInfo(const string inputFilename){/*{{{*/
+	if ( netcdf_mpas_check_dims(inputFilename) ) return 1;
+
+	nCells = netcdf_mpas_read_dim(inputFilename, "nCells");
+	nEdges = netcdf_mpas_read_dim(inputFilename, "nEdges");
+	nVertices = netcdf_mpas_read_dim(inputFilename, "nVertices");
+	maxEdges = netcdf_mpas_read_dim(inputFilename, "maxEdges");
+	maxEdges2 = netcdf_mpas_read_dim(inputFilename, "maxEdges2");
+	vertexDegree = netcdf_mpas_read_dim(inputFilename, "vertexDegree");
+	spherical = netcdf_mpas_read_onsphere(inputFilename);
+	sphereRadius = netcdf_mpas_read_sphereradius(inputFilename);
+	periodic = netcdf_mpas_read_isperiodic(inputFilename);
+	xPeriod = netcdf_mpas_read_xperiod(inputFilename);
+	yPeriod = netcdf_mpas_read_yperiod(inputFilename);
+
+	cout << "Read dimensions:" << endl;
+	cout << "    nCells = " << nCells << endl;
+	cout << "    nEdges = " << nEdges << endl;
+	cout << "    nVertices = " << nVertices << endl;
+	cout << "    maxEdges = " << maxEdges << endl;
+	cout << "    vertexDegree = " << vertexDegree << endl;
+	cout << "    Spherical? = " << spherical << endl;
+	cout << "    Periodic? = " << periodic << endl;
+
+	if ( nCells <= 0 || nEdges <= 0 || nVertices <= 0 || maxEdges <= 0 || vertexDegree <= 0 ) {
+		cout << " ERROR: " << inputFilename << " is missing mesh dimensions." << endl;
+		return 1;
+	}
+
+	return 0;
+}/*}}}*/
+void readConnectivity(const string inputFilename, const string field, vector<int> &values, const int nRows, const int nColumns){/*{{{*/
+	/*
+	 * Reads an index array with the netcdf_utils.cpp reader for field, and
+	 * makes its indices 0-based.
+	 */
+	values.resize((size_t)nRows * nColumns);
+
+	if ( field == "edgesOnCell" ) netcdf_mpas_read_edgesoncell(inputFilename, nRows, nColumns, &values[0]);
+	else if ( field == "cellsOnCell" ) netcdf_mpas_read_cellsoncell(inputFilename, nRows, nColumns, &values[0]);
+	else if ( field == "verticesOnCell" ) netcdf_mpas_read_verticesoncell(inputFilename, nRows, nColumns, &values[0]);
+	else if ( field == "cellsOnEdge" ) netcdf_mpas_read_cellsonedge(inputFilename, nRows, &values[0]);
+	else if ( field == "verticesOnEdge" ) netcdf_mpas_read_verticesonedge(inputFilename, nRows, &values[0]);
+	else if ( field == "edgesOnEdge" ) netcdf_mpas_read_edgesonedge(inputFilename, nRows, nColumns, &values[0]);
+	else if ( field == "edgesOnVertex" ) netcdf_mpas_read_edgesonvertex(inputFilename, nRows, nColumns, &values[0]);
+	else if ( field == "cellsOnVertex" ) netcdf_mpas_read_cellsonvertex(inputFilename, nRows, nColumns, &values[0]);
+	else assert(false);
+
+	#pragma omp parallel for default(shared)
+	for(size_t i = 0; i < values.size(); i++){
+		values[i]--;
+	}
+}/*}}}*/
+template <class T>
+void freeVector(vector<T> &values){/*{{{*/
+	vector<T>().swap(values);
+}/*}}}*/
+/*}}}*/
+
+/* Checking functions {{{ */
+long long checkCellEdges(const string inputFilename){/*{{{*/
+	/*
+	 * Reads nEdgesOnCell, edgesOnCell and cellsOnEdge, checks their ranges,
+	 * and checks that they list each other. areaCell is read here too: the
+	 * converter leaves cells on the boundary of non-periodic planes
+	 * incomplete (areaCell < 0), and their vertices are not checked.
+	 */
+	violation_log ranges("indexRanges (cells and edges)");
+	violation_log reciprocity("cellEdgeReciprocity");
+	long long total;
+
+	nEdgesOnCell.resize(nCells);
+	areaCell.resize(nCells);
+	netcdf_mpas_read_nedgesoncell(inputFilename, nCells, &nEdgesOnCell[0]);
+	netcdf_mpas_read_areacell(inputFilename, nCells, &areaCell[0]);
+	readConnectivity(inputFilename, "edgesOnCell", edgesOnCell, nCells, maxEdges);
+	readConnectivity(inputFilename, "cellsOnEdge", cellsOnEdge, nEdges, 2);
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iCell = 0; iCell < nCells; iCell++){
+		const int minEdges = (areaCell[iCell] < 0.0) ? 1 : 3;
+
+		if(nEdgesOnCell[iCell] < minEdges || nEdgesOnCell[iCell] > maxEdges){
+			ostringstream msg;
+			msg << "nEdgesOnCell is " << nEdgesOnCell[iCell] << ", outside " << minEdges << ".." << maxEdges;
+			ranges.add("cell", iCell, msg.str());
+			nEdgesOnCell[iCell] = max(0, min(nEdgesOnCell[iCell], maxEdges));
+		}
+
+		for(int j = 0; j < nEdgesOnCell[iCell]; j++){
+			int iEdge = edgesOnCell[(size_t)iCell * maxEdges + j];
+
+			if(!inRange(iEdge, nEdges)){
+				ostringstream msg;
+				msg << "edgesOnCell entry " << j + 1 << " is " << iEdge + 1;
+				ranges.add("cell", iCell, msg.str());
+			} else if(!rowContains(cellsOnEdge, 2, iEdge, 2, iCell)){
+				ostringstream msg;
+				msg << "lists edge " << iEdge + 1 << ", which does not list the cell in cellsOnEdge";
+				reciprocity.add("cell", iCell, msg.str());
+			}
+		}
+	}
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iEdge = 0; iEdge < nEdges; iEdge++){
+		for(int j = 0; j < 2; j++){
+			int iCell = cellsOnEdge[(size_t)iEdge * 2 + j];
+
+			// Only the second cell of a boundary edge may be missing.
+			if(!inRange(iCell, nCells) && !(j == 1 && iCell == -1)){
+				ostringstream msg;
+				msg << "cellsOnEdge entry " << j + 1 << " is " << iCell + 1;
+				ranges.add("edge", iEdge, msg.str());
+			} else if(iCell >= 0 && !rowContains(edgesOnCell, maxEdges, iCell, nEdgesOnCell[iCell], iEdge)){
+				ostringstream msg;
+				msg << "lists cell " << iCell + 1 << ", which does not list the edge in edgesOnCell";
+				reciprocity.add("edge", iEdge, msg.str());
+			}
+		}
+	}
+
+	total = ranges.report();
+	total += reciprocity.report();
+	return total;
+}/*}}}*/
+long long checkCellsOnCell(const string inputFilename){/*{{{*/
+	/*
+	 * cellsOnCell entry j has to be the cell on the other side of edgesOnCell
+	 * entry j, or none for boundary edges.
+	 */
+	violation_log neighbours("cellsOnCell");
+
+	readConnectivity(inputFilename, "cellsOnCell", cellsOnCell, nCells, maxEdges);
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iCell = 0; iCell < nCells; iCell++){
+		for(int j = 0; j < nEdgesOnCell[iCell]; j++){
+			int iEdge = edgesOnCell[(size_t)iCell * maxEdges + j];
+			int neighbour = cellsOnCell[(size_t)iCell * maxEdges + j];
+			int expected;
+
+			if(!inRange(iEdge, nEdges)){
+				continue;
+			}
+
+			expected = cellsOnEdge[(size_t)iEdge * 2];
+			if(expected == iCell){
+				expected = cellsOnEdge[(size_t)iEdge * 2 + 1];
+			}
+
+			if(neighbour != expected){
+				ostringstream msg;
+				msg << "cellsOnCell entry " << j + 1 << " is " << neighbour + 1
+					<< ", but the cell across edge " << iEdge + 1 << " is " << expected + 1;
+				neighbours.add("cell", iCell, msg.str());
+			}
+		}
+	}
+
+	freeVector(cellsOnCell);
+
+	return neighbours.report();
+}/*}}}*/
+long long checkVertices(const string inputFilename){/*{{{*/
+	/*
+	 * Reads verticesOnCell, verticesOnEdge and edgesOnVertex. Edge j of a
+	 * cell has to join its vertices j-1 and j, and verticesOnEdge and
+	 * edgesOnVertex have to list each other.
+	 */
+	violation_log ranges("indexRanges (vertices)");
+	violation_log alignment("edgeVertexAlignment");
+	violation_log reciprocity("vertexEdgeReciprocity");
+	long long total;
+
+	readConnectivity(inputFilename, "verticesOnCell", verticesOnCell, nCells, maxEdges);
+	readConnectivity(inputFilename, "verticesOnEdge", verticesOnEdge, nEdges, 2);
+	readConnectivity(inputFilename, "edgesOnVertex", edgesOnVertex, nVertices, vertexDegree);
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iCell = 0; iCell < nCells; iCell++){
+		const int n = nEdgesOnCell[iCell];
+		const int *voc = &verticesOnCell[(size_t)iCell * maxEdges];
+
+		for(int j = 0; j < n; j++){
+			int iEdge = edgesOnCell[(size_t)iCell * maxEdges + j];
+			int vertex1 = voc[(j + n - 1) % n];
+			int vertex2 = voc[j];
+
+			if(!inRange(voc[j], nVertices)){
+				ostringstream msg;
+				msg << "verticesOnCell entry " << j + 1 << " is " << voc[j] + 1;
+				ranges.add("cell", iCell, msg.str());
+				continue;
+			}
+
+			if(!inRange(iEdge, nEdges) || areaCell[iCell] < 0.0){
+				continue;
+			}
+
+			if(!rowContains(verticesOnEdge, 2, iEdge, 2, vertex1) || !rowContains(verticesOnEdge, 2, iEdge, 2, vertex2)){
+				ostringstream msg;
+				msg << "edgesOnCell entry " << j + 1 << " (edge " << iEdge + 1 << ") does not join vertices "
+					<< vertex1 + 1 << " and " << vertex2 + 1;
+				alignment.add("cell", iCell, msg.str());
+			}
+		}
+	}
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iEdge = 0; iEdge < nEdges; iEdge++){
+		for(int j = 0; j < 2; j++){
+			int iVertex = verticesOnEdge[(size_t)iEdge * 2 + j];
+
+			if(!inRange(iVertex, nVertices)){
+				ostringstream msg;
+				msg << "verticesOnEdge entry " << j + 1 << " is " << iVertex + 1;
+				ranges.add("edge", iEdge, msg.str());
+			} else if(!rowContains(edgesOnVertex, vertexDegree, iVertex, vertexDegree, iEdge)){
+				ostringstream msg;
+				msg << "lists vertex " << iVertex + 1 << ", which does not list the edge in edgesOnVertex";
+				reciprocity.add("edge", iEdge, msg.str());
+			}
+		}
+	}
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iVertex = 0; iVertex < nVertices; iVertex++){
+		for(int j = 0; j < vertexDegree; j++){
+			int iEdge = edgesOnVertex[(size_t)iVertex * vertexDegree + j];
+
+			if(iEdge == -1){
+				continue;
+			}
+
+			if(!inRange(iEdge, nEdges)){
+				ostringstream msg;
+				msg << "edgesOnVertex entry " << j + 1 << " is " << iEdge + 1;
+				ranges.add("vertex", iVertex, msg.str());
+			} else if(!rowContains(verticesOnEdge, 2, iEdge, 2, iVertex)){
+				ostringstream msg;
+				msg << "lists edge " << iEdge + 1 << ", which does not list the vertex in verticesOnEdge";
+				reciprocity.add("vertex", iVertex, msg.str());
+			}
+		}
+	}
+
+	freeVector(edgesOnVertex);
+
+	total = ranges.report();
+	total += alignment.report();
+	total += reciprocity.report();
+	return total;
+}/*}}}*/
+long long checkCellsOnVertex(const string inputFilename){/*{{{*/
+	/*
+	 * cellsOnVertex and verticesOnCell have to list each other.
+	 */
+	violation_log ranges("indexRanges (cellsOnVertex)");
+	violation_log reciprocity("cellVertexReciprocity");
+	long long total;
+
+	readConnectivity(inputFilename, "cellsOnVertex", cellsOnVertex, nVertices, vertexDegree);
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iVertex = 0; iVertex < nVertices; iVertex++){
+		for(int j = 0; j < vertexDegree; j++){
+			int iCell = cellsOnVertex[(size_t)iVertex * vertexDegree + j];
+
+			if(iCell == -1){
+				continue;
+			}
+
+			if(!inRange(iCell, nCells)){
+				ostringstream msg;
+				msg << "cellsOnVertex entry " << j + 1 << " is " << iCell + 1;
+				ranges.add("vertex", iVertex, msg.str());
+			} else if(areaCell[iCell] >= 0.0 && !rowContains(verticesOnCell, maxEdges, iCell, nEdgesOnCell[iCell], iVertex)){
+				ostringstream msg;
+				msg << "lists cell " << iCell + 1 << ", which does not list the vertex in verticesOnCell";
+				reciprocity.add("vertex", iVertex, msg.str());
+			}
+		}
+	}
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iCell = 0; iCell < nCells; iCell++){
+		for(int j = 0; j < nEdgesOnCell[iCell]; j++){
+			int iVertex = verticesOnCell[(size_t)iCell * maxEdges + j];
+
+			if(areaCell[iCell] >= 0.0 && inRange(iVertex, nVertices) && !rowContains(cellsOnVertex, vertexDegree, iVertex, vertexDegree, iCell)){
+				ostringstream msg;
+				msg << "lists vertex " << iVertex + 1 << ", which does not list the cell in cellsOnVertex";
+				reciprocity.add("cell", iCell, msg.str());
+			}
+		}
+	}
+
+	total = ranges.report();
+	total += reciprocity.report();
+	return total;
+}/*}}}*/
+template <class Geometry>
+long long checkOrientation(const string inputFilename, const Geometry &geometry){/*{{{*/
+	/*
+	 * Reads the cell and vertex locations, and checks that
+	 * complete cells list their vertices counter-clockwise, vertices with all
+	 * their cells list them counter-clockwise, and k x (cell 2 - cell 1)
+	 * points along vertex 2 - vertex 1 on interior edges. Periodic meshes are
+	 * unwrapped around each element first.
+	 */
+	violation_log ccw("ccwOrder");
+	vector<double> x, y, z;
+
+	x.resize(nCells);
+	y.resize(nCells);
+	z.resize(nCells);
+	netcdf_mpas_read_xyzcell(inputFilename, nCells, &x[0], &y[0], &z[0]);
+	cells.resize(nCells);
+	#pragma omp parallel for default(shared)
+	for(int i = 0; i < nCells; i++){
+		cells[i] = pnt(x[i], y[i], z[i], i);
+	}
+
+	x.resize(nVertices);
+	y.resize(nVertices);
+	z.resize(nVertices);
+	netcdf_mpas_read_xyzvertex(inputFilename, nVertices, &x[0], &y[0], &z[0]);
+	vertices.resize(nVertices);
+	#pragma omp parallel for default(shared)
+	for(int i = 0; i < nVertices; i++){
+		vertices[i] = pnt(x[i], y[i], z[i], i);
+	}
+	freeVector(x);
+	freeVector(y);
+	freeVector(z);
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iCell = 0; iCell < nCells; iCell++){
+		const int n = nEdgesOnCell[iCell];
+		const int *voc = &verticesOnCell[(size_t)iCell * maxEdges];
+		const pnt &center = cells[iCell];
+		const pnt normal = geometry.normal(center);
+		bool valid = (areaCell[iCell] > 0.0);
+
+		for(int j = 0; j < n && valid; j++){
+			valid = inRange(voc[j], nVertices);
+		}
+
+		for(int j = 0; j < n && valid; j++){
+			pnt v1 = vertices[voc[j]];
+			pnt v2 = vertices[voc[(j + 1) % n]];
+
+			geometry.fixPeriodicity(v1, center);
+			geometry.fixPeriodicity(v2, center);
+			if((v1 - center).cross(v2 - center).dot(normal) <= 0.0){
+				ostringstream msg;
+				msg << "verticesOnCell entries " << j + 1 << " and " << (j + 1) % n + 1 << " are not counter-clockwise";
+				ccw.add("cell", iCell, msg.str());
+				break;
+			}
+		}
+	}
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iVertex = 0; iVertex < nVertices; iVertex++){
+		const int *cov = &cellsOnVertex[(size_t)iVertex * vertexDegree];
+		const pnt &center = vertices[iVertex];
+		const pnt normal = geometry.normal(center);
+		bool valid = true;
+
+		for(int j = 0; j < vertexDegree && valid; j++){
+			valid = inRange(cov[j], nCells);
+		}
+
+		for(int j = 0; j < vertexDegree && valid; j++){
+			pnt c1 = cells[cov[j]];
+			pnt c2 = cells[cov[(j + 1) % vertexDegree]];
+
+			geometry.fixPeriodicity(c1, center);
+			geometry.fixPeriodicity(c2, center);
+			if((c1 - center).cross(c2 - center).dot(normal) <= 0.0){
+				ostringstream msg;
+				msg << "cellsOnVertex entries " << j + 1 << " and " << (j + 1) % vertexDegree + 1 << " are not counter-clockwise";
+				ccw.add("vertex", iVertex, msg.str());
+				break;
+			}
+		}
+	}
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iEdge = 0; iEdge < nEdges; iEdge++){
+		const int *coe = &cellsOnEdge[(size_t)iEdge * 2];
+		const int *voe = &verticesOnEdge[(size_t)iEdge * 2];
+
+		if(!inRange(coe[0], nCells) || !inRange(coe[1], nCells) || !inRange(voe[0], nVertices) || !inRange(voe[1], nVertices)){
+			continue;
+		}
+
+		pnt c1 = cells[coe[0]];
+		pnt c2 = cells[coe[1]];
+		pnt v1 = vertices[voe[0]];
+		pnt v2 = vertices[voe[1]];
+
+		geometry.fixPeriodicity(c2, c1);
+		geometry.fixPeriodicity(v1, c1);
+		geometry.fixPeriodicity(v2, c1);
+		if(geometry.normal(c1).cross(c2 - c1).dot(v2 - v1) <= 0.0){
+			ccw.add("edge", iEdge, "the tangent from vertex 1 to vertex 2 points right of the normal from cell 1 to cell 2");
+		}
+	}
+
+	freeVector(cells);
+	freeVector(vertices);
+	freeVector(verticesOnEdge);
+
+	return ccw.report();
+}/*}}}*/
+long long checkAreas(const string inputFilename){/*{{{*/
+	/*
+	 * Checks that lengths and areas are positive, that areaCell and
+	 * areaTriangle are the sums of their kites, and that a mesh without
+	 * boundaries covers the sphere or the periodic plane. Cells with
+	 * areaCell < 0 were left incomplete by the converter, and are only
+	 * counted.
+	 */
+	violation_log areas("areas");
+	double cellSum = 0.0, triangleSum = 0.0, expectedSum = 0.0;
+	long long incomplete = 0, boundaryEdges = 0;
+	long long total;
+
+	areaTriangle.resize(nVertices);
+	kiteAreasOnVertex.resize((size_t)nVertices * vertexDegree);
+	dcEdge.resize(nEdges);
+	dvEdge.resize(nEdges);
+	netcdf_mpas_read_areatriangle(inputFilename, nVertices, &areaTriangle[0]);
+	netcdf_mpas_read_kiteareasonvertex(inputFilename, nVertices, vertexDegree, &kiteAreasOnVertex[0]);
+	netcdf_mpas_read_dcedge(inputFilename, nEdges, &dcEdge[0]);
+	netcdf_mpas_read_dvedge(inputFilename, nEdges, &dvEdge[0]);
+
+	#pragma omp parallel for default(shared) schedule(static) reduction(+:triangleSum)
+	for(int iVertex = 0; iVertex < nVertices; iVertex++){
+		double kites = 0.0;
+
+		for(int j = 0; j < vertexDegree; j++){
+			kites += kiteAreasOnVertex[(size_t)iVertex * vertexDegree + j];
+		}
+		triangleSum += areaTriangle[iVertex];
+
+		if(areaTriangle[iVertex] <= 0.0){
+			ostringstream msg;
+			msg << "areaTriangle is " << areaTriangle[iVertex];
+			areas.add("vertex", iVertex, msg.str());
+		} else if(!closeTo(kites, areaTriangle[iVertex])){
+			ostringstream msg;
+			msg << "areaTriangle is " << areaTriangle[iVertex] << ", but its kites add up to " << kites;
+			areas.add("vertex", iVertex, msg.str());
+		}
+	}
+
+	// Each cell gathers its kites from its own vertices, so the sums need no
+	// atomics.
+	#pragma omp parallel for default(shared) schedule(static) reduction(+:cellSum, incomplete)
+	for(int iCell = 0; iCell < nCells; iCell++){
+		double kites = 0.0;
+
+		if(areaCell[iCell] < 0.0){
+			incomplete++;
+			continue;
+		}
+		cellSum += areaCell[iCell];
+
+		for(int j = 0; j < nEdgesOnCell[iCell]; j++){
+			int iVertex = verticesOnCell[(size_t)iCell * maxEdges + j];
+
+			if(!inRange(iVertex, nVertices)){
+				continue;
+			}
+
+			for(int k = 0; k < vertexDegree; k++){
+				if(cellsOnVertex[(size_t)iVertex * vertexDegree + k] == iCell){
+					kites += kiteAreasOnVertex[(size_t)iVertex * vertexDegree + k];
+				}
+			}
+		}
+
+		if(areaCell[iCell] == 0.0){
+			areas.add("cell", iCell, "areaCell is 0");
+		} else if(!closeTo(kites, areaCell[iCell])){
+			ostringstream msg;
+			msg << "areaCell is " << areaCell[iCell] << ", but its kites add up to " << kites;
+			areas.add("cell", iCell, msg.str());
+		}
+	}
+
+	#pragma omp parallel for default(shared) schedule(static) reduction(+:boundaryEdges)
+	for(int iEdge = 0; iEdge < nEdges; iEdge++){
+		if(cellsOnEdge[(size_t)iEdge * 2 + 1] == -1){
+			boundaryEdges++;
+		}
+
+		if(dcEdge[iEdge] <= 0.0 || dvEdge[iEdge] <= 0.0){
+			ostringstream msg;
+			msg << "dcEdge is " << dcEdge[iEdge] << " and dvEdge is " << dvEdge[iEdge];
+			areas.add("edge", iEdge, msg.str());
+		}
+	}
+
+	cout << "  Incomplete cells (areaCell < 0): " << incomplete << ", boundary edges: " << boundaryEdges << endl;
+	cout << "  Sum of areaCell: " << cellSum << ", sum of areaTriangle: " << triangleSum << endl;
+
+	// Only a mesh without boundaries has a known total area.
+	if(boundaryEdges == 0 && incomplete == 0){
+		if(spherical){
+			expectedSum = 4.0 * M_PI * sphereRadius * sphereRadius;
+		} else if(periodic){
+			expectedSum = xPeriod * yPeriod;
+		}
+	}
+
+	if(expectedSum > 0.0){
+		cout << "  Expected total area: " << expectedSum << endl;
+		if(!closeTo(cellSum, expectedSum)){
+			ostringstream msg;
+			msg << "areaCell adds up to " << cellSum << " instead of " << expectedSum;
+			areas.add("mesh", -1, msg.str());
+		}
+		if(!closeTo(triangleSum, expectedSum)){
+			ostringstream msg;
+			msg << "areaTriangle adds up to " << triangleSum << " instead of " << expectedSum;
+			areas.add("mesh", -1, msg.str());
+		}
+	}
+
+	total = areas.report();
+
+	freeVector(verticesOnCell);
+	freeVector(cellsOnVertex);
+	freeVector(areaTriangle);
+	freeVector(kiteAreasOnVertex);
+	return total;
+}/*}}}*/
+long long checkEdgesOnEdge(const string inputFilename){/*{{{*/
+	/*
+	 * Reads nEdgesOnEdge, edgesOnEdge and weightsOnEdge. An interior edge
+	 * lists the other edges of both its cells, each of which lists it back
+	 * unless it is a boundary edge, with antisymmetric weights. Edges that
+	 * lost a cell to the culler keep their rows, with none in place of the
+	 * removed edges, so only the ranges of boundary edges are checked. The
+	 * weights of cells left incomplete by the converter are not checked.
+	 */
+	violation_log ranges("indexRanges (edgesOnEdge)");
+	violation_log neighbours("edgesOnEdge");
+	violation_log weights("weightsOnEdge");
+	long long total;
+
+	nEdgesOnEdge.resize(nEdges);
+	weightsOnEdge.resize((size_t)nEdges * maxEdges2);
+	netcdf_mpas_read_nedgesonedge(inputFilename, nEdges, &nEdgesOnEdge[0]);
+	netcdf_mpas_read_weightsonedge(inputFilename, nEdges, maxEdges2, &weightsOnEdge[0]);
+	readConnectivity(inputFilename, "edgesOnEdge", edgesOnEdge, nEdges, maxEdges2);
+
+	#pragma omp parallel for default(shared) schedule(static)
+	for(int iEdge = 0; iEdge < nEdges; iEdge++){
+		const int *eoe = &edgesOnEdge[(size_t)iEdge * maxEdges2];
+		const double *woe = &weightsOnEdge[(size_t)iEdge * maxEdges2];
+		const int cell1 = cellsOnEdge[(size_t)iEdge * 2];
+		const int cell2 = cellsOnEdge[(size_t)iEdge * 2 + 1];
+		const bool boundary = (cell2 == -1);
+		int n = nEdgesOnEdge[iEdge];
+		bool complete;
+
+		if(n < 0 || n > maxEdges2){
+			ostringstream msg;
+			msg << "nEdgesOnEdge is " << n << ", outside 0.." << maxEdges2;
+			ranges.add("edge", iEdge, msg.str());
+			continue;
+		}
+
+		if(!inRange(cell1, nCells) || !(boundary || inRange(cell2, nCells))){
+			continue;
+		}
+
+		if(!boundary && n != nEdgesOnCell[cell1] + nEdgesOnCell[cell2] - 2){
+			ostringstream msg;
+			msg << "nEdgesOnEdge is " << n << ", but its cells have "
+				<< nEdgesOnCell[cell1] + nEdgesOnCell[cell2] - 2 << " other edges";
+			neighbours.add("edge", iEdge, msg.str());
+		}
+
+		complete = !boundary && areaCell[cell1] > 0.0 && areaCell[cell2] > 0.0;
+
+		for(int j = 0; j < n; j++){
+			const int jEdge = eoe[j];
+
+			if(jEdge == -1 && boundary){
+				continue;
+			}
+
+			if(!inRange(jEdge, nEdges)){
+				ostringstream msg;
+				msg << "edgesOnEdge entry " << j + 1 << " is " << jEdge + 1;
+				ranges.add("edge", iEdge, msg.str());
+				continue;
+			}
+
+			if(boundary){
+				continue;
+			}
+
+			if(jEdge == iEdge ||
+					(!rowContains(edgesOnCell, maxEdges, cell1, nEdgesOnCell[cell1], jEdge) &&
+					 !rowContains(edgesOnCell, maxEdges, cell2, nEdgesOnCell[cell2], jEdge))){
+				ostringstream msg;
+				msg << "edgesOnEdge entry " << j + 1 << " (edge " << jEdge + 1 << ") is not another edge of its cells";
+				neighbours.add("edge", iEdge, msg.str());
+				continue;
+			}
+
+			if(cellsOnEdge[(size_t)jEdge * 2 + 1] == -1){
+				continue;
+			}
+
+			/*
+			 * Find the entry of iEdge in the row of jEdge, and compare the
+			 * weights, scaled by the edge lengths.
+			 */
+			const int *eoeJ = &edgesOnEdge[(size_t)jEdge * maxEdges2];
+			int k = 0;
+			while(k < nEdgesOnEdge[jEdge] && k < maxEdges2 && eoeJ[k] != iEdge){
+				k++;
+			}
+
+			if(k == nEdgesOnEdge[jEdge] || k == maxEdges2){
+				ostringstream msg;
+				msg << "lists edge " << jEdge + 1 << ", which does not list the edge in edgesOnEdge";
+				neighbours.add("edge", iEdge, msg.str());
+				continue;
+			}
+
+			const int jCell1 = cellsOnEdge[(size_t)jEdge * 2];
+			const int jCell2 = cellsOnEdge[(size_t)jEdge * 2 + 1];
+			if(!complete || !inRange(jCell1, nCells) || !inRange(jCell2, nCells) ||
+					areaCell[jCell1] <= 0.0 || areaCell[jCell2] <= 0.0){
+				continue;
+			}
+
+			const double scaleI = dvEdge[iEdge] * dcEdge[iEdge];
+			const double scaleJ = dvEdge[jEdge] * dcEdge[jEdge];
+			const double wI = woe[j] * scaleI;
+			const double wJ = weightsOnEdge[(size_t)jEdge * maxEdges2 + k] * scaleJ;
+			if(fabs(wI + wJ) > tolerance * max(scaleI, scaleJ)){
+				ostringstream msg;
+				msg << "weightsOnEdge entry " << j + 1 << " (edge " << jEdge + 1 << ") is " << woe[j]
+					<< ", which is not antisymmetric with " << weightsOnEdge[(size_t)jEdge * maxEdges2 + k];
+				weights.add("edge", iEdge, msg.str());
+			}
+		}
+	}
+
+	freeVector(nEdgesOnEdge);
+	freeVector(edgesOnEdge);
+	freeVector(weightsOnEdge);
+	freeVector(areaCell);
+
+	total = ranges.report();
+	total += neighbours.report();
+	total += weights.report();
+	return total;
+}/*}}}*/
+/*}}}*/
+
+/* Utility functions {{{ */
+bool rowContains(const vector<int> &table, const int stride, const int row, const int n, const int value){/*{{{*/
+	const int *entries = &table[(size_t)row * stride];
+
+	for(int j = 0; j < n; j++){
+		if(entries[j] == value){
+			return true;
+		}
+	}
+
+	return false;
+}/*}}}*/
+bool closeTo(const double value, const double expected){/*{{{*/
+	return fabs(value - expected) <= tolerance * max(fabs(value), fabs(expected));
+}/*}}}*/
+/*}}}*/
@@ -0,0 +1,972 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <math.h>
+#include <assert.h>
+
+#include "netcdf_utils.h"
+#include "pnt.h"
+#include "stride_array.h"
+#include "mesh_reorder.h"
+#include "mesh_partition.h"
+#include "stage_profiler.h"
+#include "mpas_mesh_builder_state.h"
+#include "mpas_mesh_writer.h"
+
+#define MESH_SPEC 1.0
+#define ID_LEN 10
+
+using namespace std;
+using namespace mpas_mesh_builder;
+
+string in_history = "";
+string in_file_id = "";
+string in_parent_id = "";
+
+// Iterators {{{
+vector<pnt>::iterator pnt_itr;
+// }}}
+
+/* Output functions {{{*/
+int writeMeshFile(const string outputFilename, const string inputFilename, const string toolName, const netcdf_mpas_output_format &format){/*{{{*/
+	/*
+	 * writeMeshFile writes the whole mesh to outputFilename. toolName is
+	 * recorded in the history and source attributes.
+	 */
+	int error;
+
+	//
+	//  The output file is opened once. Dimensions, attributes and variables
+	//  are all defined before any data is written, so the header is laid out
+	//  a single time instead of being grown (and the data section moved) by
+	//  every output function.
+	//
+	netcdf_mpas_output_file grid(outputFilename, NcFile::Replace, format);
+	if(!grid.is_valid()){
+		cout << "Error - could not create " << outputFilename << endl;
+		return 2;
+	}
+
+	cout << "Writing grid dimensions" << endl;
+	profiler.start("outputGridDimensions");
+	if(error = outputGridDimensions(grid)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop();
+	cout << "Writing grid attributes" << endl;
+	profiler.start("outputGridAttributes");
+	if(error = outputGridAttributes(grid, outputFilename, inputFilename, toolName)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop();
+	cout << "Defining grid variables" << endl;
+	profiler.start("defineGridVariables");
+	if(error = defineGridVariables(grid)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop();
+	cout << "Writing grid coordinates" << endl;
+	profiler.start("outputGridCoordinates");
+	if(error = outputGridCoordinates(grid)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop(cells.size() + edges.size() + vertices.size(), "elements");
+	cout << "Writing cell connectivity" << endl;
+	profiler.start("outputCellConnectivity");
+	if(error = outputCellConnectivity(grid)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop(cells.size(), "cells");
+	cout << "Writing edge connectivity" << endl;
+	profiler.start("outputEdgeConnectivity");
+	if(error = outputEdgeConnectivity(grid)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop(edges.size(), "edges");
+	cout << "Writing vertex connectivity" << endl;
+	profiler.start("outputVertexConnectivity");
+	if(error = outputVertexConnectivity(grid)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop(vertices.size(), "vertices");
+	cout << "Writing cell parameters" << endl;
+	profiler.start("outputCellParameters");
+	if(error = outputCellParameters(grid)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop(cells.size(), "cells");
+	cout << "Writing edge parameters" << endl;
+	profiler.start("outputEdgeParameters");
+	if(error = outputEdgeParameters(grid)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop(edges.size(), "edges");
+	cout << "Writing vertex parameters" << endl;
+	profiler.start("outputVertexParameters");
+	if(error = outputVertexParameters(grid)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop(vertices.size(), "vertices");
+
+	cout << "Writing mesh qualities" << endl;
+	profiler.start("outputMeshQualities");
+	if(error = outputMeshQualities(grid)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop(cells.size() + vertices.size(), "elements");
+
+	cout << "Reading and writing meshDensity" << endl;
+	profiler.start("outputMeshDensity");
+	if(error = outputMeshDensity(grid)){
+		cout << "Error - " << error << endl;
+		return error;
+	}
+	profiler.stop(cells.size(), "cells");
+
+	profiler.start("closeOutputFile");
+	grid.close();
+	profiler.stop();
+
+	return 0;
+}/*}}}*/
+int outputGridDimensions( NcFile &grid ){/*{{{*/
+	/************************************************************************
+	 *
+	 * This function writes the grid dimensions to the open output file grid
+	 *
+	 * **********************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+	
+	int junk;
+
+	nCells = cells.size();
+
+	/*
+	for(vec_int_itr = edgesOnCell.begin(); vec_int_itr != edgesOnCell.end(); ++vec_int_itr){
+		maxEdges = std::max(maxEdges, (int)(*vec_int_itr).size());	
+	}*/
+	
+	// define dimensions
+	NcDim *nCellsDim;
+	NcDim *nEdgesDim;
+	NcDim *nVerticesDim;
+	NcDim *maxEdgesDim;
+	NcDim *maxEdges2Dim;
+	NcDim *TWODim;
+	NcDim *THREEDim;
+	NcDim *vertexDegreeDim;
+	NcDim *timeDim;
+	
+	// write dimensions
+	if (!(nCellsDim =		grid.add_dim(	"nCells",		cells.size())		)) return NC_ERR;
+	if (!(nEdgesDim =		grid.add_dim(	"nEdges",		edges.size())		)) return NC_ERR;
+	if (!(nVerticesDim =	grid.add_dim(	"nVertices",	vertices.size())	)) return NC_ERR;
+	if (!(maxEdgesDim =		grid.add_dim(	"maxEdges",		maxEdges)			)) return NC_ERR;
+	if (!(maxEdges2Dim =	grid.add_dim(	"maxEdges2",	maxEdges*2)			)) return NC_ERR;
+	if (!(TWODim =			grid.add_dim(	"TWO",			2)					)) return NC_ERR;
+	if (!(vertexDegreeDim = grid.add_dim(   "vertexDegree", vertex_degree)		)) return NC_ERR;
+	if (!(timeDim = 		grid.add_dim(   "Time")								)) return NC_ERR;
+
+	return 0;
+}/*}}}*/
+int outputGridAttributes( NcFile &grid, const string outputFilename, const string inputFilename, const string toolName ){/*{{{*/
+	/************************************************************************
+	 *
+	 * This function writes the global attributes to the open output file grid
+	 *
+	 * **********************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	char mesh_spec_str[1024];
+	
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+	
+	// check to see if the file was opened
+	if(!grid.is_valid()) return NC_ERR;
+	NcBool sphereAtt, radiusAtt, periodicAtt, xPeriodAtt, yPeriodAtt;
+	NcBool history, id, spec, conventions, source, parent_id;
+	string history_str = "";
+	string id_str = "";
+	string parent_str ="";
+	
+	// write attributes
+	if(!spherical){
+		if (!(sphereAtt = grid.add_att(   "on_a_sphere", "NO\0"))) return NC_ERR;
+		if (!(radiusAtt = grid.add_att(   "sphere_radius", 0.0))) return NC_ERR;
+	} else {
+		if (!(sphereAtt = grid.add_att(   "on_a_sphere", "YES\0"))) return NC_ERR;
+		if (!(radiusAtt = grid.add_att(   "sphere_radius", sphereRadius))) return NC_ERR;
+	}
+
+	if(!periodic){
+		if (!(periodicAtt = grid.add_att(   "is_periodic", "NO\0"))) return NC_ERR;
+	} else {
+		if (!(periodicAtt = grid.add_att(   "is_periodic", "YES\0"))) return NC_ERR;
+		if (!(xPeriodAtt = grid.add_att(   "x_period", xPeriod))) return NC_ERR;
+		if (!(xPeriodAtt = grid.add_att(   "y_period", yPeriod))) return NC_ERR;
+	}
+
+	history_str += toolName;
+	history_str += " ";
+	history_str += inputFilename;
+	history_str += " ";
+	history_str += outputFilename;
+	if(in_history != ""){
+		history_str += "\n";
+		history_str += in_history;
+	}
+
+	if(in_file_id != "" ){
+		parent_str = in_file_id;
+		if(in_parent_id != ""){
+			parent_str += "\n";
+			parent_str += in_parent_id;
+		}
+		if (!(id = grid.add_att(   "parent_id", parent_str.c_str() ))) return NC_ERR;
+	}
+	id_str = gen_random(ID_LEN);
+
+	sprintf(mesh_spec_str, "%2.1lf", (double)MESH_SPEC);
+
+	if (!(history = grid.add_att(   "history", history_str.c_str() ))) return NC_ERR;
+	if (!(spec = grid.add_att(   "mesh_spec", mesh_spec_str ))) return NC_ERR;
+	if (!(conventions = grid.add_att(   "Conventions", "MPAS" ))) return NC_ERR;
+	if (!(source = grid.add_att(   "source", toolName.c_str() ))) return NC_ERR;
+	if (!(id = grid.add_att(   "file_id", id_str.c_str() ))) return NC_ERR;
+
+	return 0;
+}/*}}}*/
+int defineGridVariables( netcdf_mpas_output_file &grid ){/*{{{*/
+	/************************************************************************
+	 *
+	 * This function defines every variable written by the output functions
+	 * below, then takes the file out of define mode. All variables are defined
+	 * in a single pass so the header is only laid out once, and the output
+	 * functions only have to stream data into variables that already exist.
+	 *
+	 * The order here sets the order of the variables in the file, and matches
+	 * the order the output functions are called in.
+	 *
+	 * **********************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+
+	// Free space left in the header for tools that append to the mesh later.
+	static const size_t HEADER_PAD = 16384;
+
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+
+	// fetch dimensions
+	NcDim *nCellsDim = grid.get_dim( "nCells" );
+	NcDim *nEdgesDim = grid.get_dim( "nEdges" );
+	NcDim *nVerticesDim = grid.get_dim( "nVertices" );
+	NcDim *maxEdgesDim = grid.get_dim( "maxEdges" );
+	NcDim *maxEdges2Dim = grid.get_dim( "maxEdges2" );
+	NcDim *twoDim = grid.get_dim( "TWO" );
+	NcDim *vertexDegreeDim = grid.get_dim( "vertexDegree" );
+
+	// Grid coordinates
+	if (!grid.add_var("latCell", ncDouble, nCellsDim)) return NC_ERR;
+	if (!grid.add_var("lonCell", ncDouble, nCellsDim)) return NC_ERR;
+	if (!grid.add_var("xCell", ncDouble, nCellsDim)) return NC_ERR;
+	if (!grid.add_var("yCell", ncDouble, nCellsDim)) return NC_ERR;
+	if (!grid.add_var("zCell", ncDouble, nCellsDim)) return NC_ERR;
+	if (!grid.add_var("indexToCellID", ncInt, nCellsDim)) return NC_ERR;
+	if (!grid.add_var("latEdge", ncDouble, nEdgesDim)) return NC_ERR;
+	if (!grid.add_var("lonEdge", ncDouble, nEdgesDim)) return NC_ERR;
+	if (!grid.add_var("xEdge", ncDouble, nEdgesDim)) return NC_ERR;
+	if (!grid.add_var("yEdge", ncDouble, nEdgesDim)) return NC_ERR;
+	if (!grid.add_var("zEdge", ncDouble, nEdgesDim)) return NC_ERR;
+	if (!grid.add_var("indexToEdgeID", ncInt, nEdgesDim)) return NC_ERR;
+	if (!grid.add_var("latVertex", ncDouble, nVerticesDim)) return NC_ERR;
+	if (!grid.add_var("lonVertex", ncDouble, nVerticesDim)) return NC_ERR;
+	if (!grid.add_var("xVertex", ncDouble, nVerticesDim)) return NC_ERR;
+	if (!grid.add_var("yVertex", ncDouble, nVerticesDim)) return NC_ERR;
+	if (!grid.add_var("zVertex", ncDouble, nVerticesDim)) return NC_ERR;
+	if (!grid.add_var("indexToVertexID", ncInt, nVerticesDim)) return NC_ERR;
+
+	// Cell connectivity
+	if (!grid.add_var("cellsOnCell", ncInt, nCellsDim, maxEdgesDim)) return NC_ERR;
+	if (!grid.add_var("edgesOnCell", ncInt, nCellsDim, maxEdgesDim)) return NC_ERR;
+	if (!grid.add_var("verticesOnCell", ncInt, nCellsDim, maxEdgesDim)) return NC_ERR;
+	if (!grid.add_var("nEdgesOnCell", ncInt, nCellsDim)) return NC_ERR;
+
+	// Edge connectivity
+	if (!grid.add_var("edgesOnEdge", ncInt, nEdgesDim, maxEdges2Dim)) return NC_ERR;
+	if (!grid.add_var("cellsOnEdge", ncInt, nEdgesDim, twoDim)) return NC_ERR;
+	if (!grid.add_var("verticesOnEdge", ncInt, nEdgesDim, twoDim)) return NC_ERR;
+	if (!grid.add_var("nEdgesOnEdge", ncInt, nEdgesDim)) return NC_ERR;
+
+	// Vertex connectivity
+	if (!grid.add_var("cellsOnVertex", ncInt, nVerticesDim, vertexDegreeDim)) return NC_ERR;
+	if (!grid.add_var("edgesOnVertex", ncInt, nVerticesDim, vertexDegreeDim)) return NC_ERR;
+	if (!grid.add_var("boundaryVertex", ncInt, nVerticesDim)) return NC_ERR;
+
+	// Cell parameters
+	if (!grid.add_var("areaCell", ncDouble, nCellsDim)) return NC_ERR;
+
+	// Edge parameters
+	if (!grid.add_var("angleEdge", ncDouble, nEdgesDim)) return NC_ERR;
+	if (!grid.add_var("dcEdge", ncDouble, nEdgesDim)) return NC_ERR;
+	if (!grid.add_var("dvEdge", ncDouble, nEdgesDim)) return NC_ERR;
+	if (!grid.add_var("weightsOnEdge", ncDouble, nEdgesDim, maxEdges2Dim)) return NC_ERR;
+
+	// Vertex parameters
+	if (!grid.add_var("areaTriangle", ncDouble, nVerticesDim)) return NC_ERR;
+	if (!grid.add_var("kiteAreasOnVertex", ncDouble, nVerticesDim, vertexDegreeDim)) return NC_ERR;
+
+	// Mesh qualities
+	if (!grid.add_var("cellQuality", ncDouble, nCellsDim)) return NC_ERR;
+	if (!grid.add_var("gridSpacing", ncDouble, nCellsDim)) return NC_ERR;
+	if (!grid.add_var("triangleQuality", ncDouble, nVerticesDim)) return NC_ERR;
+	if (!grid.add_var("triangleAngleQuality", ncDouble, nVerticesDim)) return NC_ERR;
+	if (!grid.add_var("obtuseTriangle", ncInt, nVerticesDim)) return NC_ERR;
+
+	// Mesh density
+	if (!grid.add_var("meshDensity", ncDouble, nCellsDim)) return NC_ERR;
+
+	if (!grid.end_define(HEADER_PAD)) return NC_ERR;
+
+	return 0;
+}/*}}}*/
+int outputGridCoordinates( NcFile &grid ) {/*{{{*/
+	/************************************************************************
+	 *
+	 * This function writes the grid coordinates to the open output file grid
+	 * This includes all cell centers, vertices, and edges.
+	 * Both cartesian and lat,lon, as well as all of their indices
+	 *
+	 * **********************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+	
+	// fetch dimensions
+	NcDim *nCellsDim = grid.get_dim( "nCells" );
+	NcDim *nEdgesDim = grid.get_dim( "nEdges" );
+	NcDim *nVerticesDim = grid.get_dim( "nVertices" );
+
+	int nCells = nCellsDim->size();
+	int nEdges = nEdgesDim->size();
+	int nVertices = nVerticesDim->size();
+
+	//Define nc variables
+	NcVar *xCellVar, *yCellVar, *zCellVar, *xEdgeVar, *yEdgeVar, *zEdgeVar, *xVertexVar, *yVertexVar, *zVertexVar;
+	NcVar *lonCellVar, *latCellVar, *lonEdgeVar, *latEdgeVar, *lonVertexVar, *latVertexVar;
+	NcVar *idx2cellVar, *idx2edgeVar, *idx2vertexVar;
+
+	int i;
+	
+	double *x, *y, *z, *lat, *lon;
+	int *idxTo;
+
+	// Build and write cell coordinate arrays
+	x = new double[nCells];
+	y = new double[nCells];
+	z = new double[nCells];
+	lat = new double[nCells];
+	lon = new double[nCells];
+	idxTo = new int[nCells];
+	i = 0;
+	for(pnt_itr = cells.begin(); pnt_itr != cells.end(); ++pnt_itr){
+		if(!spherical){
+			x[i] = (*pnt_itr).x;
+			y[i] = (*pnt_itr).y;
+			z[i] = (*pnt_itr).z;
+			lat[i] = 0.0;
+			lon[i] = 0.0;
+		} else {
+			x[i] = (*pnt_itr).x * sphereRadius;
+			y[i] = (*pnt_itr).y * sphereRadius;
+			z[i] = (*pnt_itr).z * sphereRadius;
+			lat[i] = (*pnt_itr).getLat();
+			lon[i] = (*pnt_itr).getLon();
+		}
+		idxTo[i] = (*pnt_itr).idx+1;
+
+		i++;
+	}
+	if (!(latCellVar = grid.get_var("latCell"))) return NC_ERR;
+	if (!latCellVar->put(lat,nCells)) return NC_ERR;
+	if (!(lonCellVar = grid.get_var("lonCell"))) return NC_ERR;
+	if (!lonCellVar->put(lon,nCells)) return NC_ERR;
+	if (!(xCellVar = grid.get_var("xCell"))) return NC_ERR;
+	if (!xCellVar->put(x,nCells)) return NC_ERR;
+	if (!(yCellVar = grid.get_var("yCell"))) return NC_ERR;
+	if (!yCellVar->put(y,nCells)) return NC_ERR;
+	if (!(zCellVar = grid.get_var("zCell"))) return NC_ERR;
+	if (!zCellVar->put(z,nCells)) return NC_ERR;
+	if (!(idx2cellVar = grid.get_var("indexToCellID"))) return NC_ERR;
+	if (!idx2cellVar->put(idxTo,nCells)) return NC_ERR;
+	delete[] x;
+	delete[] y;
+	delete[] z;
+	delete[] lat;
+	delete[] lon;
+	delete[] idxTo;
+	
+	//Build and write edge coordinate arrays
+	x = new double[nEdges];
+	y = new double[nEdges];
+	z = new double[nEdges];
+	lat = new double[nEdges];
+	lon = new double[nEdges];
+	idxTo = new int[nEdges];
+
+	i = 0;
+	for(pnt_itr = edges.begin(); pnt_itr != edges.end(); ++pnt_itr){
+		if(!spherical){
+			x[i] = (*pnt_itr).x;
+			y[i] = (*pnt_itr).y;
+			z[i] = (*pnt_itr).z;
+			lat[i] = 0.0;
+			lon[i] = 0.0;
+		} else {
+			x[i] = (*pnt_itr).x * sphereRadius;
+			y[i] = (*pnt_itr).y * sphereRadius;
+			z[i] = (*pnt_itr).z * sphereRadius;
+			lat[i] = (*pnt_itr).getLat();
+			lon[i] = (*pnt_itr).getLon();
+		}
+		idxTo[i] = (*pnt_itr).idx+1;
+
+		i++;
+	}
+	if (!(latEdgeVar = grid.get_var("latEdge"))) return NC_ERR;
+	if (!latEdgeVar->put(lat,nEdges)) return NC_ERR;
+	if (!(lonEdgeVar = grid.get_var("lonEdge"))) return NC_ERR;
+	if (!lonEdgeVar->put(lon,nEdges)) return NC_ERR;
+	if (!(xEdgeVar = grid.get_var("xEdge"))) return NC_ERR;
+	if (!xEdgeVar->put(x,nEdges)) return NC_ERR;
+	if (!(yEdgeVar = grid.get_var("yEdge"))) return NC_ERR;
+	if (!yEdgeVar->put(y,nEdges)) return NC_ERR;
+	if (!(zEdgeVar = grid.get_var("zEdge"))) return NC_ERR;
+	if (!zEdgeVar->put(z,nEdges)) return NC_ERR;
+	if (!(idx2edgeVar = grid.get_var("indexToEdgeID"))) return NC_ERR;
+	if (!idx2edgeVar->put(idxTo, nEdges)) return NC_ERR;
+	delete[] x;
+	delete[] y;
+	delete[] z;
+	delete[] lat;
+	delete[] lon;
+	delete[] idxTo;
+
+	//Build and write vertex coordinate arrays
+	x = new double[nVertices];
+	y = new double[nVertices];
+	z = new double[nVertices];
+	lat = new double[nVertices];
+	lon = new double[nVertices];
+	idxTo = new int[nVertices];
+
+	i = 0;
+	for(pnt_itr = vertices.begin(); pnt_itr != vertices.end(); ++pnt_itr){
+		if(!spherical){
+			x[i] = (*pnt_itr).x;
+			y[i] = (*pnt_itr).y;
+			z[i] = (*pnt_itr).z;
+			lat[i] = 0.0;
+			lon[i] = 0.0;
+		} else {
+			x[i] = (*pnt_itr).x * sphereRadius;
+			y[i] = (*pnt_itr).y * sphereRadius;
+			z[i] = (*pnt_itr).z * sphereRadius;
+			lat[i] = (*pnt_itr).getLat();
+			lon[i] = (*pnt_itr).getLon();
+		}
+		idxTo[i] = (*pnt_itr).idx+1;
+
+		i++;
+	}
+	if (!(latVertexVar = grid.get_var("latVertex"))) return NC_ERR;
+	if (!latVertexVar->put(lat,nVertices)) return NC_ERR;
+	if (!(lonVertexVar = grid.get_var("lonVertex"))) return NC_ERR;
+	if (!lonVertexVar->put(lon,nVertices)) return NC_ERR;
+	if (!(xVertexVar = grid.get_var("xVertex"))) return NC_ERR;
+	if (!xVertexVar->put(x,nVertices)) return NC_ERR;
+	if (!(yVertexVar = grid.get_var("yVertex"))) return NC_ERR;
+	if (!yVertexVar->put(y,nVertices)) return NC_ERR;
+	if (!(zVertexVar = grid.get_var("zVertex"))) return NC_ERR;
+	if (!zVertexVar->put(z,nVertices)) return NC_ERR;
+	if (!(idx2vertexVar = grid.get_var("indexToVertexID"))) return NC_ERR;
+	if (!idx2vertexVar->put(idxTo, nVertices)) return NC_ERR;
+	delete[] x;
+	delete[] y;
+	delete[] z;
+	delete[] lat;
+	delete[] lon;
+	delete[] idxTo;
+
+	return 0;
+}/*}}}*/
+int outputCellConnectivity( NcFile &grid ) {/*{{{*/
+	/*****************************************************************
+	 *
+	 * This function writes all of the *OnCell arrays. Including
+	 * cellsOnCell
+	 * edgesOnCell
+	 * verticesOnCell
+	 * nEdgesonCell
+	 *
+	 * ***************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+	
+	// fetch dimensions
+	NcDim *nCellsDim = grid.get_dim( "nCells" );
+	NcDim *maxEdgesDim = grid.get_dim( "maxEdges" );
+
+	int nCells = nCellsDim->size();
+	int maxEdges = maxEdgesDim->size();
+
+	// define nc variables
+	NcVar *cocVar, *nEocVar, *eocVar, *vocVar;
+
+	// The connectivity arrays are stored as padded nCells x maxEdges blocks,
+	// so they are written directly after shifting to 1-based indices. The -1
+	// padding becomes 0.
+
+	// Write COC array
+	// cellsOnCell is still needed to write graph.info, so shift it back after writing.
+	cellsOnCell.shift(1);
+	if (!(cocVar = grid.get_var("cellsOnCell"))) return NC_ERR;
+	if (!cocVar->put(cellsOnCell.data(),nCells,maxEdges)) return NC_ERR;
+	cellsOnCell.shift(-1);
+
+	// Write EOC array
+	edgesOnCell.shift(1);
+	if (!(eocVar = grid.get_var("edgesOnCell"))) return NC_ERR;
+	if (!eocVar->put(edgesOnCell.data(),nCells,maxEdges)) return NC_ERR;
+
+	// Write VOC array 
+	verticesOnCell.shift(1);
+	if (!(vocVar = grid.get_var("verticesOnCell"))) return NC_ERR;
+	if (!vocVar->put(verticesOnCell.data(),nCells,maxEdges)) return NC_ERR;
+
+	//Write nEOC array
+	if (!(nEocVar = grid.get_var("nEdgesOnCell"))) return NC_ERR;
+	if (!nEocVar->put(edgesOnCell.sizes(),nCells)) return NC_ERR;
+	verticesOnCell.clear();
+	edgesOnCell.clear();
+
+	return 0;
+}/*}}}*/
+int outputEdgeConnectivity( NcFile &grid ) {/*{{{*/
+	/*****************************************************************
+	 *
+	 * This function writes all of the *OnEdge arrays. Including
+	 * cellsOnEdge
+	 * edgesOnEdge
+	 * verticesOnEdge
+	 * nEdgesOnEdge
+	 *
+	 * ***************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+	
+	// fetch dimensions
+	NcDim *nEdgesDim = grid.get_dim( "nEdges" );
+	NcDim *maxEdges2Dim = grid.get_dim( "maxEdges2" );
+	NcDim *vertexDegreeDim = grid.get_dim( "vertexDegree" );
+	NcDim *twoDim = grid.get_dim( "TWO" );
+
+	// define nc variables
+	NcVar *coeVar, *nEoeVar, *eoeVar, *voeVar;
+
+	int nEdges = nEdgesDim->size();
+	int maxEdges2 = maxEdges2Dim->size();
+	int vertexDegree = vertexDegreeDim->size();
+	int two = twoDim->size();
+
+	// Write EOE array
+	edgesOnEdge.shift(1);
+	if (!(eoeVar = grid.get_var("edgesOnEdge"))) return NC_ERR;
+	if (!eoeVar->put(edgesOnEdge.data(),nEdges,maxEdges2)) return NC_ERR;
+
+	// Write COE array
+	cellsOnEdge.shift(1);
+	if (!(coeVar = grid.get_var("cellsOnEdge"))) return NC_ERR;
+	if (!coeVar->put(cellsOnEdge.data(),nEdges,two)) return NC_ERR;
+
+	// Write VOE array
+	verticesOnEdge.shift(1);
+	if (!(voeVar = grid.get_var("verticesOnEdge"))) return NC_ERR;
+	if (!voeVar->put(verticesOnEdge.data(),nEdges,two)) return NC_ERR;
+	verticesOnEdge.shift(-1);
+
+	// Write nEoe array
+	if (!(nEoeVar = grid.get_var("nEdgesOnEdge"))) return NC_ERR;
+	if (!nEoeVar->put(edgesOnEdge.sizes(),nEdges)) return NC_ERR;
+
+	cellsOnEdge.clear();
+//	verticesOnEdge.clear(); // Needed for Initial conditions.
+	edgesOnEdge.clear();
+	
+	return 0;
+}/*}}}*/
+int outputVertexConnectivity( NcFile &grid ) {/*{{{*/
+	/*****************************************************************
+	 *
+	 * This function writes all of the *OnVertex arrays. Including
+	 * cellsOnVertex
+	 * edgesOnVertex
+	 *
+	 * ***************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+	
+	// fetch dimensions
+	NcDim *nVerticesDim = grid.get_dim( "nVertices" );
+	NcDim *vertexDegreeDim = grid.get_dim( "vertexDegree" );
+
+	// define nc variables
+	NcVar *covVar, *eovVar, *bdryVertVar;
+
+	int nVertices = nVerticesDim->size();
+	int vertexDegree = vertexDegreeDim->size();
+	int i;
+
+	// Write COV array
+	cellsOnVertex.shift(1);
+	if (!(covVar = grid.get_var("cellsOnVertex"))) return NC_ERR;
+	if (!covVar->put(cellsOnVertex.data(),nVertices,vertexDegree)) return NC_ERR;
+
+	// Write EOV array
+	edgesOnVertex.shift(1);
+	if (!(eovVar = grid.get_var("edgesOnVertex"))) return NC_ERR;
+	if (!eovVar->put(edgesOnVertex.data(),nVertices,vertexDegree)) return NC_ERR;
+
+	if (!(bdryVertVar = grid.get_var("boundaryVertex"))) return NC_ERR;
+	if (!bdryVertVar->put(&boundaryVertex[0], nVertices)) return NC_ERR;
+
+	cellsOnVertex.clear();
+	edgesOnVertex.clear();
+	vector<int>().swap(boundaryVertex);
+
+	return 0;
+}/*}}}*/
+int outputCellParameters( NcFile &grid ) {/*{{{*/
+	/*********************************************************
+	 *
+	 * This function writes all cell parameters, including
+	 * 	areaCell
+	 *
+	 * *******************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+	
+	// fetch dimensions
+	NcDim *nCellsDim = grid.get_dim( "nCells" );
+
+	// define nc variables
+	NcVar *areacVar;
+
+	int nCells = nCellsDim->size();
+	int i, j;
+
+	if(spherical){
+		for(i = 0; i < nCells; i ++){
+			areaCell[i] = areaCell[i] * sphereRadius * sphereRadius;
+		}
+	}
+
+	if (!(areacVar = grid.get_var("areaCell"))) return NC_ERR;
+	if (!areacVar->put(&areaCell[0],nCells)) return NC_ERR;
+
+	areaCell.clear();
+
+	return 0;
+}/*}}}*/
+int outputVertexParameters( NcFile &grid ) {/*{{{*/
+	/*********************************************************
+	 *
+	 * This function writes all vertex parameters, including
+	 * 	areaTriangle
+	 * 	kiteAreasOnVertex
+	 *
+	 * *******************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+	
+	// fetch dimensions
+	NcDim *nVerticesDim = grid.get_dim( "nVertices" );
+	NcDim *vertexDegreeDim = grid.get_dim( "vertexDegree" );
+
+	// define nc variables
+	NcVar *areatVar;
+	NcVar *kareaVar;
+
+	int nVertices = nVerticesDim->size();
+	int vertexDegree = vertexDegreeDim->size();
+	int i, j;
+
+	double *kiteAreas;
+
+	if(spherical){
+		for(i = 0; i < nVertices; i++){
+			areaTriangle[i] = areaTriangle[i] * sphereRadius * sphereRadius;
+		}
+	}
+
+	// Build and write areaTriangle
+	if (!(areatVar = grid.get_var("areaTriangle"))) return NC_ERR;
+	if (!areatVar->put(&areaTriangle[0],nVertices)) return NC_ERR;
+
+	// Build and write kiteAreasOnVertex
+	// TODO: Fix kite area for quads?
+	if(spherical){
+		for(i = 0; i < nVertices; i++){
+			kiteAreas = kiteAreasOnVertex.row(i);
+			for(j = 0; j < kiteAreasOnVertex.size(i); j++){
+				kiteAreas[j] = kiteAreas[j] * sphereRadius * sphereRadius;
+			}
+		}
+	}
+
+	if (!(kareaVar = grid.get_var("kiteAreasOnVertex"))) return NC_ERR;
+	if (!kareaVar->put(kiteAreasOnVertex.data(),nVertices,vertexDegree)) return NC_ERR;
+
+	kiteAreasOnVertex.clear();
+
+	return 0;
+}/*}}}*/
+int outputEdgeParameters( NcFile &grid ) {/*{{{*/
+	/*********************************************************
+	 *
+	 * This function writes all grid parameters, including
+	 *	angleEdge
+	 *	dcEdge
+	 *	dvEdge
+	 *	weightsOnEdge
+	 *
+	 * *******************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+	
+	// fetch dimensions
+	NcDim *nEdgesDim = grid.get_dim( "nEdges" );
+	NcDim *maxEdges2Dim = grid.get_dim( "maxEdges2" );
+
+	// define nc variables
+	NcVar *angleVar;
+	NcVar *kareaVar, *dcEdgeVar, *dvEdgeVar;
+	NcVar *woeVar;
+
+	int nEdges = nEdgesDim->size();
+	int maxEdges2 = maxEdges2Dim->size();
+	int i;
+
+	if(spherical){
+		for(i = 0; i < nEdges; i++){
+			dcEdge[i] = dcEdge[i] * sphereRadius;
+			dvEdge[i] = dvEdge[i] * sphereRadius;
+		}
+	}
+
+	//Build and write angleEdge
+	if (!(angleVar = grid.get_var("angleEdge"))) return NC_ERR;
+	if (!angleVar->put(&angleEdge[0],nEdges)) return NC_ERR;
+
+	//Build and write dcEdge
+	if (!(dcEdgeVar = grid.get_var("dcEdge"))) return NC_ERR;
+	if (!dcEdgeVar->put(&dcEdge[0],nEdges)) return NC_ERR;
+
+	//Build and write dvEdge
+	if (!(dvEdgeVar = grid.get_var("dvEdge"))) return NC_ERR;
+	if (!dvEdgeVar->put(&dvEdge[0],nEdges)) return NC_ERR;
+
+	//Write weightsOnEdge
+	if (!(woeVar = grid.get_var("weightsOnEdge"))) return NC_ERR;
+	if (!woeVar->put(weightsOnEdge.data(),nEdges,maxEdges2)) return NC_ERR;
+
+	angleEdge.clear();
+	dcEdge.clear();
+	dvEdge.clear();
+	weightsOnEdge.clear();
+
+	return 0;
+}/*}}}*/
+int outputMeshDensity( NcFile &grid ) {/*{{{*/
+	/***************************************************************************
+	 *
+	 * This function writes the meshDensity variable. Read in from the file SaveDensity
+	 *
+	 * *************************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+	
+	// fetch dimensions
+	NcDim *nCellsDim = grid.get_dim( "nCells" );
+
+	NcVar *cDensVar;
+
+	int nCells = nCellsDim->size();
+	int i, j, k;
+	int junk_int;
+	double junk_dbl;
+
+	vector<double> dbl_tmp_arr;
+
+	//Write meshDensity
+	if (!(cDensVar = grid.get_var("meshDensity"))) return NC_ERR;
+	if (!cDensVar->put(&meshDensity.at(0),nCells)) return NC_ERR;
+
+	return 0;
+}/*}}}*/
+int outputMeshQualities( NcFile &grid ) {/*{{{*/
+	/***************************************************************************
+	 *
+	 * This function writes the mesh quality variables.
+	 *		- cellQuality
+	 *		- gridSpacing
+	 *		- triangleQuality
+	 *		- triangleAnalgeQuality
+	 *		- obtuseTriangle
+	 *
+	 * *************************************************************************/
+	// Return this code to the OS in case of failure.
+	static const int NC_ERR = 2;
+	
+	// set error behaviour (matches fortran behaviour)
+	NcError err(NcError::verbose_nonfatal);
+	
+	// fetch dimensions
+	NcDim *nCellsDim = grid.get_dim( "nCells" );
+	NcDim *nVerticesDim = grid.get_dim( "nVertices" );
+
+	NcVar *cellQualityVar, *gridSpacingVar, *triangleQualityVar;
+	NcVar *triangleAngleQualityVar, *obtuseTriangleVar;
+
+	int nCells = nCellsDim->size();
+	int nVertices = nVerticesDim->size();
+	int i, j, k;
+
+	// Write cellQuality
+	if (!(cellQualityVar = grid.get_var("cellQuality"))) return NC_ERR;
+	if (!cellQualityVar->put(&cellQuality.at(0), nCells)) return NC_ERR;
+
+	// Write gridSpacing
+	if (!(gridSpacingVar = grid.get_var("gridSpacing"))) return NC_ERR;
+	if (!gridSpacingVar->put(&gridSpacing.at(0), nCells)) return NC_ERR;
+
+	// Write triangleQuality
+	if (!(triangleQualityVar = grid.get_var("triangleQuality"))) return NC_ERR;
+	if (!triangleQualityVar->put(&triangleQuality.at(0), nVertices)) return NC_ERR;
+
+	// Write triangleAngleQuality
+	if (!(triangleAngleQualityVar = grid.get_var("triangleAngleQuality"))) return NC_ERR;
+	if (!triangleAngleQualityVar->put(&triangleAngleQuality.at(0), nVertices)) return NC_ERR;
+
+	// Write obtuseTriangle
+	if (!(obtuseTriangleVar = grid.get_var("obtuseTriangle"))) return NC_ERR;
+	if (!obtuseTriangleVar->put(&obtuseTriangle.at(0), nVertices)) return NC_ERR;
+
+	cellQuality.clear();
+	gridSpacing.clear();
+	triangleQuality.clear();
+	triangleAngleQuality.clear();
+	obtuseTriangle.clear();
+
+	return 0;
+}/*}}}*/
+int writeGraphFile(const string outputFilename){/*{{{*/
+	ofstream graph(outputFilename.c_str());
+
+	int edgeCount = 0;
+
+	for (int iCell = 0; iCell < nCells; iCell++){
+		for ( int j = 0; j < cellsOnCell.size(iCell); j++){
+			int coc = cellsOnCell.at(iCell, j);
+
+			if ( coc >= 0 && coc < nCells ) {
+				edgeCount++;
+			}
+		}
+	}
+
+	edgeCount = edgeCount / 2;
+	graph << cells.size() << " " << edgeCount << endl;
+
+	for(int i = 0; i < cellsOnCell.size(); i++){
+		for(int j = 0; j < cellsOnCell.size(i); j++){
+			if ( cellsOnCell.at(i, j) >= 0 ) {
+				graph << cellsOnCell.at(i, j)+1 << " ";
+			}
+		}
+		graph << endl;
+	}
+
+	graph.close();
+
+	return 0;
+}/*}}}*/
+int writeGraphPartitions(const string graphFilename, const vector<int> &partitionCounts){/*{{{*/
+	/*
+	 * Writes graphFilename.part.N for every requested partition count N, so
+	 * the mesh can be decomposed without running gpmetis. The cells are split
+	 * along a Hilbert curve, which is built once for all counts.
+	 */
+	vector<int> curve;
+
+	surfaceCurveOrder(cells, spherical, curve);
+
+	return writePartitionFiles(graphFilename, curve, cellsOnCell.data(), cellsOnCell.sizes(), cellsOnCell.stride(), 0, partitionCounts);
+}/*}}}*/
+/*}}}*/
+
+string gen_random(const int len) {/*{{{*/
+	static const char alphanum[] =
+		"0123456789"
+//		"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz";
+
+	string rand_str = "";
+
+	for (int i = 0; i < len; ++i) {
+		rand_str += alphanum[rand() % (sizeof(alphanum) - 1)];
+	}
+
+	return rand_str;
+}/*}}}*/
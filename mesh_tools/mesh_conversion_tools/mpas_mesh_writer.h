@@ -0,0 +1,44 @@
+#ifndef MPAS_MESH_WRITER_H
+#define MPAS_MESH_WRITER_H
+
+#include <string>
+#include <vector>
+
+#include "netcdf_utils.h"
+
+/*
+ * Writes the mesh held by MpasMeshBuilder (see mpas_mesh_builder_state.h) to
+ * mesh.nc and graph.info. Shared by MpasMeshConverter.x and
+ * MpasMeshPipeline.x.
+ *
+ * The output functions release the builder arrays once they are written, so
+ * the mesh can only be written once, and graph.info has to be written after
+ * mesh.nc (cellsOnCell is kept for it).
+ */
+
+// Attributes of the input grid, carried into history and parent_id.
+extern std::string in_history;
+extern std::string in_file_id;
+extern std::string in_parent_id;
+
+/* Output functions {{{*/
+int writeMeshFile(const std::string outputFilename, const std::string inputFilename, const std::string toolName, const netcdf_mpas_output_format &format);
+int outputGridDimensions(NcFile &grid);
+int outputGridAttributes(NcFile &grid, const std::string outputFilename, const std::string inputFilename, const std::string toolName);
+int defineGridVariables(netcdf_mpas_output_file &grid);
+int outputGridCoordinates(NcFile &grid);
+int outputCellConnectivity(NcFile &grid);
+int outputEdgeConnectivity(NcFile &grid);
+int outputVertexConnectivity(NcFile &grid);
+int outputCellParameters(NcFile &grid);
+int outputVertexParameters(NcFile &grid);
+int outputEdgeParameters(NcFile &grid);
+int outputMeshDensity(NcFile &grid);
+int outputMeshQualities(NcFile &grid);
+int writeGraphFile(const std::string outputFilename);
+int writeGraphPartitions(const std::string graphFilename, const std::vector<int> &partitionCounts);
+/*}}}*/
+
+std::string gen_random(const int len);
+
+#endif
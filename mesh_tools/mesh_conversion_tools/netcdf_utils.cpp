@@ -2,7 +2,11 @@
 #include <string.h>
 #include <netcdfcpp.h>
 #include <cstdlib>
+#include <climits>
 #include <vector>
+#include <iostream>
+#include <algorithm>
+#include "netcdf_utils.h"
 
 using namespace std;
 
@@ -781,7 +785,7 @@ double netcdf_mpas_read_meshspec(string filename){/*{{{*/
 
 /* Dimension reading functions {{{*/
 //****************************************************************************80
-int netcdf_mpas_read_dim ( string filename, string dim_name ){/*{{{*/
+size_t netcdf_mpas_read_dim ( string filename, string dim_name ){/*{{{*/
 	//****************************************************************************80
 	//
 	//  Purpose:
@@ -812,9 +816,8 @@ int netcdf_mpas_read_dim ( string filename, string dim_name ){/*{{{*/
 	//
 	//    Input, string DIM_NAME, the name of the dimension in question
 	//
-	//    Output, int NETCDF_MPAS_READ_DIM, the value of the dimension.
+	//    Output, size_t NETCDF_MPAS_READ_DIM, the value of the dimension.
 	//
-	int ntime;
 	long int dim_size;
 	NcDim *dim_id;
 	bool valid;
@@ -851,9 +854,38 @@ int netcdf_mpas_read_dim ( string filename, string dim_name ){/*{{{*/
 	//
 	ncid.close ( );
 
-	ntime = ( int ) dim_size;
+	return ( size_t ) dim_size;
+}/*}}}*/
+int netcdf_mpas_check_dims ( const string &filename ){/*{{{*/
+	//
+	//  Returns non-zero, after printing an error, if any dimension of
+	//  filename is longer than INT_MAX. Element counts and indices are held
+	//  in int (--int64 only widens what is written), so such a mesh would
+	//  otherwise be truncated without notice.
+	//
+	int ncid, ndims, status;
+	int error = 0;
+
+	if ( ( status = nc_open ( filename.c_str ( ), NC_NOWRITE, &ncid ) ) != NC_NOERR ) {
+		cout << " ERROR: Can't open " << filename << ": " << nc_strerror ( status ) << endl;
+		return 1;
+	}
+
+	nc_inq_ndims ( ncid, &ndims );
+	for ( int dimid = 0; dimid < ndims; dimid++ ) {
+		char name[NC_MAX_NAME+1];
+		size_t len;
 
-	return ntime;
+		nc_inq_dim ( ncid, dimid, name, &len );
+		if ( len > ( size_t ) INT_MAX ) {
+			cout << " ERROR: " << name << " in " << filename << " is " << len << ", but at most "
+				<< INT_MAX << " elements are supported." << endl;
+			error = 1;
+		}
+	}
+	nc_close ( ncid );
+
+	return error;
 }/*}}}*/
 /*}}}*/
 
@@ -2617,3 +2649,292 @@ void netcdf_mpas_read_nedgesonedge ( string filename, int nedges, int nedgesoned
 
 /* }}} */
 
+
+/* Output format {{{*/
+int netcdf_mpas_parse_output_flags( int &argc, char *argv[], netcdf_mpas_output_format &format ){/*{{{*/
+	//
+	//  Pulls --format, --deflate, --shuffle, --float32 and --int64 out of
+	//  argv, so each tool can parse its remaining arguments as before. argc
+	//  is reduced to match.
+	//
+	//  Returns 0 on success, and 1 (after printing an error) on a bad flag.
+	//
+	int nArgs = 1;
+
+	for ( int i = 1; i < argc; i++ ) {
+		string str_flag = argv[i];
+
+		if ( str_flag == "--format" ) {
+			string str_format = ( i + 1 < argc ) ? argv[i+1] : "";
+
+			format.cmode_given = true;
+			if ( str_format == "64bit" ) {
+				format.cmode = NC_64BIT_OFFSET;
+#ifdef NC_64BIT_DATA
+			} else if ( str_format == "cdf5" ) {
+				format.cmode = NC_64BIT_DATA;
+#endif
+#ifdef NC_NETCDF4
+			} else if ( str_format == "netcdf4" ) {
+				format.cmode = NC_NETCDF4;
+#endif
+			} else {
+				cout << " ERROR: --format must be one of the formats supported by this netCDF library:"
+					<< " 64bit, cdf5 or netcdf4." << endl;
+				return 1;
+			}
+			i++;
+		} else if ( str_flag == "--deflate" ) {
+			if ( i + 1 >= argc || atoi(argv[i+1]) < 1 || atoi(argv[i+1]) > 9 ) {
+				cout << " ERROR: --deflate requires a level between 1 and 9." << endl;
+				return 1;
+			}
+			format.deflate_level = atoi(argv[i+1]);
+			i++;
+		} else if ( str_flag == "--shuffle" ) {
+			format.shuffle = true;
+		} else if ( str_flag == "--float32" || str_flag == "--int64" ) {
+			vector<string> &names = ( str_flag == "--float32" ) ? format.float_vars : format.int64_vars;
+			string str_names = ( i + 1 < argc ) ? argv[i+1] : "";
+			size_t start = 0;
+
+			if ( str_names == "" || str_names[0] == '-' ) {
+				cout << " ERROR: " << str_flag << " requires a comma separated list of variables." << endl;
+				return 1;
+			}
+
+			while ( start <= str_names.size() ) {
+				size_t end = str_names.find(',', start);
+				if ( end == string::npos ) end = str_names.size();
+				string name = str_names.substr(start, end - start);
+
+				//  The coordinates and metrics groups expand to the mesh
+				//  variables of each kind.
+				if ( str_flag == "--float32" && name == "coordinates" ) {
+					const char *elements[] = { "Cell", "Edge", "Vertex" };
+					const char *coordinates[] = { "lat", "lon", "x", "y", "z" };
+					for ( int e = 0; e < 3; e++ ) {
+						for ( int c = 0; c < 5; c++ ) {
+							names.push_back( string(coordinates[c]) + elements[e] );
+						}
+					}
+				} else if ( str_flag == "--float32" && name == "metrics" ) {
+					const char *metrics[] = { "areaCell", "angleEdge", "dcEdge", "dvEdge", "weightsOnEdge",
+						"areaTriangle", "kiteAreasOnVertex", "cellQuality", "gridSpacing",
+						"triangleQuality", "triangleAngleQuality", "meshDensity" };
+					names.insert( names.end(), metrics, metrics + sizeof(metrics) / sizeof(metrics[0]) );
+				} else if ( name != "" ) {
+					names.push_back(name);
+				}
+				start = end + 1;
+			}
+			i++;
+		} else {
+			argv[nArgs] = argv[i];
+			nArgs++;
+		}
+	}
+
+	argc = nArgs;
+
+#ifdef NC_NETCDF4
+	if ( ( format.deflate_level > 0 || format.shuffle ) && format.cmode != NC_NETCDF4 ) {
+#else
+	if ( format.deflate_level > 0 || format.shuffle ) {
+#endif
+		cout << " ERROR: --deflate and --shuffle require --format netcdf4." << endl;
+		return 1;
+	}
+
+	if ( ! format.int64_vars.empty() && format.cmode == NC_64BIT_OFFSET ) {
+		cout << " ERROR: --int64 requires --format cdf5 or netcdf4." << endl;
+		return 1;
+	}
+
+	return 0;
+}/*}}}*/
+int netcdf_mpas_match_input_types( const string &filename, netcdf_mpas_output_format &format ){/*{{{*/
+	//
+	//  Looks for 64-bit ints and the other types CDF5 added (unsigned ints
+	//  and bytes) among the variables of filename, before any output is
+	//  written.
+	//
+	int ncid, nvars, status;
+	bool wide_ints = false;
+	bool cdf5_types = false;
+
+	if ( ( status = nc_open ( filename.c_str ( ), NC_NOWRITE, &ncid ) ) != NC_NOERR ) {
+		cout << " ERROR: Can't open " << filename << ": " << nc_strerror ( status ) << endl;
+		return 1;
+	}
+
+	nc_inq_nvars ( ncid, &nvars );
+	for ( int varid = 0; varid < nvars; varid++ ) {
+		nc_type type;
+
+		nc_inq_vartype ( ncid, varid, &type );
+		wide_ints = wide_ints || type == NC_INT64 || type == NC_UINT64;
+		cdf5_types = cdf5_types || ( type >= NC_UBYTE && type <= NC_UINT64 );
+	}
+	nc_close ( ncid );
+
+	if ( cdf5_types && format.cmode == NC_64BIT_OFFSET ) {
+#ifdef NC_64BIT_DATA
+		if ( format.cmode_given ) {
+#endif
+			cout << " ERROR: " << filename << " has 64-bit or unsigned integer variables, which a 64bit"
+				<< " (netCDF-3 64-bit offset) file can't hold. Use --format cdf5 or netcdf4." << endl;
+			return 1;
+#ifdef NC_64BIT_DATA
+		}
+		format.cmode = NC_64BIT_DATA;
+		cout << "Writing CDF5, since " << filename << " has 64-bit or unsigned integer variables." << endl;
+#endif
+	}
+
+	if ( wide_ints ) {
+		format.int64_vars.push_back("all");
+	}
+
+	return 0;
+}/*}}}*/
+void netcdf_mpas_print_output_usage( ){/*{{{*/
+	cout << "\t\t--format 64bit|cdf5|netcdf4:" << endl;
+	cout << "\t\t\tSelects the format of the output file. The default is 64bit" << endl;
+	cout << "\t\t\t(netCDF-3 64-bit offset). cdf5 allows variables larger than 4 GB." << endl;
+	cout << "\t\t\tnetcdf4 writes an HDF5 based file, chunked along nCells, nEdges" << endl;
+	cout << "\t\t\tor nVertices." << endl;
+	cout << "\t\t--deflate level:" << endl;
+	cout << "\t\t\tCompresses every variable with deflate at the given level (1-9)." << endl;
+	cout << "\t\t\tRequires --format netcdf4." << endl;
+	cout << "\t\t--shuffle:" << endl;
+	cout << "\t\t\tApplies the shuffle filter before compression. Requires --format netcdf4." << endl;
+	cout << "\t\t--float32 var[,var...]:" << endl;
+	cout << "\t\t\tStores the listed double variables as 32-bit floats. coordinates selects" << endl;
+	cout << "\t\t\tlat/lon/x/y/z of cells, edges and vertices, metrics the lengths, areas," << endl;
+	cout << "\t\t\tweights and quality fields, and all every double variable." << endl;
+	cout << "\t\t--int64 var[,var...]:" << endl;
+	cout << "\t\t\tStores the listed int variables (all for every one) as 64-bit ints." << endl;
+	cout << "\t\t\tRequires --format cdf5 or netcdf4." << endl;
+}/*}}}*/
+/*}}}*/
+
+/* Writer session {{{*/
+int netcdf_mpas_define_storage( int ncid, int varid, const netcdf_mpas_output_format &format ){/*{{{*/
+	//
+	//  Chunks span whole rows (e.g. all maxEdges entries of a cell), and as
+	//  many rows along nCells, nEdges or nVertices as fit in CHUNK_BYTES. That
+	//  keeps chunks large enough to compress well, and small enough to fit in
+	//  the default HDF5 chunk cache. Record dimensions are chunked one record
+	//  at a time.
+	//
+	static const size_t CHUNK_BYTES = 1 << 20;
+	size_t chunks[NC_MAX_VAR_DIMS];
+	size_t row_size, nRows;
+	int dimids[NC_MAX_VAR_DIMS];
+	int ndims, unlimited, status;
+	nc_type type;
+
+	if ( ( status = nc_inq_var ( ncid, varid, NULL, &type, &ndims, dimids, NULL ) ) != NC_NOERR ) return status;
+	if ( ndims == 0 ) return NC_NOERR;
+	if ( ( status = nc_inq_type ( ncid, type, NULL, &row_size ) ) != NC_NOERR ) return status;
+	if ( ( status = nc_inq_unlimdim ( ncid, &unlimited ) ) != NC_NOERR ) return status;
+
+	for ( int d = 1; d < ndims; d++ ) {
+		if ( ( status = nc_inq_dimlen ( ncid, dimids[d], &chunks[d] ) ) != NC_NOERR ) return status;
+		row_size *= std::max( chunks[d], (size_t) 1 );
+	}
+
+	if ( dimids[0] == unlimited ) {
+		chunks[0] = 1;
+	} else {
+		// Spread the rows evenly over the chunks, since HDF5 allocates the
+		// last (partial) chunk in full.
+		if ( ( status = nc_inq_dimlen ( ncid, dimids[0], &nRows ) ) != NC_NOERR ) return status;
+		nRows = std::max( nRows, (size_t) 1 );
+		size_t maxRows = std::max( CHUNK_BYTES / row_size, (size_t) 1 );
+		size_t nChunks = ( nRows + maxRows - 1 ) / maxRows;
+		chunks[0] = ( nRows + nChunks - 1 ) / nChunks;
+	}
+
+	if ( ( status = nc_def_var_chunking ( ncid, varid, NC_CHUNKED, chunks ) ) != NC_NOERR ) return status;
+
+	if ( format.deflate_level > 0 || format.shuffle ) {
+		if ( ( status = nc_def_var_deflate ( ncid, varid, format.shuffle,
+						format.deflate_level > 0, format.deflate_level ) ) != NC_NOERR ) return status;
+	}
+
+	return NC_NOERR;
+}/*}}}*/
+nc_type netcdf_mpas_output_type( const netcdf_mpas_output_format &format, const string &name, const nc_type type ){/*{{{*/
+	const vector<string> &names = ( type == NC_DOUBLE ) ? format.float_vars : format.int64_vars;
+
+	if ( type != NC_DOUBLE && type != NC_INT ) return type;
+	if ( find(names.begin(), names.end(), "all") == names.end()
+			&& find(names.begin(), names.end(), name) == names.end() ) return type;
+
+	return ( type == NC_DOUBLE ) ? NC_FLOAT : NC_INT64;
+}/*}}}*/
+netcdf_mpas_output_file::netcdf_mpas_output_file(const string &filename, FileMode fmode,/*{{{*/
+		const netcdf_mpas_output_format &format_)
+	: NcFile( fmode == Replace ? create_empty(filename, format_.cmode) : filename.c_str(),
+			fmode == Replace ? Write : fmode ),
+	  format(format_), chunked(false)
+{
+	chunked = is_valid() && get_format() == Netcdf4;
+}/*}}}*/
+const char* netcdf_mpas_output_file::create_empty(const string &filename, const int cmode){/*{{{*/
+	//
+	//  NcFile can only create classic and 64-bit offset files, so the file is
+	//  created (and closed again) through the C interface, and then reopened
+	//  by the NcFile constructor. An empty name makes that reopen fail if the
+	//  file could not be created.
+	//
+	int ncid;
+
+	if ( NcError::set_err ( nc_create ( filename.c_str ( ), cmode | NC_CLOBBER, &ncid ) ) != NC_NOERR ) return "";
+	if ( NcError::set_err ( nc_close ( ncid ) ) != NC_NOERR ) return "";
+
+	return filename.c_str ( );
+}/*}}}*/
+NcVar* netcdf_mpas_output_file::add_var( NcToken varname, NcType type,/*{{{*/
+		const NcDim* dim0, const NcDim* dim1, const NcDim* dim2, const NcDim* dim3, const NcDim* dim4 ){
+	//
+	//  NcType has no 64-bit integer, but NcFile::add_var only hands the type
+	//  on to nc_def_var, so NC_INT64 is passed through it as is.
+	//
+	NcVar *var = NcFile::add_var(varname, (NcType) netcdf_mpas_output_type(format, varname, type),
+			dim0, dim1, dim2, dim3, dim4);
+
+	if ( var && ! set_storage ( var ) ) return 0;
+
+	return var;
+}/*}}}*/
+NcVar* netcdf_mpas_output_file::add_var( NcToken varname, NcType type, int ndims, const NcDim** dims ){/*{{{*/
+	NcVar *var = NcFile::add_var(varname, (NcType) netcdf_mpas_output_type(format, varname, type), ndims, dims);
+
+	if ( var && ! set_storage ( var ) ) return 0;
+
+	return var;
+}/*}}}*/
+NcBool netcdf_mpas_output_file::set_storage(NcVar *var){/*{{{*/
+	if ( ! chunked || var->num_dims ( ) == 0 ) return true;
+
+	return NcError::set_err ( netcdf_mpas_define_storage ( the_id, var->id ( ), format ) ) == NC_NOERR;
+}/*}}}*/
+NcBool netcdf_mpas_output_file::end_define(const size_t header_pad){/*{{{*/
+	//
+	//  Leave define mode through the netcdf-3 interface, so the header can be
+	//  padded. NcFile::data_mode() would call nc_enddef, which leaves no free
+	//  space behind the header.
+	//
+	if ( ! is_valid ( ) ) return false;
+	if ( ! in_define_mode ) return true;
+	if ( ! set_fill ( NoFill ) ) return false;
+
+	if ( NcError::set_err ( nc__enddef ( the_id, header_pad, 4, 0, 4 ) ) != NC_NOERR ) return false;
+	in_define_mode = 0;
+
+	return true;
+}/*}}}*/
+/*}}}*/
@@ -1,4 +1,8 @@
+#ifndef NETCDF_UTILS_H
+#define NETCDF_UTILS_H
+
 #include <string>
+#include <vector>
 #include <netcdfcpp.h>
 
 using namespace std;
@@ -18,7 +22,8 @@ double netcdf_mpas_read_meshspec(string filename);
 /*}}}*/
 
 /* Dimension reading functions {{{*/
-int netcdf_mpas_read_dim ( string filename, string dim_name );
+size_t netcdf_mpas_read_dim ( string filename, string dim_name );
+int netcdf_mpas_check_dims ( const string &filename );
 /*}}}*/
 
 /* Cell Reading Functions {{{*/
@@ -58,3 +63,93 @@ void netcdf_mpas_read_edgesonedge ( string filename, int nedges, int maxedges2,
 void netcdf_mpas_read_nedgesonedge ( string filename, int nedges, int nedgesonedge[] );
 /* }}} */
 
+
+/* Output format {{{*/
+/*
+ * netcdf_mpas_output_format selects how output files are created. cmode is
+ * the netCDF creation mode (64-bit offset, CDF5 or netCDF-4). For netCDF-4
+ * files every variable is chunked along its first dimension, and can be
+ * compressed with deflate (level 1-9) and the shuffle filter.
+ *
+ * float_vars lists the double variables to store as 32-bit floats, and
+ * int64_vars the int variables to store as 64-bit ints (CDF5 and netCDF-4
+ * only). "all" matches every variable. Tools keep writing doubles and ints,
+ * and netCDF converts them as they are written. cmode_given is set when
+ * --format picked cmode.
+ */
+struct netcdf_mpas_output_format {/*{{{*/
+	int cmode;
+	bool cmode_given;
+	int deflate_level;
+	bool shuffle;
+	vector<string> float_vars;
+	vector<string> int64_vars;
+
+	netcdf_mpas_output_format() : cmode(NC_64BIT_OFFSET), cmode_given(false), deflate_level(0), shuffle(false) { }
+};/*}}}*/
+
+int netcdf_mpas_parse_output_flags( int &argc, char *argv[], netcdf_mpas_output_format &format );
+void netcdf_mpas_print_output_usage( );
+
+/*
+ * Matches format to an input file whose variables are carried to the
+ * output. If the input stores any integer variable as 64-bit ints, every
+ * int variable is written as a 64-bit int, so indices keep one width. If
+ * it has types a 64-bit offset file can't hold, CDF5 is picked unless
+ * --format chose another format. Returns 0 on success, and 1 (after
+ * printing an error) if the input can't be opened or --format 64bit was
+ * given for such an input.
+ */
+int netcdf_mpas_match_input_types( const string &filename, netcdf_mpas_output_format &format );
+
+/*
+ * Sets up chunking and compression of variable varid in a netCDF-4 file
+ * opened through the C interface, as netcdf_mpas_output_file does for its
+ * own variables. Returns the netCDF status.
+ */
+int netcdf_mpas_define_storage( int ncid, int varid, const netcdf_mpas_output_format &format );
+
+/*
+ * Returns the type to define variable name with in format, for a variable
+ * the tool writes as type (NC_DOUBLE or NC_INT).
+ */
+nc_type netcdf_mpas_output_type( const netcdf_mpas_output_format &format, const string &name, const nc_type type );
+/*}}}*/
+
+/* Writer session {{{*/
+/*
+ * netcdf_mpas_output_file is an NcFile for writing tool output. Opening it
+ * with Replace creates a new, empty file in the requested format (replacing
+ * any existing file); Write reopens a file created earlier.
+ *
+ * Callers that write a whole file in one session add every dimension,
+ * attribute and variable first, then call end_define once before writing any
+ * data. end_define leaves extra free space in the header, so a later tool can
+ * add a few attributes or variables without shifting the whole data section,
+ * and turns off prefilling since every variable is written in full afterwards.
+ *
+ * In netCDF-4 files add_var also sets up chunking and compression for the new
+ * variable.
+ */
+class netcdf_mpas_output_file : public NcFile {/*{{{*/
+	public:
+		netcdf_mpas_output_file(const string &filename, FileMode fmode = Replace,
+				const netcdf_mpas_output_format &format_ = netcdf_mpas_output_format());
+
+		virtual NcVar* add_var( NcToken varname, NcType type,
+				const NcDim* dim0=0, const NcDim* dim1=0, const NcDim* dim2=0,
+				const NcDim* dim3=0, const NcDim* dim4=0 );
+		virtual NcVar* add_var( NcToken varname, NcType type, int ndims, const NcDim** dims );
+
+		NcBool end_define(const size_t header_pad);
+
+	private:
+		static const char* create_empty(const string &filename, const int cmode);
+		NcBool set_storage(NcVar *var);
+
+		netcdf_mpas_output_format format;
+		bool chunked;
+};/*}}}*/
+/*}}}*/
+
+#endif
@@ -1,58 +1,30 @@
+#ifndef PNT_H
+#define PNT_H
+
 #include <vector>
 #include <iostream>
 #include <fstream>
 #include <cmath>
 
+/*
+ * pnt is a plain x, y, z value (plus the index of the element it belongs to),
+ * so it can be copied, stored in vectors and returned from the arithmetic
+ * operators without any extra work. Latitude and longitude are not stored;
+ * getLat() and getLon() compute them from the coordinates when asked.
+ */
 class pnt {/*{{{*/
 	public:
 		double x, y, z;
-		double lat, lon;
 		int idx;
-		bool positiveLonRange;
-
-		pnt(double x_, double y_, double z_, int idx_) {
-			(*this).x = x_;
-			(*this).y = y_;
-			(*this).z = z_;
-			(*this).idx = idx_;
-			(*this).positiveLonRange = true;
-			(*this).buildLat();
-			(*this).buildLon();
-		}
-
-		pnt(double x_, double y_, double z_) {
-			(*this).x = x_;
-			(*this).y = y_;
-			(*this).z = z_;
-			(*this).idx = 0;
-			(*this).positiveLonRange = true;
-			(*this).buildLat();
-			(*this).buildLon();
-		}
 
-		pnt() {
-			(*this).x = 0.0;
-			(*this).y = 0.0;
-			(*this).z = 0.0;
-			(*this).idx = 0;
-			(*this).positiveLonRange = true;
-			(*this).lat = 0.0;
-			(*this).lon = 0.0;
-		}
+		pnt(double x_, double y_, double z_, int idx_) : x(x_), y(y_), z(z_), idx(idx_) { }
+		pnt(double x_, double y_, double z_) : x(x_), y(y_), z(z_), idx(0) { }
+		pnt() : x(0.0), y(0.0), z(0.0), idx(0) { }
 
 		friend pnt operator*(const double d, const pnt &p);
 		friend std::ostream & operator<<(std::ostream &os, const pnt &p);
 		friend std::istream & operator>>(std::istream &is, pnt &p);
 
-		pnt& operator=(const pnt &p){/*{{{*/
-			x = p.x;
-			y = p.y;
-			z = p.z;
-			idx = p.idx;
-			(*this).buildLat();
-			(*this).buildLon();
-			return *this;
-		}/*}}}*/
 		bool operator==(const pnt &p) const {/*{{{*/
 			return (x == p.x) & (y == p.y) & (z == p.z);
 		}/*}}}*/
@@ -175,13 +147,13 @@ class pnt {/*{{{*/
 
 			if(fabs(dist_vec.x) > xRef * 0.6){
 #ifdef _DEBUG
-				std::cout << "   Fixing x periodicity " << endl;
+				std::cout << "   Fixing x periodicity " << std::endl;
 #endif
 				(*this).x += -(dist_vec.x/fabs(dist_vec.x)) * xRef;
 			}
 			if(fabs(dist_vec.y) > yRef * 0.6){
 #ifdef _DEBUG
-				std::cout << "   Fixing y periodicity " << endl;
+				std::cout << "   Fixing y periodicity " << std::endl;
 #endif
 				(*this).y += -(dist_vec.y/fabs(dist_vec.y)) * yRef;
 			}
@@ -216,58 +188,43 @@ class pnt {/*{{{*/
 			y = y_;
 			z = z_;
 		}/*}}}*/
-		void setPositiveLonRange(bool value){/*{{{*/
-			(*this).positiveLonRange = value;
-			(*this).buildLon();
-		}/*}}}*/
 		double getLat() const {/*{{{*/
-			return (*this).lat;
-		}/*}}}*/
-		double getLon() const {/*{{{*/
-			return (*this).lon;
-		}/*}}}*/
-		void buildLat() {/*{{{*/
-			double dl;
-
-			dl = sqrt((*this).x*(*this).x + (*this).y*(*this).y + (*this).z*(*this).z);
-			(*this).lat = asin(z/dl);
+			return asin(z / magnitude());
 		}/*}}}*/
-		void buildLon() {/*{{{*/
+		double getLon(const bool positiveLonRange = true) const {/*{{{*/
 			double lon;
 
 			lon = atan2(y, x);
 
 			// If the prime meridian is the minimum, this means the degree
 			// range is 0-360, so we need to translate.
-			if ( (*this).positiveLonRange ) {
+			if ( positiveLonRange ) {
 				if(lon < 0.0) {
 					lon = 2.0*M_PI + lon;
 				}
 			}
 
-			(*this).lon = lon;
+			return lon;
 		}/*}}}*/
 		double sphereDistance(const pnt &p) const {/*{{{*/
-			double arg;
-
-			arg = sqrt( powf(sin(0.5*((*this).getLat()-p.getLat())),2) +
-					cos(p.getLat())*cos((*this).getLat())*powf(sin(0.5*((*this).getLon()-p.getLon())),2));
-			return 2.0*asin(arg);
-
 			/*
-			pnt temp, cross;
-			double dot;
-			temp.x = x;
-			temp.y = y;
-			temp.z = z;
-
-			cross = temp.cross(p);
-			dot = temp.dot(p);
-
+			 * Great circle distance between the directions of the two points,
+			 * using the haversine formula in Cartesian form: half the chord
+			 * between the unit vectors is the sine of half the angle.
+			 */
+			double na, nb, dx, dy, dz, arg;
 
+			na = (*this).magnitude();
+			nb = p.magnitude();
+			dx = x/na - p.x/nb;
+			dy = y/na - p.y/nb;
+			dz = z/na - p.z/nb;
 
-			return atan2(cross.magnitude(),dot);
-			// */
+			arg = 0.5 * sqrt(dx*dx + dy*dy + dz*dz);
+			if(arg > 1.0){
+				arg = 1.0;
+			}
+			return 2.0*asin(arg);
 		}/*}}}*/
 	struct hasher {/*{{{*/
 		size_t operator()(const pnt &p) const {
@@ -307,7 +264,7 @@ inline std::istream & operator>>(std::istream &is, pnt &p){/*{{{*/
 }/*}}}*/
 
 /* Geometric utility functions {{{ */
-pnt gcIntersect(const pnt &c1, const pnt &c2, const pnt &v1, const pnt &v2){/*{{{*/
+inline pnt gcIntersect(const pnt &c1, const pnt &c2, const pnt &v1, const pnt &v2){/*{{{*/
 	/*
 	 * gcIntersect is intended to compute the intersection of two great circles.
 	 *   The great circles pass through the point sets c1-c2 and v1-v2.
@@ -371,7 +328,7 @@ pnt gcIntersect(const pnt &c1, const pnt &c2, const pnt &v1, const pnt &v2){/*{{
 	c.normalize();
 	return c;
 }/*}}}*/
-pnt planarIntersect(const pnt &c1, const pnt &c2, const pnt &v1, const pnt &v2){/*{{{*/
+inline pnt planarIntersect(const pnt &c1, const pnt &c2, const pnt &v1, const pnt &v2){/*{{{*/
 	/*
 	 * planarIntersect is intended to compute the point of intersection
 	 *    of the lines c1-c2 and v1-v2 in a plane.
@@ -392,7 +349,7 @@ pnt planarIntersect(const pnt &c1, const pnt &c2, const pnt &v1, const pnt &v2){
 	return c;
 }/*}}}*/
 
-double planarTriangleArea(const pnt &A, const pnt &B, const pnt &C){/*{{{*/
+inline double planarTriangleArea(const pnt &A, const pnt &B, const pnt &C){/*{{{*/
 	/*
 	 * planarTriangleArea uses Heron's formula to compute the area of a triangle in a plane.
 	 */
@@ -413,7 +370,7 @@ double planarTriangleArea(const pnt &A, const pnt &B, const pnt &C){/*{{{*/
 
 	return sqrt(s * (s - a) * (s - b) * (s - c));
 }/*}}}*/
-double sphericalTriangleArea(const pnt &A, const pnt &B, const pnt &C){/*{{{*/
+inline double sphericalTriangleArea(const pnt &A, const pnt &B, const pnt &C){/*{{{*/
 	/*
 	 * sphericalTriangleArea uses the spherical analog of Heron's formula to compute
 	 *    the area of a triangle on the surface of a sphere.
@@ -432,7 +389,7 @@ double sphericalTriangleArea(const pnt &A, const pnt &B, const pnt &C){/*{{{*/
 	return e;
 }/*}}}*/
 
-double planeAngle(const pnt &A, const pnt &B, const pnt &C, const pnt &n){/*{{{*/
+inline double planeAngle(const pnt &A, const pnt &B, const pnt &C, const pnt &n){/*{{{*/
 	/*
 	 * planeAngle computes the angles between the vectors AB and AC in a plane defined with
 	 *    the normal vector n
@@ -492,7 +449,7 @@ double planeAngle(const pnt &A, const pnt &B, const pnt &C, const pnt &n){/*{{{*
 		return -acos(cos_angle);
 	}
 }/*}}}*/
-pnt pntFromLatLon(const double &lat, const double &lon){/*{{{*/
+inline pnt pntFromLatLon(const double &lat, const double &lon){/*{{{*/
 	/*
 	 * pntFromLatLon constructs a point location in 3-Space
 	 *    from an initial latitude and longitude location.
@@ -502,8 +459,8 @@ pnt pntFromLatLon(const double &lat, const double &lon){/*{{{*/
 	temp.y = sin(lon) * cos(lat);
 	temp.z = sin(lat);
 	temp.normalize();
-	temp.buildLat();
-	temp.buildLon();
 	return temp;
 }/*}}}*/
 /*}}}*/
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <vector>
+#include <algorithm>
+#include <inttypes.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * radixSortKeys sorts keys in ascending order and applies the same permutation
+ * to values. The sort is a least significant digit radix sort on 8 bit digits,
+ * so it is stable: equal keys keep their original relative order.
+ *
+ * Each pass builds per-thread digit histograms over contiguous chunks of the
+ * input, and scatters each chunk in thread order, so the result does not
+ * depend on the number of OpenMP threads. Passes where every key has the same
+ * digit are skipped, which makes narrow keys (e.g. packed 32 bit indices)
+ * cheap to sort.
+ */
+inline void radixSortKeys(std::vector<uint64_t> &keys, std::vector<int> &values){/*{{{*/
+	const int RADIX_BITS = 8;
+	const int RADIX = 1 << RADIX_BITS;
+	const size_t n = keys.size();
+	int maxThreads = 1;
+	int nThreads = 1;
+	bool skipPass = false;
+
+#ifdef _OPENMP
+	maxThreads = omp_get_max_threads();
+#endif
+
+	std::vector<uint64_t> keyBuf(n);
+	std::vector<int> valueBuf(n);
+	std::vector<size_t> offsets((size_t)maxThreads * RADIX);
+
+	for(int shift = 0; shift < 64; shift += RADIX_BITS){
+		std::fill(offsets.begin(), offsets.end(), 0);
+
+		#pragma omp parallel default(shared)
+		{
+			int tid = 0;
+#ifdef _OPENMP
+			tid = omp_get_thread_num();
+			#pragma omp single
+			nThreads = omp_get_num_threads();
+#endif
+			size_t start = n * tid / nThreads;
+			size_t end = n * (tid + 1) / nThreads;
+			size_t *localOffsets = &offsets[(size_t)tid * RADIX];
+
+			for(size_t i = start; i < end; i++){
+				localOffsets[(keys[i] >> shift) & (RADIX - 1)]++;
+			}
+
+			#pragma omp barrier
+
+			#pragma omp single
+			{
+				// Exclusive prefix sum in (digit, thread) order keeps the sort stable.
+				size_t offset = 0;
+				skipPass = false;
+				for(int d = 0; d < RADIX; d++){
+					size_t digitCount = 0;
+					for(int t = 0; t < nThreads; t++){
+						size_t count = offsets[(size_t)t * RADIX + d];
+						offsets[(size_t)t * RADIX + d] = offset;
+						offset += count;
+						digitCount += count;
+					}
+					if(digitCount == n){
+						skipPass = true;
+					}
+				}
+			}
+
+			if(!skipPass){
+				for(size_t i = start; i < end; i++){
+					size_t dest = localOffsets[(keys[i] >> shift) & (RADIX - 1)]++;
+					keyBuf[dest] = keys[i];
+					valueBuf[dest] = values[i];
+				}
+			}
+		}
+
+		if(!skipPass){
+			keys.swap(keyBuf);
+			values.swap(valueBuf);
+		}
+	}
+}/*}}}*/
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef STAGE_PROFILER_H
+#define STAGE_PROFILER_H
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * stage_profiler records the wall time, CPU time (user + system, summed over
+ * all threads), and peak resident set size of each stage of a tool, along with
+ * the number of elements the stage processed, so throughput can be compared
+ * between releases.
+ *
+ * Each stage costs two clock reads and two getrusage calls, so profiling is
+ * always on. report() prints a table to stdout, and write_json() writes the
+ * same numbers for scripts, when a --profile file was requested.
+ *
+ * Stages should not overlap: start() begins a stage and stop() ends the
+ * current one.
+ */
+class stage_profiler {/*{{{*/
+	public:
+		stage_profiler() : running(false) {/*{{{*/
+			sample(toolStart);
+		}/*}}}*/
+
+		void start(const std::string &name){/*{{{*/
+			current.name = name;
+			running = true;
+			sample(stageStart);
+		}/*}}}*/
+		void stop(const long long elements = 0, const std::string &elementType = ""){/*{{{*/
+			usage now;
+
+			if(!running){
+				return;
+			}
+
+			sample(now);
+			current.wall = now.wall - stageStart.wall;
+			current.cpu = now.cpu - stageStart.cpu;
+			current.peakRSS = now.peakRSS;
+			current.elements = elements;
+			current.elementType = elementType;
+			stages.push_back(current);
+			running = false;
+		}/*}}}*/
+		void append(const stage_profiler &other){/*{{{*/
+			// Adds the stages of a profiler that timed part of this tool,
+			// e.g. the mask creator stages run by MpasMeshPipeline.x.
+			stages.insert(stages.end(), other.stages.begin(), other.stages.end());
+		}/*}}}*/
+
+		void report(std::ostream &out) const {/*{{{*/
+			usage now;
+			std::ios::fmtflags flags = out.flags();
+			std::streamsize precision = out.precision();
+
+			sample(now);
+
+			out << std::endl << "Stage profile (" << threads() << " threads):" << std::endl;
+			out << "  " << std::left << std::setw(36) << "stage" << std::right
+				<< std::setw(11) << "wall (s)" << std::setw(11) << "cpu (s)"
+				<< std::setw(14) << "peak RSS (MB)" << std::setw(14) << "elements/s" << std::endl;
+
+			out << std::fixed;
+			for(size_t i = 0; i < stages.size(); i++){
+				const stage &s = stages[i];
+
+				out << "  " << std::left << std::setw(36) << s.name << std::right
+					<< std::setprecision(3) << std::setw(11) << s.wall << std::setw(11) << s.cpu
+					<< std::setprecision(1) << std::setw(14) << s.peakRSS;
+				if(s.elements > 0 && s.wall > 0.0){
+					out << std::setprecision(0) << std::setw(14) << s.elements / s.wall << " " << s.elementType;
+				}
+				out << std::endl;
+			}
+
+			out << "  " << std::left << std::setw(36) << "total" << std::right
+				<< std::setprecision(3) << std::setw(11) << now.wall - toolStart.wall << std::setw(11) << now.cpu - toolStart.cpu
+				<< std::setprecision(1) << std::setw(14) << now.peakRSS << std::endl << std::endl;
+
+			out.flags(flags);
+			out.precision(precision);
+		}/*}}}*/
+		int write_json(const std::string &filename, const std::string &tool) const {/*{{{*/
+			usage now;
+			std::ofstream out(filename.c_str());
+
+			if(!out){
+				std::cout << " ERROR: Could not open profile file " << filename << std::endl;
+				return 1;
+			}
+
+			sample(now);
+
+			out << std::setprecision(9);
+			out << "{" << std::endl;
+			out << "  \"tool\": \"" << tool << "\"," << std::endl;
+			out << "  \"threads\": " << threads() << "," << std::endl;
+			out << "  \"stages\": [" << std::endl;
+			for(size_t i = 0; i < stages.size(); i++){
+				const stage &s = stages[i];
+
+				out << "    {\"name\": \"" << s.name << "\""
+					<< ", \"wall_seconds\": " << s.wall
+					<< ", \"cpu_seconds\": " << s.cpu
+					<< ", \"peak_rss_mb\": " << s.peakRSS
+					<< ", \"elements\": " << s.elements
+					<< ", \"element_type\": \"" << s.elementType << "\""
+					<< ", \"elements_per_second\": " << ((s.elements > 0 && s.wall > 0.0) ? s.elements / s.wall : 0.0)
+					<< "}" << ((i + 1 < stages.size()) ? "," : "") << std::endl;
+			}
+			out << "  ]," << std::endl;
+			out << "  \"total\": {\"wall_seconds\": " << now.wall - toolStart.wall
+				<< ", \"cpu_seconds\": " << now.cpu - toolStart.cpu
+				<< ", \"peak_rss_mb\": " << now.peakRSS << "}" << std::endl;
+			out << "}" << std::endl;
+
+			return 0;
+		}/*}}}*/
+
+	private:
+		struct usage {
+			double wall, cpu, peakRSS;
+		};
+		struct stage {
+			std::string name, elementType;
+			double wall, cpu, peakRSS;
+			long long elements;
+		};
+
+		std::vector<stage> stages;
+		stage current;
+		usage toolStart, stageStart;
+		bool running;
+
+		static void sample(usage &u){/*{{{*/
+			struct timespec ts;
+			struct rusage ru;
+
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			getrusage(RUSAGE_SELF, &ru);
+
+			u.wall = ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+			u.cpu = ru.ru_utime.tv_sec + 1.0e-6 * ru.ru_utime.tv_usec
+				+ ru.ru_stime.tv_sec + 1.0e-6 * ru.ru_stime.tv_usec;
+#ifdef __APPLE__
+			u.peakRSS = ru.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+			u.peakRSS = ru.ru_maxrss / 1024.0; // kilobytes
+#endif
+		}/*}}}*/
+		static int threads(){/*{{{*/
+#ifdef _OPENMP
+			return omp_get_max_threads();
+#else
+			return 1;
+#endif
+		}/*}}}*/
+};/*}}}*/
+
+inline int parseProfileFlags(int &argc, char *argv[], std::string &filename){/*{{{*/
+	/*
+	 * Removes "--profile file" from argv, in the same way as
+	 * netcdf_mpas_parse_output_flags. Returns non-zero if the file name is
+	 * missing.
+	 */
+	int nKept = 1;
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "--profile") != 0){
+			argv[nKept++] = argv[i];
+			continue;
+		}
+
+		if(i + 1 >= argc){
+			std::cout << " ERROR: --profile requires an output file name." << std::endl;
+			return 1;
+		}
+		filename = argv[++i];
+	}
+
+	argc = nKept;
+	return 0;
+}/*}}}*/
+inline void printProfileUsage(){/*{{{*/
+	std::cout << "\t\t--profile file:" << std::endl;
+	std::cout << "\t\t\tWrite the per-stage wall time, CPU time, peak memory" << std::endl;
+	std::cout << "\t\t\tand throughput, also printed at the end of the run," << std::endl;
+	std::cout << "\t\t\tto file as JSON." << std::endl;
+}/*}}}*/
+
+#endif
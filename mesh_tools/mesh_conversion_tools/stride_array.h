@@ -0,0 +1,142 @@
+#ifndef STRIDE_ARRAY_H
+#define STRIDE_ARRAY_H
+
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+/*
+ * stride_array stores a ragged connectivity table (e.g. verticesOnCell) as a
+ * single contiguous nRows x stride block, plus a count of valid entries per
+ * row. Unused slots hold a fill value (-1 for index tables), so the block has
+ * exactly the layout of the padded 2D arrays in an MPAS mesh file and can be
+ * handed to NetCDF without building a temporary.
+ *
+ * The stride has to be known before a row is filled. Callers typically count
+ * entries per row first, then resize and push_back.
+ */
+template <class T>
+class stride_array {/*{{{*/
+	public:
+		stride_array() : nRows(0), rowStride(0), fillValue() { }
+
+		void resize(const int nRows_, const int stride_, const T fill){/*{{{*/
+			nRows = nRows_;
+			rowStride = stride_;
+			fillValue = fill;
+			values.assign((size_t)nRows * rowStride, fill);
+			counts.assign(nRows, 0);
+		}/*}}}*/
+		void clear(){/*{{{*/
+			nRows = 0;
+			rowStride = 0;
+			std::vector<T>().swap(values);
+			std::vector<int>().swap(counts);
+		}/*}}}*/
+
+		int size() const { return nRows; }
+		int size(const int i) const { return counts[i]; }
+		int stride() const { return rowStride; }
+		T fill() const { return fillValue; }
+
+		T& at(const int i, const int j){/*{{{*/
+			assert(j >= 0 && j < counts[i]);
+			return values[(size_t)i * rowStride + j];
+		}/*}}}*/
+		const T& at(const int i, const int j) const {/*{{{*/
+			assert(j >= 0 && j < counts[i]);
+			return values[(size_t)i * rowStride + j];
+		}/*}}}*/
+		T* row(const int i) { return &values[(size_t)i * rowStride]; }
+
+		void push_back(const int i, const T v){/*{{{*/
+			assert(counts[i] < rowStride);
+			values[(size_t)i * rowStride + counts[i]] = v;
+			counts[i]++;
+		}/*}}}*/
+		void set_size(const int i, const int n){/*{{{*/
+			// Truncating or growing a row resets the affected slots to the fill value.
+			assert(n >= 0 && n <= rowStride);
+			for(int j = std::min(n, counts[i]); j < std::max(n, counts[i]); j++){
+				values[(size_t)i * rowStride + j] = fillValue;
+			}
+			counts[i] = n;
+		}/*}}}*/
+		void clear_row(const int i){ set_size(i, 0); }
+
+		void shift(const T delta){/*{{{*/
+			// Adds delta to every slot, including padding. Used to move index
+			// tables between C (0-based) and Fortran (1-based) numbering, in
+			// which case the -1 fill value becomes the 0 MPAS expects.
+			for(size_t k = 0; k < values.size(); k++){
+				values[k] += delta;
+			}
+			fillValue += delta;
+		}/*}}}*/
+
+		void permute_rows(const std::vector<int> &order){/*{{{*/
+			// Row i becomes old row order[i]. Entries are left untouched.
+			assert((int)order.size() == nRows);
+			select_rows(order);
+		}/*}}}*/
+		void select_rows(const std::vector<int> &order){/*{{{*/
+			// Like permute_rows, but order may list only some of the rows.
+			// The others are dropped, as when a mesh is culled.
+			const int nSelected = order.size();
+			std::vector<T> permutedValues((size_t)nSelected * rowStride);
+			std::vector<int> permutedCounts(nSelected);
+
+			assert(nSelected <= nRows);
+			#pragma omp parallel for default(shared)
+			for(int i = 0; i < nSelected; i++){
+				std::copy(values.begin() + (size_t)order[i] * rowStride,
+						values.begin() + (size_t)(order[i] + 1) * rowStride,
+						permutedValues.begin() + (size_t)i * rowStride);
+				permutedCounts[i] = counts[order[i]];
+			}
+
+			nRows = nSelected;
+			values.swap(permutedValues);
+			counts.swap(permutedCounts);
+		}/*}}}*/
+		void restride(const int stride_){/*{{{*/
+			// Changes the stride, e.g. when culling lowers maxEdges. Rows
+			// longer than the new stride are truncated.
+			std::vector<T> restrided((size_t)nRows * stride_, fillValue);
+
+			#pragma omp parallel for default(shared)
+			for(int i = 0; i < nRows; i++){
+				counts[i] = std::min(counts[i], stride_);
+				std::copy(values.begin() + (size_t)i * rowStride,
+						values.begin() + (size_t)i * rowStride + counts[i],
+						restrided.begin() + (size_t)i * stride_);
+			}
+
+			rowStride = stride_;
+			values.swap(restrided);
+		}/*}}}*/
+		void renumber(const std::vector<int> &oldToNew){/*{{{*/
+			// Maps every valid index entry through oldToNew. Negative entries
+			// (missing neighbours) and padding are left as they are.
+			#pragma omp parallel for default(shared)
+			for(int i = 0; i < nRows; i++){
+				for(int j = 0; j < counts[i]; j++){
+					T &v = values[(size_t)i * rowStride + j];
+					if(v >= 0 && v < (T)oldToNew.size()){
+						v = oldToNew[v];
+					}
+				}
+			}
+		}/*}}}*/
+
+		T* data() { return values.empty() ? NULL : &values[0]; }
+		int* sizes() { return counts.empty() ? NULL : &counts[0]; }
+
+	private:
+		int nRows, rowStride;
+		T fillValue;
+		std::vector<T> values;
+		std::vector<int> counts;
+};/*}}}*/
+
+#endif